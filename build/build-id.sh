@@ -0,0 +1,18 @@
+#!/bin/bash
+#
+# Prints the build ID of the loader (see src/common/BUMBuildId.h): a digest
+# of the loader sources and of the files that hold its build defines (the
+# platform description and the module description), followed by any extra
+# compiler flags given as arguments. Builds from the same sources and defines
+# get the same ID, and any change to either gets another.
+#
+# Run from the top of the repository.
+
+set -o errexit
+set -o pipefail
+
+{
+    find src/loader src/common -type f | LC_ALL=C sort | xargs cat
+    cat BootUpdateManager.dsc src/BootUpdateManager.inf
+    echo "$*"
+} | sha256sum | cut -c1-48
@@ -19,34 +19,19 @@ function ExecutableTarget () {
 }
 
 function Loader () {
+    # The build ID tells the root BUM that a configuration BUM is a copy
+    local build_id
+    build_id=$(./build/build-id.sh)
     cd /home/edge/edk2
     export EDK_TOOLS_PATH=/home/edge/edk2/BaseTools
     . ./edksetup.sh BaseTools
-    build -a X64 -p BootUpdateManager/BootUpdateManager.dsc -b RELEASE -t GCC5 -n 64
+    build -a X64 -p BootUpdateManager/BootUpdateManager.dsc -b RELEASE -t GCC5 -n 64 \
+        -D BUM_BUILD_ID=${build_id}
 }
 
-function StaticLib() {
-
-    export cc_flags='-static -c -Wall'
-    export post_build='mv *.o $(arch_dir); ar r $(arch_dir)/lib${NAME}.a.${VERSION} $(arch_dir)/*.o'
-    make -f build/Makefile.gcc
-
-}
-
-function SharedLib() {
-
-    export cc_flags='-fPIC -g -c -Wall'
-    export post_build='mv *.o $(arch_dir)'
-    make -f build/Makefile.gcc
-    export post_build=''
-
-    export cc_flags="-shared -Wl,-soname,lib${NAME}.so.${VERSION%%.*} -o \$(arch_dir)/lib${NAME}.so.${VERSION}"
-    export source_files='$(arch_dir)/*.o'
-    export ld_flags='-lc'
-    export post_build='rm $(arch_dir)/*.o'
-    make -f build/Makefile.gcc
-    
-
+function Library () {
+    export cc_flags='-Wall'
+    make -f build/Makefile.gcc lib
 }
 
 case "$BUILD_TYPE" in
@@ -60,16 +45,10 @@ case "$BUILD_TYPE" in
         ExecutableTarget
         Loader
     ;;
-#    static-library) 
-#        StaticLib
-#    ;;
-#    shared-library)
-#        SharedLib
-#    ;;
-#    dynamic-library) 
-#        DynamicLib
-#    ;;
+    library)
+        Library
+    ;;
     *)
-        echo "Usage: $0 {executable|static-library|shared-library|dynamic-library}"
+        echo "Usage: $0 {executable|loader|library|all}"
         exit 1
 esac
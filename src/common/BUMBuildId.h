@@ -0,0 +1,38 @@
+/* BUMBuildId.h - The build-ID record embedded in a BUM image.
+ *
+ *                A BUM finds its own record through the PE section table:
+ *                the record's offset from the image base is its RVA, and the
+ *                section holding that RVA gives its place in an image file.
+ *                A configuration BUM whose file holds the same record at that
+ *                place is a copy of the running BUM, and only the record has
+ *                to be read to tell.
+ *
+ *                The build defines BUM_BUILD_ID as the Id, a token (not a
+ *                string) such as the digest build/build-id.sh makes of the
+ *                loader sources and build defines. A build time would not
+ *                do: reproducible builds share it, and so do variants built
+ *                in the same second, and a false match runs the root BUM's
+ *                own code instead of the configuration BUM.
+ *                BootUpdateManager.c, which defines the record, does not
+ *                build without it. The deferred boot trace (BootTrace.h)
+ *                names the image holding its format strings by the Id.
+ */
+
+#ifndef __BUM_BUILD_ID__
+#define __BUM_BUILD_ID__
+
+#define BUMBUILDID_MAGIC    (0x4449444C424D5542ULL) /* "BUMBLDID" */
+#define BUMBUILDID_IDLEN    (56)
+
+#define BUMBUILDID_STR(Id)      #Id
+#define BUMBUILDID_STRING(Id)   BUMBUILDID_STR(Id)
+
+typedef struct {
+    UINT64  Magic;
+    CHAR8   Id[BUMBUILDID_IDLEN];
+} BUM_buildId_t;
+
+/*  The record of the running BUM, defined in BootUpdateManager.c */
+extern CONST BUM_buildId_t gBUMBuildId;
+
+#endif
@@ -0,0 +1,54 @@
+/* BUMContext.h - The BUM context handed by a BUM to the image it starts (a
+ *                configuration BUM or a payload), installed on the started
+ *                image's handle as the BUM context protocol.
+ *
+ *                The context is read with gBS->HandleProtocol on the image's
+ *                own handle; no runtime service is involved. It names the
+ *                configuration being booted, the kind of image, the boot
+ *                attempt of the default configuration, and the boot-phase
+ *                timeline recorded so far (see BootTimeline.h), whose
+ *                TicksPerUs and first mark anchor the payload's own timing
+ *                to the start of the root BUM.
+ *
+ *                Include after BUMState.h and BootTimeline.h.
+ */
+
+#ifndef __BUM_CONTEXT__
+#define __BUM_CONTEXT__
+
+/*  e1ec02f6-68a3-4b3c-89dd-41e2187a9463 */
+#define BUMCONTEXT_PROTOCOL_GUID \
+    { 0xE1EC02F6, 0x68A3, 0x4B3C, \
+        { 0x89, 0xDD, 0x41, 0xE2, 0x18, 0x7A, 0x94, 0x63 } }
+
+#define BUMCONTEXT_MAGIC        (0x5458544E434D5542ULL) /* "BUMCNTXT" */
+#define BUMCONTEXT_VERSION      (0)
+
+/* The started image */
+#define BUMCONTEXT_IMAGE_CFGBUM (1)     /* a configuration BUM */
+#define BUMCONTEXT_IMAGE_CFGPLD (2)     /* the payload of a configuration */
+
+/*  BootAttempt counts the boots of the default configuration since it last
+    came up, starting at 1; it is zero when the alternate is booted. */
+typedef struct {
+    UINT64          Magic;
+    UINT32          Version;
+    UINT32          Size;
+    UINT32          ImageType;
+    UINT32          Reserved;
+    UINT64          BootAttempt;
+    CHAR8           Config[BUMSTATE_CONFIG_MAXLEN];
+    BOOTTIME_boot_t Timeline;
+} BUM_context_t;
+
+static inline BOOLEAN BUMContext_isValid(IN  BUM_context_t  *Context)
+{
+    return  (BUMCONTEXT_MAGIC == Context->Magic) &&
+            (BUMCONTEXT_VERSION == Context->Version) &&
+            (sizeof(BUM_context_t) == Context->Size) &&
+            ( (BUMCONTEXT_IMAGE_CFGBUM == Context->ImageType) ||
+              (BUMCONTEXT_IMAGE_CFGPLD == Context->ImageType) ) &&
+            (Context->Timeline.MarkCount <= BOOTTIME_MARKS_MAX);
+}
+
+#endif
@@ -12,9 +12,7 @@
 */
 #include "__BUMState.h"
 
-#define ASTATE_FILENAME "A.state"
-#define BSTATE_FILENAME "B.state"
-
+/*  Version 0: the UINT64 words of the state add up to zero */
 static UINT64 BUMState_GetSum(  IN  BUM_state_t *state_p)
 {
     UINT64 *buffer, len, i, sum;
@@ -24,31 +22,220 @@ static UINT64 BUMState_GetSum(  IN  BUM_state_t *state_p)
     return sum;
 }
 
+/*  Version 1: Checksum is the CRC32C of the state with Checksum set to zero */
+static UINT64 BUMState_GetCrc(  IN  BUM_state_t *state_p)
+{
+    UINT64 saved, crc;
+    saved = state_p->Checksum;
+    state_p->Checksum = 0;
+    crc = Common_Crc32c(state_p, state_p->StateSize);
+    state_p->Checksum = saved;
+    return crc;
+}
+
+/*  Sets the checksum of the version the state has. A state is written in
+    the version it was read as, so that a root BUM older than version 1
+    still reads a version 0 state after an update; only BUMState_Init
+    writes a new state, in BUMSTATE_VERSION. */
 static VOID BUMState_SetSum(IN  BUM_state_t *state_p)
 {
-    UINT64 sum;
-    state_p->Checksum=0;
-    sum = BUMState_GetSum(state_p);
-    state_p->Checksum = -sum;
+    if(0 == state_p->Version){
+        state_p->Checksum = 0;
+        state_p->Checksum = -BUMState_GetSum(state_p);
+    }else
+        state_p->Checksum = BUMState_GetCrc(state_p);
+}
+
+/*  A journal record's Checksum is the CRC32C of the record with Checksum set
+    to zero */
+static UINT32 BUMState_GetRecordCrc(IN  BUM_state_record_t  *record_p)
+{
+    BUM_state_record_t record;
+    CopyMem(&record, record_p, sizeof(record));
+    record.Checksum = 0;
+    return Common_Crc32c(&record, sizeof(record));
+}
+
+static BOOLEAN BUMState_SumInvalid(IN  BUM_state_t *state_p)
+{
+    BOOLEAN invalid;
+    switch(state_p->Version){
+        case 0:
+            invalid = (0 != BUMState_GetSum(state_p));
+            break;
+        case 1:
+            invalid = (state_p->Checksum != BUMState_GetCrc(state_p));
+            break;
+        default:
+            /*  A newer format this code can not check */
+            invalid = TRUE;
+            break;
+    }
+    return invalid;
+}
+
+EFI_STATUS EFIAPI BUMState_Check(   IN  BUM_state_t *BUM_state_p,
+                                    IN  UINTN       BufferSize)
+{
+    /*  Check the size */
+    if( (BufferSize < sizeof(BUM_state_t)) ||
+        (BufferSize != BUM_state_p->StateSize) )
+        return EFI_LOAD_ERROR;
+    /*  Check the checksum */
+    if(BUMState_SumInvalid(BUM_state_p))
+        return EFI_LOAD_ERROR;
+    return EFI_SUCCESS;
+}
+
+/*  The file backend: slot A is <directory>/A.state and B is B.state */
+static CHAR8 *BUMStateFile_Name(IN  UINT8   Slot)
+{
+    return (BUMSTATE_SLOT_A == Slot)? ASTATE_FILENAME : BSTATE_FILENAME;
 }
 
-#define BUMState_SumInvalid(state_p) (0 != BUMState_GetSum(state_p))
+static EFI_STATUS EFIAPI BUMStateFile_Read( IN  CHAR8   *Target,
+                                            IN  UINT8   Slot,
+                                            OUT VOID*   *Buffer_p,
+                                            OUT UINTN   *BufferSize_p)
+{
+    return Common_OpenReadCloseDirFile( Target,
+                                        BUMStateFile_Name(Slot),
+                                        Buffer_p,
+                                        BufferSize_p);
+}
+
+static EFI_STATUS EFIAPI BUMStateFile_Write(IN  CHAR8   *Target,
+                                            IN  UINT8   Slot,
+                                            IN  VOID*   Buffer,
+                                            IN  UINTN   BufferSize)
+{
+    return Common_CreateWriteCloseDirFile(  Target,
+                                            BUMStateFile_Name(Slot),
+                                            Buffer,
+                                            BufferSize);
+}
+
+static EFI_STATUS EFIAPI BUMStateFile_ReadInto(IN  CHAR8   *Target,
+                                                IN  UINT8   Slot,
+                                                OUT VOID*   Buffer,
+                                                IN  UINTN   BufferSize,
+                                                OUT UINTN   *ReadSize_p)
+{
+    return Common_ReadDirFileInto(  Target,
+                                    BUMStateFile_Name(Slot),
+                                    Buffer,
+                                    BufferSize,
+                                    ReadSize_p);
+}
+
+static EFI_STATUS EFIAPI BUMStateFile_JournalRead(
+                                                IN  CHAR8   *Target,
+                                                OUT VOID*   Buffer,
+                                                IN  UINTN   BufferSize,
+                                                OUT UINTN   *ReadSize_p)
+{
+    return Common_ReadDirFileInto(  Target,
+                                    JSTATE_FILENAME,
+                                    Buffer,
+                                    BufferSize,
+                                    ReadSize_p);
+}
+
+/*  A record past the first is written in place after the others */
+static EFI_STATUS EFIAPI BUMStateFile_JournalWrite(
+                                                IN  CHAR8   *Target,
+                                                IN  UINTN   Offset,
+                                                IN  VOID*   Buffer,
+                                                IN  UINTN   BufferSize)
+{
+    if(0 == Offset)
+        return Common_CreateWriteCloseDirFile(  Target,
+                                                JSTATE_FILENAME,
+                                                Buffer,
+                                                BufferSize);
+    return Common_WriteDirFileAt(   Target,
+                                    JSTATE_FILENAME,
+                                    Offset,
+                                    Buffer,
+                                    BufferSize);
+}
+
+static CONST BUM_state_backend_t BUMStateBackend_File = {
+    .Name           = "file",
+    .Read           = BUMStateFile_Read,
+    .Write          = BUMStateFile_Write,
+    .ReadInto       = BUMStateFile_ReadInto,
+    .JournalRead    = BUMStateFile_JournalRead,
+    .JournalWrite   = BUMStateFile_JournalWrite,
+};
+
+static BOOLEAN BUMState_HasPrefix(  IN  CHAR8       *Location,
+                                    IN  CONST CHAR8 *Prefix,
+                                    IN  UINTN       PrefixLength)
+{
+    return  (AsciiStrnLenS(Location, PrefixLength) == PrefixLength) &&
+            (0 == CompareMem(Location, Prefix, PrefixLength));
+}
+
+CONST BUM_state_backend_t* EFIAPI BUMState_GetBackend(
+                                    IN  CHAR8   *Location,
+                                    OUT CHAR8   **Target_p)
+{
+    CONST BUM_state_backend_t *backend;
+    UINTN prefix_len;
+    if(BUMState_HasPrefix(  Location,
+                            BUMSTATE_VAR_PREFIX,
+                            sizeof(BUMSTATE_VAR_PREFIX) - 1)){
+        backend = &BUMStateBackend_Var;
+        prefix_len = sizeof(BUMSTATE_VAR_PREFIX) - 1;
+    }else if(BUMState_HasPrefix(Location,
+                                BUMSTATE_BLK_PREFIX,
+                                sizeof(BUMSTATE_BLK_PREFIX) - 1)){
+        backend = &BUMStateBackend_Block;
+        prefix_len = sizeof(BUMSTATE_BLK_PREFIX) - 1;
+    }else{
+        backend = &BUMStateBackend_File;
+        prefix_len = 0;
+    }
+    *Target_p = Location + prefix_len;
+    return backend;
+}
+
+static EFI_STATUS BUMState_WriteSlot(   IN  CHAR8   *Location,
+                                        IN  UINT8   Slot,
+                                        IN  VOID*   Buffer,
+                                        IN  UINTN   BufferSize)
+{
+    CHAR8 *target;
+    CONST BUM_state_backend_t *backend = BUMState_GetBackend(Location, &target);
+    return backend->Write(target, Slot, Buffer, BufferSize);
+}
 
 EFI_STATUS EFIAPI BUMState_Init(IN  CHAR8   *BootStatDirPath,
                                 IN  CHAR8   *Config)
 {
     EFI_STATUS ret;
     BUM_state_t state;
+    CHAR8 *target;
+    CONST BUM_state_backend_t *backend;
     /*  Zero-out state*/
     ZeroMem((VOID*)&state, sizeof(state));
-    /*  Write to the B.state file */
-    ret = Common_CreateWriteCloseDirFile(   BootStatDirPath,
-                                            BSTATE_FILENAME,
-                                            (VOID*)&state,
-                                            0);
+    /*  Empty the journal, whose records could otherwise follow the new
+        state */
+    backend = BUMState_GetBackend(BootStatDirPath, &target);
+    if(NULL != backend->JournalWrite){
+        ret = backend->JournalWrite(target, 0, (VOID*)&state, 0);
+        if(EFI_ERROR(ret))
+            goto exit0;
+    }
+    /*  Empty slot B */
+    ret = BUMState_WriteSlot(   BootStatDirPath,
+                                BUMSTATE_SLOT_B,
+                                (VOID*)&state,
+                                0);
     if(EFI_ERROR(ret))
         goto exit0;
-    /*  Populate the A.state file */
+    /*  Populate slot A */
     state.StateUpdateCounter = 1;
     state.StateSize = sizeof(BUM_state_t);
     state.Version   = BUMSTATE_VERSION;
@@ -66,81 +253,165 @@ EFI_STATUS EFIAPI BUMState_Init(IN  CHAR8   *BootStatDirPath,
         goto exit0;
     /*  Set state.Checksum; */
     BUMState_SetSum(&state);
-    /*  Write to the A.state file */
-    ret = Common_CreateWriteCloseDirFile(   BootStatDirPath,
-                                            ASTATE_FILENAME,
-                                            (VOID*)&state,
-                                            state.StateSize);
+    /*  Write slot A */
+    ret = BUMState_WriteSlot(   BootStatDirPath,
+                                BUMSTATE_SLOT_A,
+                                (VOID*)&state,
+                                state.StateSize);
 exit0:
     return ret;
 }
 
-static EFI_STATUS BUMState_ParseFile(   IN  CHAR8       *BootStatDirPath,
-                                        IN  CHAR8       *FileName,
-                                        OUT BUM_state_t **BUM_state_pp)
+/*  States up to this size are read into the pair itself. A larger slot
+    fills the buffer and is read again through the backend's Read. */
+#define BUMSTATE_READINTO_SIZE  (512)
+
+/*  The states of both slots. state[i] points into storage[i] or, when
+    owned[i] is set, to a buffer from the backend's Read. The journal records
+    that follow the current slot have been applied to state[curr]: there are
+    journalnext of them, and journalbase is the checksum of the slot they
+    follow. */
+typedef struct {
+    CONST BUM_state_backend_t   *backend;
+    CHAR8       *target;
+    BUM_state_t *state[2];
+    BOOLEAN     owned[2];
+    UINT64      storage[2][BUMSTATE_READINTO_SIZE / sizeof(UINT64)];
+    UINT8       curr;
+    UINT8       next;
+    UINT32      journalbase;
+    UINT8       journalnext;
+    #define BUMSTATE_A_IDX BUMSTATE_SLOT_A
+    #define BUMSTATE_B_IDX BUMSTATE_SLOT_B
+} BUM_state_pair_t;
+
+#define BUMStatePair_Invalid(pair)  (((pair)->state[BUMSTATE_A_IDX] == NULL)\
+                                    && ((pair)->state[BUMSTATE_B_IDX] == NULL))
+
+static EFI_STATUS BUMState_ParseFile(   IN  BUM_state_pair_t *BUM_state_pair_p,
+                                        IN  UINT8           Slot)
 {
     EFI_STATUS ret;
     VOID    *buffer;
     UINTN   buffer_size;
-    BUM_state_t *BUM_state_p;
-    /*  Read the file */
-    ret = Common_OpenReadCloseDirFile(  BootStatDirPath,
-                                        FileName,
-                                        &buffer,
-                                        &buffer_size );
-    if(EFI_ERROR(ret))
-        goto exit0;
-    /*  Check the size */
-    BUM_state_p = (BUM_state_t*)buffer;
-    if(buffer_size != BUM_state_p->StateSize){
-        ret = EFI_LOAD_ERROR;
-        goto exit1;
+    BOOLEAN owned;
+    CONST BUM_state_backend_t *backend = BUM_state_pair_p->backend;
+    /*  Read the slot into the pair if the backend can and the slot fits */
+    buffer_size = sizeof(BUM_state_pair_p->storage[Slot]);
+    if(NULL != backend->ReadInto){
+        buffer = BUM_state_pair_p->storage[Slot];
+        ret = backend->ReadInto(BUM_state_pair_p->target,
+                                Slot,
+                                buffer,
+                                buffer_size,
+                                &buffer_size);
+        if(EFI_ERROR(ret))
+            goto exit0;
     }
-    /*  Check the checksum */
-    if(BUMState_SumInvalid(BUM_state_p)){
-        ret = EFI_LOAD_ERROR;
-        goto exit1;
+    owned = (buffer_size == sizeof(BUM_state_pair_p->storage[Slot]));
+    if(owned){
+        ret = backend->Read(BUM_state_pair_p->target,
+                            Slot,
+                            &buffer,
+                            &buffer_size );
+        if(EFI_ERROR(ret))
+            goto exit0;
     }
-    /*  May need to check version number in the future. We're good for now. */
-    ret = EFI_SUCCESS;
-exit1:
+    /*  Check the size, version, and checksum */
+    ret = BUMState_Check((BUM_state_t*)buffer, buffer_size);
     if(EFI_ERROR(ret)){
         /*  Free the buffer on error */
-        Common_FreeReadBuffer(  buffer,
-                                buffer_size);
+        if(owned)
+            Common_FreeReadBuffer(  buffer,
+                                    buffer_size);
     }else{
         /*  Set the output buffer */
-        *BUM_state_pp = BUM_state_p;
+        BUM_state_pair_p->state[Slot] = (BUM_state_t*)buffer;
+        BUM_state_pair_p->owned[Slot] = owned;
     }
 exit0:
     return ret;
 }
 
-typedef struct {
-    BUM_state_t *state[2];
-    UINT8       curr;
-    UINT8       next;
-    #define BUMSTATE_A_IDX (0)
-    #define BUMSTATE_B_IDX (1)
-} BUM_state_pair_t;
+static VOID BUMStatePair_Release(IN  BUM_state_pair_t    *BUM_state_pair_p)
+{
+    UINT8 i;
+    for(i = BUMSTATE_A_IDX; i <= BUMSTATE_B_IDX; i++){
+        if( (NULL != BUM_state_pair_p->state[i]) && BUM_state_pair_p->owned[i] )
+            BUMState_Free(BUM_state_pair_p->state[i]);
+        BUM_state_pair_p->state[i] = NULL;
+    }
+}
 
-#define BUMStatePair_Invalid(pair)  (((pair)->state[BUMSTATE_A_IDX] == NULL)\
-                                    && ((pair)->state[BUMSTATE_B_IDX] == NULL))
+/*  Returns the current state in a buffer the caller owns, freed with
+    BUMState_Free, and releases the pair */
+static EFI_STATUS BUMStatePair_TakeCurr(IN  BUM_state_pair_t *BUM_state_pair_p,
+                                        OUT BUM_state_t     **BUM_state_pp)
+{
+    EFI_STATUS ret;
+    UINT8 curr = BUM_state_pair_p->curr;
+    BUM_state_t *cur_state_p = BUM_state_pair_p->state[curr];
+    if(BUM_state_pair_p->owned[curr]){
+        *BUM_state_pp = cur_state_p;
+        BUM_state_pair_p->state[curr] = NULL;
+        ret = EFI_SUCCESS;
+    }else
+        ret = Common_CopyReadBuffer(cur_state_p,
+                                    cur_state_p->StateSize,
+                                    (VOID**)BUM_state_pp);
+    BUMStatePair_Release(BUM_state_pair_p);
+    return ret;
+}
+
+/*  Applies the journal records that follow the current slot to its state.
+    Only a version 1 state is journaled, and a missing journal has no
+    records. */
+static VOID BUMStatePair_ApplyJournal(IN  BUM_state_pair_t    *BUM_state_pair_p)
+{
+    BUM_state_record_t records[BUMSTATE_JOURNAL_RECORDS], *record_p;
+    BUM_state_t *state_p = BUM_state_pair_p->state[BUM_state_pair_p->curr];
+    CONST BUM_state_backend_t *backend = BUM_state_pair_p->backend;
+    UINTN readsize, count, i;
+    BUM_state_pair_p->journalbase = (UINT32)state_p->Checksum;
+    BUM_state_pair_p->journalnext = 0;
+    if( (NULL == backend->JournalRead) ||
+        (BUMSTATE_VERSION != state_p->Version) ||
+        EFI_ERROR(backend->JournalRead( BUM_state_pair_p->target,
+                                        (VOID*)records,
+                                        sizeof(records),
+                                        &readsize)) )
+        return;
+    /*  Stop at the first record that does not follow the state so far */
+    count = readsize / sizeof(BUM_state_record_t);
+    for(i = 0; i < count; i++){
+        record_p = &(records[i]);
+        if( (BUM_state_pair_p->journalbase != record_p->Base) ||
+            (state_p->StateUpdateCounter + 1 !=
+                record_p->StateUpdateCounter) ||
+            (BUMState_GetRecordCrc(record_p) != record_p->Checksum) )
+            break;
+        state_p->StateUpdateCounter     = record_p->StateUpdateCounter;
+        state_p->Flags.raw              = record_p->Flags;
+        state_p->DfltAttemptsRemaining  = record_p->DfltAttemptsRemaining;
+    }
+    BUM_state_pair_p->journalnext = (UINT8)i;
+    /*  The state read is then a valid state on its own */
+    if(0 != i)
+        BUMState_SetSum(state_p);
+}
 
 static VOID BUMStatePair_Get(   IN  CHAR8               *BootStatDirPath,
                                 OUT BUM_state_pair_t    *BUM_state_pair_p)
 {
     EFI_STATUS ret;
+    BUM_state_pair_p->backend =
+        BUMState_GetBackend(BootStatDirPath, &(BUM_state_pair_p->target));
     /*  Get A.state */
-    ret = BUMState_ParseFile(   BootStatDirPath,
-                                ASTATE_FILENAME,
-                                &(BUM_state_pair_p->state[BUMSTATE_A_IDX]));
+    ret = BUMState_ParseFile(BUM_state_pair_p, BUMSTATE_A_IDX);
     if(EFI_ERROR(ret))
         BUM_state_pair_p->state[BUMSTATE_A_IDX] = NULL;
     /*  Get B.state */
-    ret = BUMState_ParseFile(   BootStatDirPath,
-                                BSTATE_FILENAME,
-                                &(BUM_state_pair_p->state[BUMSTATE_B_IDX]));
+    ret = BUMState_ParseFile(BUM_state_pair_p, BUMSTATE_B_IDX);
     if(EFI_ERROR(ret))
         BUM_state_pair_p->state[BUMSTATE_B_IDX] = NULL;
     /*  Set curr and next */
@@ -176,6 +447,8 @@ static VOID BUMStatePair_Get(   IN  CHAR8               *BootStatDirPath,
             }
         }
     }
+    if(!BUMStatePair_Invalid(BUM_state_pair_p))
+        BUMStatePair_ApplyJournal(BUM_state_pair_p);
 }
 
 EFI_STATUS EFIAPI BUMState_Free(IN  BUM_state_t *BUM_state_p)
@@ -192,12 +465,42 @@ EFI_STATUS EFIAPI BUMState_Get( IN  CHAR8       *BootStatDirPath,
     BUM_state_pair_t    BUM_state_pair;
     BUMStatePair_Get(   BootStatDirPath,
                         &BUM_state_pair);
-    if(BUMStatePair_Invalid(&BUM_state_pair)){
+    if(BUMStatePair_Invalid(&BUM_state_pair))
         ret = EFI_NOT_FOUND;
-    }else{
-        *BUM_state_pp = BUM_state_pair.state[BUM_state_pair.curr];
-        if(NULL != BUM_state_pair.state[BUM_state_pair.next])
-            BUMState_Free(BUM_state_pair.state[BUM_state_pair.next]);
+    else
+        ret = BUMStatePair_TakeCurr(&BUM_state_pair, BUM_state_pp);
+    return ret;
+}
+
+EFI_STATUS EFIAPI BUMState_GetCopy( IN  CHAR8       *BootStatDirPath,
+                                    OUT BUM_state_t *BUM_state_p)
+{
+    UINT8 CurrSlot;
+    BOOLEAN OtherValid;
+    return BUMState_GetInfo(BootStatDirPath,
+                            BUM_state_p,
+                            &CurrSlot,
+                            &OtherValid);
+}
+
+EFI_STATUS EFIAPI BUMState_GetInfo( IN  CHAR8       *BootStatDirPath,
+                                    OUT BUM_state_t *BUM_state_p,
+                                    OUT UINT8       *CurrSlot_p,
+                                    OUT BOOLEAN     *OtherValid_p)
+{
+    EFI_STATUS ret;
+    BUM_state_pair_t    BUM_state_pair;
+    BUMStatePair_Get(   BootStatDirPath,
+                        &BUM_state_pair);
+    if(BUMStatePair_Invalid(&BUM_state_pair))
+        ret = EFI_NOT_FOUND;
+    else{
+        CopyMem(BUM_state_p,
+                BUM_state_pair.state[BUM_state_pair.curr],
+                sizeof(BUM_state_t));
+        *CurrSlot_p = BUM_state_pair.curr;
+        *OtherValid_p = (NULL != BUM_state_pair.state[BUM_state_pair.next]);
+        BUMStatePair_Release(&BUM_state_pair);
         ret = EFI_SUCCESS;
     }
     return ret;
@@ -210,7 +513,6 @@ EFI_STATUS EFIAPI BUMState_Put( IN  CHAR8       *BootStatDirPath,
     /*  Get the state pair */
     BUM_state_pair_t BUM_state_pair;
     BUM_state_t *cur_state_p;
-    CHAR8 *filename;
     BUMStatePair_Get(   BootStatDirPath,
                         &BUM_state_pair);
     if(BUMStatePair_Invalid(&BUM_state_pair)){
@@ -232,23 +534,137 @@ EFI_STATUS EFIAPI BUMState_Put( IN  CHAR8       *BootStatDirPath,
     new_state_p->StateUpdateCounter++;
     BUMState_SetSum(new_state_p);
     /*  Write the new next state */
-    filename =  (BUM_state_pair.next == BUMSTATE_A_IDX)?
-                ASTATE_FILENAME : BSTATE_FILENAME;
-    ret = Common_CreateWriteCloseDirFile(   BootStatDirPath,
-                                            filename,
-                                            (VOID*)new_state_p,
-                                            new_state_p->StateSize);
-    /*  return the return value from Common_CreateWriteCloseFile */
+    ret = BUMState_WriteSlot(   BootStatDirPath,
+                                BUM_state_pair.next,
+                                (VOID*)new_state_p,
+                                new_state_p->StateSize);
+    /*  return the return value from BUMState_WriteSlot */
     /*  Free the state pair */
 exit1:
-    if(NULL != BUM_state_pair.state[BUM_state_pair.curr])
-        BUMState_Free(BUM_state_pair.state[BUM_state_pair.curr]);
-    if(NULL != BUM_state_pair.state[BUM_state_pair.next])
-        BUMState_Free(BUM_state_pair.state[BUM_state_pair.next]);
+    BUMStatePair_Release(&BUM_state_pair);
+exit0:
+    return ret;
+}
+
+EFI_STATUS EFIAPI BUMState_Open(IN  CHAR8               *BootStatDirPath,
+                                OUT BUM_state_handle_t  *Handle_p)
+{
+    EFI_STATUS ret;
+    BUM_state_pair_t    BUM_state_pair;
+    BUMStatePair_Get(   BootStatDirPath,
+                        &BUM_state_pair);
+    if(BUMStatePair_Invalid(&BUM_state_pair)){
+        ret = EFI_NOT_FOUND;
+        goto exit0;
+    }
+    /*  Only the current state is kept. The other slot's state was only
+        needed to pick the current one. */
+    Handle_p->Next = BUM_state_pair.next;
+    Handle_p->NextValid = (NULL != BUM_state_pair.state[BUM_state_pair.next]);
+    Handle_p->JournalBase = BUM_state_pair.journalbase;
+    Handle_p->JournalNext = BUM_state_pair.journalnext;
+    CopyMem(&(Handle_p->Committed),
+            BUM_state_pair.state[BUM_state_pair.curr],
+            sizeof(BUM_state_t));
+    ret = BUMStatePair_TakeCurr(&BUM_state_pair, &(Handle_p->State));
+    if(EFI_ERROR(ret))
+        goto exit0;
+    Handle_p->BootStatDirPath = BootStatDirPath;
+exit0:
+    return ret;
+}
+
+BOOLEAN EFIAPI BUMState_CommitAppends(IN  BUM_state_handle_t  *Handle_p)
+{
+    BUM_state_t state;
+    CHAR8 *target;
+    CONST BUM_state_backend_t *backend =
+        BUMState_GetBackend(Handle_p->BootStatDirPath, &target);
+    if( (NULL == backend->JournalWrite) ||
+        (BUMSTATE_VERSION != Handle_p->Committed.Version) ||
+        (BUMSTATE_JOURNAL_RECORDS <= Handle_p->JournalNext) )
+        return FALSE;
+    /*  Only the fields a record holds may differ */
+    CopyMem(&state, Handle_p->State, sizeof(state));
+    state.StateUpdateCounter    = Handle_p->Committed.StateUpdateCounter;
+    state.Flags.raw             = Handle_p->Committed.Flags.raw;
+    state.DfltAttemptsRemaining = Handle_p->Committed.DfltAttemptsRemaining;
+    state.Checksum              = Handle_p->Committed.Checksum;
+    return (0 == CompareMem(&state, &(Handle_p->Committed), sizeof(state)));
+}
+
+/*  Appends the working copy, whose counter has been updated, to the journal */
+static EFI_STATUS BUMState_AppendRecord(IN  BUM_state_handle_t  *Handle_p)
+{
+    BUM_state_record_t record;
+    CHAR8 *target;
+    CONST BUM_state_backend_t *backend =
+        BUMState_GetBackend(Handle_p->BootStatDirPath, &target);
+    record.StateUpdateCounter       = Handle_p->State->StateUpdateCounter;
+    record.Flags                    = Handle_p->State->Flags.raw;
+    record.DfltAttemptsRemaining    = Handle_p->State->DfltAttemptsRemaining;
+    record.Base                     = Handle_p->JournalBase;
+    record.Checksum                 = BUMState_GetRecordCrc(&record);
+    return backend->JournalWrite(   target,
+                                    Handle_p->JournalNext * sizeof(record),
+                                    (VOID*)&record,
+                                    sizeof(record));
+}
+
+EFI_STATUS EFIAPI BUMState_Commit(IN  BUM_state_handle_t  *Handle_p)
+{
+    EFI_STATUS ret;
+    BOOLEAN appends;
+    BUM_state_t *new_state_p = Handle_p->State;
+    BUM_state_t *cur_state_p = &(Handle_p->Committed);
+    new_state_p->StateUpdateCounter = cur_state_p->StateUpdateCounter;
+    new_state_p->Checksum = cur_state_p->Checksum;
+    /*  Check if the working copy and the current state are equal. Any bytes
+        past BUM_state_t are never modified. */
+    if(0 == CompareMem(new_state_p, cur_state_p, sizeof(BUM_state_t))){
+        /*  Nothing to write */
+        ret = EFI_SUCCESS;
+        goto exit0;
+    }
+    appends = BUMState_CommitAppends(Handle_p);
+    /*  Update the counter and checksum of the new next state */
+    new_state_p->StateUpdateCounter++;
+    BUMState_SetSum(new_state_p);
+    if(appends){
+        /*  Append a record to the journal */
+        ret = BUMState_AppendRecord(Handle_p);
+        if(EFI_ERROR(ret))
+            goto exit0;
+        Handle_p->JournalNext++;
+    }else{
+        /*  Write the new next state */
+        ret = BUMState_WriteSlot(   Handle_p->BootStatDirPath,
+                                    Handle_p->Next,
+                                    (VOID*)new_state_p,
+                                    new_state_p->StateSize);
+        if(EFI_ERROR(ret))
+            goto exit0;
+        /*  The written slot is now the current one, and no record follows
+            it yet */
+        Handle_p->Next =    (Handle_p->Next == BUMSTATE_A_IDX)?
+                            BUMSTATE_B_IDX : BUMSTATE_A_IDX;
+        Handle_p->NextValid = TRUE;
+        Handle_p->JournalBase = (UINT32)new_state_p->Checksum;
+        Handle_p->JournalNext = 0;
+    }
+    CopyMem(cur_state_p, new_state_p, sizeof(BUM_state_t));
 exit0:
     return ret;
 }
 
+EFI_STATUS EFIAPI BUMState_Close(IN  BUM_state_handle_t  *Handle_p)
+{
+    EFI_STATUS ret;
+    ret = BUMState_Free(Handle_p->State);
+    Handle_p->State = NULL;
+    return ret;
+}
+
 VOID EFIAPI BUMStateNext_StartUpdate(IN  BUM_state_t *BUM_state_p)
 {
     CHAR8 tmp[BUMSTATE_CONFIG_MAXLEN];
@@ -273,7 +689,7 @@ EFI_STATUS EFIAPI BUMStateNext_CompleteUpdate(  IN  BUM_state_t *BUM_state_p,
     /*  Only do the update if we are currently in AltrConfig */
     if(BUMSTATE_CONFIG_DFLT == BUM_state_p->Flags.CurrConfig){
         /*  The update operation modifies the default.
-            The current configurtaion is default.
+            The current configuration is default.
             It's not safe to modify the current configuration.
             Return error. */
         ret = EFI_INVALID_PARAMETER;
@@ -298,6 +714,23 @@ VOID EFIAPI BUMStateNext_BootTime(IN  BUM_state_t *BUM_state_p)
     }
 }
 
+EFI_STATUS EFIAPI BUMStateNext_BootFailure(IN  BUM_state_t *BUM_state_p)
+{
+    EFI_STATUS ret;
+    /*  Only the default configuration has another one to fall back to */
+    if(BUMSTATE_CONFIG_ALTR == BUM_state_p->Flags.CurrConfig){
+        ret = EFI_NOT_FOUND;
+        goto exit0;
+    }
+    /*  Spend the remaining attempts: the boot-time logic picks the
+        alternate, as it would have after that many failed boots */
+    BUM_state_p->DfltAttemptsRemaining = 0;
+    BUMStateNext_BootTime(BUM_state_p);
+    ret = EFI_SUCCESS;
+exit0:
+    return ret;
+}
+
 VOID EFIAPI BUMStateNext_RunTimeInit(IN  BUM_state_t *BUM_state_p)
 {
     if(BUMSTATE_CONFIG_DFLT == BUM_state_p->Flags.CurrConfig)
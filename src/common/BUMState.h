@@ -9,7 +9,12 @@
 #ifndef __BUM_STATE__
 #define __BUM_STATE__
 
-#define BUMSTATE_VERSION (0)
+/*  Version 0 files are protected by an additive UINT64 sum and version 1
+    files by a CRC32C. Both are read, and a state is written back in the
+    version it was read as; BUMState_Init writes version 1. */
+#define BUMSTATE_VERSION (1)
+#define ASTATE_FILENAME "A.state"
+#define BSTATE_FILENAME "B.state"
 #define BUMSTATE_CONFIG_MAXLEN (128)
 #define BUMSTATE_CONFIG_SIZE (sizeof(CHAR8) * BUMSTATE_CONFIG_MAXLEN)
 
@@ -52,17 +57,149 @@ typedef struct {
     UINT64  Checksum;
 } BUM_state_t;
 
+/*  Storage backends. The state is kept in two slots, A and B, and the
+    location passed to the functions below picks where the slots live:
+        "var:<target>"  the non-volatile UEFI variables BUMStateA and BUMStateB
+        "blk:<target>"  the first two sectors of a reserved partition or
+                        block device, one slot per sector
+        <directory>     the files A.state and B.state in the directory
+    What <target> names depends on the environment: the loader expects nothing
+    after "var:" and a partition number on the boot disk after "blk:"; the
+    utilities take the efivarfs directory (empty for the default) after "var:"
+    and a block device or image file after "blk:".
+    Read returns a buffer freed with Common_FreeReadBuffer. Writing zero bytes
+    empties a slot. ReadInto is optional: it reads at most BufferSize bytes of
+    a slot into the caller's buffer, so that the state can be checked where it
+    was read without an allocation. JournalRead and JournalWrite are optional
+    too (see the journal below): JournalRead reads at most BufferSize bytes of
+    the journal like ReadInto, and JournalWrite writes at Offset of it. A
+    write at offset zero replaces the journal, so writing zero bytes there
+    empties it. */
+#define BUMSTATE_SLOT_A (0)
+#define BUMSTATE_SLOT_B (1)
+#define BUMSTATE_VAR_PREFIX "var:"
+#define BUMSTATE_BLK_PREFIX "blk:"
+#define BUMSTATE_AVAR_NAME  "BUMStateA"
+#define BUMSTATE_BVAR_NAME  "BUMStateB"
+#define BUMSTATE_VAR_GUID_STRING    "3b56ca66-94b1-11e6-9806-d89d67f40bd7"
+#define BUMSTATE_VAR_ATTRIBUTES (EFI_VARIABLE_NON_VOLATILE |\
+                                 EFI_VARIABLE_BOOTSERVICE_ACCESS |\
+                                 EFI_VARIABLE_RUNTIME_ACCESS)
+
+typedef struct {
+    CONST CHAR8 *Name;
+    EFI_STATUS (EFIAPI *Read)(  IN  CHAR8   *Target,
+                                IN  UINT8   Slot,
+                                OUT VOID*   *Buffer_p,
+                                OUT UINTN   *BufferSize_p);
+    EFI_STATUS (EFIAPI *Write)( IN  CHAR8   *Target,
+                                IN  UINT8   Slot,
+                                IN  VOID*   Buffer,
+                                IN  UINTN   BufferSize);
+    EFI_STATUS (EFIAPI *ReadInto)(  IN  CHAR8   *Target,
+                                    IN  UINT8   Slot,
+                                    OUT VOID*   Buffer,
+                                    IN  UINTN   BufferSize,
+                                    OUT UINTN   *ReadSize_p);
+    EFI_STATUS (EFIAPI *JournalRead)(   IN  CHAR8   *Target,
+                                        OUT VOID*   Buffer,
+                                        IN  UINTN   BufferSize,
+                                        OUT UINTN   *ReadSize_p);
+    EFI_STATUS (EFIAPI *JournalWrite)(  IN  CHAR8   *Target,
+                                        IN  UINTN   Offset,
+                                        IN  VOID*   Buffer,
+                                        IN  UINTN   BufferSize);
+} BUM_state_backend_t;
+
+extern CONST BUM_state_backend_t BUMStateBackend_Var;
+extern CONST BUM_state_backend_t BUMStateBackend_Block;
+
+/*  The journal. A commit that only changes Flags and DfltAttemptsRemaining
+    (a boot attempt, runtime-init) is appended to the journal as a record
+    rather than written to a slot as a whole state, on backends that have
+    one: the directory backend keeps it in the file J.state. Record N is at
+    offset N * sizeof(BUM_state_record_t) and follows the state of the
+    current slot, whose checksum is Base, and records 0 to N-1. It is valid
+    if its Checksum is the CRC32C of the record with Checksum set to zero
+    and its StateUpdateCounter is one more than that of the state it
+    follows. The current state is that of the current slot with the valid
+    records that follow it applied, up to the first record that is not
+    valid: a torn record leaves the state it would have changed.
+    A commit that changes anything else, and the commit after
+    BUMSTATE_JOURNAL_RECORDS records, writes the whole state to the other
+    slot as before. That compacts the journal: the old records do not follow
+    the new current slot, and the next record replaces them. */
+#define JSTATE_FILENAME "J.state"
+#define BUMSTATE_JOURNAL_RECORDS (16)
+
+typedef struct {
+    UINT64  StateUpdateCounter;
+    UINT64  Flags;
+    UINT64  DfltAttemptsRemaining;
+    UINT32  Base;
+    UINT32  Checksum;
+} BUM_state_record_t;
+
+/*  Returns the backend for Location and sets *Target_p to the part of
+    Location naming the storage within it */
+CONST BUM_state_backend_t* EFIAPI BUMState_GetBackend(
+                                    IN  CHAR8   *Location,
+                                    OUT CHAR8   **Target_p);
+
+/*  An open BUM state. State is the working copy for the caller to modify.
+    Committed holds the contents of the current slot and Next is the slot
+    (A or B) the next commit goes to, so that a commit does not need to read
+    the slots again. NextValid is set if slot Next holds a valid state.
+    JournalBase is the checksum of the current slot's state and JournalNext
+    the number of journal records that follow it, which is where the next
+    record goes. BootStatDirPath is the state location (see above). */
+typedef struct {
+    CHAR8       *BootStatDirPath;
+    BUM_state_t *State;
+    BUM_state_t Committed;
+    UINT8       Next;
+    BOOLEAN     NextValid;
+    UINT32      JournalBase;
+    UINT8       JournalNext;
+} BUM_state_handle_t;
+
 EFI_STATUS EFIAPI BUMState_Init(IN  CHAR8   *BootStatDirPath,
                                 IN  CHAR8   *Config);
 
 EFI_STATUS EFIAPI BUMState_Get( IN  CHAR8       *BootStatDirPath,
                                 OUT BUM_state_t **BUM_state_pp);
 
+/*  Copies the current state into *BUM_state_p without allocating. Only the
+    BUM_state_t fields are copied. */
+EFI_STATUS EFIAPI BUMState_GetCopy( IN  CHAR8       *BootStatDirPath,
+                                    OUT BUM_state_t *BUM_state_p);
+
+/*  Like BUMState_GetCopy, also returning the slot (A or B) holding the
+    current state and whether the other slot holds a valid state */
+EFI_STATUS EFIAPI BUMState_GetInfo( IN  CHAR8       *BootStatDirPath,
+                                    OUT BUM_state_t *BUM_state_p,
+                                    OUT UINT8       *CurrSlot_p,
+                                    OUT BOOLEAN     *OtherValid_p);
+
 EFI_STATUS EFIAPI BUMState_Put( IN  CHAR8       *BootStatDirPath,
                                 IN  BUM_state_t *BUM_state_p);
 
 EFI_STATUS EFIAPI BUMState_Free(IN  BUM_state_t *BUM_state_p);
 
+EFI_STATUS EFIAPI BUMState_Check(   IN  BUM_state_t *BUM_state_p,
+                                    IN  UINTN       BufferSize);
+
+EFI_STATUS EFIAPI BUMState_Open(IN  CHAR8               *BootStatDirPath,
+                                OUT BUM_state_handle_t  *Handle_p);
+
+/*  Returns TRUE if committing the working copy would append a journal record
+    rather than write a slot */
+BOOLEAN EFIAPI BUMState_CommitAppends(IN  BUM_state_handle_t  *Handle_p);
+
+EFI_STATUS EFIAPI BUMState_Commit(IN  BUM_state_handle_t  *Handle_p);
+
+EFI_STATUS EFIAPI BUMState_Close(IN  BUM_state_handle_t  *Handle_p);
+
 VOID EFIAPI BUMStateNext_StartUpdate(IN  BUM_state_t *BUM_state_p);
 
 EFI_STATUS EFIAPI BUMStateNext_CompleteUpdate(  IN  BUM_state_t *BUM_state_p,
@@ -71,6 +208,11 @@ EFI_STATUS EFIAPI BUMStateNext_CompleteUpdate(  IN  BUM_state_t *BUM_state_p,
 
 VOID EFIAPI BUMStateNext_BootTime(IN  BUM_state_t *BUM_state_p);
 
+/*  The configuration picked by the boot-time logic failed to boot: falls back
+    to the alternate within the same boot. Returns EFI_NOT_FOUND if the
+    alternate is the one that failed. */
+EFI_STATUS EFIAPI BUMStateNext_BootFailure(IN  BUM_state_t *BUM_state_p);
+
 VOID EFIAPI BUMStateNext_RunTimeInit( IN  BUM_state_t *BUM_state_p);
 
 EFI_STATUS EFIAPI BUMState_getCurrConfig(
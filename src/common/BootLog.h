@@ -0,0 +1,72 @@
+/* BootLog.h -  On-disk format of the binary boot log (log.bin) written by the
+ *              loader's LogPrint and decoded by the user-space utilities.
+ *
+ *              The file is a header followed by BOOTLOG_RECORD_COUNT
+ *              fixed-size record slots used as a circular buffer. Head and
+ *              Tail are record sequence numbers: records Head .. Tail-1 are
+ *              valid and record n lives in slot (n % RecordCount).
+ */
+
+#ifndef __BOOT_LOG__
+#define __BOOT_LOG__
+
+#define BOOTLOG_FILENAME        "log.bin"
+#define BOOTLOG_MAGIC           (0x474F4C544F4F4255ULL) /* "UBOOTLOG" */
+#define BOOTLOG_VERSION         (0)
+#define BOOTLOG_RECORD_COUNT    (512)
+#define BOOTLOG_CONTEXT_SIZE    (48)
+#define BOOTLOG_MESSAGE_SIZE    (432)
+
+/* Record flags */
+#define BOOTLOG_RECORD_TRUNCATED    (0x1)
+
+typedef struct {
+    UINT64  Magic;
+    UINT32  Version;
+    UINT32  HeaderSize;
+    UINT32  RecordSize;
+    UINT32  RecordCount;
+    UINT64  Head;
+    UINT64  Tail;
+} BOOTLOG_header_t;
+
+typedef struct {
+    UINT64  Sequence;
+    UINT64  TSC;
+    UINT16  Year;
+    UINT8   Month;
+    UINT8   Day;
+    UINT8   Hour;
+    UINT8   Minute;
+    UINT8   Second;
+    UINT8   Flags;
+    UINT16  Length;
+    UINT16  Reserved[3];
+    CHAR8   Context[BOOTLOG_CONTEXT_SIZE];
+    CHAR8   Message[BOOTLOG_MESSAGE_SIZE];
+} BOOTLOG_record_t;
+
+#define BOOTLOG_RECORD_SIZE     (sizeof(BOOTLOG_record_t))
+#define BOOTLOG_FILE_SIZE       (sizeof(BOOTLOG_header_t) + \
+                                    (BOOTLOG_RECORD_SIZE * BOOTLOG_RECORD_COUNT))
+
+/* Offset of the slot holding record Sequence */
+static inline UINT64 BootLog_recordOffset(  IN  BOOTLOG_header_t    *Header,
+                                            IN  UINT64              Sequence)
+{
+    return Header->HeaderSize +
+            (Sequence % Header->RecordCount) * Header->RecordSize;
+}
+
+static inline BOOLEAN BootLog_headerIsValid(IN  BOOTLOG_header_t    *Header)
+{
+    return  (BOOTLOG_MAGIC == Header->Magic) &&
+            (BOOTLOG_VERSION == Header->Version) &&
+            (sizeof(BOOTLOG_header_t) == Header->HeaderSize) &&
+            (BOOTLOG_RECORD_SIZE == Header->RecordSize) &&
+            (BOOTLOG_RECORD_COUNT == Header->RecordCount) &&
+            (Header->Head <= Header->Tail) &&
+            ((Header->Tail - Header->Head) <= Header->RecordCount);
+}
+
+#endif
@@ -0,0 +1,62 @@
+/* BootStatFile.h - On-disk format of the boot-status record (bootstat.bin)
+ *                  written by the loader's BootStat_persist and decoded by
+ *                  the user-space utilities.
+ *
+ *                  The file is a header followed by EntryCount TLV entries.
+ *                  Each entry is a BOOTSTAT_entry_t followed by its name and
+ *                  its value, padded with zeros to a multiple of 8 bytes. The
+ *                  name is that of the file the field used to be written to
+ *                  on its own (e.g. "nvinfo_NVSize"), and the value is that
+ *                  file's contents. Checksum is the CRC32C of the whole file
+ *                  computed with Checksum set to zero.
+ */
+
+#ifndef __BOOT_STAT_FILE__
+#define __BOOT_STAT_FILE__
+
+#define BOOTSTAT_FILENAME       "bootstat.bin"
+#define BOOTSTAT_MAGIC          (0x54415453544F4F42ULL) /* "BOOTSTAT" */
+#define BOOTSTAT_VERSION        (0)
+#define BOOTSTAT_ALIGN          (8)
+
+/* Entry types: how the value is to be read */
+#define BOOTSTAT_TYPE_STRING    (1)     /* ASCII, not terminated */
+#define BOOTSTAT_TYPE_UINT64    (2)     /* little-endian */
+#define BOOTSTAT_TYPE_BINARY    (3)     /* e.g. the data of a UEFI variable */
+
+typedef struct {
+    UINT64  Magic;
+    UINT32  Version;
+    UINT32  HeaderSize;
+    UINT32  FileSize;
+    UINT32  EntryCount;
+    UINT32  Checksum;
+    UINT32  Reserved;
+} BOOTSTAT_header_t;
+
+typedef struct {
+    UINT16  Type;
+    UINT16  NameLength;
+    UINT32  ValueLength;
+} BOOTSTAT_entry_t;
+
+/* Size of an entry with its name, value and padding */
+static inline UINT32 BootStatFile_entrySize(IN  UINT32  NameLength,
+                                            IN  UINT32  ValueLength)
+{
+    return  ((UINT32)sizeof(BOOTSTAT_entry_t) + NameLength + ValueLength +
+                BOOTSTAT_ALIGN - 1) & ~(UINT32)(BOOTSTAT_ALIGN - 1);
+}
+
+static inline BOOLEAN BootStatFile_headerIsValid(
+                                        IN  BOOTSTAT_header_t   *Header,
+                                        IN  UINTN               FileSize)
+{
+    return  (sizeof(BOOTSTAT_header_t) <= FileSize) &&
+            (BOOTSTAT_MAGIC == Header->Magic) &&
+            (BOOTSTAT_VERSION == Header->Version) &&
+            (sizeof(BOOTSTAT_header_t) == Header->HeaderSize) &&
+            (FileSize == Header->FileSize);
+}
+
+#endif
@@ -0,0 +1,97 @@
+/* BootTimeline.h - Boot-phase timeline recorded by the root and configuration
+ *                  BUMs, carried across the root -> configuration BUM hop in
+ *                  the BUM context (see BUMContext.h), and kept as a history
+ *                  of boots in \bootstatus\boottime.bin.
+ *
+ *                  The history file is a header followed by BootCount slots
+ *                  of BOOTTIME_boot_t used as a circular buffer. Next is the
+ *                  sequence number of the next boot to be recorded; boot n
+ *                  lives in slot (n % BootCount).
+ */
+
+#ifndef __BOOT_TIMELINE__
+#define __BOOT_TIMELINE__
+
+#define BOOTTIME_FILENAME       "boottime.bin"
+#define BOOTTIME_VARNAME        L"BUM_TIMELINE"
+#define BOOTTIME_MAGIC          (0x53454D49544D5542ULL) /* "BUMTIMES" */
+#define BOOTTIME_VERSION        (0)
+#define BOOTTIME_MARKS_MAX      (48)
+#define BOOTTIME_HISTORY_COUNT  (64)
+/* Length of the gBS->Stall used to measure the TSC frequency */
+#define BOOTTIME_CALIBRATE_US   (1000)
+
+typedef enum {
+    BOOTTIME_PHASE_INIT         = 0,    /* BUM_init */
+    BOOTTIME_PHASE_STATEGET     = 1,    /* BUMState_Get */
+    BOOTTIME_PHASE_STATEPUT     = 2,    /* BUMState_Put */
+    BOOTTIME_PHASE_LOADKEYS     = 3,    /* BUM_loadKeys */
+    BOOTTIME_PHASE_LOADIMAGE    = 4,    /* BUM_LoadImage */
+    BOOTTIME_PHASE_BOOTSTAT     = 5,    /* BootStat_capture */
+    BOOTTIME_PHASE_STARTIMAGE   = 6,    /* just before gBS->StartImage */
+    BOOTTIME_PHASE_BOOTSTATPUT  = 7,    /* BootStat_persist */
+    BOOTTIME_PHASE_COUNT
+} BOOTTIME_phase_t;
+
+/* The image that recorded a mark */
+#define BOOTTIME_STAGE_ROOT     (0)
+#define BOOTTIME_STAGE_CONFIG   (1)
+#define BOOTTIME_STAGE_UNKNOWN  (2)
+#define BOOTTIME_STAGE_COUNT    (3)
+
+/* Kinds of marks */
+#define BOOTTIME_MARK_BEGIN     (0)
+#define BOOTTIME_MARK_END       (1)
+#define BOOTTIME_MARK_POINT     (2)
+
+typedef struct {
+    UINT64  TSC;
+    UINT8   Phase;
+    UINT8   Stage;
+    UINT8   Kind;
+    UINT8   Reserved[5];
+} BOOTTIME_mark_t;
+
+/*  One boot: the marks of the root and configuration BUM in TSC order. The
+    time is the RTC time when the root BUM started. TicksPerUs is the TSC
+    frequency measured by the root BUM, or zero if it could not be measured. */
+typedef struct {
+    UINT64          Sequence;
+    UINT16          Year;
+    UINT8           Month;
+    UINT8           Day;
+    UINT8           Hour;
+    UINT8           Minute;
+    UINT8           Second;
+    UINT8           Reserved0;
+    UINT32          MarkCount;
+    UINT32          TicksPerUs;
+    BOOTTIME_mark_t Marks[BOOTTIME_MARKS_MAX];
+} BOOTTIME_boot_t;
+
+typedef struct {
+    UINT64  Magic;
+    UINT32  Version;
+    UINT32  HeaderSize;
+    UINT32  BootSize;
+    UINT32  BootCount;
+    UINT64  Next;
+} BOOTTIME_header_t;
+
+static inline UINT64 BootTime_bootOffset(   IN  BOOTTIME_header_t   *Header,
+                                            IN  UINT64              Sequence)
+{
+    return Header->HeaderSize +
+            (Sequence % Header->BootCount) * Header->BootSize;
+}
+
+static inline BOOLEAN BootTime_headerIsValid(IN  BOOTTIME_header_t  *Header)
+{
+    return  (BOOTTIME_MAGIC == Header->Magic) &&
+            (BOOTTIME_VERSION == Header->Version) &&
+            (sizeof(BOOTTIME_header_t) == Header->HeaderSize) &&
+            (sizeof(BOOTTIME_boot_t) == Header->BootSize) &&
+            (BOOTTIME_HISTORY_COUNT == Header->BootCount);
+}
+
+#endif
@@ -0,0 +1,160 @@
+/* BootTrace.h - On-disk format of the deferred boot trace (trace.bin) written
+ *               by the loader's LogPrint in LOG_PRINT_MODE_TRACE, and the
+ *               format-string scan shared by the loader and the user-space
+ *               renderer.
+ *
+ *               Instead of formatted text, each LogPrint call records the
+ *               format string's offset in the loaded image (RVA), the TSC,
+ *               and the raw argument words. Strings, GUIDs, and times passed
+ *               by pointer are copied into the record. The renderer reads the
+ *               format strings back from the .efi image and produces the same
+ *               text LogPrint would have.
+ *
+ *               The file is a sequence of segments. Each segment is a
+ *               BOOTTRACE_segment_t followed by RecordsSize bytes of records.
+ *               A segment names the image holding its format strings by the
+ *               image's build ID (see BUMBuildId.h): the root and
+ *               configuration BUMs of an A/B update are different builds,
+ *               which can have the same size.
+ */
+
+#ifndef __BOOT_TRACE__
+#define __BOOT_TRACE__
+
+#include "BUMBuildId.h"
+
+#define BOOTTRACE_FILENAME      "trace.bin"
+#define BOOTTRACE_MAGIC         (0x45434152544D5542ULL) /* "BUMTRACE" */
+#define BOOTTRACE_VERSION       (1)
+#define BOOTTRACE_CONTEXT_SIZE  (48)
+/* Maximum number of argument words recorded per call */
+#define BOOTTRACE_ARGS_MAX      (16)
+/* Maximum size of one record, including copied strings */
+#define BOOTTRACE_RECORD_MAX    (1024)
+/* The file is restarted once it would grow past this size */
+#define BOOTTRACE_FILE_MAX      (1024 * 1024)
+
+/* Record flags */
+#define BOOTTRACE_RECORD_TRUNCATED      (0x1)   /* arguments or strings cut */
+#define BOOTTRACE_RECORD_INLINE_FORMAT  (0x2)   /* format copied into record */
+
+typedef struct {
+    UINT16  Year;
+    UINT8   Month;
+    UINT8   Day;
+    UINT8   Hour;
+    UINT8   Minute;
+    UINT8   Second;
+    UINT8   Reserved;
+} BOOTTRACE_time_t;
+
+typedef struct {
+    UINT64              Magic;
+    UINT32              Version;
+    UINT32              HeaderSize;
+    UINT32              RecordsSize;
+    UINT32              RecordCount;
+    CHAR8               ImageId[BUMBUILDID_IDLEN];  /* build ID of the
+                                                       image holding formats */
+    UINT64              StartTSC;
+    UINT64              EndTSC;
+    BOOTTRACE_time_t    StartTime;
+    BOOTTRACE_time_t    EndTime;
+    CHAR8               Context[BOOTTRACE_CONTEXT_SIZE];
+} BOOTTRACE_segment_t;
+
+/*  A record is followed by ArgCount argument words and then the copied data.
+    The word of a string, GUID, or time argument is the offset of its copy
+    from the start of the record (zero for a NULL pointer). Size is a
+    multiple of 8. */
+typedef struct {
+    UINT32  Format;     /* image RVA, or record offset if INLINE_FORMAT */
+    UINT16  Size;
+    UINT8   ArgCount;
+    UINT8   Flags;
+    UINT64  TSC;
+} BOOTTRACE_record_t;
+
+#define BOOTTRACE_ALIGN(x)  (((x) + 7) & ~((UINTN)7))
+
+/* Classes of arguments consumed by a conversion */
+typedef enum {
+    BOOTTRACE_ARG_INT,      /* int-sized integer (%d, %x, %c, '*') */
+    BOOTTRACE_ARG_INT64,    /* 64-bit integer ('L'/'l', %r) */
+    BOOTTRACE_ARG_POINTER,  /* pointer printed as a number (%p) */
+    BOOTTRACE_ARG_STRING16, /* UCS-2 string (%s, %S) */
+    BOOTTRACE_ARG_STRING8,  /* ASCII string (%a) */
+    BOOTTRACE_ARG_GUID,     /* GUID (%g) */
+    BOOTTRACE_ARG_TIME      /* EFI_TIME (%t) */
+} BOOTTRACE_argclass_t;
+
+/*  Scans a PrintLib format string for the arguments it consumes. Writes the
+    class of up to BOOTTRACE_ARGS_MAX arguments and returns the total count.
+    This is a lighter pass than formatting: flags and widths are skipped and
+    nothing is printed. */
+static inline UINTN BootTrace_scanFormat(
+                            IN  CONST CHAR16    *Format,
+                            OUT UINT8           Classes[BOOTTRACE_ARGS_MAX])
+{
+    UINTN count = 0;
+    BOOLEAN is64;
+    UINT8 argclass;
+    while(0 != *Format){
+        if(L'%' != *Format++)
+            continue;
+        is64 = FALSE;
+        /*  Flags, width, and precision */
+        for(;; Format++){
+            if((L'L' == *Format) || (L'l' == *Format))
+                is64 = TRUE;
+            else if(L'*' == *Format){
+                if(count < BOOTTRACE_ARGS_MAX)
+                    Classes[count] = BOOTTRACE_ARG_INT;
+                count++;
+            }else if(   (L'-' != *Format) && (L'+' != *Format) &&
+                        (L' ' != *Format) && (L',' != *Format) &&
+                        (L'.' != *Format) &&
+                        ((*Format < L'0') || (*Format > L'9')) )
+                break;
+        }
+        switch(*Format){
+            case L'd': case L'u': case L'x': case L'X':
+                argclass = is64? BOOTTRACE_ARG_INT64 : BOOTTRACE_ARG_INT;
+                break;
+            case L'c':
+                argclass = BOOTTRACE_ARG_INT;
+                break;
+            case L'r':
+                argclass = BOOTTRACE_ARG_INT64;
+                break;
+            case L'p':
+                argclass = BOOTTRACE_ARG_POINTER;
+                break;
+            case L's': case L'S':
+                argclass = BOOTTRACE_ARG_STRING16;
+                break;
+            case L'a':
+                argclass = BOOTTRACE_ARG_STRING8;
+                break;
+            case L'g':
+                argclass = BOOTTRACE_ARG_GUID;
+                break;
+            case L't':
+                argclass = BOOTTRACE_ARG_TIME;
+                break;
+            case 0:
+                return count;
+            default:
+                /*  %% and unknown conversions take no argument */
+                Format++;
+                continue;
+        }
+        if(count < BOOTTRACE_ARGS_MAX)
+            Classes[count] = argclass;
+        count++;
+        Format++;
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,255 @@
+/* BUMStateBackend.c -  The UEFI-variable and block backends of the BUM state
+ *                      for the loader (see BUMState.h).
+ */
+
+#include "__BUMStateBackend.h"
+
+/******************************************************************************/
+/*  UEFI variables                                                            */
+/******************************************************************************/
+
+/*  BUMSTATE_VAR_GUID_STRING */
+static EFI_GUID sgBUMStateVarGuid =
+    {0x3B56CA66, 0x94B1, 0x11E6, {0x98, 0x06, 0xD8, 0x9D, 0x67, 0xF4, 0x0B, 0xD7}};
+
+static CHAR16 *BUMStateVar_Name(IN  UINT8   Slot)
+{
+    return  (BUMSTATE_SLOT_A == Slot)?
+            L"" BUMSTATE_AVAR_NAME : L"" BUMSTATE_BVAR_NAME;
+}
+
+static EFI_STATUS EFIAPI BUMStateVar_Read(  IN  CHAR8   *Target,
+                                            IN  UINT8   Slot,
+                                            OUT VOID*   *Buffer_p,
+                                            OUT UINTN   *BufferSize_p)
+{
+    EFI_STATUS Status;
+    UINT32 Attributes;
+    Status = Common_ReadUEFIVariable(   &sgBUMStateVarGuid,
+                                        BUMStateVar_Name(Slot),
+                                        Buffer_p,
+                                        BufferSize_p,
+                                        &Attributes);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    /*  A variable with other attributes was not written by BUM */
+    if(BUMSTATE_VAR_ATTRIBUTES != Attributes){
+        Common_FreeReadBuffer(*Buffer_p, *BufferSize_p);
+        *Buffer_p = NULL;
+        *BufferSize_p = 0;
+        Status = EFI_LOAD_ERROR;
+    }
+exit0:
+    return Status;
+}
+
+static EFI_STATUS EFIAPI BUMStateVar_Write( IN  CHAR8   *Target,
+                                            IN  UINT8   Slot,
+                                            IN  VOID*   Buffer,
+                                            IN  UINTN   BufferSize)
+{
+    EFI_STATUS Status;
+    /*  Writing zero bytes deletes the variable */
+    Status = gRT->SetVariable(  BUMStateVar_Name(Slot),
+                                &sgBUMStateVarGuid,
+                                (0 == BufferSize)? 0 : BUMSTATE_VAR_ATTRIBUTES,
+                                BufferSize,
+                                (0 == BufferSize)? NULL : Buffer);
+    /*  An empty slot may not have existed */
+    if( (0 == BufferSize) && (EFI_NOT_FOUND == Status) )
+        Status = EFI_SUCCESS;
+    return Status;
+}
+
+CONST BUM_state_backend_t BUMStateBackend_Var = {
+    .Name   = "var",
+    .Read   = BUMStateVar_Read,
+    .Write  = BUMStateVar_Write,
+};
+
+/******************************************************************************/
+/*  Raw blocks of a partition on the boot disk                                */
+/******************************************************************************/
+
+/*  Slot N is block N of the partition numbered Target on the disk holding the
+    boot partition. A slot is written whole, padded with zeros, and flushed;
+    an empty slot has a StateSize of zero. */
+
+/*  The partition found by the last search */
+static EFI_BLOCK_IO_PROTOCOL *sgStateBlockIo = NULL;
+static UINTN sgStateBlockPartition = 0;
+
+/*  Returns the hard-drive media node of DevicePath, or NULL */
+static HARDDRIVE_DEVICE_PATH *BUMStateBlock_PartitionNode(
+                                    IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath)
+{
+    for(;   !IsDevicePathEnd(DevicePath);
+            DevicePath = NextDevicePathNode(DevicePath)){
+        if( (MEDIA_DEVICE_PATH == DevicePathType(DevicePath)) &&
+            (MEDIA_HARDDRIVE_DP == DevicePathSubType(DevicePath)) )
+            return (HARDDRIVE_DEVICE_PATH*)DevicePath;
+    }
+    return NULL;
+}
+
+static EFI_STATUS BUMStateBlock_Find(   IN  CHAR8                   *Target,
+                                        OUT EFI_BLOCK_IO_PROTOCOL   **BlockIo_pp)
+{
+    EFI_STATUS Status;
+    EFI_DEVICE_PATH_PROTOCOL *BootPath, *Path;
+    HARDDRIVE_DEVICE_PATH *BootNode, *Node;
+    EFI_HANDLE *Handles;
+    UINTN NoHandles, DiskPathSize, Partition, i;
+
+    Partition = AsciiStrDecimalToUintn(Target);
+    if(0 == Partition){
+        Status = EFI_INVALID_PARAMETER;
+        goto exit0;
+    }
+    if( (NULL != sgStateBlockIo) && (Partition == sgStateBlockPartition) ){
+        Status = EFI_SUCCESS;
+        goto exit0;
+    }
+    /*  The disk is the part of the boot partition's device path before its
+        hard-drive node. */
+    Status = gBS->HandleProtocol(   Common_GetBootPartHandle(),
+                                    &gEfiDevicePathProtocolGuid,
+                                    (VOID**)&BootPath);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    BootNode = BUMStateBlock_PartitionNode(BootPath);
+    if(NULL == BootNode){
+        Status = EFI_NOT_FOUND;
+        goto exit0;
+    }
+    DiskPathSize = (UINTN)((UINT8*)BootNode - (UINT8*)BootPath);
+    /*  Find the partition with the same disk and the given number */
+    Status = gBS->LocateHandleBuffer(   ByProtocol,
+                                        &gEfiBlockIoProtocolGuid,
+                                        NULL,
+                                        &NoHandles,
+                                        &Handles);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    Status = EFI_NOT_FOUND;
+    for(i = 0; i < NoHandles; i++){
+        if(EFI_ERROR(gBS->HandleProtocol(   Handles[i],
+                                            &gEfiDevicePathProtocolGuid,
+                                            (VOID**)&Path)))
+            continue;
+        Node = BUMStateBlock_PartitionNode(Path);
+        if( (NULL == Node) || (Partition != Node->PartitionNumber) ||
+            (DiskPathSize != (UINTN)((UINT8*)Node - (UINT8*)Path)) ||
+            (0 != CompareMem(Path, BootPath, DiskPathSize)) )
+            continue;
+        Status = gBS->HandleProtocol(   Handles[i],
+                                        &gEfiBlockIoProtocolGuid,
+                                        (VOID**)&sgStateBlockIo);
+        if(EFI_ERROR(Status))
+            sgStateBlockIo = NULL;
+        else
+            sgStateBlockPartition = Partition;
+        break;
+    }
+    gBS->FreePool(Handles);
+exit0:
+    if(!EFI_ERROR(Status))
+        *BlockIo_pp = sgStateBlockIo;
+    return Status;
+}
+
+/*  Allocates a block buffer aligned as the device requires. Pool is what is
+    freed. */
+static EFI_STATUS BUMStateBlock_AllocBlock( IN  EFI_BLOCK_IO_MEDIA  *Media,
+                                            OUT VOID                **Pool_p,
+                                            OUT VOID                **Block_p)
+{
+    EFI_STATUS Status;
+    UINTN Align = (Media->IoAlign > 1)? Media->IoAlign : 1;
+    Status = gBS->AllocatePool( EfiLoaderData,
+                                Media->BlockSize + Align - 1,
+                                Pool_p);
+    if(!EFI_ERROR(Status))
+        *Block_p = (VOID*)(((UINTN)*Pool_p + Align - 1) & ~(Align - 1));
+    return Status;
+}
+
+static EFI_STATUS EFIAPI BUMStateBlock_Read(IN  CHAR8   *Target,
+                                            IN  UINT8   Slot,
+                                            OUT VOID*   *Buffer_p,
+                                            OUT UINTN   *BufferSize_p)
+{
+    EFI_STATUS Status;
+    EFI_BLOCK_IO_PROTOCOL *BlockIo;
+    VOID *Pool, *Block, *Buffer;
+    UINT64 StateSize;
+
+    Status = BUMStateBlock_Find(Target, &BlockIo);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    Status = BUMStateBlock_AllocBlock(BlockIo->Media, &Pool, &Block);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    Status = BlockIo->ReadBlocks(   BlockIo,
+                                    BlockIo->Media->MediaId,
+                                    (EFI_LBA)Slot,
+                                    BlockIo->Media->BlockSize,
+                                    Block);
+    if(EFI_ERROR(Status))
+        goto exit1;
+    /*  Return the state without the padding */
+    StateSize = ((BUM_state_t*)Block)->StateSize;
+    if( (0 == StateSize) || (StateSize > BlockIo->Media->BlockSize) ){
+        Status = EFI_LOAD_ERROR;
+        goto exit1;
+    }
+    Status = gBS->AllocatePool( EfiLoaderData, (UINTN)StateSize, &Buffer);
+    if(EFI_ERROR(Status))
+        goto exit1;
+    CopyMem(Buffer, Block, (UINTN)StateSize);
+    *Buffer_p = Buffer;
+    *BufferSize_p = (UINTN)StateSize;
+exit1:
+    gBS->FreePool(Pool);
+exit0:
+    return Status;
+}
+
+static EFI_STATUS EFIAPI BUMStateBlock_Write(   IN  CHAR8   *Target,
+                                                IN  UINT8   Slot,
+                                                IN  VOID*   Buffer,
+                                                IN  UINTN   BufferSize)
+{
+    EFI_STATUS Status;
+    EFI_BLOCK_IO_PROTOCOL *BlockIo;
+    VOID *Pool, *Block;
+
+    Status = BUMStateBlock_Find(Target, &BlockIo);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    if(BufferSize > BlockIo->Media->BlockSize){
+        Status = EFI_INVALID_PARAMETER;
+        goto exit0;
+    }
+    Status = BUMStateBlock_AllocBlock(BlockIo->Media, &Pool, &Block);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    ZeroMem(Block, BlockIo->Media->BlockSize);
+    CopyMem(Block, Buffer, BufferSize);
+    Status = BlockIo->WriteBlocks(  BlockIo,
+                                    BlockIo->Media->MediaId,
+                                    (EFI_LBA)Slot,
+                                    BlockIo->Media->BlockSize,
+                                    Block);
+    if(!EFI_ERROR(Status))
+        Status = BlockIo->FlushBlocks(BlockIo);
+    gBS->FreePool(Pool);
+exit0:
+    return Status;
+}
+
+CONST BUM_state_backend_t BUMStateBackend_Block = {
+    .Name   = "blk",
+    .Read   = BUMStateBlock_Read,
+    .Write  = BUMStateBlock_Write,
+};
@@ -34,22 +34,102 @@ static EFI_STATUS BootStat_CreateDir(VOID)
     return Status;
 }
 
-static EFI_STATUS BootStat_ReportToFile(IN CHAR8   *filename,
-                                        IN VOID*    buffer,
-                                        IN UINTN    buffersize )
+/******************************************************************************/
+/*  Captured records                                                          */
+/******************************************************************************/
+
+/*  The collectors only capture their values into memory. BootStat_persist
+    writes them out later as the entries of a single bootstat.bin (see
+    BootStatFile.h), so that no file is written while the values are
+    collected. */
+#define BOOTSTAT_RECORDS_MAX    (16)
+#define BOOTSTAT_NAME_MAX       (32)
+#define BOOTSTAT_INLINE_MAX     (40)
+
+/*  Data points either at Inline or at a pool buffer owned by the record */
+typedef struct {
+    CHAR8   Name[BOOTSTAT_NAME_MAX];
+    UINT16  Type;
+    VOID    *Data;
+    UINTN   Size;
+    BOOLEAN Owned;
+    UINT8   Inline[BOOTSTAT_INLINE_MAX];
+} BootStat_record_t;
+
+static BootStat_record_t    sgRecords[BOOTSTAT_RECORDS_MAX];
+static UINTN                sgRecordCount = 0;
+
+static BootStat_record_t *BootStat_NewRecord(IN CHAR8  *Name,
+                                                IN UINT16 Type)
 {
-    EFI_STATUS Status;
-    /*  generate path */
-    Status = Common_CreateWriteCloseDirFile(BOOTSTATDIR,
-                                            filename,
-                                            buffer,
-                                            buffersize);
-    if(EFI_ERROR(Status))
-        LogPrint(L"BootStat_ReportToFile: Common_CreateWriteCloseDirFile "
-                    L"failed (%d)", Status);
-    return Status;
+    BootStat_record_t *Record;
+    if( (BOOTSTAT_RECORDS_MAX == sgRecordCount) ||
+        EFI_ERROR(AsciiStrnCpyS(sgRecords[sgRecordCount].Name,
+                                BOOTSTAT_NAME_MAX,
+                                Name,
+                                BOOTSTAT_NAME_MAX - 1)) ){
+        LogPrint(   L"BootStat_NewRecord: no record for \"%a\"", Name);
+        return NULL;
+    }
+    Record = &(sgRecords[sgRecordCount++]);
+    Record->Type = Type;
+    Record->Data = NULL;
+    Record->Size = 0;
+    Record->Owned = FALSE;
+    return Record;
 }
 
+/*  Captures a copy of a small value */
+static EFI_STATUS BootStat_CaptureCopy( IN CHAR8   *Name,
+                                        IN UINT16   Type,
+                                        IN VOID*    Data,
+                                        IN UINTN    Size)
+{
+    BootStat_record_t *Record;
+    if(BOOTSTAT_INLINE_MAX < Size)
+        return EFI_BUFFER_TOO_SMALL;
+    Record = BootStat_NewRecord(Name, Type);
+    if(NULL == Record)
+        return EFI_OUT_OF_RESOURCES;
+    CopyMem(Record->Inline, Data, Size);
+    Record->Data = Record->Inline;
+    Record->Size = Size;
+    return EFI_SUCCESS;
+}
+
+/*  Captures a pool buffer (or NULL for an empty value), which is freed once
+    persisted. The buffer is freed here if it can not be captured. */
+static EFI_STATUS BootStat_CaptureTake( IN CHAR8   *Name,
+                                        IN UINT16   Type,
+                                        IN VOID*    Data,
+                                        IN UINTN    Size)
+{
+    BootStat_record_t *Record;
+    Record = BootStat_NewRecord(Name, Type);
+    if(NULL == Record){
+        if(NULL != Data)
+            gBS->FreePool(Data);
+        return EFI_OUT_OF_RESOURCES;
+    }
+    Record->Data = Data;
+    Record->Size = Size;
+    Record->Owned = (NULL != Data);
+    return EFI_SUCCESS;
+}
+
+static VOID BootStat_ReleaseRecords( void )
+{
+    UINTN i;
+    for( i = 0; i < sgRecordCount; i++ )
+        if(sgRecords[i].Owned)
+            gBS->FreePool(sgRecords[i].Data);
+    sgRecordCount = 0;
+}
+
+/******************************************************************************/
+/*  Collectors                                                                */
+/******************************************************************************/
+
 static EFI_STATUS BootStat_TimeStamp( void )
 {
     EFI_STATUS Status;
@@ -88,12 +168,27 @@ static EFI_STATUS BootStat_TimeStamp( void )
         return Status;
     }
 
-    Status = BootStat_ReportToFile(    "bum_timestamp",
-                                        TimeStampStringBuffer,
-                                        TIME_STAMP_STRING_LENGTH);
-    if( EFI_ERROR(Status) )
-        LogPrint(   L"BootStat_TimeStamp: BootStat_ReportToFile"
+    Status = BootStat_CaptureCopy(  "bum_timestamp",
+                                    BOOTSTAT_TYPE_STRING,
+                                    TimeStampStringBuffer,
+                                    TIME_STAMP_STRING_LENGTH);
+    if( EFI_ERROR(Status) ){
+        LogPrint(   L"BootStat_TimeStamp: BootStat_CaptureCopy"
                     L" failed (%d)", Status);
+        return Status;
+    }
+
+    /*  The TSC frequency, to turn TSC deltas into microseconds */
+    Printed = AsciiSPrint(  TimeStampStringBuffer,
+                            sizeof(TimeStampStringBuffer),
+                            "%u", BootTime_ticksPerUs() );
+    Status = BootStat_CaptureCopy(  "bum_tsc_ticks_per_us",
+                                    BOOTSTAT_TYPE_STRING,
+                                    TimeStampStringBuffer,
+                                    Printed);
+    if( EFI_ERROR(Status) )
+        LogPrint(   L"BootStat_TimeStamp: BootStat_CaptureCopy"
+                    L" failed (%d) for the TSC frequency", Status);
     return Status;
 }
 
@@ -118,33 +213,31 @@ static EFI_STATUS BootStat_SmBiosInfo( void )
         goto exit0;
     }
 
-    /* Output the strings to the boot-Status files. */
-    Status = BootStat_ReportToFile("smbiosinfo_vendor",
+    /*  Capture the strings; the records free them once persisted. */
+    Status = BootStat_CaptureTake(  "smbiosinfo_vendor",
+                                    BOOTSTAT_TYPE_STRING,
                                     Vendorp, VendorLen);
     if( EFI_ERROR(Status) )
-        LogPrint(   L"BootStat_SmBiosInfo: BootStat_ReportToFile"
+        LogPrint(   L"BootStat_SmBiosInfo: BootStat_CaptureTake"
                     L" failed (%d) for vendor", Status);
 
-    RetStatus = BootStat_ReportToFile("smbiosinfo_version",
+    RetStatus = BootStat_CaptureTake(   "smbiosinfo_version",
+                                        BOOTSTAT_TYPE_STRING,
                                         Versionp, VersionLen);
     if( EFI_ERROR(RetStatus) ){
         Status = RetStatus;
-        LogPrint(   L"BootStat_SmBiosInfo: BootStat_ReportToFile"
+        LogPrint(   L"BootStat_SmBiosInfo: BootStat_CaptureTake"
                     L" failed (%d) for version", Status);
     }
 
-    RetStatus = BootStat_ReportToFile("smbiosinfo_releasedate",
+    RetStatus = BootStat_CaptureTake(   "smbiosinfo_releasedate",
+                                        BOOTSTAT_TYPE_STRING,
                                         ReleaseDatep, ReleaseDateLen);
     if( EFI_ERROR(RetStatus) ){
         Status = RetStatus;
-        LogPrint(   L"BootStat_SmBiosInfo: BootStat_ReportToFile"
+        LogPrint(   L"BootStat_SmBiosInfo: BootStat_CaptureTake"
                     L" failed (%d) for release date", Status);
     }
-
-    /* Free all the allocated strings. */
-    gBS->FreePool(Vendorp);
-    gBS->FreePool(Versionp);
-    gBS->FreePool(ReleaseDatep);
 exit0:
     return Status;
 }
@@ -176,22 +269,24 @@ static EFI_STATUS BootStat_UEFINVInfo( void )
 
     LogPrint(   L"BootStat_UEFINVInfo: NVSize       = %d bytes",
                 MaximumVariableStorageSize );
-    CurrStatus = BootStat_ReportToFile("nvinfo_NVSize",
+    CurrStatus = BootStat_CaptureCopy(  "nvinfo_NVSize",
+                                        BOOTSTAT_TYPE_UINT64,
                                         &MaximumVariableStorageSize,
                                         sizeof(UINT64));
     if( EFI_ERROR(CurrStatus) ){
-        LogPrint(   L"BootStat_UEFINVInfo: BootStat_ReportToFile failed "
+        LogPrint(   L"BootStat_UEFINVInfo: BootStat_CaptureCopy failed "
                     L"for \"nvinfo_NVSize\"" );
         Status = CurrStatus;
     }
 
     LogPrint(   L"BootStat_UEFINVInfo: NVRemaining  = %d bytes",
                 RemainingVariableStorageSize );
-    CurrStatus = BootStat_ReportToFile("nvinfo_NVRemaining",
+    CurrStatus = BootStat_CaptureCopy(  "nvinfo_NVRemaining",
+                                        BOOTSTAT_TYPE_UINT64,
                                         &RemainingVariableStorageSize,
                                         sizeof(UINT64));
     if( EFI_ERROR(CurrStatus) ){
-        LogPrint(   L"BootStat_UEFINVInfo: BootStat_ReportToFile failed "
+        LogPrint(   L"BootStat_UEFINVInfo: BootStat_CaptureCopy failed "
                     L"for \"nvinfo_NVRemaining\"" );
         if( !EFI_ERROR(Status) )
             Status = CurrStatus;
@@ -199,11 +294,12 @@ static EFI_STATUS BootStat_UEFINVInfo( void )
 
     LogPrint(   L"BootStat_UEFINVInfo: MaxVarSize   = %d bytes",
                 MaximumVariableSize );
-    CurrStatus = BootStat_ReportToFile("nvinfo_MaxVarSize",
+    CurrStatus = BootStat_CaptureCopy(  "nvinfo_MaxVarSize",
+                                        BOOTSTAT_TYPE_UINT64,
                                         &MaximumVariableSize,
                                         sizeof(UINT64));
     if( EFI_ERROR(CurrStatus) ){
-        LogPrint(   L"BootStat_UEFINVInfo: BootStat_ReportToFile failed "
+        LogPrint(   L"BootStat_UEFINVInfo: BootStat_CaptureCopy failed "
                     L"for \"nvinfo_MaxVarSize\"" );
         if( !EFI_ERROR(Status) )
             Status = CurrStatus;
@@ -248,7 +344,7 @@ static inline EFI_STATUS BootStat_UEFIVar( BOOTSTAT_UEFIVAR_ENUM_t var_i )
     UINTN       buffersize;
     UINT32      attrs;
 
-    CHAR8   StatFileName_l[IMAGENAME_MAX];
+    CHAR8   StatFileName_l[BOOTSTAT_NAME_MAX];
     UINTN   StatFileNameLen;
 
     /* Read the UEFI varriable. */
@@ -272,22 +368,25 @@ static inline EFI_STATUS BootStat_UEFIVar( BOOTSTAT_UEFIVAR_ENUM_t var_i )
                                     sizeof(StatFileName_l),
                                     "uefivars_%s",
                                     BOOTSTAT_UEFIVAR_NAMES[var_i] );
-    if( (StatFileNameLen == 0) || (StatFileNameLen == IMAGENAME_MAX) ){
+    if( (StatFileNameLen == 0) || (StatFileNameLen == BOOTSTAT_NAME_MAX) ){
         LogPrint(   L"BootStat_UEFIVar: UnicodeSPrint failed to produce "
                     L"file name for \"%s\"",
                     BOOTSTAT_UEFIVAR_NAMES[ var_i ]);
-        goto exit1;
+        /* Free the UEFI varriable buffer. */
+        if(NULL != buffer)
+            gBS->FreePool(buffer);
+        goto exit0;
     }
 
-    /* Write the varriable to the file. */
-    Status = BootStat_ReportToFile(StatFileName_l, buffer, buffersize);
+    /* Capture the varriable; the record frees the buffer once persisted. */
+    Status = BootStat_CaptureTake(  StatFileName_l,
+                                    BOOTSTAT_TYPE_BINARY,
+                                    buffer,
+                                    buffersize);
     if( EFI_ERROR(Status) )
-        LogPrint(   L"BootStat_UEFIVar: BootStat_ReportToFile failed (%d) "
-                    L"for \"%s\"", Status, StatFileName_l);
+        LogPrint(   L"BootStat_UEFIVar: BootStat_CaptureTake failed (%d) "
+                    L"for \"%a\"", Status, StatFileName_l);
 
-exit1:
-    /* Free the UEFI varriable buffer. */
-    gBS->FreePool(buffer);
 exit0:
     return Status;
 }
@@ -307,18 +406,14 @@ static EFI_STATUS BootStat_UEFIVars( void )
     return Status;
 }
 
-typedef EFI_STATUS (*state_report_func_t)( void );
+typedef EFI_STATUS (*state_capture_func_t)( void );
 
 typedef struct {
-    BOOLEAN             supported;
-    CHAR16              *name;
-    state_report_func_t report;
+    BOOLEAN                 supported;
+    CHAR16                  *name;
+    state_capture_func_t    capture;
 } BootStat_Descriptor_t;
 
-static EFI_STATUS BootStat_SmBiosInfo( void );
-static EFI_STATUS BootStat_UEFINVInfo( void );
-static EFI_STATUS BootStat_UEFIVars( void );
-
 static BootStat_Descriptor_t BootStat_array[BOOTSTAT_ENUM_COUNT] =
         {   { TRUE, L"bum_timestamp",   BootStat_TimeStamp },
             { TRUE, L"smbios_info",     BootStat_SmBiosInfo },
@@ -326,30 +421,28 @@ static BootStat_Descriptor_t BootStat_array[BOOTSTAT_ENUM_COUNT] =
             { TRUE, L"uefi_vars",       BootStat_UEFIVars},
         };
 
-EFI_STATUS EFIAPI ReportBootStat(IN UINT64 BootStat_bitmap)
+/******************************************************************************/
+/*  Capture and persist                                                       */
+/******************************************************************************/
+
+EFI_STATUS EFIAPI BootStat_capture(IN UINT64 BootStat_bitmap)
 {
     BootStat_enum_t i;
     EFI_STATUS Status;
 
-    /*  Ensure we can open the boot sttaus directory.
-        Otherwise, we can't write anything else. */
-    Status = BootStat_CreateDir();
-    if(EFI_ERROR(Status))
-        LogPrint(   L"ReportBootStat: BootStat_CreateDir failed (%d)",
-                    Status);
-    else{
-        for( i = 0; i < BOOTSTAT_ENUM_COUNT; i++ ){
-            if( BootStat_bitmap & ((UINT64)1 << i) ){
-                if( ! BootStat_array[i].supported ){
-                    LogPrint(   L"ReportBootStat: WARNING Status (%d) not "
-                                L"supported", i );
-                } else {
-                    Status = BootStat_array[i].report();
-                    if( EFI_ERROR(Status) ){
-                        LogPrint(   L"ReportBootStat: Failed to report "
-                                    L"status \"%s\" (%d)",
-                                    BootStat_array[i].name, i );
-                    }
+    /*  Drop anything captured but not persisted */
+    BootStat_ReleaseRecords();
+    for( i = 0; i < BOOTSTAT_ENUM_COUNT; i++ ){
+        if( BootStat_bitmap & ((UINT64)1 << i) ){
+            if( ! BootStat_array[i].supported ){
+                LogPrint(   L"BootStat_capture: WARNING Status (%d) not "
+                            L"supported", i );
+            } else {
+                Status = BootStat_array[i].capture();
+                if( EFI_ERROR(Status) ){
+                    LogPrint(   L"BootStat_capture: Failed to capture "
+                                L"status \"%s\" (%d)",
+                                BootStat_array[i].name, i );
                 }
             }
         }
@@ -357,3 +450,75 @@ EFI_STATUS EFIAPI ReportBootStat(IN UINT64 BootStat_bitmap)
     return EFI_SUCCESS;
 }
 
+EFI_STATUS EFIAPI BootStat_persist( VOID )
+{
+    EFI_STATUS Status;
+    BOOTSTAT_header_t *Header;
+    BOOTSTAT_entry_t *Entry;
+    UINT8 *File;
+    UINT32 FileSize, NameLength, i;
+
+    if(0 == sgRecordCount)
+        return EFI_SUCCESS;
+    /*  Lay the records out as the entries of one file */
+    FileSize = sizeof(BOOTSTAT_header_t);
+    for( i = 0; i < sgRecordCount; i++ )
+        FileSize += BootStatFile_entrySize(
+                        (UINT32)AsciiStrLen(sgRecords[i].Name),
+                        (UINT32)sgRecords[i].Size);
+    Status = gBS->AllocatePool(EfiLoaderData, FileSize, (VOID**)&File);
+    if(EFI_ERROR(Status)){
+        LogPrint(   L"BootStat_persist: gBS->AllocatePool failed (%d)",
+                    Status);
+        goto exit0;
+    }
+    ZeroMem(File, FileSize);
+    Header = (BOOTSTAT_header_t*)File;
+    Header->Magic       = BOOTSTAT_MAGIC;
+    Header->Version     = BOOTSTAT_VERSION;
+    Header->HeaderSize  = sizeof(BOOTSTAT_header_t);
+    Header->FileSize    = FileSize;
+    Header->EntryCount  = (UINT32)sgRecordCount;
+    Entry = (BOOTSTAT_entry_t*)(File + sizeof(BOOTSTAT_header_t));
+    for( i = 0; i < sgRecordCount; i++ ){
+        NameLength = (UINT32)AsciiStrLen(sgRecords[i].Name);
+        Entry->Type         = sgRecords[i].Type;
+        Entry->NameLength   = (UINT16)NameLength;
+        Entry->ValueLength  = (UINT32)sgRecords[i].Size;
+        CopyMem(Entry + 1, sgRecords[i].Name, NameLength);
+        if(0 != sgRecords[i].Size)
+            CopyMem((UINT8*)(Entry + 1) + NameLength,
+                    sgRecords[i].Data,
+                    sgRecords[i].Size);
+        Entry = (BOOTSTAT_entry_t*)((UINT8*)Entry +
+                    BootStatFile_entrySize(NameLength, Entry->ValueLength));
+    }
+    Header->Checksum = Common_Crc32c(File, FileSize);
+    /*  A single file create and write for the whole boot status, in the
+        boot-status directory kept open for the boot-time history. The
+        directory is only created when it is missing. */
+    Status = Common_CreateWriteCloseDirFile(BOOTSTATDIR,
+                                            BOOTSTAT_FILENAME,
+                                            File,
+                                            FileSize);
+    if(EFI_NOT_FOUND == Status){
+        Status = BootStat_CreateDir();
+        if(EFI_ERROR(Status)){
+            LogPrint(   L"BootStat_persist: BootStat_CreateDir failed (%d)",
+                        Status);
+            goto exit1;
+        }
+        Status = Common_CreateWriteCloseDirFile(BOOTSTATDIR,
+                                                BOOTSTAT_FILENAME,
+                                                File,
+                                                FileSize);
+    }
+    if(EFI_ERROR(Status))
+        LogPrint(   L"BootStat_persist: Common_CreateWriteCloseDirFile "
+                    L"failed (%d)", Status);
+exit1:
+    gBS->FreePool(File);
+exit0:
+    BootStat_ReleaseRecords();
+    return Status;
+}
@@ -27,6 +27,11 @@ typedef enum {
 #define BOOTSTAT_BMAP_FULL          ((1 <<  BOOTSTAT_ENUM_COUNT) - 1)
 #define BOOTSTAT_BMAP_VALID         BOOTSTAT_BMAP_FULL
 
-EFI_STATUS EFIAPI ReportBootStat(IN UINT64               BootStat_bitmap);
+/*  Captures the boot status selected by BootStat_bitmap into memory,
+    without writing any file */
+EFI_STATUS EFIAPI BootStat_capture(IN UINT64            BootStat_bitmap);
+
+/*  Writes out and releases the captured boot status */
+EFI_STATUS EFIAPI BootStat_persist( VOID );
 
 #endif
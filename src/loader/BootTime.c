@@ -0,0 +1,313 @@
+/* BootTime.c - Record a TSC timeline of the boot phases of the root and
+ *              configuration BUMs (see BootTimeline.h).
+ */
+
+/* includes (header file) */
+
+#include "__BootTime.h"
+
+/*  The timeline of this boot. Marks carried over from the root BUM come first,
+    followed by the marks of this image starting at sgFirstMark. */
+static BOOTTIME_boot_t  sgTimeline;
+static UINT32           sgFirstMark = 0;
+static UINT8            sgStage = BOOTTIME_STAGE_UNKNOWN;
+
+/******************************************************************************/
+/*  Phase markers                                                             */
+/******************************************************************************/
+
+static inline VOID BootTime_add(IN BOOTTIME_phase_t Phase,
+                                IN UINT8            Kind)
+{
+    BOOTTIME_mark_t *mark;
+    /*  Marks past the end of the table are dropped */
+    if(sgTimeline.MarkCount < BOOTTIME_MARKS_MAX){
+        mark = &(sgTimeline.Marks[sgTimeline.MarkCount++]);
+        mark->TSC   = AsmReadTsc();
+        mark->Phase = (UINT8)Phase;
+        mark->Stage = sgStage;
+        mark->Kind  = Kind;
+    }
+}
+
+VOID EFIAPI BootTime_begin(IN BOOTTIME_phase_t  Phase)
+{
+    BootTime_add(Phase, BOOTTIME_MARK_BEGIN);
+}
+
+VOID EFIAPI BootTime_end(IN BOOTTIME_phase_t    Phase)
+{
+    BootTime_add(Phase, BOOTTIME_MARK_END);
+}
+
+VOID EFIAPI BootTime_mark(IN BOOTTIME_phase_t   Phase)
+{
+    BootTime_add(Phase, BOOTTIME_MARK_POINT);
+}
+
+VOID EFIAPI BootTime_setStage(IN UINT8  Stage)
+{
+    UINT32 i;
+    /*  The stage is only known once the current-config variable is read, so
+        also label the marks this image recorded before that. */
+    sgStage = Stage;
+    for( i = sgFirstMark; i < sgTimeline.MarkCount; i++)
+        sgTimeline.Marks[i].Stage = Stage;
+}
+
+VOID EFIAPI BootTime_nextStage(IN UINT8 Stage)
+{
+    sgFirstMark = sgTimeline.MarkCount;
+    sgStage = Stage;
+}
+
+/******************************************************************************/
+/*  TSC calibration                                                           */
+/******************************************************************************/
+
+/*  TRUE if CPUID.80000007H:EDX[8] reports an invariant TSC, which runs at
+    the same rate whatever the core frequency and power state */
+static BOOLEAN BootTime_tscIsInvariant(VOID)
+{
+    UINT32 MaxLeaf, Edx;
+    AsmCpuid(0x80000000, &MaxLeaf, NULL, NULL, NULL);
+    if(MaxLeaf < 0x80000007)
+        return FALSE;
+    AsmCpuid(0x80000007, NULL, NULL, NULL, &Edx);
+    return (0 != (Edx & BIT8));
+}
+
+/*  The TSC frequency reported by CPUID leaf 0x15 (TSC/crystal ratio and
+    crystal frequency), or zero if the processor does not report all three.
+    The nominal core frequency of leaf 0x16 is not used: it need not be the
+    TSC rate. */
+static UINT32 BootTime_cpuidTicksPerUs(VOID)
+{
+    UINT32 MaxLeaf, Denominator, Numerator, CrystalHz;
+    AsmCpuid(0, &MaxLeaf, NULL, NULL, NULL);
+    if(MaxLeaf < 0x15)
+        return 0;
+    AsmCpuid(0x15, &Denominator, &Numerator, &CrystalHz, NULL);
+    if( (0 == Denominator) || (0 == Numerator) || (0 == CrystalHz) )
+        return 0;
+    return (UINT32)DivU64x32(DivU64x32((UINT64)CrystalHz * Numerator,
+                                        Denominator),
+                             1000000);
+}
+
+/*  The TSC frequency recorded with the last boot in the boot-time history,
+    or zero if there is none. Every BOOTTIME_HISTORY_COUNT boots it is not
+    used, so that a history moved to other hardware is measured again. */
+static UINT32 BootTime_savedTicksPerUs(IN CHAR8 *BootStatDirPath)
+{
+    EFI_STATUS Status;
+    EFI_FILE_PROTOCOL *filep;
+    BOOTTIME_header_t header;
+    UINT32 TicksPerUs = 0;
+
+    Status = Common_OpenDirFile(&filep,
+                                BootStatDirPath,
+                                BOOTTIME_FILENAME,
+                                EFI_FILE_MODE_READ,
+                                0);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    Status = Common_ReadFileAt(filep, 0, &header, sizeof(header));
+    if( !EFI_ERROR(Status) && BootTime_headerIsValid(&header) &&
+        (0 != (header.Next % BOOTTIME_HISTORY_COUNT)) ){
+        Status = Common_ReadFileAt( filep,
+                                    BootTime_bootOffset(&header,
+                                                        header.Next - 1) +
+                                        OFFSET_OF(BOOTTIME_boot_t, TicksPerUs),
+                                    &TicksPerUs, sizeof(TicksPerUs));
+        if(EFI_ERROR(Status))
+            TicksPerUs = 0;
+    }
+    filep->Close(filep);
+exit0:
+    return TicksPerUs;
+}
+
+/*  Measures the TSC against gBS->Stall, unless the processor reports its
+    frequency or the boot-time history has it from an earlier boot. Neither
+    is taken unless the TSC is invariant: only then does its rate not change
+    within and between boots. */
+static VOID BootTime_calibrate(IN CHAR8 *BootStatDirPath)
+{
+    EFI_STATUS Status;
+    UINT64 start, stop;
+    sgTimeline.TicksPerUs = 0;
+    if(BootTime_tscIsInvariant()){
+        sgTimeline.TicksPerUs = BootTime_cpuidTicksPerUs();
+        if(0 == sgTimeline.TicksPerUs)
+            sgTimeline.TicksPerUs = BootTime_savedTicksPerUs(BootStatDirPath);
+    }
+    if(0 != sgTimeline.TicksPerUs)
+        return;
+    start = AsmReadTsc();
+    Status = gBS->Stall(BOOTTIME_CALIBRATE_US);
+    stop = AsmReadTsc();
+    if(EFI_ERROR(Status)){
+        LogPrint(L"BootTime_calibrate: gBS->Stall failed (%d)", Status);
+        sgTimeline.TicksPerUs = 0;
+    }else
+        sgTimeline.TicksPerUs = (UINT32)DivU64x32(  stop - start,
+                                                    BOOTTIME_CALIBRATE_US);
+}
+
+UINT32 EFIAPI BootTime_ticksPerUs(VOID)
+{
+    return sgTimeline.TicksPerUs;
+}
+
+/******************************************************************************/
+/*  Hand-off between images                                                   */
+/******************************************************************************/
+
+/*  Puts the carried marks in front of the ones recorded so far */
+static VOID BootTime_merge(IN CONST BOOTTIME_boot_t *Carried)
+{
+    UINT32 ownmarks = sgTimeline.MarkCount - sgFirstMark;
+    if(ownmarks > (BOOTTIME_MARKS_MAX - Carried->MarkCount))
+        ownmarks = BOOTTIME_MARKS_MAX - Carried->MarkCount;
+    CopyMem(&(sgTimeline.Marks[Carried->MarkCount]),
+            &(sgTimeline.Marks[sgFirstMark]),
+            ownmarks * sizeof(BOOTTIME_mark_t));
+    CopyMem(&sgTimeline, Carried, OFFSET_OF(BOOTTIME_boot_t, Marks) +
+                                    Carried->MarkCount * sizeof(BOOTTIME_mark_t));
+    sgFirstMark = Carried->MarkCount;
+    sgTimeline.MarkCount = Carried->MarkCount + ownmarks;
+}
+
+EFI_STATUS EFIAPI BootTime_init(IN EFI_GUID                 *VendorGuid,
+                                IN CONST BOOTTIME_boot_t    *Carried,
+                                IN CHAR8                    *BootStatDirPath)
+{
+    EFI_STATUS Status;
+    BOOTTIME_boot_t *carried;
+    UINTN carriedsize;
+    UINT32 attrs;
+    EFI_TIME TimeStamp;
+
+    /*  Take the timeline handed over with the BUM context */
+    if(NULL != Carried){
+        BootTime_merge(Carried);
+        Status = EFI_SUCCESS;
+        goto exit0;
+    }
+    /*  Read the timeline handed off by the previous image, if it may have
+        used a variable */
+    Status = (NULL == VendorGuid)? EFI_NOT_FOUND :
+                Common_ReadUEFIVariable(VendorGuid, BOOTTIME_VARNAME,
+                                        (VOID**)&carried, &carriedsize,
+                                        &attrs);
+    if(EFI_ERROR(Status)){
+        /*  No hand-off: this is the first image of the boot */
+        if(EFI_NOT_FOUND == Status){
+            if(EFI_ERROR(gRT->GetTime( &TimeStamp, NULL )))
+                TimeStamp = (EFI_TIME){0};
+            sgTimeline.Year     = TimeStamp.Year;
+            sgTimeline.Month    = TimeStamp.Month;
+            sgTimeline.Day      = TimeStamp.Day;
+            sgTimeline.Hour     = TimeStamp.Hour;
+            sgTimeline.Minute   = TimeStamp.Minute;
+            sgTimeline.Second   = TimeStamp.Second;
+            Status = EFI_SUCCESS;
+        }else
+            LogPrint(L"BootTime_init: Common_ReadUEFIVariable failed (%d)",
+                        Status);
+        BootTime_calibrate(BootStatDirPath);
+        goto exit0;
+    }
+    /*  The variable is only used once */
+    gRT->SetVariable(BOOTTIME_VARNAME, VendorGuid, 0, 0, NULL);
+    if( (sizeof(BOOTTIME_boot_t) != carriedsize) ||
+        (EFI_VARIABLE_BOOTSERVICE_ACCESS != attrs) ||
+        (carried->MarkCount > BOOTTIME_MARKS_MAX) ){
+        LogPrint(L"BootTime_init: invalid timeline variable");
+        BootTime_calibrate(BootStatDirPath);
+        Status = EFI_COMPROMISED_DATA;
+        goto exit1;
+    }
+    BootTime_merge(carried);
+    Status = EFI_SUCCESS;
+exit1:
+    gBS->FreePool(carried);
+exit0:
+    return Status;
+}
+
+EFI_STATUS EFIAPI BootTime_handOff(IN  EFI_GUID        *VendorGuid,
+                                    OUT BOOTTIME_boot_t *Timeline)
+{
+    EFI_STATUS Status;
+    CopyMem(Timeline, &sgTimeline, sizeof(sgTimeline));
+    if(NULL == VendorGuid)
+        return EFI_SUCCESS;
+    Status = gRT->SetVariable(  BOOTTIME_VARNAME,
+                                VendorGuid,
+                                EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                                sizeof(sgTimeline),
+                                &sgTimeline);
+    if(EFI_ERROR(Status))
+        LogPrint(L"BootTime_handOff: gRT->SetVariable failed (%d)", Status);
+    return Status;
+}
+
+/******************************************************************************/
+/*  Boot-time history                                                         */
+/******************************************************************************/
+
+EFI_STATUS EFIAPI BootTime_persist(IN CHAR8 *BootStatDirPath)
+{
+    EFI_STATUS Status, CloseStatus;
+    EFI_FILE_PROTOCOL *filep;
+    BOOTTIME_header_t header;
+
+    Status = Common_OpenDirFile(&filep,
+                                BootStatDirPath,
+                                BOOTTIME_FILENAME,
+                                (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
+                                    EFI_FILE_MODE_CREATE),
+                                0);
+    if(EFI_ERROR(Status)){
+        LogPrint(L"BootTime_persist: Common_OpenDirFile failed (%d) "
+                    L"for \"%a\\%a\"", Status, BootStatDirPath,
+                    BOOTTIME_FILENAME);
+        goto exit0;
+    }
+    /*  Read the history header, starting a new history if there is none */
+    Status = Common_ReadFileAt(filep, 0, &header, sizeof(header));
+    if(EFI_ERROR(Status) || !BootTime_headerIsValid(&header)){
+        ZeroMem(&header, sizeof(header));
+        header.Magic        = BOOTTIME_MAGIC;
+        header.Version      = BOOTTIME_VERSION;
+        header.HeaderSize   = sizeof(BOOTTIME_header_t);
+        header.BootSize     = sizeof(BOOTTIME_boot_t);
+        header.BootCount    = BOOTTIME_HISTORY_COUNT;
+        Status = Common_SetFileSize(filep, sizeof(BOOTTIME_header_t));
+        if(EFI_ERROR(Status)){
+            LogPrint(L"BootTime_persist: Common_SetFileSize failed (%d)",
+                        Status);
+            goto exit2;
+        }
+    }
+    /*  Write this boot into its slot, then publish it in the header */
+    sgTimeline.Sequence = header.Next;
+    Status = Common_WriteFileAt(filep,
+                                BootTime_bootOffset(&header, header.Next),
+                                &sgTimeline, sizeof(sgTimeline));
+    if(!EFI_ERROR(Status)){
+        header.Next++;
+        Status = Common_WriteFileAt(filep, 0, &header, sizeof(header));
+    }
+    if(EFI_ERROR(Status))
+        LogPrint(L"BootTime_persist: Common_WriteFileAt failed (%d)", Status);
+exit2:
+    CloseStatus = filep->Close(filep);
+    if(EFI_ERROR(CloseStatus))
+        if(!EFI_ERROR(Status))
+            Status = CloseStatus;
+exit0:
+    return Status;
+}
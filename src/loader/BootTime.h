@@ -0,0 +1,46 @@
+/* BootTime.h - Macros, structure definitions, and function headers for
+ *              BootTime.c
+ */
+
+#ifndef __BOOT_TIME__
+#define __BOOT_TIME__
+
+/*  Phase markers. These only read the TSC and append to a static table, so
+    they may be called before anything else is initialized. */
+VOID EFIAPI BootTime_begin(IN BOOTTIME_phase_t  Phase);
+
+VOID EFIAPI BootTime_end(IN BOOTTIME_phase_t    Phase);
+
+VOID EFIAPI BootTime_mark(IN BOOTTIME_phase_t   Phase);
+
+/*  Sets the stage (root or configuration BUM) of this image's marks */
+VOID EFIAPI BootTime_setStage(IN UINT8  Stage);
+
+/*  Starts the marks of a later stage run by this same image, as when the root
+    BUM runs the configuration BUM's logic itself. Earlier marks keep their
+    stage. */
+VOID EFIAPI BootTime_nextStage(IN UINT8 Stage);
+
+/*  Picks up the timeline handed off by the root BUM, if any, and otherwise
+    gets the TSC frequency: from CPUID, from the last boot recorded in the
+    boot-time history in BootStatDirPath, or by measuring it. Carried is the
+    timeline of the BUM context, or NULL if there is none; then, unless
+    VendorGuid is NULL, the timeline is looked for in the volatile variable
+    written by older BUMs. */
+EFI_STATUS EFIAPI BootTime_init(IN EFI_GUID                 *VendorGuid,
+                                IN CONST BOOTTIME_boot_t    *Carried,
+                                IN CHAR8                    *BootStatDirPath);
+
+/*  TSC ticks per microsecond, or zero if unknown */
+UINT32 EFIAPI BootTime_ticksPerUs(VOID);
+
+/*  Copies the timeline into the BUM context of the next image, and also
+    into a volatile variable unless VendorGuid is NULL */
+EFI_STATUS EFIAPI BootTime_handOff(IN  EFI_GUID        *VendorGuid,
+                                    OUT BOOTTIME_boot_t *Timeline);
+
+/*  Appends the timeline to the boot-time history in the boot-status
+    directory */
+EFI_STATUS EFIAPI BootTime_persist(IN CHAR8 *BootStatDirPath);
+
+#endif
@@ -16,9 +16,25 @@
 /*  Type and Constant Definitions                                             */
 /******************************************************************************/
 
+static EFI_GUID gBUMContextProtocolGuid = BUMCONTEXT_PROTOCOL_GUID;
+
+/*  Each BUM hands the configuration it boots to the image it starts in a BUM
+    context (see BUMContext.h) installed on the started image's handle. BUMs
+    older than the context read and write the volatile variable BUM_CURCONFIG
+    instead, and an A/B update mixes them with newer ones: a configuration
+    BUM is also handed its configuration and the timeline in the variables
+    BUM_CURCONFIG and BUM_TIMELINE, and an image started without a context
+    looks for them, so that it is the root BUM only if neither is found.
+    Defining BUM_NO_CURCONFIG_VAR at build time drops the variables, for a
+    deployment with no BUM older than the context. */
+#ifndef BUM_NO_CURCONFIG_VAR
 static EFI_GUID gEfiBUMVariableGuid = { 0x3B56CA66, 0x94B1, 0x11E6,
                                                 { 0x98, 0x06, 0xD8, 0x9D,
                                                   0x67, 0xF4, 0x0B, 0xD7 } };
+#define BUM_CURCONFIG_VARGUID   (&gEfiBUMVariableGuid)
+#else
+#define BUM_CURCONFIG_VARGUID   (NULL)
+#endif
 
 typedef enum {
     BUM_KEYUPDATE_PK_UPDAT,
@@ -85,6 +101,12 @@ static UINT32 BUM_KEYUPDATE_ATTRIBUTE_LIST[BUM_KEYUPDATE_TYPE_COUNT] =
                     BUM_KEYAPPEND_ATTRIBUTES, /* dbx append*/
                 };
 
+/* The boot-status directory: boot status and boot-time history */
+#define BUM_BOOTSTATDIR     "\\bootstatus"
+
+/* The most PE sections looked through for the build-ID record */
+#define BUM_PE_SECTIONS_MAX (16)
+
 /* (un|)comment the following to (en|dis)able TSC-based timing of the
    SetVariable operation
 #define BUM_TIME_KEYLOAD */
@@ -93,9 +115,24 @@ static UINT32 BUM_KEYUPDATE_ATTRIBUTE_LIST[BUM_KEYUPDATE_TYPE_COUNT] =
 /*  Global Variables                                                          */
 /******************************************************************************/
 
+/*  The build-ID record of this image, found in a configuration BUM's file to
+    tell that it is a copy of this image (see BUMBuildId.h) */
+#ifndef BUM_BUILD_ID
+#error "BUM_BUILD_ID must be defined (see build/build-id.sh)"
+#endif
+CONST BUM_buildId_t gBUMBuildId = { BUMBUILDID_MAGIC,
+                                    BUMBUILDID_STRING(BUM_BUILD_ID) };
+
 static EFI_HANDLE gLoadedImageHandle;
 static EFI_LOADED_IMAGE_PROTOCOL *gLoadedImageProtocol = NULL;
 
+/*  The BUM context this image was started with, and the one it hands to the
+    image it starts */
+static BUM_context_t *gBUMContext = NULL;
+static BUM_context_t gChildContext;
+/*  The boot attempt of the default configuration (see BUMContext.h) */
+static UINT64 gBootAttempt = 0;
+
 /******************************************************************************/
 /*  Miscellaneous functions                                                   */
 /******************************************************************************/
@@ -203,19 +240,21 @@ static VOID BUM_printVarInfo(   EFI_GUID *guid_p, CHAR16 *name_p,
 /*  Cur-config functions                                                     */
 /******************************************************************************/
 
+typedef enum {
+    BUM_CURIMAGE_ROOTBUM = 0,
+    BUM_CURIMAGE_CFGBUM = BUMCONTEXT_IMAGE_CFGBUM,
+    BUM_CURIMAGE_CFGPLD = BUMCONTEXT_IMAGE_CFGPLD,
+    BUM_CURIMAGE_TYPE_COUNT
+} BUM_CURIMAGE_TYPE_t;
+
+#ifndef BUM_NO_CURCONFIG_VAR
+
 #define BUM_CURCONFIG_CFGBUMPRFX   "BUM:"
 #define BUM_CURCONFIG_CFGPLDPRFX   "PLD:"
 #define BUM_CURCONFIG_VARSIZE   (sizeof(BUM_CURCONFIG_CFGBUMPRFX)\
                                     +   BUMSTATE_CONFIG_SIZE)
 #define BUM_CURCONFIG_VARNAME   L"BUM_CURCONFIG"
 
-typedef enum {
-    BUM_CURIMAGE_ROOTBUM = 0,
-    BUM_CURIMAGE_CFGBUM = 1,
-    BUM_CURIMAGE_CFGPLD = 2,
-    BUM_CURIMAGE_TYPE_COUNT
-} BUM_CURIMAGE_TYPE_t;
-
 static EFI_STATUS EFIAPI BUM_parseConfigVarValue(
                             IN  CHAR8 configvar[static BUM_CURCONFIG_VARSIZE],
                             OUT BUM_CURIMAGE_TYPE_t *imgtype_p,
@@ -363,7 +402,7 @@ static EFI_STATUS EFIAPI BUM_getCurConfigVar(
     return ret;
 }
 
-static EFI_STATUS EFIAPI BUM_getCurConfig(
+static EFI_STATUS EFIAPI BUM_getCurConfigFromVar(
                                 OUT BUM_CURIMAGE_TYPE_t *imgtype_p,
                                 OUT CHAR8 config[static BUMSTATE_CONFIG_MAXLEN])
 {
@@ -378,7 +417,7 @@ static EFI_STATUS EFIAPI BUM_getCurConfig(
             config[0] = '\0';
             ret = EFI_SUCCESS;
         }else{
-            LogPrint(L"BUM_getCurConfig: BUM_getCurConfigVar returned %d",
+            LogPrint(L"BUM_getCurConfigFromVar: BUM_getCurConfigVar returned %d",
                         ret);
         }
     }else{
@@ -387,7 +426,8 @@ static EFI_STATUS EFIAPI BUM_getCurConfig(
                                         imgtype_p,
                                         config);
         if(EFI_ERROR(ret)){
-            LogPrint(L"BUM_getCurConfig: BUM_parseConfigVarValue returned %d",
+            LogPrint(L"BUM_getCurConfigFromVar: BUM_parseConfigVarValue "
+                        L"returned %d",
                         ret);
         }
     }
@@ -396,13 +436,13 @@ static EFI_STATUS EFIAPI BUM_getCurConfig(
         EFI_STATUS cleanup = BUM_deleteVar( BUM_CURCONFIG_VARNAME,
                                             &gEfiBUMVariableGuid);
         if(EFI_ERROR(cleanup))
-            LogPrint(L"BUM_getCurConfig: BUM_deleteVar returned %d",
+            LogPrint(L"BUM_getCurConfigFromVar: BUM_deleteVar returned %d",
                         cleanup);
     }
     return ret;
 }
 
-static EFI_STATUS EFIAPI BUM_setCurConfig(
+static EFI_STATUS EFIAPI BUM_setCurConfigToVar(
                                 IN  BUM_CURIMAGE_TYPE_t imgtype,
                                 IN  CHAR8 config[static BUMSTATE_CONFIG_MAXLEN])
 {
@@ -412,18 +452,102 @@ static EFI_STATUS EFIAPI BUM_setCurConfig(
                                 imgtype,
                                 config);
     if(EFI_ERROR(ret)){
-        LogPrint(L"BUM_setCurConfig: BUM_setConfigVarValue returned %d",
+        LogPrint(L"BUM_setCurConfigToVar: BUM_setConfigVarValue returned %d",
                     ret);
     }else{
         ret = BUM_setCurConfigVar(configvar);
         if(EFI_ERROR(ret)){
-            LogPrint(L"BUM_setCurConfig: BUM_setCurConfigVar returned %d",
+            LogPrint(L"BUM_setCurConfigToVar: BUM_setCurConfigVar returned %d",
                         ret);
         }
     }
     return ret;
 }
 
+#endif
+
+static EFI_STATUS EFIAPI BUM_getCurConfig(
+                                OUT BUM_CURIMAGE_TYPE_t *imgtype_p,
+                                OUT CHAR8 config[static BUMSTATE_CONFIG_MAXLEN])
+{
+    EFI_STATUS ret;
+    if(NULL == gBUMContext){
+#ifndef BUM_NO_CURCONFIG_VAR
+        /*  Started without a context: by a BUM older than the context if
+            the variable is set, otherwise this is the root BUM */
+        ret = BUM_getCurConfigFromVar(imgtype_p, config);
+#else
+        /*  Started without a context: this is the root BUM */
+        *imgtype_p = BUM_CURIMAGE_ROOTBUM;
+        config[0] = '\0';
+        ret = EFI_SUCCESS;
+#endif
+        goto exit0;
+    }
+    /*  A context that does not check out was not installed by a BUM */
+    if(!BUMContext_isValid(gBUMContext)){
+        LogPrint(L"BUM_getCurConfig: invalid BUM context");
+        ret = EFI_COMPROMISED_DATA;
+        goto exit0;
+    }
+    ret = CopyConfig(config, gBUMContext->Config);
+    if(EFI_ERROR(ret)){
+        LogPrint(L"BUM_getCurConfig: invalid configuration in the BUM context");
+        goto exit0;
+    }
+    *imgtype_p = (BUM_CURIMAGE_TYPE_t)gBUMContext->ImageType;
+    gBootAttempt = gBUMContext->BootAttempt;
+exit0:
+    return ret;
+}
+
+/*  Installs the BUM context for the image about to be started on its handle.
+    The timeline is filled in by BootTime_handOff just before it starts. */
+static EFI_STATUS EFIAPI BUM_setCurConfig(
+                                IN  EFI_HANDLE LoadedImageHandle,
+                                IN  BUM_CURIMAGE_TYPE_t imgtype,
+                                IN  CHAR8 config[static BUMSTATE_CONFIG_MAXLEN])
+{
+    EFI_STATUS ret;
+    if( (BUM_CURIMAGE_CFGBUM != imgtype) && (BUM_CURIMAGE_CFGPLD != imgtype) ){
+        ret = EFI_UNSUPPORTED;
+        goto exit0;
+    }
+    ZeroMem(&gChildContext, sizeof(gChildContext));
+    gChildContext.Magic         = BUMCONTEXT_MAGIC;
+    gChildContext.Version       = BUMCONTEXT_VERSION;
+    gChildContext.Size          = sizeof(gChildContext);
+    gChildContext.ImageType     = (UINT32)imgtype;
+    gChildContext.BootAttempt   = gBootAttempt;
+    ret = CopyConfig(gChildContext.Config, config);
+    if(EFI_ERROR(ret)){
+        LogPrint(L"BUM_setCurConfig: CopyConfig returned %d", ret);
+        goto exit0;
+    }
+    ret = gBS->InstallProtocolInterface(&LoadedImageHandle,
+                                        &gBUMContextProtocolGuid,
+                                        EFI_NATIVE_INTERFACE,
+                                        &gChildContext);
+    if(EFI_ERROR(ret)){
+        LogPrint(L"BUM_setCurConfig: gBS->InstallProtocolInterface "
+                    L"returned %d", ret);
+        goto exit0;
+    }
+#ifndef BUM_NO_CURCONFIG_VAR
+    /*  A configuration BUM may be older than the context. A payload does
+        not read the variable. */
+    if(BUM_CURIMAGE_CFGBUM == imgtype){
+        ret = BUM_setCurConfigToVar(imgtype, config);
+        if(EFI_ERROR(ret))
+            gBS->UninstallProtocolInterface(LoadedImageHandle,
+                                            &gBUMContextProtocolGuid,
+                                            &gChildContext);
+    }
+#endif
+exit0:
+    return ret;
+}
+
 /******************************************************************************/
 /*  Key-Loading functions                                                     */
 /******************************************************************************/
@@ -540,19 +664,20 @@ exit0:
 static EFI_STATUS BUM_loadKeys( IN CHAR8 *CfgDirPathText )
 {
     EFI_STATUS FuncStatus, RetStatus;
-    CHAR16 *KeyDirPathText;
+    CHAR16 KeyDirPathText[PATHBUF_LEN];
     EFI_FILE_PROTOCOL *KeyDir = NULL;
     BUM_KEYUPDATE_TYPE_t i;
 
+    BootTime_begin(BOOTTIME_PHASE_LOADKEYS);
     RetStatus = Common_GetPathFromParts(CfgDirPathText,
                                         KEYDIR_NAME,
-                                        &KeyDirPathText);
-    LogPrint(L"    Loading keys from \"%s\"", KeyDirPathText);
+                                        KeyDirPathText);
     if(EFI_ERROR(RetStatus))
         LogPrint(L"BUM_loadKeys: Common_GetPathFromParts failed (%d) "
-                    L"for the config directory \"%s\"",
-                    CfgDirPathText);
+                    L"for the config directory \"%a\"",
+                    RetStatus, CfgDirPathText);
     else{
+        LogPrint(L"    Loading keys from \"%s\"", KeyDirPathText);
         /* Open the key directory */
         RetStatus = Common_OpenFile(&KeyDir,
                                     KeyDirPathText,
@@ -577,15 +702,8 @@ static EFI_STATUS BUM_loadKeys( IN CHAR8 *CfgDirPathText )
             /* Close the key directory. Close never fails. */
             KeyDir->Close( KeyDir );
         }
-        /*  Free the path string */
-        FuncStatus = Common_FreePath(KeyDirPathText);
-        if(EFI_ERROR(FuncStatus)){
-            LogPrint(L"BUM_loadKeys: Common_FreePath failed (%d)",
-                        FuncStatus);
-            if(!EFI_ERROR(RetStatus))
-                RetStatus = FuncStatus;
-        }
     }
+    BootTime_end(BOOTTIME_PHASE_LOADKEYS);
     return RetStatus;
 }
 
@@ -611,6 +729,18 @@ static EFI_STATUS BUM_init( IN EFI_HANDLE LoadedImageHandle )
         if(!EFI_ERROR(Status)){
             /*  Setup logging */
             LogPrint_init();
+            /*  Pick up the BUM context this image was started with, if any,
+                and with it the timeline of the root BUM. Otherwise,
+                calibrate the TSC. */
+            if(EFI_ERROR(gBS->HandleProtocol(   LoadedImageHandle,
+                                                &gBUMContextProtocolGuid,
+                                                (VOID**)&gBUMContext)))
+                gBUMContext = NULL;
+            BootTime_init(  BUM_CURCONFIG_VARGUID,
+                            ( (NULL != gBUMContext) &&
+                              BUMContext_isValid(gBUMContext) )?
+                                &(gBUMContext->Timeline) : NULL,
+                            BUM_BOOTSTATDIR);
             Status = EFI_SUCCESS;
         }
     }
@@ -621,6 +751,8 @@ static EFI_STATUS BUM_init( IN EFI_HANDLE LoadedImageHandle )
 static EFI_STATUS BUM_fini( void )
 {
     EFI_STATUS Status;
+    /* Write out any buffered log lines while the file system is open */
+    LogPrint_fini( );
     /* Close the root directory of the boot partition */
     Status = Common_FileOpsClose( );
     if(!EFI_ERROR(Status)){
@@ -647,14 +779,15 @@ static EFI_STATUS EFIAPI BUM_LoadImage( IN CHAR8        *ConfigDirPath,
                                         IN CHAR8        *ImageName,
                                         OUT EFI_HANDLE  *LoadedImageHandle_p)
 {
-    EFI_STATUS ret, cleanup_ret;
-    CHAR16 *ImagePathString;
+    EFI_STATUS ret;
+    CHAR16 ImagePathString[PATHBUF_LEN];
     EFI_DEVICE_PATH_PROTOCOL *imageDPPp;
     EFI_HANDLE LoadedImageHandle;
+    BootTime_begin(BOOTTIME_PHASE_LOADIMAGE);
     /*  Generate the image path */
     ret = Common_GetPathFromParts(  ConfigDirPath,
                                     ImageName,
-                                    &ImagePathString);
+                                    ImagePathString);
     if(EFI_ERROR(ret))
         LogPrint(L"BUM_LoadImage: Common_GetPathFromParts failed (%d)",
                     ret);
@@ -683,21 +816,15 @@ static EFI_STATUS EFIAPI BUM_LoadImage( IN CHAR8        *ConfigDirPath,
             /* Succeed or fail, the DevicePathProtocol should be freed. */
             gBS->FreePool(imageDPPp);
         }
-        /* Succeed or fail, the image path should be freed. */
-        cleanup_ret = Common_FreePath(ImagePathString);
-        if(EFI_ERROR(cleanup_ret)){
-            LogPrint(L"BUM_LoadImage: Common_FreePath returned (%d) ",
-                        cleanup_ret);
-            if(!EFI_ERROR(ret))
-                ret = cleanup_ret;
-        }
     }
+    BootTime_end(BOOTTIME_PHASE_LOADIMAGE);
     return ret;
 }
 
 static EFI_STATUS EFIAPI BUM_LoadKeyLoadImage(  IN CHAR8        *ConfigDirPath,
                                                 IN CHAR8        *ImageName,
                                                 IN BOOLEAN      LoadKeysByDefault,
+                                                IN BOOLEAN      CaptureBootStatus,
                                                 IN EFI_HANDLE   *LoadedImageHandle_p)
 {
     EFI_STATUS ret, LoadKey_ret;
@@ -709,6 +836,14 @@ static EFI_STATUS EFIAPI BUM_LoadKeyLoadImage(  IN CHAR8        *ConfigDirPath,
         /*  Failure in loading keys is not fatal */
     }else
         LoadKey_ret = EFI_SUCCESS;
+    /*  Capture the boot status, with the keys just loaded, before the image
+        is loaded: only its write is left for just before the image starts */
+    if(CaptureBootStatus){
+        BootTime_begin(BOOTTIME_PHASE_BOOTSTAT);
+        if(EFI_ERROR(BootStat_capture(BOOTSTAT_BMAP_FULL)))
+            LogPrint(L"BUM_LoadKeyLoadImage: BootStat_capture failed");
+        BootTime_end(BOOTTIME_PHASE_BOOTSTAT);
+    }
     /*  Make first attempt at loading the image */
     ret = BUM_LoadImage(ConfigDirPath,
                         ImageName,
@@ -735,6 +870,103 @@ static EFI_STATUS EFIAPI BUM_LoadKeyLoadImage(  IN CHAR8        *ConfigDirPath,
     return ret;
 }
 
+/*  Returns TRUE if the image ImageName of the configuration is a copy of this
+    image: its file holds this image's build-ID record (see BUMBuildId.h) in
+    the section holding the record's RVA. Only the PE headers and the record
+    are read from the file; this image's record is compared from memory.
+    Running this image's own code for it then does what loading and starting
+    it would, without the load and its verification. */
+static BOOLEAN EFIAPI BUM_isThisImage(  IN CHAR8        *ConfigDirPath,
+                                        IN CHAR8        *ImageName)
+{
+    EFI_STATUS ret;
+    EFI_FILE_PROTOCOL *filep;
+    EFI_IMAGE_DOS_HEADER DosHeader;
+    struct {
+        UINT32                  Signature;
+        EFI_IMAGE_FILE_HEADER   FileHeader;
+    } NtHeader;
+    EFI_IMAGE_SECTION_HEADER Sections[BUM_PE_SECTIONS_MAX];
+    BUM_buildId_t BuildId;
+    UINT8 *ImageBase = (UINT8*)gLoadedImageProtocol->ImageBase;
+    UINT64 Rva;
+    UINTN SectionCount, i;
+    BOOLEAN Same = FALSE;
+
+    /*  The record's RVA in this image */
+    if( (NULL == ImageBase) || ((CONST UINT8*)&gBUMBuildId < ImageBase) )
+        goto exit0;
+    Rva = (UINT64)((CONST UINT8*)&gBUMBuildId - ImageBase);
+    if(Rva + sizeof(BUM_buildId_t) > gLoadedImageProtocol->ImageSize)
+        goto exit0;
+    ret = Common_OpenDirFile(   &filep,
+                                ConfigDirPath,
+                                ImageName,
+                                EFI_FILE_MODE_READ,
+                                0);
+    if(EFI_ERROR(ret))
+        goto exit0;
+    /*  The section table of the file */
+    ret = Common_ReadFileAt(filep, 0, &DosHeader, sizeof(DosHeader));
+    if( EFI_ERROR(ret) || (EFI_IMAGE_DOS_SIGNATURE != DosHeader.e_magic) )
+        goto exit1;
+    ret = Common_ReadFileAt(filep,
+                            DosHeader.e_lfanew,
+                            &NtHeader,
+                            sizeof(NtHeader));
+    if( EFI_ERROR(ret) || (EFI_IMAGE_NT_SIGNATURE != NtHeader.Signature) )
+        goto exit1;
+    SectionCount = MIN( NtHeader.FileHeader.NumberOfSections,
+                        BUM_PE_SECTIONS_MAX);
+    ret = Common_ReadFileAt(filep,
+                            (UINT64)DosHeader.e_lfanew + sizeof(NtHeader) +
+                                NtHeader.FileHeader.SizeOfOptionalHeader,
+                            Sections,
+                            SectionCount * sizeof(Sections[0]));
+    if(EFI_ERROR(ret))
+        goto exit1;
+    /*  The record, from the raw data of the section holding its RVA */
+    for(i = 0; i < SectionCount; i++){
+        if( (Rva >= Sections[i].VirtualAddress) &&
+            (Rva + sizeof(BuildId) <= (UINT64)Sections[i].VirtualAddress +
+                                        Sections[i].SizeOfRawData) )
+            break;
+    }
+    if(SectionCount == i)
+        goto exit1;
+    ret = Common_ReadFileAt(filep,
+                            (UINT64)Sections[i].PointerToRawData +
+                                (Rva - Sections[i].VirtualAddress),
+                            &BuildId,
+                            sizeof(BuildId));
+    Same =  !EFI_ERROR(ret) &&
+            (0 == CompareMem(&BuildId, &gBUMBuildId, sizeof(BuildId)));
+exit1:
+    filep->Close(filep);
+exit0:
+    return Same;
+}
+
+/*  A started image that returns control normally gets the system reset.
+    Defining BUM_FALLBACK_ON_RETURN at build time makes a configuration BUM
+    that returns (it could not start its payload) fail back to the root BUM
+    instead, which then falls back to the other configuration in place. */
+#ifdef BUM_FALLBACK_ON_RETURN
+#define BUM_RESET_ON_RETURN(imgtype)    (BUM_CURIMAGE_CFGBUM != (imgtype))
+#else
+#define BUM_RESET_ON_RETURN(imgtype)    (TRUE)
+#endif
+
+/*  Reboots the system once a started image has returned control */
+static VOID EFIAPI BUM_resetSystem( IN  EFI_STATUS Status )
+{
+    LogPrint(L"BUM_resetSystem: rebooting ... ");
+    LogPrint_flush();
+    gRT->ResetSystem(   EfiResetCold,
+                        Status,
+                        0, NULL);
+}
+
 static EFI_STATUS EFIAPI BUM_SetConfigBootImage(
                                 IN  EFI_HANDLE LoadedImageHandle,
                                 IN  BUM_CURIMAGE_TYPE_t imgtype,
@@ -742,29 +974,47 @@ static EFI_STATUS EFIAPI BUM_SetConfigBootImage(
                                 IN  BOOLEAN ReportBootStatus )
 {
     EFI_STATUS ret;
-    ret = BUM_setCurConfig( imgtype,
+    ret = BUM_setCurConfig( LoadedImageHandle,
+                            imgtype,
                             Config);
     if(EFI_ERROR(ret)){
         LogPrint(L"BUM_SetStateBootImage: BUM_setCurConfig "
                     L"failed (%d) for Config \"%a\"", ret, Config);
     }else{
-        /* Report Boot Status if requested */
+        LogPrint(L"    Starting image ...");
+        /*  Write the boot status captured before the image was loaded with
+            the other files written to the boot-status directory just before
+            the image starts. */
         if(ReportBootStatus){
-            ret = ReportBootStat(BOOTSTAT_BMAP_FULL);
-            if(EFI_ERROR(ret))
-                LogPrint(L"BUM_SetStateBootImage: ReportBootStat failed");
+            BootTime_begin(BOOTTIME_PHASE_BOOTSTATPUT);
+            if(EFI_ERROR(BootStat_persist()))
+                LogPrint(L"BUM_SetStateBootImage: BootStat_persist failed");
+            BootTime_end(BOOTTIME_PHASE_BOOTSTATPUT);
         }
-        LogPrint(L"    Starting image ...");
+        /*  The configuration BUM records the boot timeline; the root BUM
+            passes its part on to the configuration BUM. Both hand it to the
+            started image with the BUM context. */
+        BootTime_mark(BOOTTIME_PHASE_STARTIMAGE);
+        if(BUM_CURIMAGE_CFGPLD == imgtype)
+            BootTime_persist(BUM_BOOTSTATDIR);
+        BootTime_handOff(   (BUM_CURIMAGE_CFGPLD == imgtype)?
+                                NULL : BUM_CURCONFIG_VARGUID,
+                            &(gChildContext.Timeline));
+        /*  The started image logs to the same directory */
+        LogPrint_flush();
         ret = gBS->StartImage(LoadedImageHandle, NULL, NULL);
         if(EFI_ERROR(ret)){
             LogPrint(L"BUM_SetStateBootImage: gBS->StartImage failed (%d)", ret);
         }
         LogPrint(L"BUM_SetConfigBootImage: StartImage returned control ... ");
-        /*  If control reaches here, reboot the system */
-        LogPrint(L"BUM_SetConfigBootImage: rebooting ... ");
-        gRT->ResetSystem(   EfiResetCold,
-                            ret,
-                            0, NULL);
+        gBS->UninstallProtocolInterface(LoadedImageHandle,
+                                        &gBUMContextProtocolGuid,
+                                        &gChildContext);
+        if(BUM_RESET_ON_RETURN(imgtype)){
+            /*  If control reaches here, reboot the system */
+            BUM_resetSystem(ret);
+        }else if(!EFI_ERROR(ret))
+            ret = EFI_ABORTED;
     }
     return ret;
 }
@@ -782,6 +1032,7 @@ EFI_STATUS EFIAPI BUM_loadKeysSetStateBootImage(
     ret = BUM_LoadKeyLoadImage( Config,
                                 ImageName,
                                 LoadKeysByDefault,
+                                ReportBootStatus,
                                 &LoadedImageHandle);
     if(EFI_ERROR(ret)){
         LogPrint(L"BUM_loadKeysSetStateBootImage: "
@@ -795,7 +1046,7 @@ EFI_STATUS EFIAPI BUM_loadKeysSetStateBootImage(
                                         ReportBootStatus);
         LogPrint(L"BUM_loadKeysSetStateBootImage: "
                         L"BUM_SetStateBootImage returned (%d)", ret);
-        /*FIXME: unload image here */
+        gBS->UnloadImage(LoadedImageHandle);
     }
     return ret;
 }
@@ -804,7 +1055,12 @@ EFI_STATUS EFIAPI BUM_loadKeysSetStateBootImage(
 /*  Main                                                                      */
 /******************************************************************************/
 
+/*  The state location (see BUMState.h). Defining BUM_STATEDIR at build time
+    as "var:" or "blk:<partition number>" keeps the state in UEFI variables
+    or in the first two blocks of a reserved partition on the boot disk. */
+#ifndef BUM_STATEDIR
 #define BUM_STATEDIR        "\\bumstate"
+#endif
 #define BUM_IMAGENAME       "bootx64.efi"
 #define PAYLOAD_IMAGENAME   "payload.efi"
 
@@ -827,46 +1083,116 @@ EFI_STATUS BUM_config_main( IN  CHAR8   Config[static BUMSTATE_CONFIG_MAXLEN])
     return ret;
 }
 
-EFI_STATUS BUM_root_main( VOID )
+/*  Applies the boot-time logic to the state, or the fall-back logic if the
+    configuration it picked failed to boot, writes the state back, and gets
+    the configuration to boot next */
+static EFI_STATUS EFIAPI BUM_rootNextConfig(
+                                IN  BOOLEAN BootFailed,
+                                OUT CHAR8   Config[static BUMSTATE_CONFIG_MAXLEN])
 {
     EFI_STATUS ret, cleanup_ret;
-    BUM_state_t *BUM_state_p;
-    char Config[BUMSTATE_CONFIG_MAXLEN];
+    BUM_state_handle_t BUM_state;
     /*  Get the BUM state */
-    ret = BUMState_Get(BUM_STATEDIR, &BUM_state_p);
-    if(EFI_ERROR(ret))
-        LogPrint(L"BUM_root_main: BUMState_Get failed (%d)\n",
+    BootTime_begin(BOOTTIME_PHASE_STATEGET);
+    ret = BUMState_Open(BUM_STATEDIR, &BUM_state);
+    BootTime_end(BOOTTIME_PHASE_STATEGET);
+    if(EFI_ERROR(ret)){
+        LogPrint(L"BUM_rootNextConfig: BUMState_Open failed (%d)\n",
                     ret);
-    else{
+        goto exit0;
+    }
+    if(BootFailed){
+        /*  Give up on the configuration that failed */
+        ret = BUMStateNext_BootFailure(BUM_state.State);
+        if(EFI_ERROR(ret)){
+            LogPrint(L"BUM_rootNextConfig: no configuration to fall back "
+                        L"to (%d)\n", ret);
+            goto exit1;
+        }
+    }else{
         /*  Perform the boot-time logic. */
-        BUMStateNext_BootTime(BUM_state_p);
-        /*  Get the actual configurtaion name from the state */
-        ret = BUMState_getCurrConfig(BUM_state_p, Config);
-        /*  Write the state back out to file */
-        cleanup_ret = BUMState_Put( BUM_STATEDIR,
-                                    BUM_state_p);
-        if(EFI_ERROR(cleanup_ret))
-            LogPrint(L"BUM_root_main: BUMState_Put failed (%d)\n",
-                        cleanup_ret);
-        /*  Free the state */
-        cleanup_ret = BUMState_Free(BUM_state_p);
-        if(EFI_ERROR(cleanup_ret))
-            LogPrint(L"BUM_root_main: BUMState_Free failed (%d)\n",
-                        cleanup_ret);
-        /*  Check if we successfully got the configurtaion name */
-        if(EFI_ERROR(ret))
-            LogPrint(L"BUM_root_main: BUMState_getCurrConfig failed (%d)\n",
-                        ret);
-        else{
-            /*  Try to boot the configurtaion-specific BUM image */
-            ret = BUM_loadKeysSetStateBootImage(Config,
+        BUMStateNext_BootTime(BUM_state.State);
+    }
+    /*  Count the attempt for the BUM context */
+    gBootAttempt =
+        (BUMSTATE_CONFIG_DFLT == BUM_state.State->Flags.CurrConfig)?
+            BUM_state.State->DfltAttemptCount -
+                BUM_state.State->DfltAttemptsRemaining : 0;
+    /*  Get the actual configuration name from the state */
+    ret = BUMState_getCurrConfig(BUM_state.State, Config);
+    /*  Write the state back out to file */
+    BootTime_begin(BOOTTIME_PHASE_STATEPUT);
+    cleanup_ret = BUMState_Commit(&BUM_state);
+    BootTime_end(BOOTTIME_PHASE_STATEPUT);
+    if(EFI_ERROR(cleanup_ret))
+        LogPrint(L"BUM_rootNextConfig: BUMState_Commit failed (%d)\n",
+                    cleanup_ret);
+    /*  Check if we successfully got the configuration name */
+    if(EFI_ERROR(ret))
+        LogPrint(L"BUM_rootNextConfig: BUMState_getCurrConfig failed (%d)\n",
+                    ret);
+exit1:
+    /*  Close the state */
+    cleanup_ret = BUMState_Close(&BUM_state);
+    if(EFI_ERROR(cleanup_ret))
+        LogPrint(L"BUM_rootNextConfig: BUMState_Close failed (%d)\n",
+                    cleanup_ret);
+exit0:
+    return ret;
+}
+
+/*  Boots the configuration BUM of Config. A configuration BUM identical to
+    the root BUM is not loaded: the root BUM runs the configuration BUM's
+    logic itself, with the same key loading and boot-status reporting. Like
+    the started image, it only returns if the payload could not be started,
+    and then resets the system unless built with BUM_FALLBACK_ON_RETURN. */
+static EFI_STATUS EFIAPI BUM_rootBootConfig(
+                                IN  CHAR8   Config[static BUMSTATE_CONFIG_MAXLEN])
+{
+    EFI_STATUS ret;
+    if(!BUM_isThisImage(Config, BUM_IMAGENAME))
+        return BUM_loadKeysSetStateBootImage(   Config,
                                                 BUM_IMAGENAME,
                                                 BUM_CURIMAGE_CFGBUM,
                                                 FALSE,
                                                 FALSE);
-            if(EFI_ERROR(ret))
-                LogPrint(L"BUM_root_main: BUM_loadKeysSetStateBootImage "
-                            L"failed (%d)\n", ret);
+    LogPrint(L"    \"%a\\%a\" is this image: running it in place ...",
+                Config, BUM_IMAGENAME);
+    LogPrint_setContextLabel(L"Config BUM");
+    BootTime_nextStage(BOOTTIME_STAGE_CONFIG);
+    LogPrint(L"    Configuration:    %a", Config);
+    ret = BUM_config_main(Config);
+    LogPrint_setContextLabel(L"Root BUM");
+    BootTime_nextStage(BOOTTIME_STAGE_ROOT);
+    LogPrint(L"BUM_rootBootConfig: BUM_config_main returned (%d)", ret);
+    if(BUM_RESET_ON_RETURN(BUM_CURIMAGE_CFGBUM))
+        BUM_resetSystem(ret);
+    else if(!EFI_ERROR(ret))
+        ret = EFI_ABORTED;
+    return ret;
+}
+
+EFI_STATUS BUM_root_main( VOID )
+{
+    EFI_STATUS ret;
+    char Config[BUMSTATE_CONFIG_MAXLEN];
+    /*  Pick the configuration and try to boot its BUM image. If the image of
+        the default configuration cannot be loaded (or, with
+        BUM_FALLBACK_ON_RETURN, returns), fall back to the alternate now
+        rather than spending a reset on each of its remaining attempts. */
+    ret = BUM_rootNextConfig(FALSE, Config);
+    if(!EFI_ERROR(ret)){
+        ret = BUM_rootBootConfig(Config);
+        if(EFI_ERROR(ret)){
+            LogPrint(L"BUM_root_main: BUM_rootBootConfig "
+                        L"failed (%d) for \"%a\"\n", ret, Config);
+            if(!EFI_ERROR(BUM_rootNextConfig(TRUE, Config))){
+                LogPrint(L"    Falling back to \"%a\" ...", Config);
+                ret = BUM_rootBootConfig(Config);
+                if(EFI_ERROR(ret))
+                    LogPrint(L"BUM_root_main: BUM_rootBootConfig "
+                                L"failed (%d) for \"%a\"\n", ret, Config);
+            }
         }
     }
     return ret;
@@ -880,7 +1206,9 @@ EFI_STATUS EFIAPI BUM_main( IN EFI_HANDLE       LoadedImageHandle,
     BUM_CURIMAGE_TYPE_t imgtype = BUM_CURIMAGE_TYPE_COUNT;
     CHAR8   ConfigLocal[BUMSTATE_CONFIG_MAXLEN]= "\0";
 
+    BootTime_begin(BOOTTIME_PHASE_INIT);
     FuncStatus = BUM_init(LoadedImageHandle);
+    BootTime_end(BOOTTIME_PHASE_INIT);
     if(EFI_ERROR(FuncStatus)){
         AppStatus = FuncStatus;
         goto exit0;
@@ -901,12 +1229,14 @@ EFI_STATUS EFIAPI BUM_main( IN EFI_HANDLE       LoadedImageHandle,
             case BUM_CURIMAGE_ROOTBUM:
                 /*  This is the root BUM. */
                 LogPrint_setContextLabel(L"Root BUM");
+                BootTime_setStage(BOOTTIME_STAGE_ROOT);
                 AppStatus = BUM_root_main();
                 LogPrint(L"BUM_main: BUM_root_main failed with status (%d)",
                             AppStatus);
                 break;
             case BUM_CURIMAGE_CFGBUM:
                 LogPrint_setContextLabel(L"Config BUM");
+                BootTime_setStage(BOOTTIME_STAGE_CONFIG);
                 LogPrint(L"    Configuration:    %a",
                             ConfigLocal);
                 /*  This is a configuration BUM. */
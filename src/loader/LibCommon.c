@@ -50,6 +50,74 @@ exit0:
 }
 
 static EFI_FILE_PROTOCOL *sgBootPart_RootDir = NULL;
+static EFI_HANDLE sgBootPart_Handle = NULL;
+
+/*  Directories opened by Common_OpenDirFile, kept open until
+    Common_FileOpsClose so that the files in them are looked up from the
+    directory rather than walked to from the root on every open. Entries are
+    replaced round-robin; longer directory paths are not cached. */
+#define DIRCACHE_ENTRIES    (4)
+#define DIRCACHE_PATHLEN    (64)
+
+typedef struct {
+    CHAR8               Path[DIRCACHE_PATHLEN];
+    EFI_FILE_PROTOCOL   *Dir;
+} Common_DirCacheEntry_t;
+
+static Common_DirCacheEntry_t sgDirCache[DIRCACHE_ENTRIES];
+static UINTN sgDirCache_Next = 0;
+
+static VOID Common_DirCacheFlush( VOID )
+{
+    UINTN i;
+    for(i = 0; i < DIRCACHE_ENTRIES; i++){
+        if(NULL != sgDirCache[i].Dir)
+            sgDirCache[i].Dir->Close(sgDirCache[i].Dir);
+        sgDirCache[i].Dir = NULL;
+        sgDirCache[i].Path[0] = '\0';
+    }
+    sgDirCache_Next = 0;
+}
+
+/*  Returns the open directory dirpath, opening it from the root on a miss */
+static EFI_STATUS Common_DirCacheGet(   IN  CHAR8               *dirpath,
+                                        OUT EFI_FILE_PROTOCOL   **Dir_pp)
+{
+    EFI_STATUS Status;
+    CHAR16 path[DIRCACHE_PATHLEN];
+    Common_DirCacheEntry_t *Entry;
+    UINTN i, len;
+    for(i = 0; i < DIRCACHE_ENTRIES; i++){
+        if( (NULL != sgDirCache[i].Dir) &&
+            (0 == AsciiStrCmp(sgDirCache[i].Path, dirpath)) ){
+            *Dir_pp = sgDirCache[i].Dir;
+            return EFI_SUCCESS;
+        }
+    }
+    len = AsciiStrnLenS(dirpath, DIRCACHE_PATHLEN);
+    if(DIRCACHE_PATHLEN <= len)
+        return EFI_UNSUPPORTED;
+    Status = AsciiStrToUnicodeStrS(dirpath, path, len + 1);
+    if(EFI_ERROR(Status))
+        return Status;
+    Status = Common_OpenFile(   Dir_pp,
+                                path,
+                                (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE));
+    if(EFI_ERROR(Status))
+        return Status;
+    Entry = &(sgDirCache[sgDirCache_Next]);
+    sgDirCache_Next = (sgDirCache_Next + 1) % DIRCACHE_ENTRIES;
+    if(NULL != Entry->Dir)
+        Entry->Dir->Close(Entry->Dir);
+    Entry->Dir = *Dir_pp;
+    CopyMem(Entry->Path, dirpath, len + 1);
+    return EFI_SUCCESS;
+}
+
+EFI_HANDLE EFIAPI Common_GetBootPartHandle( VOID )
+{
+    return sgBootPart_Handle;
+}
 
 EFI_STATUS EFIAPI Common_FileOpsInit(   EFI_HANDLE  BootPartHandle)
 {
@@ -69,6 +137,8 @@ EFI_STATUS EFIAPI Common_FileOpsInit(   EFI_HANDLE  BootPartHandle)
         if (EFI_ERROR(Status))
             /*  On failing to open the root directory, set protocol to NULL */
             sgBootPart_RootDir = NULL;
+        else
+            sgBootPart_Handle = BootPartHandle;
     }
     return Status;
 }
@@ -76,54 +146,37 @@ EFI_STATUS EFIAPI Common_FileOpsInit(   EFI_HANDLE  BootPartHandle)
 EFI_STATUS EFIAPI Common_FileOpsClose( VOID )
 {
     EFI_STATUS Status;
+    /* Close the cached directories before their root */
+    Common_DirCacheFlush();
     /* Close the EFI_FILE_PROTOCOL interface for the root directory. */
     /* Close never fails. */
     Status = sgBootPart_RootDir->Close( sgBootPart_RootDir );
     sgBootPart_RootDir = NULL;
+    sgBootPart_Handle = NULL;
     return Status;
 }
 
-#define PATHLEN_MAX (512)
-
-EFI_STATUS EFIAPI Common_FreePath(  IN  CHAR16 *Path)
-{
-    return gBS->FreePool(Path);
-}
-
 EFI_STATUS EFIAPI Common_GetPathFromParts(  IN  CHAR8   *DirPath,
                                             IN  CHAR8   *FileName,
-                                            OUT CHAR16  **Path_p)
+                                            OUT CHAR16  Path[static PATHBUF_LEN])
 {
     EFI_STATUS ret;
-    UINTN DirPath_len, FileName_len, Path_len;
-    CHAR16 *Path;
-    /*  Get lengths of the two strings to be generated */
+    UINTN DirPath_len, FileName_len;
+    /*  Get lengths of the two strings to be joined */
     DirPath_len = AsciiStrnLenS(DirPath, PATHLEN_MAX);
     FileName_len = AsciiStrnLenS(FileName, PATHLEN_MAX);
-    Path_len = DirPath_len + 1 + FileName_len;
-    if(PATHLEN_MAX < Path_len)
+    if(PATHLEN_MAX < DirPath_len + 1 + FileName_len)
         ret = EFI_UNSUPPORTED;
     else{
-        /*  Allocate space for Path */
-        ret = gBS->AllocatePool(EfiLoaderData,
-                                (Path_len+1)*sizeof(CHAR16),
-                                (VOID**)&Path);
+        /*  Generate the path */
+        ret = AsciiStrToUnicodeStrS(DirPath,
+                                    Path,
+                                    DirPath_len+1);
         if(!EFI_ERROR(ret)){
-            /*  Generate the path */
-            ret = AsciiStrToUnicodeStrS(DirPath,
-                                        Path,
-                                        DirPath_len+1);
-            if(!EFI_ERROR(ret)){
-                Path[DirPath_len] = L'\\';
-                ret = AsciiStrToUnicodeStrS(FileName,
-                                            &(Path[DirPath_len+1]),
-                                            FileName_len+1);
-            }
-            /*  Free the buffer or assign it to the output variable */
-            if(EFI_ERROR(ret))
-                Common_FreePath(Path);
-            else
-                *Path_p = Path;
+            Path[DirPath_len] = L'\\';
+            ret = AsciiStrToUnicodeStrS(FileName,
+                                        &(Path[DirPath_len+1]),
+                                        FileName_len+1);
         }
     }
     return ret;
@@ -158,6 +211,44 @@ EFI_STATUS EFIAPI Common_OpenFile(  OUT EFI_FILE_PROTOCOL   **NewHandle,
         return EFI_NOT_READY;
 }
 
+EFI_STATUS EFIAPI Common_OpenDirFile(   OUT EFI_FILE_PROTOCOL   **NewHandle,
+                                        IN  CHAR8               *dirpath,
+                                        IN  CHAR8               *filename,
+                                        IN  UINT64              OpenMode,
+                                        IN  UINT64              Attributes)
+{
+    EFI_STATUS Status;
+    EFI_FILE_PROTOCOL *Dir;
+    CHAR16 filepath[PATHBUF_LEN];
+    /*  Open the file relative to its cached directory */
+    if( !EFI_ERROR(Common_DirCacheGet(dirpath, &Dir)) ){
+        Status = AsciiStrToUnicodeStrS( filename,
+                                        filepath,
+                                        PATHBUF_LEN);
+        if(!EFI_ERROR(Status))
+            Status = Dir->Open( Dir,
+                                NewHandle,
+                                filepath,
+                                OpenMode,
+                                Attributes);
+        return Status;
+    }
+    /*  Otherwise open the file from the root, which fails the same way the
+        directory did if it is missing. */
+    Status = Common_GetPathFromParts(   dirpath,
+                                        filename,
+                                        filepath);
+    if(EFI_ERROR(Status))
+        return Status;
+    if(NULL == sgBootPart_RootDir)
+        return EFI_NOT_READY;
+    return sgBootPart_RootDir->Open(sgBootPart_RootDir,
+                                    NewHandle,
+                                    filepath,
+                                    OpenMode,
+                                    Attributes);
+}
+
 EFI_STATUS EFIAPI Common_GetFileInfo(   IN  EFI_FILE_PROTOCOL   *filep,
                                         OUT EFI_FILE_INFO       **fileinfo_pp,
                                         OUT UINTN               *fileinfosize_p)
@@ -271,6 +362,49 @@ EFI_STATUS EFIAPI Common_WriteFile( IN EFI_FILE_PROTOCOL *filep,
 {
     EFI_STATUS Status, FlushStatus;
     UINTN bytes_written;
+    UINT64 filesize;
+
+    /* get the current file size */
+    Status = filep->SetPosition( filep, MAX_UINT64);
+    if( !EFI_ERROR(Status) )
+        Status = filep->GetPosition( filep, &filesize);
+    if( EFI_ERROR(Status) )
+        goto exit0;
+
+    /*  Overwrite the file in place. Truncating it first would free its
+        cluster chain only to allocate it again, updating the FAT copies and
+        the directory entry twice; a file rewritten at the same size (a
+        state file, the log-line file, the boot status) only has its data
+        written. */
+    Status = filep->SetPosition( filep, 0);
+    if( EFI_ERROR(Status) )
+        goto exit0;
+
+    /* Write out to file */
+    bytes_written = buffersize;
+    Status = filep->Write( filep, &bytes_written, buffer);
+    if( bytes_written != buffersize )
+        if( ! EFI_ERROR(Status) )
+            Status = EFI_DEVICE_ERROR;
+
+    /* Drop the rest of a file that was longer */
+    if( !EFI_ERROR(Status) && (filesize > buffersize) )
+        Status = Common_SetFileSize( filep, buffersize);
+
+    /* Flush changes to file. */
+    FlushStatus = filep->Flush( filep );
+    if( EFI_ERROR(FlushStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = FlushStatus;
+
+exit0:
+    return Status;
+}
+
+EFI_STATUS EFIAPI Common_SetFileSize(  IN EFI_FILE_PROTOCOL *filep,
+                                        IN UINT64             filesize)
+{
+    EFI_STATUS Status;
 
     EFI_FILE_INFO	*fileinfo_p = NULL;
     UINTN           fileinfosize = 0;
@@ -280,8 +414,8 @@ EFI_STATUS EFIAPI Common_WriteFile( IN EFI_FILE_PROTOCOL *filep,
     if( EFI_ERROR(Status) )
         goto exit0;
 
-    /* truncate file size */
-    fileinfo_p->FileSize = 0;
+    /* set the file size, growing or truncating the file */
+    fileinfo_p->FileSize = filesize;
     /* leave other fields the same */
     fileinfo_p->CreateTime = (EFI_TIME){0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     fileinfo_p->LastAccessTime = (EFI_TIME){0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
@@ -290,32 +424,54 @@ EFI_STATUS EFIAPI Common_WriteFile( IN EFI_FILE_PROTOCOL *filep,
     /* set file info */
     Status = filep->SetInfo(filep, &gEfiFileInfoGuid, fileinfosize, fileinfo_p);
 
-    /* Flush changes to file. */
-    FlushStatus = filep->Flush( filep );
-    if( EFI_ERROR(FlushStatus) )
-        if( ! EFI_ERROR(Status) )
-            Status = FlushStatus;
-
     /* Free the file-info structure */
     gBS->FreePool(fileinfo_p);
+exit0:
+    return Status;
+}
+
+EFI_STATUS EFIAPI Common_ReadFileAt(IN  EFI_FILE_PROTOCOL *filep,
+                                    IN  UINT64            position,
+                                    OUT VOID*             buffer,
+                                    IN  UINTN             buffersize)
+{
+    EFI_STATUS Status;
+    UINTN bytes_read;
 
-    /* If SetInfo or Flush failed, exit*/
+    /* Seek to the requested position */
+    Status = filep->SetPosition( filep, position);
     if( EFI_ERROR(Status) )
         goto exit0;
 
-    /* Write out to file */
+    /* Read from file; a short read is an error */
+    bytes_read = buffersize;
+    Status = filep->Read( filep, &bytes_read, buffer);
+    if( bytes_read != buffersize )
+        if( ! EFI_ERROR(Status) )
+            Status = EFI_END_OF_FILE;
+exit0:
+    return Status;
+}
+
+EFI_STATUS EFIAPI Common_WriteFileAt(   IN EFI_FILE_PROTOCOL *filep,
+                                        IN UINT64            position,
+                                        IN VOID*             buffer,
+                                        IN UINTN             buffersize)
+{
+    EFI_STATUS Status;
+    UINTN bytes_written;
+
+    /* Seek to the requested position */
+    Status = filep->SetPosition( filep, position);
+    if( EFI_ERROR(Status) )
+        goto exit0;
+
+    /* Write out to file. The caller decides when to flush. */
     bytes_written = buffersize;
     Status = filep->Write( filep, &bytes_written, buffer);
     if( bytes_written != buffersize )
         if( ! EFI_ERROR(Status) )
             Status = EFI_DEVICE_ERROR;
-
-    /* Flush changes to file. */
-    FlushStatus = filep->Flush( filep );
-    if( EFI_ERROR(FlushStatus) )
-        if( ! EFI_ERROR(Status) )
-            Status = FlushStatus;
-
 exit0:
     return Status;
 }
@@ -383,22 +539,27 @@ EFI_STATUS EFIAPI Common_CreateWriteCloseDirFile(   IN CHAR8  *dirpath,
                                                     IN UINTN  buffersize)
 {
     EFI_STATUS Status, CloseStatus;
-    CHAR16 *filepath;
-    /* Form file path */
-    Status = Common_GetPathFromParts(   dirpath,
-                                        filename,
-                                        &filepath);
-    if(!EFI_ERROR(Status)){
-        /* Create, write, and close the file */
-        Status = Common_CreateWriteCloseFile(   filepath,
-                                                buffer,
-                                                buffersize);
-        /* Free the file path */
-        CloseStatus = Common_FreePath(filepath);
-        if( EFI_ERROR(CloseStatus) )
-            if( ! EFI_ERROR(Status) )
-                Status = CloseStatus;
-    }
+    EFI_FILE_PROTOCOL *filep;
+
+    /* Open file */
+    Status = Common_OpenDirFile(&filep,
+                                dirpath,
+                                filename,
+                                (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
+                                    EFI_FILE_MODE_CREATE),
+                                0);
+    if( EFI_ERROR(Status) )
+        goto exit0;
+
+    /* Write out to file */
+    Status = Common_WriteFile( filep, buffer, buffersize);
+
+    /* close file */
+    CloseStatus = filep->Close( filep );
+    if( EFI_ERROR(CloseStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = CloseStatus;
+exit0:
     return Status;
 }
 
@@ -408,28 +569,112 @@ EFI_STATUS EFIAPI Common_OpenReadCloseDirFile(  IN CHAR8    *dirpath,
                                                 OUT UINTN   *buffersize_p)
 {
     EFI_STATUS Status, CloseStatus;
-    CHAR16 *filepath;
-    /* Form file path */
-    Status = Common_GetPathFromParts(   dirpath,
-                                        filename,
-                                        &filepath);
-    if(!EFI_ERROR(Status)){
-        /* Open, read, and close the file */
-        Common_OpenReadCloseFile(   filepath,
-                                    buffer_p,
-                                    buffersize_p);
-        /* Free the file path */
-        CloseStatus = Common_FreePath(filepath);
-        if( EFI_ERROR(CloseStatus) ){
-            if( ! EFI_ERROR(Status) ){
-                Common_FreeReadBuffer(  *buffer_p,
-                                        *buffersize_p);
-                *buffer_p = NULL;
-                *buffersize_p = 0;
-                Status = CloseStatus;
-            }
-        }
+    EFI_FILE_PROTOCOL *filep;
+
+    /* Open file */
+    Status = Common_OpenDirFile(&filep,
+                                dirpath,
+                                filename,
+                                EFI_FILE_MODE_READ,
+                                0);
+    if( EFI_ERROR(Status) )
+        goto exit0;
+
+    /* Read the file */
+    Status = Common_ReadFile(   filep,
+                                buffer_p,
+                                buffersize_p);
+
+    /* close file */
+    CloseStatus = filep->Close( filep );
+    if( EFI_ERROR(CloseStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = CloseStatus;
+exit0:
+    return Status;
+}
+
+EFI_STATUS EFIAPI Common_WriteDirFileAt(IN  CHAR8   *dirpath,
+                                        IN  CHAR8   *filename,
+                                        IN  UINT64  position,
+                                        IN  VOID*   buffer,
+                                        IN  UINTN   buffersize)
+{
+    EFI_STATUS Status, FlushStatus, CloseStatus;
+    EFI_FILE_PROTOCOL *filep;
+
+    /* Open file */
+    Status = Common_OpenDirFile(&filep,
+                                dirpath,
+                                filename,
+                                (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
+                                    EFI_FILE_MODE_CREATE),
+                                0);
+    if( EFI_ERROR(Status) )
+        goto exit0;
+
+    /* Write in place */
+    Status = Common_WriteFileAt( filep, position, buffer, buffersize);
+
+    /* Flush changes to file. */
+    FlushStatus = filep->Flush( filep );
+    if( EFI_ERROR(FlushStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = FlushStatus;
+
+    /* close file */
+    CloseStatus = filep->Close( filep );
+    if( EFI_ERROR(CloseStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = CloseStatus;
+exit0:
+    return Status;
+}
+
+EFI_STATUS EFIAPI Common_ReadDirFileInto(   IN  CHAR8   *dirpath,
+                                            IN  CHAR8   *filename,
+                                            OUT VOID*   buffer,
+                                            IN  UINTN   buffersize,
+                                            OUT UINTN   *readsize_p)
+{
+    EFI_STATUS Status, CloseStatus;
+    EFI_FILE_PROTOCOL *filep;
+    /* Open file */
+    Status = Common_OpenDirFile(&filep,
+                                dirpath,
+                                filename,
+                                EFI_FILE_MODE_READ,
+                                0);
+    if( EFI_ERROR(Status) )
+        goto exit0;
+    /* Read at most buffersize bytes, without asking for the file size */
+    *readsize_p = buffersize;
+    Status = filep->Read( filep, readsize_p, buffer);
+    /* close file */
+    CloseStatus = filep->Close( filep );
+    if( EFI_ERROR(CloseStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = CloseStatus;
+exit0:
+    return Status;
+}
+
+EFI_STATUS EFIAPI Common_CopyReadBuffer(IN  CONST VOID  *source,
+                                        IN  UINTN       size,
+                                        OUT VOID*       *buffer_p)
+{
+    EFI_STATUS Status;
+    VOID *buffer;
+    Status = gBS->AllocatePool( EfiLoaderData, size, &buffer);
+    if( !EFI_ERROR(Status) ){
+        CopyMem(buffer, source, size);
+        *buffer_p = buffer;
     }
     return Status;
 }
 
+UINT32 EFIAPI Common_Crc32c(IN  CONST VOID  *Buffer,
+                            IN  UINTN       Length)
+{
+    return Crc32c_update(0, Buffer, Length);
+}
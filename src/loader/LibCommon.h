@@ -18,13 +18,18 @@ EFI_STATUS EFIAPI Common_FileOpsInit(   EFI_HANDLE  BootPartHandle);
 
 EFI_STATUS EFIAPI Common_FileOpsClose( VOID );
 
+/*  The handle of the boot partition opened by Common_FileOpsInit */
+EFI_HANDLE EFIAPI Common_GetBootPartHandle( VOID );
+
 #define PATHLEN_MAX (512)
+/*  Characters in a path buffer, with the terminator */
+#define PATHBUF_LEN (PATHLEN_MAX + 1)
 
+/*  Forms "DirPath\FileName" in the caller's buffer, typically on the stack,
+    so that building a path never allocates */
 EFI_STATUS EFIAPI Common_GetPathFromParts(  IN  CHAR8   *DirPath,
                                             IN  CHAR8   *FileName,
-                                            OUT CHAR16  **Path_p);
-
-EFI_STATUS EFIAPI Common_FreePath(  IN  CHAR16 *Path);
+                                            OUT CHAR16  Path[static PATHBUF_LEN]);
 
 EFI_STATUS EFIAPI Common_CreateOpenFile(OUT EFI_FILE_PROTOCOL   **NewHandle,
                                         IN  CHAR16              *FileName,
@@ -35,6 +40,14 @@ EFI_STATUS EFIAPI Common_OpenFile(  OUT EFI_FILE_PROTOCOL   **NewHandle,
                                     IN  CHAR16              *FileName,
                                     IN  UINT64              OpenMode);
 
+/*  Opens filename in the directory dirpath. The directory stays open, and
+    later files in it are opened relative to it, until Common_FileOpsClose. */
+EFI_STATUS EFIAPI Common_OpenDirFile(   OUT EFI_FILE_PROTOCOL   **NewHandle,
+                                        IN  CHAR8               *dirpath,
+                                        IN  CHAR8               *filename,
+                                        IN  UINT64              OpenMode,
+                                        IN  UINT64              Attributes);
+
 EFI_STATUS EFIAPI Common_GetFileInfo(   IN  EFI_FILE_PROTOCOL   *filep,
                                         OUT EFI_FILE_INFO       **fileinfo_pp,
                                         OUT UINTN               *fileinfosize_p );
@@ -50,6 +63,19 @@ EFI_STATUS EFIAPI Common_WriteFile( IN EFI_FILE_PROTOCOL    *filep,
                                     IN VOID*                buffer,
                                     IN UINTN                buffersize );
 
+EFI_STATUS EFIAPI Common_SetFileSize(  IN EFI_FILE_PROTOCOL *filep,
+                                        IN UINT64             filesize);
+
+EFI_STATUS EFIAPI Common_ReadFileAt(IN  EFI_FILE_PROTOCOL *filep,
+                                    IN  UINT64            position,
+                                    OUT VOID*             buffer,
+                                    IN  UINTN             buffersize);
+
+EFI_STATUS EFIAPI Common_WriteFileAt(   IN EFI_FILE_PROTOCOL *filep,
+                                        IN UINT64            position,
+                                        IN VOID*             buffer,
+                                        IN UINTN             buffersize);
+
 EFI_STATUS EFIAPI Common_CreateWriteCloseFile(  IN CHAR16   *filename,
                                                 IN VOID*    buffer,
                                                 IN UINTN    buffersize );
@@ -68,4 +94,28 @@ EFI_STATUS EFIAPI Common_OpenReadCloseDirFile(  IN CHAR8    *dirpath,
                                                 OUT VOID*   *buffer_p,
                                                 OUT UINTN   *buffersize_p);
 
+/*  Writes buffersize bytes at position of a file, creating it if needed, and
+    flushes it. The rest of the file is left as it is. */
+EFI_STATUS EFIAPI Common_WriteDirFileAt(IN  CHAR8   *dirpath,
+                                        IN  CHAR8   *filename,
+                                        IN  UINT64  position,
+                                        IN  VOID*   buffer,
+                                        IN  UINTN   buffersize);
+
+/*  Reads at most buffersize bytes of a file into the caller's buffer;
+    *readsize_p is set to the number of bytes read */
+EFI_STATUS EFIAPI Common_ReadDirFileInto(   IN  CHAR8   *dirpath,
+                                            IN  CHAR8   *filename,
+                                            OUT VOID*   buffer,
+                                            IN  UINTN   buffersize,
+                                            OUT UINTN   *readsize_p);
+
+/*  Copies a buffer into a new buffer freed with Common_FreeReadBuffer */
+EFI_STATUS EFIAPI Common_CopyReadBuffer(IN  CONST VOID  *source,
+                                        IN  UINTN       size,
+                                        OUT VOID*       *buffer_p);
+
+UINT32 EFIAPI Common_Crc32c(IN  CONST VOID  *Buffer,
+                            IN  UINTN       Length);
+
 #endif
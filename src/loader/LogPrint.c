@@ -18,7 +18,11 @@
 /* Maximum allowed length for the context */
 #define LOG_PRINT_LINE_CONTEXT_MAXLENGTH (80 - LOG_PRINT_LINE_PREFIX_LENGTH)
 
-#define LOG_PRINT_MODE_DEFAULT  (LOG_PRINT_MODE_FILE | LOG_PRINT_MODE_CONSOLE)
+/* The default modes may be overridden at build time, e.g. with
+   -DLOG_PRINT_MODE_DEFAULT=LOG_PRINT_MODE_TRACE for deferred logging only */
+#ifndef LOG_PRINT_MODE_DEFAULT
+#define LOG_PRINT_MODE_DEFAULT  (LOG_PRINT_MODE_BINFILE | LOG_PRINT_MODE_CONSOLE)
+#endif
 #define LOG_PRINT_CTXLBL_DEFAULT    L""
 
 /******************************************************************************/
@@ -28,12 +32,19 @@
 static UINT16 modes = 0;
 static const CHAR16 *context = NULL;
 
+static EFI_STATUS LogPrint_init_file(VOID);
+static VOID LogPrint_init_trace(VOID);
+static EFI_STATUS LogPrint_trace_flush(VOID);
+static BOOLEAN LogPrint_trace_ready(VOID);
+
 EFI_STATUS LogPrint_setContextLabel(const CHAR16 *setcontext)
 {
     /* Make sure the context label is smaller than the maximum supported */
     if(StrLen(setcontext) > LOG_PRINT_LINE_CONTEXT_MAXLENGTH)
         return EFI_INVALID_PARAMETER;
     else{
+        /* Trace segments carry a single context label */
+        LogPrint_trace_flush();
         context = setcontext;
         return EFI_SUCCESS;
     }
@@ -44,6 +55,14 @@ EFI_STATUS LogPrint_setModes(UINT16 setmodes)
     if(0 != (setmodes & ~LOG_PRINT_MODE_VALID))
         return EFI_INVALID_PARAMETER;
     else{
+        /* Set up the text log files when they are first requested */
+        if( (0 != (setmodes & LOG_PRINT_MODE_FILE)) &&
+            (0 == (modes & LOG_PRINT_MODE_FILE)) )
+            LogPrint_init_file();
+        /* Likewise the trace buffer */
+        if( (0 != (setmodes & LOG_PRINT_MODE_TRACE)) &&
+            !LogPrint_trace_ready() )
+            LogPrint_init_trace();
         modes = setmodes;
         return EFI_SUCCESS;
     }
@@ -133,6 +152,8 @@ static EFI_STATUS LogPrint_file_getline(OUT UINT16 *logline_p)
     return Status;
 }
 
+/*  Writes Buffer out as the next log file. Buffer may hold a single line or a
+    whole segment of buffered lines. */
 static EFI_STATUS LogPrint_file(IN CHAR8*           Buffer,
                                 IN UINTN            Length,
                                 OUT UINTN           *Printedp)
@@ -141,7 +162,8 @@ static EFI_STATUS LogPrint_file(IN CHAR8*           Buffer,
     UINT16  logline;
     UINT16  filename[LOGFILE_PATHLEN];
     UINTN Printed = 0;
-    /* Get the line number */
+    /* Get the line number (re-read every time, since a started image may have
+       written log files of its own) */
     Status = LogPrint_file_getline(&logline);
     if( !EFI_ERROR(Status) ){
         /* Form the log-file name */
@@ -158,8 +180,7 @@ static EFI_STATUS LogPrint_file(IN CHAR8*           Buffer,
                 the full buffer was written */
             Printed = Length;
             /*  Increment the line number
-                (not more than 512 lines upto 512-bytes each ~1MB total
-                on FAT fs ) */
+                (not more than 512 files of up to one segment each) */
             logline = (logline + 1) & LOG_PRINT_LINENO_MAX_MASK;
             Status = LogPrint_file_setline(logline);
         }
@@ -168,15 +189,439 @@ static EFI_STATUS LogPrint_file(IN CHAR8*           Buffer,
     return Status;
 }
 
+/*  Formatted lines are collected in a boot-services pool buffer and written
+    out as one log file per segment. This replaces the five file-system round
+    trips per line of the unbuffered path with one pass per segment. The
+    segment is flushed when full, on LogPrint_flush, and on LogPrint_fini. If
+    the buffer cannot be allocated, lines are written out one at a time. */
+#define LOG_PRINT_SEGMENT_SIZE  (16 * 1024)
+
+static CHAR8    *segment = NULL;
+static UINTN    segmentUsed = 0;
+
+static EFI_STATUS LogPrint_segment_flush(VOID)
+{
+    EFI_STATUS  Status;
+    UINTN Printed;
+    if( (NULL == segment) || (0 == segmentUsed) )
+        return EFI_SUCCESS;
+    Status = LogPrint_file(segment, segmentUsed, &Printed);
+    /*  Succeed or fail, the segment is emptied so that a failing file system
+        does not stop new lines from being collected. */
+    segmentUsed = 0;
+    return Status;
+}
+
+static EFI_STATUS LogPrint_segment(IN CHAR8*        Buffer,
+                                   IN UINTN         Length,
+                                   OUT UINTN        *Printedp)
+{
+    EFI_STATUS  Status = EFI_SUCCESS;
+    /* Fall back to unbuffered writes if there is no segment buffer, or the
+       line would never fit in one */
+    if( (NULL == segment) || (Length > LOG_PRINT_SEGMENT_SIZE) ){
+        LogPrint_segment_flush();
+        return LogPrint_file(Buffer, Length, Printedp);
+    }
+    /* Write the current segment out if the line does not fit */
+    if( Length > (LOG_PRINT_SEGMENT_SIZE - segmentUsed) )
+        Status = LogPrint_segment_flush();
+    /* Append the line (without the NULL terminator) */
+    CopyMem(segment + segmentUsed, Buffer, Length);
+    segmentUsed += Length;
+    *Printedp = Length;
+    return Status;
+}
+
 static EFI_STATUS LogPrint_init_file(VOID)
 {
+    EFI_STATUS  Status;
     UINT16  logline;
     /* Check that the LogDir is in fact a directory by attempting to read the
        line file and then attempting to write it. */
     LogPrint_file_getline(&logline);
     /*  On failure, logline should be zero. Otherwise, logline
         should be corretcly set. Attempt to write it back out. */
-    return LogPrint_file_setline(logline);
+    Status = LogPrint_file_setline(logline);
+    /*  Allocate the segment buffer. On failure, log lines are written
+        unbuffered. */
+    if(NULL == segment){
+        if( EFI_ERROR(gBS->AllocatePool(EfiLoaderData,
+                                        LOG_PRINT_SEGMENT_SIZE,
+                                        (VOID**)&segment)) )
+            segment = NULL;
+    }
+    segmentUsed = 0;
+    return Status;
+}
+
+/******************************************************************************/
+/*  Functions and definitions related to logging to the binary log file       */
+/******************************************************************************/
+
+/*  Records are written into fixed-size slots of a single preallocated file
+    (see BootLog.h), so each line costs two positioned writes on an open
+    handle instead of file creates and directory look-ups. The handle is
+    opened on the first record and closed on LogPrint_flush, since a started
+    image appends to the same file. */
+#define LOGBIN_PATH     LOGDIR_PATH L"\\" BOOTLOG_FILENAME
+
+static EFI_FILE_PROTOCOL    *logbin = NULL;
+static BOOTLOG_header_t     logbinHeader;
+static BOOTLOG_record_t     logbinRecord;
+
+static EFI_STATUS LogPrint_binfile_open(VOID)
+{
+    EFI_STATUS  Status;
+    /* Open or create the log file */
+    Status = Common_CreateOpenFile( &logbin,
+                                    LOGBIN_PATH,
+                                    (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE),
+                                    0);
+    if( EFI_ERROR(Status) ){
+        logbin = NULL;
+        goto exit0;
+    }
+    /* Pick up where the last writer left off */
+    Status = Common_ReadFileAt( logbin, 0,
+                                &logbinHeader, sizeof(logbinHeader));
+    if( EFI_ERROR(Status) || !BootLog_headerIsValid(&logbinHeader) ){
+        /* New or unusable file: preallocate it and start from scratch */
+        Status = Common_SetFileSize(logbin, BOOTLOG_FILE_SIZE);
+        if( EFI_ERROR(Status) )
+            goto exit1;
+        ZeroMem(&logbinHeader, sizeof(logbinHeader));
+        logbinHeader.Magic       = BOOTLOG_MAGIC;
+        logbinHeader.Version     = BOOTLOG_VERSION;
+        logbinHeader.HeaderSize  = sizeof(BOOTLOG_header_t);
+        logbinHeader.RecordSize  = BOOTLOG_RECORD_SIZE;
+        logbinHeader.RecordCount = BOOTLOG_RECORD_COUNT;
+        Status = Common_WriteFileAt(logbin, 0,
+                                    &logbinHeader, sizeof(logbinHeader));
+        if( EFI_ERROR(Status) )
+            goto exit1;
+    }
+    Status = EFI_SUCCESS;
+    goto exit0;
+exit1:
+    logbin->Close(logbin);
+    logbin = NULL;
+exit0:
+    return Status;
+}
+
+static EFI_STATUS LogPrint_binfile_close(VOID)
+{
+    EFI_STATUS  Status, CloseStatus;
+    if(NULL == logbin)
+        return EFI_SUCCESS;
+    Status = logbin->Flush(logbin);
+    CloseStatus = logbin->Close(logbin);
+    if( EFI_ERROR(CloseStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = CloseStatus;
+    logbin = NULL;
+    return Status;
+}
+
+static EFI_STATUS LogPrint_binfile( IN  EFI_TIME        *TimeStampp,
+                                    IN  UINT64          TSC,
+                                    IN  CONST CHAR16*   Context,
+                                    IN  CHAR8*          Message,
+                                    IN  UINTN           Length,
+                                    OUT UINTN           *Printedp)
+{
+    EFI_STATUS  Status;
+    UINTN i;
+    UINTN Printed = 0;
+    BOOTLOG_record_t *record = &logbinRecord;
+    /* Open the file on the first record after init or a flush */
+    if(NULL == logbin){
+        Status = LogPrint_binfile_open();
+        if( EFI_ERROR(Status) )
+            goto exit0;
+    }
+    /* Fill in the record */
+    ZeroMem(record, sizeof(*record));
+    record->Sequence    = logbinHeader.Tail;
+    record->TSC         = TSC;
+    record->Year        = TimeStampp->Year;
+    record->Month       = TimeStampp->Month;
+    record->Day         = TimeStampp->Day;
+    record->Hour        = TimeStampp->Hour;
+    record->Minute      = TimeStampp->Minute;
+    record->Second      = TimeStampp->Second;
+    for( i = 0; (i < (BOOTLOG_CONTEXT_SIZE - 1)) && (L'\0' != Context[i]); i++)
+        record->Context[i] = (CHAR8)Context[i];
+    if( Length > BOOTLOG_MESSAGE_SIZE ){
+        Length = BOOTLOG_MESSAGE_SIZE;
+        record->Flags |= BOOTLOG_RECORD_TRUNCATED;
+    }
+    record->Length = (UINT16)Length;
+    CopyMem(record->Message, Message, Length);
+    /* Write the record into its slot, then publish it in the header */
+    Status = Common_WriteFileAt(logbin,
+                                BootLog_recordOffset(   &logbinHeader,
+                                                        logbinHeader.Tail),
+                                record, sizeof(*record));
+    if( EFI_ERROR(Status) )
+        goto exit0;
+    logbinHeader.Tail++;
+    if( (logbinHeader.Tail - logbinHeader.Head) > logbinHeader.RecordCount )
+        logbinHeader.Head = logbinHeader.Tail - logbinHeader.RecordCount;
+    Status = Common_WriteFileAt(logbin, 0,
+                                &logbinHeader, sizeof(logbinHeader));
+    if( !EFI_ERROR(Status) )
+        Printed = Length;
+exit0:
+    *Printedp = Printed;
+    return Status;
+}
+
+/******************************************************************************/
+/*  Functions and definitions related to deferred (trace) logging             */
+/******************************************************************************/
+
+/*  In trace mode nothing is formatted at boot time. Each call records the
+    format string's RVA in this image, the TSC, and the raw argument words
+    into a pool buffer (see BootTrace.h). The buffer is appended to the trace
+    file as one segment when full, when the context label changes, and on
+    LogPrint_flush. bumstate-trace-dump renders the records with the format
+    strings read from the .efi image. */
+#define TRACE_PATH          LOGDIR_PATH L"\\" BOOTTRACE_FILENAME
+#define TRACE_BUFFER_SIZE   (32 * 1024)
+
+static UINT8                *trace = NULL;
+static UINTN                traceUsed = 0;
+static UINT32               traceCount = 0;
+static BOOTTRACE_segment_t  traceSegment;
+static UINT8                *imageBase = NULL;
+static UINT64               imageSize = 0;
+
+static VOID LogPrint_trace_time(OUT BOOTTRACE_time_t    *Time)
+{
+    EFI_TIME    TimeStamp;
+    if( EFI_ERROR(gRT->GetTime( &TimeStamp, NULL )) )
+        TimeStamp = (EFI_TIME){0};
+    Time->Year      = TimeStamp.Year;
+    Time->Month     = TimeStamp.Month;
+    Time->Day       = TimeStamp.Day;
+    Time->Hour      = TimeStamp.Hour;
+    Time->Minute    = TimeStamp.Minute;
+    Time->Second    = TimeStamp.Second;
+    Time->Reserved  = 0;
+}
+
+/*  Starts a new segment: the segment header is completed on flush */
+static VOID LogPrint_trace_start(IN UINT64  TSC)
+{
+    UINTN i;
+    ZeroMem(&traceSegment, sizeof(traceSegment));
+    traceSegment.Magic      = BOOTTRACE_MAGIC;
+    traceSegment.Version    = BOOTTRACE_VERSION;
+    traceSegment.HeaderSize = sizeof(BOOTTRACE_segment_t);
+    CopyMem(traceSegment.ImageId, gBUMBuildId.Id, BUMBUILDID_IDLEN);
+    traceSegment.StartTSC   = TSC;
+    LogPrint_trace_time(&traceSegment.StartTime);
+    for( i = 0; (i < (BOOTTRACE_CONTEXT_SIZE - 1)) && (L'\0' != context[i]); i++)
+        traceSegment.Context[i] = (CHAR8)context[i];
+}
+
+static EFI_STATUS LogPrint_trace_flush(VOID)
+{
+    EFI_STATUS  Status, CloseStatus;
+    EFI_FILE_PROTOCOL *filep;
+    EFI_FILE_INFO *fileinfo_p;
+    UINTN fileinfosize;
+    UINT64 position;
+    if( (NULL == trace) || (0 == traceCount) )
+        return EFI_SUCCESS;
+    /* Complete the segment header */
+    traceSegment.RecordsSize = (UINT32)traceUsed;
+    traceSegment.RecordCount = traceCount;
+    traceSegment.EndTSC = AsmReadTsc();
+    LogPrint_trace_time(&traceSegment.EndTime);
+    /* Append the segment to the trace file */
+    Status = Common_CreateOpenFile( &filep,
+                                    TRACE_PATH,
+                                    (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE),
+                                    0);
+    if( EFI_ERROR(Status) )
+        goto exit0;
+    Status = Common_GetFileInfo(filep, &fileinfo_p, &fileinfosize);
+    if( EFI_ERROR(Status) )
+        goto exit1;
+    position = fileinfo_p->FileSize;
+    gBS->FreePool(fileinfo_p);
+    /* Restart the file rather than let it grow without bound */
+    if( (position + sizeof(traceSegment) + traceUsed) > BOOTTRACE_FILE_MAX ){
+        Status = Common_SetFileSize(filep, 0);
+        if( EFI_ERROR(Status) )
+            goto exit1;
+        position = 0;
+    }
+    Status = Common_WriteFileAt(filep, position,
+                                &traceSegment, sizeof(traceSegment));
+    if( !EFI_ERROR(Status) )
+        Status = Common_WriteFileAt(filep, position + sizeof(traceSegment),
+                                    trace, traceUsed);
+exit1:
+    CloseStatus = filep->Close(filep);
+    if( EFI_ERROR(CloseStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = CloseStatus;
+exit0:
+    /*  Succeed or fail, the buffer is emptied */
+    traceUsed = 0;
+    traceCount = 0;
+    return Status;
+}
+
+/*  Copies a NULL-terminated string (or Size bytes when CharSize is zero) into
+    the record at Used, cutting it to what fits. Returns the record offset of
+    the copy, or zero if nothing fits. */
+static UINTN LogPrint_trace_copy(   IN OUT BOOTTRACE_record_t   *record,
+                                    IN OUT UINTN                *Usedp,
+                                    IN  CONST VOID              *Src,
+                                    IN  UINTN                   CharSize,
+                                    IN  UINTN                   Size)
+{
+    UINT8 *Dst = ((UINT8*)record) + *Usedp;
+    UINTN DstSize = BOOTTRACE_RECORD_MAX - *Usedp;
+    UINTN offset = *Usedp;
+    if(0 != CharSize){
+        /* Measure the string including its NULL terminator */
+        for( Size = 0; ; Size += CharSize){
+            if( (sizeof(CHAR16) == CharSize)?
+                    (0 == *(CONST CHAR16*)((CONST UINT8*)Src + Size)) :
+                    (0 == *(CONST CHAR8*)((CONST UINT8*)Src + Size)) )
+                break;
+        }
+        Size += CharSize;
+        /* Cut the string to what is left of the record */
+        if(Size > DstSize){
+            record->Flags |= BOOTTRACE_RECORD_TRUNCATED;
+            if(DstSize < CharSize)
+                return 0;
+            Size = DstSize - (DstSize % CharSize);
+            CopyMem(Dst, Src, Size - CharSize);
+            ZeroMem(Dst + Size - CharSize, CharSize);
+            *Usedp += BOOTTRACE_ALIGN(Size);
+            return offset;
+        }
+    }else if(Size > DstSize){
+        record->Flags |= BOOTTRACE_RECORD_TRUNCATED;
+        return 0;
+    }
+    CopyMem(Dst, Src, Size);
+    *Usedp += BOOTTRACE_ALIGN(Size);
+    return offset;
+}
+
+static EFI_STATUS LogPrint_trace(   IN  UINT64          TSC,
+                                    IN  CONST CHAR16*   Format,
+                                    IN  VA_LIST         Marker)
+{
+    BOOTTRACE_record_t *record;
+    UINT64 *args;
+    UINT8 classes[BOOTTRACE_ARGS_MAX];
+    UINTN argcount, i, used;
+    CONST VOID *ptr;
+    if(NULL == trace)
+        return EFI_NOT_READY;
+    /* Make sure a record of the maximum size fits */
+    if( (TRACE_BUFFER_SIZE - traceUsed) < BOOTTRACE_RECORD_MAX )
+        LogPrint_trace_flush();
+    if(0 == traceCount)
+        LogPrint_trace_start(TSC);
+    record = (BOOTTRACE_record_t*)(trace + traceUsed);
+    args = (UINT64*)(record + 1);
+    record->Flags = 0;
+    record->TSC = TSC;
+    /* Find the argument classes */
+    argcount = BootTrace_scanFormat(Format, classes);
+    if(argcount > BOOTTRACE_ARGS_MAX){
+        argcount = BOOTTRACE_ARGS_MAX;
+        record->Flags |= BOOTTRACE_RECORD_TRUNCATED;
+    }
+    record->ArgCount = (UINT8)argcount;
+    used = sizeof(*record) + (argcount * sizeof(UINT64));
+    /* Record the format by RVA when it lies in this image */
+    if( ((CONST UINT8*)Format >= imageBase) &&
+        ((CONST UINT8*)Format < (imageBase + imageSize)) )
+        record->Format = (UINT32)((CONST UINT8*)Format - imageBase);
+    else{
+        record->Flags |= BOOTTRACE_RECORD_INLINE_FORMAT;
+        record->Format = (UINT32)LogPrint_trace_copy(   record, &used, Format,
+                                                        sizeof(CHAR16), 0);
+    }
+    /* Record the argument words, copying what is passed by pointer */
+    for( i = 0; i < argcount; i++){
+        switch(classes[i]){
+            case BOOTTRACE_ARG_INT:
+                args[i] = (UINT32)VA_ARG(Marker, int);
+                break;
+            case BOOTTRACE_ARG_INT64:
+                args[i] = VA_ARG(Marker, UINT64);
+                break;
+            case BOOTTRACE_ARG_POINTER:
+                args[i] = (UINTN)VA_ARG(Marker, VOID*);
+                break;
+            case BOOTTRACE_ARG_STRING16:
+                ptr = VA_ARG(Marker, CONST VOID*);
+                args[i] = (NULL == ptr)? 0 :
+                            LogPrint_trace_copy(record, &used, ptr,
+                                                sizeof(CHAR16), 0);
+                break;
+            case BOOTTRACE_ARG_STRING8:
+                ptr = VA_ARG(Marker, CONST VOID*);
+                args[i] = (NULL == ptr)? 0 :
+                            LogPrint_trace_copy(record, &used, ptr,
+                                                sizeof(CHAR8), 0);
+                break;
+            case BOOTTRACE_ARG_GUID:
+                ptr = VA_ARG(Marker, CONST VOID*);
+                args[i] = (NULL == ptr)? 0 :
+                            LogPrint_trace_copy(record, &used, ptr,
+                                                0, sizeof(EFI_GUID));
+                break;
+            default:
+                ptr = VA_ARG(Marker, CONST VOID*);
+                args[i] = (NULL == ptr)? 0 :
+                            LogPrint_trace_copy(record, &used, ptr,
+                                                0, sizeof(EFI_TIME));
+                break;
+        }
+    }
+    record->Size = (UINT16)used;
+    traceUsed += used;
+    traceCount++;
+    return EFI_SUCCESS;
+}
+
+static BOOLEAN LogPrint_trace_ready(VOID)
+{
+    return (NULL != trace);
+}
+
+static VOID LogPrint_init_trace(VOID)
+{
+    EFI_LOADED_IMAGE_PROTOCOL *LoadedImage;
+    /* Format strings are recorded relative to the image base */
+    if( !EFI_ERROR(gBS->HandleProtocol( gImageHandle,
+                                        &gEfiLoadedImageProtocolGuid,
+                                        (VOID**)&LoadedImage)) ){
+        imageBase = (UINT8*)LoadedImage->ImageBase;
+        imageSize = LoadedImage->ImageSize;
+    }
+    if(NULL == trace){
+        if( EFI_ERROR(gBS->AllocatePool(EfiLoaderData,
+                                        TRACE_BUFFER_SIZE,
+                                        (VOID**)&trace)) )
+            trace = NULL;
+    }
+    traceUsed = 0;
+    traceCount = 0;
 }
 
 /******************************************************************************/
@@ -233,10 +678,12 @@ static EFI_STATUS LogPrint_buffer(  IN  EFI_TIME        *TimeStampp,
                                     IN  VA_LIST         Marker,
                                     OUT UINTN           *BufferSizep,
                                     OUT CHAR8*          *Bufferp,
+                                    OUT UINTN           *PrefixLengthp,
                                     OUT UINTN           *Printedp )
 {
     EFI_STATUS Status;
     UINTN Printed = 0;
+    UINTN PrefixLength = 0;
 
     UINTN BufferSize = 0;
     CHAR8 *Buffer = NULL;
@@ -279,6 +726,7 @@ static EFI_STATUS LogPrint_buffer(  IN  EFI_TIME        *TimeStampp,
 
     /* Write the line prefix to the buffer */
     Printed = LOG_PRINT_LINE_PREFIX(Buffer, BufferSize, TimeStampp, TSC, Context);
+    PrefixLength = Printed;
 
     /* Write the line to the buffer */
     Printed += AsciiVSPrintUnicodeFormat(   Buffer + Printed,
@@ -296,6 +744,7 @@ exit0:
     /* Write the output varriables and return success */
     *Bufferp = Buffer;
     *BufferSizep = BufferSize;
+    *PrefixLengthp = PrefixLength;
     *Printedp = Printed;
     return Status;
 }
@@ -309,7 +758,7 @@ UINTN EFIAPI LogPrint(  IN CONST CHAR16  *Format,
 {
     EFI_STATUS Status;
 
-    UINTN   Ret, PrintedToBuffer, PrintedToLog;
+    UINTN   Ret, PrintedToBuffer, PrintedToLog, PrefixLength;
 
     EFI_TIME    TimeStamp;
     UINT64      TimeStamp_TSC;
@@ -322,6 +771,16 @@ UINTN EFIAPI LogPrint(  IN CONST CHAR16  *Format,
     /* Get the TSC time stamp time */
     TimeStamp_TSC = AsmReadTsc();
 
+    /* If one of the requested logging modes, record the unformatted call */
+    if( 0 != (modes & LOG_PRINT_MODE_TRACE ) ){
+        VA_START (Marker, Format);
+        LogPrint_trace( TimeStamp_TSC, Format, Marker);
+        VA_END (Marker);
+        /*  Nothing is formatted in trace-only mode, so nothing is printed */
+        if( 0 == (modes & ~LOG_PRINT_MODE_TRACE) )
+            return 0;
+    }
+
     /* Get the current time */
     Status = gRT->GetTime( &TimeStamp, NULL );
     if( EFI_ERROR(Status) ){
@@ -334,7 +793,8 @@ UINTN EFIAPI LogPrint(  IN CONST CHAR16  *Format,
     /* Parse the format string and other arguments to get a CHAR8 buffer */
     Status = LogPrint_buffer(   &TimeStamp, TimeStamp_TSC, context,
                                 Format, Marker,
-                                &BufferSize, &Buffer, &PrintedToBuffer);
+                                &BufferSize, &Buffer,
+                                &PrefixLength, &PrintedToBuffer);
     if( EFI_ERROR(Status) ){
         Ret = 0;
         goto exit0;
@@ -353,7 +813,19 @@ UINTN EFIAPI LogPrint(  IN CONST CHAR16  *Format,
 
     /* If one of the requested logging modes, print to log file */
     if( 0 != (modes & LOG_PRINT_MODE_FILE ) ){
-        LogPrint_file( Buffer, PrintedToBuffer, &PrintedToLog);
+        LogPrint_segment( Buffer, PrintedToBuffer, &PrintedToLog);
+        /* Ret should be minimum of what is written to all requested logs */
+        Ret = ( Ret > PrintedToLog)? PrintedToLog : Ret;
+    }
+
+    /* If one of the requested logging modes, print to the binary log file
+       (the record holds the message without the prefix and new-line) */
+    if( 0 != (modes & LOG_PRINT_MODE_BINFILE ) ){
+        LogPrint_binfile(   &TimeStamp, TimeStamp_TSC, context,
+                            Buffer + PrefixLength,
+                            PrintedToBuffer - PrefixLength - 1,
+                            &PrintedToLog);
+        PrintedToLog += PrefixLength + 1;
         /* Ret should be minimum of what is written to all requested logs */
         Ret = ( Ret > PrintedToLog)? PrintedToLog : Ret;
     }
@@ -371,6 +843,40 @@ VOID EFIAPI LogPrint_init(VOID)
     /*  Initialize the "context" string to a default value (empty) */
     context = LOG_PRINT_CTXLBL_DEFAULT;
     modes = LOG_PRINT_MODE_DEFAULT;
-    LogPrint_init_file();
+    if( 0 != (modes & LOG_PRINT_MODE_FILE) )
+        LogPrint_init_file();
+    if( 0 != (modes & LOG_PRINT_MODE_TRACE) )
+        LogPrint_init_trace();
+}
+
+EFI_STATUS EFIAPI LogPrint_flush(VOID)
+{
+    EFI_STATUS  Status, BinStatus;
+    Status = LogPrint_segment_flush();
+    BinStatus = LogPrint_binfile_close();
+    if( EFI_ERROR(BinStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = BinStatus;
+    BinStatus = LogPrint_trace_flush();
+    if( EFI_ERROR(BinStatus) )
+        if( ! EFI_ERROR(Status) )
+            Status = BinStatus;
+    return Status;
+}
+
+EFI_STATUS EFIAPI LogPrint_fini(VOID)
+{
+    EFI_STATUS  Status;
+    /*  Write out what is left and return to unbuffered writes */
+    Status = LogPrint_flush();
+    if(NULL != segment){
+        gBS->FreePool(segment);
+        segment = NULL;
+    }
+    if(NULL != trace){
+        gBS->FreePool(trace);
+        trace = NULL;
+    }
+    return Status;
 }
 
@@ -9,7 +9,9 @@
 #ifndef __LOG_PRINT__
 #define __LOG_PRINT__
 
-#define LOG_PRINT_MODE_VALID    (0x3)
+#define LOG_PRINT_MODE_VALID    (0xF)
+#define LOG_PRINT_MODE_TRACE    (0x8)
+#define LOG_PRINT_MODE_BINFILE  (0x4)
 #define LOG_PRINT_MODE_CONSOLE  (0x2)
 #define LOG_PRINT_MODE_FILE     (0x1)
 
@@ -17,11 +19,22 @@ EFI_STATUS LogPrint_setModes(UINT16 setmodes);
 
 EFI_STATUS LogPrint_setContextLabel(const CHAR16 *setcontext);
 
+/*  Logs a line in every requested mode. LOG_PRINT_MODE_TRACE records the
+    format string's position in the image and the raw arguments instead of
+    formatting them (see BootTrace.h). */
 UINTN EFIAPI LogPrint(  IN CONST CHAR16  *Format,
                         ... );
 
 VOID EFIAPI LogPrint_init(VOID);
 
+/*  Writes buffered log lines out to the log directory. Must be called before
+    control leaves the image (StartImage, ResetSystem) and before the file
+    operations are closed. */
+EFI_STATUS EFIAPI LogPrint_flush(VOID);
+
+/*  Flushes the buffered log lines and releases the log buffer */
+EFI_STATUS EFIAPI LogPrint_fini(VOID);
+
 
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
@@ -0,0 +1,20 @@
+/* __BUMStateBackend.h - Include header files for BUMStateBackend.c
+ */
+
+#ifndef ____BUM_STATE_BACKEND__
+#define ____BUM_STATE_BACKEND__
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DevicePathLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+#include <Protocol/BlockIo.h>
+#include <Protocol/DevicePath.h>
+
+#include "LibCommon.h"
+#include "BUMState.h"
+
+#endif
@@ -24,6 +24,9 @@
 #include "LibCommon.h"
 #include "LogPrint.h"
 #include "LibSmBios.h"
+#include "BootTimeline.h"
+#include "BootTime.h"
+#include "BootStatFile.h"
 #include "BootStat.h"
 
 #endif
@@ -0,0 +1,22 @@
+/* __BootTime.h - Include header files for BootTime.c
+ */
+
+#ifndef ____BOOT_TIME__
+#define ____BOOT_TIME__
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+#include <Protocol/SimpleFileSystem.h>
+#include <Guid/FileInfo.h>
+
+#include "LibCommon.h"
+#include "LogPrint.h"
+#include "BootTimeline.h"
+#include "BootTime.h"
+
+#endif
@@ -24,11 +24,16 @@
 #include <Guid/GlobalVariable.h>
 #include <Guid/ImageAuthentication.h>
 #include <Protocol/UnicodeCollation.h>
+#include <IndustryStandard/PeImage.h>
 
 #include "LibCommon.h"
 #include "LogPrint.h"
 #include "BootStat.h"
 #include "BUMState.h"
+#include "BootTimeline.h"
+#include "BUMContext.h"
+#include "BUMBuildId.h"
+#include "BootTime.h"
 
 #endif
 
@@ -9,6 +9,7 @@
 #define ____LIB_COMMON__
 
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Uefi.h>
 #include <Library/UefiLib.h>
 #include <Library/UefiBootServicesTableLib.h>
@@ -17,5 +18,8 @@
 #include <Protocol/SimpleFileSystem.h>
 #include <Guid/FileInfo.h>
 
+#include "Crc32c.h"
+#include "LibCommon.h"
+
 #endif
 
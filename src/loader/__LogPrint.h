@@ -15,12 +15,16 @@
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/PcdLib.h>
 #include <Library/PrintLib.h>
+#include <Library/BaseMemoryLib.h>
 
 #include <Protocol/SimpleFileSystem.h>
 #include <Guid/FileInfo.h>
+#include <Protocol/LoadedImage.h>
 
 #include "LibCommon.h"
 #include "LogPrint.h"
+#include "BootLog.h"
+#include "BootTrace.h"
 
 #endif
 
@@ -1,5 +1,6 @@
-/* TestPayload.c -  Simple EFI application for printing image-file path and
- *                  image arguments. Serves as a test EFI payload for the BUM
+/* TestPayload.c -  Simple EFI application for printing image-file path,
+ *                  image arguments, and the BUM context it was started with.
+ *                  Serves as a test EFI payload for the BUM
  *
  * Author: Safayet N Ahmed (GE Global Research) <Safayet.Ahmed@ge.com>
  *
@@ -13,6 +14,12 @@
 
 #include <Protocol/LoadedImage.h>
 
+#include "../common/BUMState.h"
+#include "../common/BootTimeline.h"
+#include "../common/BUMContext.h"
+
+static EFI_GUID gBUMContextProtocolGuid = BUMCONTEXT_PROTOCOL_GUID;
+
 EFI_STATUS getLoadedImageParams(IN  EFI_HANDLE       LoadedImageHandle,
                                 OUT CHAR16*          *ImageName_p,
                                 OUT CHAR16*          *ImageArgs_p)
@@ -42,6 +49,30 @@ EFI_STATUS getLoadedImageParams(IN  EFI_HANDLE       LoadedImageHandle,
     return ret;
 }
 
+/*  Prints the BUM context installed on the image handle by the configuration
+    BUM. Reading it takes no runtime-service call. */
+VOID printBUMContext(IN  EFI_HANDLE LoadedImageHandle)
+{
+    BUM_context_t *Context;
+    UINT64 Ticks;
+    if( EFI_ERROR(gBS->HandleProtocol(  LoadedImageHandle,
+                                        &gBUMContextProtocolGuid,
+                                        (VOID**)&Context)) ||
+        !BUMContext_isValid(Context) ){
+        Print(L"        BUM Context: none\n");
+        return;
+    }
+    Print(L"        BUM Config: %a\n", Context->Config);
+    Print(L"        BUM Boot Attempt: %lu\n", Context->BootAttempt);
+    if( (0 == Context->Timeline.MarkCount) ||
+        (0 == Context->Timeline.TicksPerUs) )
+        return;
+    /*  The first mark is the start of the root BUM */
+    Ticks = AsmReadTsc() - Context->Timeline.Marks[0].TSC;
+    Print(L"        Time since root BUM: %lu us\n",
+            DivU64x32(Ticks, Context->Timeline.TicksPerUs));
+}
+
 EFI_STATUS EFIAPI TestPayload_main( IN EFI_HANDLE       LoadedImageHandle,
                                     IN EFI_SYSTEM_TABLE *SystemTable)
 {
@@ -64,6 +95,7 @@ EFI_STATUS EFIAPI TestPayload_main( IN EFI_HANDLE       LoadedImageHandle,
     Print(L"\n");
     Print(L"        Image Name: %s\n", ImageName);
     Print(L"        Image Args: %s\n", ImageArgs);
+    printBUMContext(LoadedImageHandle);
     Print(L"\n");
     Print(L"****************************************\n");
     Print(L"\n");
@@ -0,0 +1,290 @@
+/* BUMStateBackend.c -  The UEFI-variable and block backends of the BUM state
+ *                      for user-space utilities (see BUMState.h).
+ */
+
+#define _GNU_SOURCE     /* O_DIRECT */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <uchar.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include "EFIGlue.h"
+#include "BUMState.h"
+#include "LibCommon.h"
+
+#define NO_FSYNC_ENV    "BUMSTATE_NO_FSYNC"
+
+/******************************************************************************/
+/*  UEFI variables through efivarfs                                           */
+/******************************************************************************/
+
+/*  An efivarfs file holds the UINT32 attributes followed by the data. The
+    whole variable has to be written by a single write(). */
+#define EFIVARFS_DIR        "/sys/firmware/efi/efivars"
+#define VAR_ATTRIBUTES_SIZE (sizeof(UINT32))
+
+#define VAR_FILENAME_MAXLEN (64)
+
+static char *BUMStateVar_Dir(   IN  CHAR8   *Target)
+{
+    return ('\0' == Target[0])? EFIVARFS_DIR : Target;
+}
+
+/*  <name>-<vendor GUID> */
+static char *BUMStateVar_FileName(  IN  UINT8   Slot,
+                                    OUT char    FileName[VAR_FILENAME_MAXLEN])
+{
+    snprintf(FileName, VAR_FILENAME_MAXLEN, "%s-%s",
+                (BUMSTATE_SLOT_A == Slot)?
+                    BUMSTATE_AVAR_NAME : BUMSTATE_BVAR_NAME,
+                BUMSTATE_VAR_GUID_STRING);
+    return FileName;
+}
+
+static EFI_STATUS EFIAPI BUMStateVar_Read(  IN  CHAR8   *Target,
+                                            IN  UINT8   Slot,
+                                            OUT VOID*   *Buffer_p,
+                                            OUT UINTN   *BufferSize_p)
+{
+    EFI_STATUS Status;
+    char filename[VAR_FILENAME_MAXLEN];
+    VOID *buffer;
+    UINTN buffersize;
+    UINT32 attributes;
+    Status = Common_OpenReadCloseDirFile(   BUMStateVar_Dir(Target),
+                                            BUMStateVar_FileName(Slot, filename),
+                                            &buffer,
+                                            &buffersize);
+    if(EFI_ERROR(Status))
+        goto exit0;
+    if(buffersize <= VAR_ATTRIBUTES_SIZE){
+        Status = EFI_LOAD_ERROR;
+        goto exit1;
+    }
+    /*  A variable with other attributes was not written by BUM */
+    memcpy(&attributes, buffer, VAR_ATTRIBUTES_SIZE);
+    if(BUMSTATE_VAR_ATTRIBUTES != attributes){
+        Status = EFI_LOAD_ERROR;
+        goto exit1;
+    }
+    buffersize -= VAR_ATTRIBUTES_SIZE;
+    memmove(buffer, (char*)buffer + VAR_ATTRIBUTES_SIZE, buffersize);
+    *Buffer_p = buffer;
+    *BufferSize_p = buffersize;
+    goto exit0;
+exit1:
+    Common_FreeReadBuffer(buffer, buffersize);
+exit0:
+    return Status;
+}
+
+/*  efivarfs marks variable files immutable; clear the flag before writing or
+    deleting. Errors are ignored: other file systems have no such flag. */
+static void BUMStateVar_MakeMutable(const char  *path)
+{
+    int fd, flags;
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return;
+    if( (0 == ioctl(fd, FS_IOC_GETFLAGS, &flags)) &&
+        (0 != (flags & FS_IMMUTABLE_FL)) ){
+        flags &= ~FS_IMMUTABLE_FL;
+        ioctl(fd, FS_IOC_SETFLAGS, &flags);
+    }
+    close(fd);
+}
+
+static EFI_STATUS EFIAPI BUMStateVar_Write( IN  CHAR8   *Target,
+                                            IN  UINT8   Slot,
+                                            IN  VOID*   Buffer,
+                                            IN  UINTN   BufferSize)
+{
+    EFI_STATUS Status;
+    char filename[VAR_FILENAME_MAXLEN], *path, *var;
+    UINT32 attributes = BUMSTATE_VAR_ATTRIBUTES;
+    size_t len;
+    int fd;
+    BUMStateVar_FileName(Slot, filename);
+    len = strlen(BUMStateVar_Dir(Target)) + 1 + strlen(filename) + 1;
+    path = malloc(len);
+    if(NULL == path)
+        return EFI_OUT_OF_RESOURCES;
+    snprintf(path, len, "%s/%s", BUMStateVar_Dir(Target), filename);
+    BUMStateVar_MakeMutable(path);
+    /*  An empty slot is a deleted variable */
+    if(0 == BufferSize){
+        Status = ( (0 == unlink(path)) || (ENOENT == errno) )?
+                    EFI_SUCCESS : EFI_DEVICE_ERROR;
+        goto exit0;
+    }
+    var = malloc(VAR_ATTRIBUTES_SIZE + BufferSize);
+    if(NULL == var){
+        Status = EFI_OUT_OF_RESOURCES;
+        goto exit0;
+    }
+    memcpy(var, &attributes, VAR_ATTRIBUTES_SIZE);
+    memcpy(var + VAR_ATTRIBUTES_SIZE, Buffer, BufferSize);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+        Status = EFI_DEVICE_ERROR;
+    else{
+        Status =    ( (ssize_t)(VAR_ATTRIBUTES_SIZE + BufferSize) ==
+                        write(fd, var, VAR_ATTRIBUTES_SIZE + BufferSize) )?
+                    EFI_SUCCESS : EFI_DEVICE_ERROR;
+        if( (0 != close(fd)) && !EFI_ERROR(Status) )
+            Status = EFI_DEVICE_ERROR;
+    }
+    free(var);
+exit0:
+    free(path);
+    return Status;
+}
+
+CONST BUM_state_backend_t BUMStateBackend_Var = {
+    .Name   = "var",
+    .Read   = BUMStateVar_Read,
+    .Write  = BUMStateVar_Write,
+};
+
+/******************************************************************************/
+/*  Raw sectors of a block device or image file                               */
+/******************************************************************************/
+
+/*  Slot N is sector N. A slot is written whole, padded with zeros, so a
+    single-sector write replaces it; an empty slot has a StateSize of zero.
+    The device is opened with O_DIRECT so that reads bypass the page cache
+    and see what is on media, falling back to buffered I/O where O_DIRECT is
+    not supported (e.g. an image file on tmpfs). Writes use O_DSYNC unless
+    BUMSTATE_NO_FSYNC is set. */
+#define BLK_SECTOR_SIZE_DFLT    (512)
+#define BLK_IO_ALIGN            (4096)
+
+static int BUMStateBlock_Open(  IN  CHAR8   *Target,
+                                IN  int     Flags,
+                                OUT UINTN   *SectorSize_p)
+{
+    int fd, sectorsize;
+    struct stat st;
+    fd = open(Target, Flags | O_DIRECT);
+    if( (fd < 0) && (EINVAL == errno) )
+        fd = open(Target, Flags);
+    if(fd < 0)
+        return fd;
+    *SectorSize_p = BLK_SECTOR_SIZE_DFLT;
+    if( (0 == fstat(fd, &st)) && S_ISBLK(st.st_mode) &&
+        (0 == ioctl(fd, BLKSSZGET, &sectorsize)) && (sectorsize > 0) )
+        *SectorSize_p = (UINTN)sectorsize;
+    return fd;
+}
+
+/*  Transfers one sector. An image file on a file system with larger blocks
+    than the sector rejects the O_DIRECT transfer, which is then retried
+    buffered. */
+static BOOLEAN BUMStateBlock_Transfer(  IN  int     fd,
+                                        IN  BOOLEAN Write,
+                                        IN  VOID    *Sector,
+                                        IN  UINTN   SectorSize,
+                                        IN  UINT8   Slot)
+{
+    off_t offset = (off_t)Slot * (off_t)SectorSize;
+    ssize_t done;
+    int retry;
+    for(retry = 0; retry < 2; retry++){
+        done =  Write?  pwrite(fd, Sector, SectorSize, offset) :
+                        pread(fd, Sector, SectorSize, offset);
+        if( (done >= 0) || (EINVAL != errno) )
+            break;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+    }
+    return (ssize_t)SectorSize == done;
+}
+
+static EFI_STATUS EFIAPI BUMStateBlock_Read(IN  CHAR8   *Target,
+                                            IN  UINT8   Slot,
+                                            OUT VOID*   *Buffer_p,
+                                            OUT UINTN   *BufferSize_p)
+{
+    EFI_STATUS Status;
+    UINTN sectorsize;
+    UINT64 statesize;
+    VOID *sector, *buffer;
+    int fd;
+    fd = BUMStateBlock_Open(Target, O_RDONLY, &sectorsize);
+    if(fd < 0)
+        return EFI_NOT_FOUND;
+    if(0 != posix_memalign(&sector, BLK_IO_ALIGN, sectorsize)){
+        Status = EFI_OUT_OF_RESOURCES;
+        goto exit0;
+    }
+    if(!BUMStateBlock_Transfer(fd, FALSE, sector, sectorsize, Slot)){
+        Status = EFI_DEVICE_ERROR;
+        goto exit1;
+    }
+    /*  Return the state without the padding */
+    statesize = ((BUM_state_t*)sector)->StateSize;
+    if( (0 == statesize) || (statesize > sectorsize) ){
+        Status = EFI_LOAD_ERROR;
+        goto exit1;
+    }
+    buffer = malloc(statesize);
+    if(NULL == buffer){
+        Status = EFI_OUT_OF_RESOURCES;
+        goto exit1;
+    }
+    memcpy(buffer, sector, statesize);
+    *Buffer_p = buffer;
+    *BufferSize_p = statesize;
+    Status = EFI_SUCCESS;
+exit1:
+    free(sector);
+exit0:
+    close(fd);
+    return Status;
+}
+
+static EFI_STATUS EFIAPI BUMStateBlock_Write(   IN  CHAR8   *Target,
+                                                IN  UINT8   Slot,
+                                                IN  VOID*   Buffer,
+                                                IN  UINTN   BufferSize)
+{
+    EFI_STATUS Status;
+    UINTN sectorsize;
+    VOID *sector;
+    int fd, flags;
+    flags = O_WRONLY;
+    if(NULL == getenv(NO_FSYNC_ENV))
+        flags |= O_DSYNC;
+    fd = BUMStateBlock_Open(Target, flags, &sectorsize);
+    if(fd < 0)
+        return EFI_NOT_FOUND;
+    if(BufferSize > sectorsize){
+        Status = EFI_INVALID_PARAMETER;
+        goto exit0;
+    }
+    if(0 != posix_memalign(&sector, BLK_IO_ALIGN, sectorsize)){
+        Status = EFI_OUT_OF_RESOURCES;
+        goto exit0;
+    }
+    memset(sector, 0, sectorsize);
+    memcpy(sector, Buffer, BufferSize);
+    Status =    BUMStateBlock_Transfer(fd, TRUE, sector, sectorsize, Slot)?
+                EFI_SUCCESS : EFI_DEVICE_ERROR;
+    free(sector);
+exit0:
+    if( (0 != close(fd)) && !EFI_ERROR(Status) )
+        Status = EFI_DEVICE_ERROR;
+    return Status;
+}
+
+CONST BUM_state_backend_t BUMStateBackend_Block = {
+    .Name   = "blk",
+    .Read   = BUMStateBlock_Read,
+    .Write  = BUMStateBlock_Write,
+};
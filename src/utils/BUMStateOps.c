@@ -0,0 +1,246 @@
+/* BUMStateOps.c - Operations on the BUM state shared by the single-purpose
+ *                 utilities and the multi-call bumstate tool.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <uchar.h>
+#include "EFIGlue.h"
+#include "BUMState.h"
+#include "libbumstate.h"
+#include "BUMStateOps.h"
+
+void BUMStateOps_Print( BUM_state_t *BUM_state_p,
+                        char        *statedir)
+{
+    printf("    BUM State: \n");
+    printf("        State directory:        %s\n", statedir);
+    printf("        Current Configuration:  ");
+    if(BUM_state_p->Flags.CurrConfig == BUMSTATE_CONFIG_DFLT)
+        printf("Default\n");
+    else
+        printf("Alternate\n");
+    printf("        Update Attempt:         ");
+    if(BUM_state_p->Flags.UpdateAttempt == 1)
+        printf("Yes\n");
+    else
+        printf("No\n");
+    printf("        Default Attempt Count:  %" PRIu64 "\n",
+            BUM_state_p->DfltAttemptCount);
+    printf("        Default Attempts Rem.:  %" PRIu64 "\n",
+            BUM_state_p->DfltAttemptsRemaining);
+    printf("        Default Configuration:      \"%s\"\n",
+            BUM_state_p->DfltConfig);
+    printf("        Alternate Configuration:    \"%s\"\n",
+            BUM_state_p->AltrConfig);
+}
+
+static const char *format_names[] = {
+    [BUMSTATE_FORMAT_TEXT]      = "text",
+    [BUMSTATE_FORMAT_JSON]      = "json",
+    [BUMSTATE_FORMAT_KV]        = "kv",
+    [BUMSTATE_FORMAT_BINARY]    = "binary",
+};
+
+int BUMStateOps_ParseFormat(const char          *arg,
+                            bumstate_format_t   *format_p)
+{
+    size_t i;
+    if(0 != strncmp(arg, BUMSTATE_FORMAT_OPT, sizeof(BUMSTATE_FORMAT_OPT) - 1))
+        return 0;
+    arg += sizeof(BUMSTATE_FORMAT_OPT) - 1;
+    for(i = 0; i < sizeof(format_names)/sizeof(format_names[0]); i++){
+        if(0 == strcmp(arg, format_names[i])){
+            *format_p = (bumstate_format_t)i;
+            return 1;
+        }
+    }
+    fprintf(stderr, "    unknown format \"%s\"\n", arg);
+    return -1;
+}
+
+/*  Indexed by bumstate_bootstatus_t */
+static char *bootstatus_names[] = {
+    [LIBBUMSTATE_BOOTSUCCESS]   = BOOTSUCCESS,
+    [LIBBUMSTATE_UPDATESUCCESS] = UPDTSUCCESS,
+    [LIBBUMSTATE_BOOTFAILURE]   = BOOTFAILURE,
+    [LIBBUMSTATE_UPDATEFAILURE] = UPDTFAILURE,
+};
+
+static bumstate_bootstatus_t BootStatus(BUM_state_t *BUM_state_p)
+{
+    bumstate_bootstatus_t status;
+    /*  Check for failure: booting alternate */
+    if(BUMSTATE_CONFIG_ALTR == BUM_state_p->Flags.CurrConfig){
+        /*  Check if this was a failed update */
+        if(1 == BUM_state_p->Flags.UpdateAttempt)
+            status = LIBBUMSTATE_UPDATEFAILURE;
+        else
+            status = LIBBUMSTATE_BOOTFAILURE;
+    }else{ /*Success: booted default */
+        /*  Check if this was a successful update */
+        if(1 == BUM_state_p->Flags.UpdateAttempt)
+            status = LIBBUMSTATE_UPDATESUCCESS;
+        else
+            status = LIBBUMSTATE_BOOTSUCCESS;
+    }
+    return status;
+}
+
+char* BUMStateOps_BootStatusString(BUM_state_t *BUM_state_p)
+{
+    return bootstatus_names[BootStatus(BUM_state_p)];
+}
+
+void BUMStateOps_GetReport( BUM_state_t         *BUM_state_p,
+                            UINT8               CurrSlot,
+                            BOOLEAN             OtherValid,
+                            bumstate_report_t   *report)
+{
+    memset(report, 0, sizeof(*report));
+    report->magic                   = LIBBUMSTATE_REPORT_MAGIC;
+    report->size                    = sizeof(*report);
+    report->state_update_counter    = BUM_state_p->StateUpdateCounter;
+    report->state_size              = BUM_state_p->StateSize;
+    report->version                 = BUM_state_p->Version;
+    report->flags                   = BUM_state_p->Flags.raw;
+    report->dflt_attempt_count      = BUM_state_p->DfltAttemptCount;
+    report->dflt_attempts_remaining = BUM_state_p->DfltAttemptsRemaining;
+    report->checksum                = BUM_state_p->Checksum;
+    report->curr_config             = BUM_state_p->Flags.CurrConfig;
+    report->update_attempt          = BUM_state_p->Flags.UpdateAttempt;
+    report->curr_slot               = CurrSlot;
+    report->other_slot_valid        = OtherValid? 1 : 0;
+    report->boot_status             = BootStatus(BUM_state_p);
+    memcpy(report->dflt_config, BUM_state_p->DfltConfig,
+            sizeof(report->dflt_config) - 1);
+    memcpy(report->altr_config, BUM_state_p->AltrConfig,
+            sizeof(report->altr_config) - 1);
+}
+
+void BUMStateOps_PrintJsonString(const char *str)
+{
+    putchar('"');
+    for(; '\0' != *str; str++){
+        if( ('"' == *str) || ('\\' == *str) )
+            printf("\\%c", *str);
+        else if((unsigned char)*str < 0x20)
+            printf("\\u%04x", (unsigned char)*str);
+        else
+            putchar(*str);
+    }
+    putchar('"');
+}
+
+/*  Starts a field: JSON fields are separated by ',' inside braces, key=value
+    fields by newlines */
+static void Report_Key( bumstate_format_t   format,
+                        const char          *key,
+                        bool                first)
+{
+    if(BUMSTATE_FORMAT_JSON == format)
+        printf("%s\"%s\":", first? "{" : ",", key);
+    else
+        printf("%s%s=", first? "" : "\n", key);
+}
+
+static void Report_U64( bumstate_format_t   format,
+                        const char          *key,
+                        uint64_t            value)
+{
+    Report_Key(format, key, false);
+    printf("%" PRIu64, value);
+}
+
+static void Report_String(  bumstate_format_t   format,
+                            const char          *key,
+                            const char          *value)
+{
+    Report_Key(format, key, false);
+    BUMStateOps_PrintJsonString(value);
+}
+
+int BUMStateOps_PrintReport(bumstate_report_t   *report,
+                            bumstate_format_t   format)
+{
+    if(BUMSTATE_FORMAT_BINARY == format){
+        if(1 != fwrite(report, sizeof(*report), 1, stdout))
+            return -1;
+        return (0 == fflush(stdout))? 0 : -1;
+    }
+    Report_Key(format, "state_update_counter", true);
+    printf("%" PRIu64, report->state_update_counter);
+    Report_U64(format, "state_size", report->state_size);
+    Report_U64(format, "version", report->version);
+    Report_U64(format, "flags", report->flags);
+    Report_String(  format, "curr_config",
+                    report->curr_config? "alternate" : "default");
+    Report_U64(format, "update_attempt", report->update_attempt);
+    Report_U64(format, "dflt_attempt_count", report->dflt_attempt_count);
+    Report_U64( format, "dflt_attempts_remaining",
+                report->dflt_attempts_remaining);
+    Report_String(format, "dflt_config", report->dflt_config);
+    Report_String(format, "altr_config", report->altr_config);
+    Report_U64(format, "checksum", report->checksum);
+    Report_String(format, "curr_slot", report->curr_slot? "B" : "A");
+    Report_U64(format, "other_slot_valid", report->other_slot_valid);
+    Report_String(  format, "boot_status",
+                    bootstatus_names[report->boot_status]);
+    printf("%s", (BUMSTATE_FORMAT_JSON == format)? "}\n" : "\n");
+    return 0;
+}
+
+int BUMStateOps_ValidateUpdateArgs( char        *attemptcount_str,
+                                    char        *updateconfig,
+                                    uint64_t    *attemptcount_p)
+{
+    size_t len;
+    int ret;
+    char *endptr;
+    unsigned long long attemptcount;
+    /*  Check the attempt count*/
+    len = strlen(attemptcount_str);
+    if(0 == len){
+        fprintf(stderr, "    validateargs: "\
+                        "attempt count can not be an empty string\n");
+        ret = -1;
+    }else{
+        errno = 0;
+        attemptcount = strtoull(attemptcount_str, &endptr, 0);
+        if(0 != errno){
+            perror( "    validateargs: "\
+                    "strtoull failed for attempt count");
+            ret = -1;
+        }else{
+            if('\0' != *endptr){
+                fprintf(stderr, "    validateargs: "\
+                                "attempt count contains non-digit characters\n");
+                ret = -1;
+            }else{
+                if(0 == attemptcount){
+                    fprintf(stderr, "    validateargs: "\
+                                    "attempt count must be greater than zero\n");
+                    ret = -1;
+                }else{
+                    /*  Check the new-configuration name */
+                    len = strlen(updateconfig);
+                    if(0 == len){
+                        fprintf(stderr, "    validateargs: "\
+                                        "new configuration name must be"\
+                                        "a non-empty string.\n");
+                        ret = -1;
+                    }else{
+                        *attemptcount_p = (uint64_t)attemptcount;
+                        ret = 0;
+                    }
+                }
+            }
+        }
+    }
+    return ret;
+}
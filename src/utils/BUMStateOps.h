@@ -0,0 +1,59 @@
+/* BUMStateOps.h - Function headers for utils/BUMStateOps.c, the operations
+ *                 shared by the single-purpose utilities and the multi-call
+ *                 bumstate tool.
+ */
+
+#ifndef __BUM_STATE_OPS__
+#define __BUM_STATE_OPS__
+
+/*  seems redundant, but defining as macros to ensure
+    error-reporting consistency */
+#define BOOTSUCCESS "BOOTSUCCESS"
+#define UPDTSUCCESS "UPDATESUCCESS"
+#define BOOTFAILURE "BOOTFAILURE"
+#define UPDTFAILURE "UPDATEFAILURE"
+#define FATALERROR  "FATALERROR"
+
+/*  Output formats of the utilities, picked with --format=<name>. text is the
+    original output of each utility; the others print a bumstate_report_t
+    (see libbumstate.h) as JSON, as key=value lines, or as the raw record. */
+typedef enum {
+    BUMSTATE_FORMAT_TEXT,
+    BUMSTATE_FORMAT_JSON,
+    BUMSTATE_FORMAT_KV,
+    BUMSTATE_FORMAT_BINARY,
+} bumstate_format_t;
+
+#define BUMSTATE_FORMAT_OPT     "--format="
+#define BUMSTATE_FORMAT_USAGE   "[--format=text|json|kv|binary]"
+
+void BUMStateOps_Print( BUM_state_t *BUM_state_p,
+                        char        *statedir);
+
+/*  Returns 1 if arg is a --format option, setting *format_p, 0 if it is not
+    one and -1 if it names an unknown format */
+int BUMStateOps_ParseFormat(const char          *arg,
+                            bumstate_format_t   *format_p);
+
+/*  Fills *report. The boot status is that of BUM_state_p. */
+void BUMStateOps_GetReport( BUM_state_t         *BUM_state_p,
+                            UINT8               CurrSlot,
+                            BOOLEAN             OtherValid,
+                            bumstate_report_t   *report);
+
+/*  Prints str as a quoted JSON string. Configuration names are printed this
+    way in both JSON and key=value output, so that any byte in a name
+    survives. */
+void BUMStateOps_PrintJsonString(const char *str);
+
+/*  Prints the report in a format other than text */
+int BUMStateOps_PrintReport(bumstate_report_t   *report,
+                            bumstate_format_t   format);
+
+char* BUMStateOps_BootStatusString(BUM_state_t *BUM_state_p);
+
+int BUMStateOps_ValidateUpdateArgs( char        *attemptcount_str,
+                                    char        *updateconfig,
+                                    uint64_t    *attemptcount_p);
+
+#endif
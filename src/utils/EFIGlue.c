@@ -28,6 +28,13 @@ VOID* EFIAPI ZeroMem(   OUT VOID    *Buffer,
     return Buffer;
 }
 
+VOID* EFIAPI CopyMem(   OUT VOID        *DestinationBuffer,
+                        IN  CONST VOID  *SourceBuffer,
+                        IN  UINTN       Length)
+{
+    return memmove(DestinationBuffer, SourceBuffer, (size_t)Length);
+}
+
 INTN EFIAPI CompareMem( IN CONST VOID  *DestinationBuffer,
                         IN CONST VOID  *SourceBuffer,
                         IN UINTN       Length)
@@ -13,6 +13,8 @@
 typedef void                VOID;
 typedef uint64_t            UINT64;
 typedef uint32_t            UINT32;
+typedef uint16_t            UINT16;
+typedef int16_t             INT16;
 typedef uint8_t             UINT8;
 typedef long                INTN;
 typedef unsigned long       UINTN;
@@ -22,6 +24,9 @@ typedef UINTN               EFI_STATUS;
 typedef VOID                EFI_FILE_PROTOCOL;
 typedef bool                BOOLEAN;
 
+#define TRUE    true
+#define FALSE   false
+
 #define EFIAPI
 #define IN
 #define OUT
@@ -38,6 +43,10 @@ typedef bool                BOOLEAN;
 #define EFI_NOT_FOUND           EFI_GENERIC_ERROR
 #define EFI_ERROR(stat)         (EFI_SUCCESS != stat)
 
+#define EFI_VARIABLE_NON_VOLATILE       (0x00000001)
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS (0x00000002)
+#define EFI_VARIABLE_RUNTIME_ACCESS     (0x00000004)
+
 UINTN EFIAPI AsciiStrnLenS( IN CONST CHAR8  *String,
                             IN UINTN        MaxSize);
 
@@ -47,6 +56,10 @@ CHAR8* EFIAPI AsciiStrCpy(  OUT CHAR8       *Destination,
 VOID* EFIAPI ZeroMem(   OUT VOID    *Buffer,
                         IN  UINTN   Length);
 
+VOID* EFIAPI CopyMem(   OUT VOID        *DestinationBuffer,
+                        IN  CONST VOID  *SourceBuffer,
+                        IN  UINTN       Length);
+
 INTN EFIAPI CompareMem( IN CONST VOID  *DestinationBuffer,
                         IN CONST VOID  *SourceBuffer,
                         IN UINTN       Length);
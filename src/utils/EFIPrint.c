@@ -0,0 +1,399 @@
+/* EFIPrint.c - User-space re-implementation of the EDK2 PrintLib formatting
+ *              rules used by the loader's log messages. Produces the same text
+ *              as AsciiSPrintUnicodeFormat/AsciiSPrint for the conversions
+ *              used in this code base:
+ *                  %d %u %x %X %p %c %s %S %a %g %t %r %%
+ *              with the '-', '+', ' ', '0', width, '*', '.', 'L' and 'l'
+ *              modifiers. As in EDK2, hexadecimal digits are upper case,
+ *              %s takes a UCS-2 string, integers without 'L'/'l' are int
+ *              sized, and a '\n' in the format is emitted as "\r\n".
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "EFIPrint.h"
+
+#define FLAG_LEFT_JUSTIFY   (1 << 0)
+#define FLAG_PREFIX_SIGN    (1 << 1)
+#define FLAG_PREFIX_BLANK   (1 << 2)
+#define FLAG_PREFIX_ZERO    (1 << 3)
+#define FLAG_LONG_TYPE      (1 << 4)
+#define FLAG_PAD_TO_WIDTH   (1 << 5)
+#define FLAG_PRECISION      (1 << 6)
+
+/*  Output sink: writes into buf while there is room, always counts */
+typedef struct {
+    char    *buf;
+    size_t  size;
+    size_t  count;
+} sink_t;
+
+static void sink_putc(sink_t *sink, char c)
+{
+    if((NULL != sink->buf) && (sink->count + 1 < sink->size))
+        sink->buf[sink->count] = c;
+    sink->count++;
+}
+
+static void sink_pad(sink_t *sink, char c, size_t n)
+{
+    while(n-- > 0)
+        sink_putc(sink, c);
+}
+
+/*  Format-string reader over either a UCS-2 or an ASCII format */
+typedef struct {
+    const uint16_t  *f16;
+    const char      *f8;
+    size_t          i;
+} reader_t;
+
+static unsigned int reader_peek(reader_t *r)
+{
+    return (NULL != r->f16)? (unsigned int)r->f16[r->i]
+                           : (unsigned int)(unsigned char)r->f8[r->i];
+}
+
+static unsigned int reader_next(reader_t *r)
+{
+    unsigned int c = reader_peek(r);
+    if(0 != c)
+        r->i++;
+    return c;
+}
+
+/*  Status strings, indexed by the low bits of the status code */
+static const char *warning_strings[] = {
+    "Success",                  "Warning Unknown Glyph",
+    "Warning Delete Failure",   "Warning Write Failure",
+    "Warning Buffer Too Small", "Warning Stale Data",
+};
+
+static const char *error_strings[] = {
+    NULL,                       "Load Error",
+    "Invalid Parameter",        "Unsupported",
+    "Bad Buffer Size",          "Buffer Too Small",
+    "Not Ready",                "Device Error",
+    "Write Protected",          "Out of Resources",
+    "Volume Corrupt",           "Volume Full",
+    "No Media",                 "Media changed",
+    "Not Found",                "Access Denied",
+    "No Response",              "No mapping",
+    "Time out",                 "Not started",
+    "Already started",          "Aborted",
+    "ICMP Error",               "TFTP Error",
+    "Protocol Error",           "Incompatible Version",
+    "Security Violation",       "CRC Error",
+    "End of Media",             NULL,
+    NULL,                       "End of File",
+    "Invalid Language",         "Compromised Data",
+};
+
+#define STATUS_ERROR_BIT (0x8000000000000000ULL)
+
+static const char *status_string(uint64_t status)
+{
+    uint64_t index;
+    if(0 != (status & STATUS_ERROR_BIT)){
+        index = status & ~STATUS_ERROR_BIT;
+        if(index < sizeof(error_strings)/sizeof(error_strings[0]))
+            return error_strings[index];
+    }else if(status < sizeof(warning_strings)/sizeof(warning_strings[0]))
+        return warning_strings[status];
+    return NULL;
+}
+
+/*  Emits a number honouring width, precision and justification */
+static void emit_number(sink_t      *sink,
+                        uint64_t    magnitude,
+                        char        prefix,
+                        unsigned    radix,
+                        unsigned    flags,
+                        size_t      width,
+                        size_t      precision)
+{
+    char digits[24];
+    size_t ndigits = 0, nzeros, total;
+    do{
+        digits[ndigits++] = "0123456789ABCDEF"[magnitude % radix];
+        magnitude /= radix;
+    }while(0 != magnitude);
+    /*  Zero-fill to the width when requested and no precision was given */
+    if(!(flags & FLAG_PRECISION)){
+        precision = 1;
+        if( (flags & FLAG_PREFIX_ZERO) && (flags & FLAG_PAD_TO_WIDTH)
+            && !(flags & FLAG_LEFT_JUSTIFY) )
+            precision = width - ((0 != prefix)? 1 : 0);
+    }
+    nzeros = (precision > ndigits)? precision - ndigits : 0;
+    total = ndigits + nzeros + ((0 != prefix)? 1 : 0);
+    if(!(flags & FLAG_LEFT_JUSTIFY) && (width > total))
+        sink_pad(sink, ' ', width - total);
+    if(0 != prefix)
+        sink_putc(sink, prefix);
+    sink_pad(sink, '0', nzeros);
+    while(ndigits > 0)
+        sink_putc(sink, digits[--ndigits]);
+    if((flags & FLAG_LEFT_JUSTIFY) && (width > total))
+        sink_pad(sink, ' ', width - total);
+}
+
+/*  Emits a string (UCS-2 or ASCII) honouring width and precision */
+static void emit_string(sink_t          *sink,
+                        const uint16_t  *s16,
+                        const char      *s8,
+                        unsigned        flags,
+                        size_t          width,
+                        size_t          precision)
+{
+    size_t len, i;
+    for(len = 0; ; len++){
+        if((flags & FLAG_PRECISION) && (len >= precision))
+            break;
+        if(((NULL != s16)? s16[len] : (uint16_t)(unsigned char)s8[len]) == 0)
+            break;
+    }
+    if(!(flags & FLAG_LEFT_JUSTIFY) && (width > len))
+        sink_pad(sink, ' ', width - len);
+    for(i = 0; i < len; i++)
+        sink_putc(sink, (char)((NULL != s16)? s16[i] : s8[i]));
+    if((flags & FLAG_LEFT_JUSTIFY) && (width > len))
+        sink_pad(sink, ' ', width - len);
+}
+
+typedef struct {
+    uint32_t    Data1;
+    uint16_t    Data2;
+    uint16_t    Data3;
+    uint8_t     Data4[8];
+} guid_t;
+
+typedef struct {
+    uint16_t    Year;
+    uint8_t     Month;
+    uint8_t     Day;
+    uint8_t     Hour;
+    uint8_t     Minute;
+} efitime_prefix_t;
+
+static size_t do_format(sink_t          *sink,
+                        reader_t        *r,
+                        EFIPrint_args_t *args)
+{
+    unsigned int c;
+    while(0 != (c = reader_next(r))){
+        unsigned flags = 0;
+        size_t width = 0, precision = 0;
+        bool in_precision = false, done = false;
+        char prefix = 0;
+        uint64_t value;
+        /*  Plain characters, with the EDK2 new-line translation */
+        if('%' != c){
+            if('\n' == c){
+                sink_putc(sink, '\r');
+                sink_putc(sink, '\n');
+                if('\r' == reader_peek(r))
+                    reader_next(r);
+            }else if('\r' == c){
+                sink_putc(sink, '\r');
+                if('\n' == reader_peek(r)){
+                    reader_next(r);
+                    sink_putc(sink, '\n');
+                }
+            }else
+                sink_putc(sink, (char)(c & 0xff));
+            continue;
+        }
+        /*  Flags, width, and precision */
+        while(!done){
+            c = reader_next(r);
+            switch(c){
+                case '-':   flags |= FLAG_LEFT_JUSTIFY;     break;
+                case '+':   flags |= FLAG_PREFIX_SIGN;      break;
+                case ' ':   flags |= FLAG_PREFIX_BLANK;     break;
+                case ',':                                   break;
+                case 'L':
+                case 'l':   flags |= FLAG_LONG_TYPE;        break;
+                case '.':
+                    flags |= FLAG_PRECISION;
+                    in_precision = true;
+                    break;
+                case '*':
+                    value = args->next(args->ctx, EFIPRINT_ARG_INT);
+                    if(in_precision)
+                        precision = (size_t)(uint32_t)value;
+                    else{
+                        flags |= FLAG_PAD_TO_WIDTH;
+                        width = (size_t)(uint32_t)value;
+                    }
+                    break;
+                case '0':
+                    if(!in_precision && !(flags & FLAG_PAD_TO_WIDTH)){
+                        flags |= FLAG_PREFIX_ZERO;
+                        break;
+                    }
+                    /* fall through */
+                case '1': case '2': case '3': case '4':
+                case '5': case '6': case '7': case '8': case '9':
+                    if(in_precision)
+                        precision = precision * 10 + (c - '0');
+                    else{
+                        flags |= FLAG_PAD_TO_WIDTH;
+                        width = width * 10 + (c - '0');
+                    }
+                    break;
+                default:
+                    done = true;
+                    break;
+            }
+        }
+        /*  Conversion */
+        switch(c){
+            case 'p':
+                flags &= ~(FLAG_PREFIX_BLANK | FLAG_PREFIX_SIGN);
+                value = args->next(args->ctx, EFIPRINT_ARG_POINTER);
+                emit_number(sink, value, 0, 16, flags | FLAG_PREFIX_ZERO,
+                            width, precision);
+                break;
+            case 'X':
+                flags |= FLAG_PREFIX_ZERO;
+                /* fall through */
+            case 'x':
+                if(flags & FLAG_LONG_TYPE)
+                    value = args->next(args->ctx, EFIPRINT_ARG_INT64);
+                else
+                    value = (uint32_t)args->next(args->ctx, EFIPRINT_ARG_INT);
+                emit_number(sink, value, 0, 16, flags, width, precision);
+                break;
+            case 'u':
+            case 'd':
+                if(flags & FLAG_LONG_TYPE)
+                    value = args->next(args->ctx, EFIPRINT_ARG_INT64);
+                else if('u' == c)
+                    value = (uint32_t)args->next(args->ctx, EFIPRINT_ARG_INT);
+                else
+                    value = (uint64_t)(int64_t)(int32_t)
+                                args->next(args->ctx, EFIPRINT_ARG_INT);
+                if(flags & FLAG_PREFIX_BLANK)
+                    prefix = ' ';
+                if(flags & FLAG_PREFIX_SIGN)
+                    prefix = '+';
+                if(('d' == c) && ((int64_t)value < 0)){
+                    prefix = '-';
+                    value = (uint64_t)(-(int64_t)value);
+                }
+                emit_number(sink, value, prefix, 10, flags, width, precision);
+                break;
+            case 'c':
+                value = args->next(args->ctx, EFIPRINT_ARG_INT);
+                {
+                    uint16_t ch[2] = { (uint16_t)value, 0 };
+                    emit_string(sink, ch, NULL, flags, width, precision);
+                }
+                break;
+            case 's':
+            case 'S':
+                value = args->next(args->ctx, EFIPRINT_ARG_STRING16);
+                if(0 == value)
+                    emit_string(sink, NULL, "<null string>",
+                                flags, width, precision);
+                else
+                    emit_string(sink, (const uint16_t*)(uintptr_t)value, NULL,
+                                flags, width, precision);
+                break;
+            case 'a':
+                value = args->next(args->ctx, EFIPRINT_ARG_STRING8);
+                emit_string(sink, NULL,
+                            (0 == value)? "<null string>"
+                                        : (const char*)(uintptr_t)value,
+                            flags, width, precision);
+                break;
+            case 'g':
+                value = args->next(args->ctx, EFIPRINT_ARG_GUID);
+                if(0 == value)
+                    emit_string(sink, NULL, "<null guid>",
+                                flags, width, precision);
+                else{
+                    const guid_t *g = (const guid_t*)(uintptr_t)value;
+                    unsigned i;
+                    emit_number(sink, g->Data1, 0, 16, FLAG_PREFIX_ZERO |
+                                FLAG_PAD_TO_WIDTH, 8, 0);
+                    sink_putc(sink, '-');
+                    emit_number(sink, g->Data2, 0, 16, FLAG_PREFIX_ZERO |
+                                FLAG_PAD_TO_WIDTH, 4, 0);
+                    sink_putc(sink, '-');
+                    emit_number(sink, g->Data3, 0, 16, FLAG_PREFIX_ZERO |
+                                FLAG_PAD_TO_WIDTH, 4, 0);
+                    sink_putc(sink, '-');
+                    for(i = 0; i < 8; i++){
+                        if(2 == i)
+                            sink_putc(sink, '-');
+                        emit_number(sink, g->Data4[i], 0, 16,
+                                    FLAG_PREFIX_ZERO | FLAG_PAD_TO_WIDTH, 2, 0);
+                    }
+                }
+                break;
+            case 't':
+                value = args->next(args->ctx, EFIPRINT_ARG_TIME);
+                if(0 == value)
+                    emit_string(sink, NULL, "<null time>",
+                                flags, width, precision);
+                else{
+                    const efitime_prefix_t *t =
+                                (const efitime_prefix_t*)(uintptr_t)value;
+                    unsigned zp = FLAG_PREFIX_ZERO | FLAG_PAD_TO_WIDTH;
+                    emit_number(sink, t->Month, 0, 10, zp, 2, 0);
+                    sink_putc(sink, '/');
+                    emit_number(sink, t->Day, 0, 10, zp, 2, 0);
+                    sink_putc(sink, '/');
+                    emit_number(sink, t->Year, 0, 10, zp, 4, 0);
+                    sink_putc(sink, ' ');
+                    sink_putc(sink, ' ');
+                    emit_number(sink, t->Hour, 0, 10, zp, 2, 0);
+                    sink_putc(sink, ':');
+                    emit_number(sink, t->Minute, 0, 10, zp, 2, 0);
+                }
+                break;
+            case 'r':
+                value = args->next(args->ctx, EFIPRINT_ARG_INT64);
+                {
+                    const char *str = status_string(value);
+                    if(NULL != str)
+                        emit_string(sink, NULL, str, flags, width, precision);
+                    else
+                        emit_number(sink, value, 0, 16, flags,
+                                    width, precision);
+                }
+                break;
+            case '%':
+                sink_putc(sink, '%');
+                break;
+            case 0:
+                /*  Format ends in the middle of a conversion */
+                return sink->count;
+            default:
+                /*  Unknown conversions are reproduced verbatim */
+                sink_putc(sink, (char)(c & 0xff));
+                break;
+        }
+    }
+    return sink->count;
+}
+
+size_t EFIPrint_format( char                *buf,
+                        size_t              bufsize,
+                        const uint16_t      *format16,
+                        const char          *format8,
+                        EFIPrint_args_t     *args)
+{
+    sink_t sink = { buf, bufsize, 0 };
+    reader_t r = { format16, format8, 0 };
+    do_format(&sink, &r, args);
+    if((NULL != buf) && (bufsize > 0)){
+        if(sink.count >= bufsize)
+            sink.count = bufsize - 1;
+        buf[sink.count] = '\0';
+    }
+    return sink.count;
+}
@@ -0,0 +1,42 @@
+/* EFIPrint.h - Interface of a user-space re-implementation of the EDK2
+ *              PrintLib formatting rules (UCS-2 and ASCII format strings).
+ */
+
+#ifndef __EFI_PRINT__
+#define __EFI_PRINT__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*  Classes of arguments consumed by a conversion. The argument source decides
+    how each class is fetched (va_list, recorded argument words, ...). */
+typedef enum {
+    EFIPRINT_ARG_INT,       /* int-sized integer (%d, %x, %c without 'L') */
+    EFIPRINT_ARG_INT64,     /* 64-bit integer (%Ld, %lx, %r, ...) */
+    EFIPRINT_ARG_POINTER,   /* pointer printed as a number (%p) */
+    EFIPRINT_ARG_STRING16,  /* pointer to a UCS-2 string (%s, %S) */
+    EFIPRINT_ARG_STRING8,   /* pointer to an ASCII string (%a) */
+    EFIPRINT_ARG_GUID,      /* pointer to a GUID (%g) */
+    EFIPRINT_ARG_TIME       /* pointer to an EFI_TIME (%t) */
+} EFIPrint_argclass_t;
+
+typedef struct {
+    /*  Returns the next argument of the given class. Pointers are returned
+        as uintptr_t values; a zero pointer prints as "<null string>". */
+    uint64_t    (*next)(void *ctx, EFIPrint_argclass_t argclass);
+    void        *ctx;
+} EFIPrint_args_t;
+
+/*  Formats into an ASCII buffer following EDK2 PrintLib rules. The format is
+    either a UCS-2 string (format16 != NULL) or an ASCII string (format8).
+    At most bufsize-1 characters are written and the buffer is always
+    NUL-terminated when bufsize > 0. A NULL buffer only counts. Returns the
+    number of characters produced (excluding the terminator), truncated to
+    what fit in the buffer when a buffer is supplied. */
+size_t EFIPrint_format( char                *buf,
+                        size_t              bufsize,
+                        const uint16_t      *format16,
+                        const char          *format8,
+                        EFIPrint_args_t     *args);
+
+#endif
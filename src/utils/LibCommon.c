@@ -16,6 +16,13 @@
 #include "EFIGlue.h"
 
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+#include "Crc32c.h"
 
 static size_t c16strlen(const CHAR16 *c16str)
 {
@@ -186,28 +193,135 @@ EFI_STATUS EFIAPI Common_OpenReadCloseFile( IN  CHAR16      *filepath,
     return Status;
 }
 
+/*  Files are replaced atomically: the new contents are written to a temporary
+    file, which is synced and renamed over the old file. The directory is then
+    synced so that the rename itself is on media when the utility returns.
+    Setting BUMSTATE_NO_FSYNC in the environment skips the two syncs but keeps
+    the rename (e.g. for tests on tmpfs). */
+#define TMPFILE_SUFFIX  ".tmp"
+#define NO_FSYNC_ENV    "BUMSTATE_NO_FSYNC"
+
+#ifdef BUMSTATE_FAULT_INJECTION
+/*  Test builds exit at the Nth syscall boundary of the write path, with N
+    taken from BUMSTATE_FAULT_AT, to check that an interrupted write always
+    leaves either the old or the new state behind (see test/fault-test.sh). */
+#define FAULT_AT_ENV        "BUMSTATE_FAULT_AT"
+#define FAULT_EXIT_STATUS   (99)
+
+static void Common_FaultPoint(void)
+{
+    static long count = 0, target = -1;
+    char *env;
+    if(target < 0){
+        env = getenv(FAULT_AT_ENV);
+        target = (NULL == env)? 0 : strtol(env, NULL, 0);
+    }
+    if(++count == target)
+        _exit(FAULT_EXIT_STATUS);
+}
+#else
+#define Common_FaultPoint()
+#endif
+
+static EFI_STATUS Common_WriteAll(  int     fd,
+                                    VOID    *buffer,
+                                    UINTN   buffersize)
+{
+    ssize_t written;
+    UINTN done = 0;
+    while(done < buffersize){
+        written = write(fd, (char*)buffer + done, buffersize - done);
+        Common_FaultPoint();
+        if(written <= 0)
+            return EFI_DEVICE_ERROR;
+        done += (UINTN)written;
+    }
+    return EFI_SUCCESS;
+}
+
+/*  Syncs the directory holding filepath8 */
+static EFI_STATUS Common_SyncDir(char   *filepath8)
+{
+    EFI_STATUS Status;
+    char *slash, *dirpath8;
+    int fd;
+    slash = strrchr(filepath8, '/');
+    if(NULL == slash)
+        dirpath8 = strdup(".");
+    else if(slash == filepath8)
+        dirpath8 = strdup("/");
+    else
+        dirpath8 = strndup(filepath8, (size_t)(slash - filepath8));
+    if(NULL == dirpath8)
+        return EFI_OUT_OF_RESOURCES;
+    fd = open(dirpath8, O_RDONLY | O_DIRECTORY);
+    Common_FaultPoint();
+    if(fd < 0)
+        Status = EFI_DEVICE_ERROR;
+    else{
+        Status = (0 == fsync(fd))? EFI_SUCCESS : EFI_DEVICE_ERROR;
+        Common_FaultPoint();
+        close(fd);
+        Common_FaultPoint();
+    }
+    free(dirpath8);
+    return Status;
+}
+
 EFI_STATUS EFIAPI Common_CreateWriteCloseFile(  IN CHAR16 *filepath,
                                                 IN VOID*  buffer,
                                                 IN UINTN  buffersize)
 {
     EFI_STATUS Status;
-    EFI_FILE_PROTOCOL *filep;
-    size_t writesize;
+    size_t pathlen;
+    char *filepath8, *tmppath8;
+    bool dosync;
+    int fd;
 
-    /* Open file */
-    Status = Common_OpenFile(   &filep,
-                                filepath,
-                                "w+");
-    if( !EFI_ERROR(Status) ){
-        /* Write out to file */
-        writesize = fwrite(buffer, 1, buffersize, (FILE*)filep);
-        if(writesize < buffersize)
+    pathlen = c16strlen(filepath);
+    filepath8 = (char*)malloc(sizeof(char)*(pathlen+1));
+    tmppath8 = (char*)malloc(sizeof(char)*(pathlen+sizeof(TMPFILE_SUFFIX)));
+    if( (NULL == filepath8) || (NULL == tmppath8) ){
+        Status = EFI_OUT_OF_RESOURCES;
+        goto exit0;
+    }
+    c16strtostr(filepath8, filepath);
+    strcpy(tmppath8, filepath8);
+    strcat(tmppath8, TMPFILE_SUFFIX);
+    dosync = (NULL == getenv(NO_FSYNC_ENV));
+    /* Write the temporary file */
+    Common_FaultPoint();
+    fd = open(tmppath8, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    Common_FaultPoint();
+    if(fd < 0){
+        Status = EFI_OUT_OF_RESOURCES;
+        goto exit0;
+    }
+    Status = Common_WriteAll(fd, buffer, buffersize);
+    if( !EFI_ERROR(Status) && dosync ){
+        if(0 != fsync(fd))
             Status = EFI_DEVICE_ERROR;
-        else
-            Status = EFI_SUCCESS;
-        /* close file */
-        fclose((FILE*)filep);
+        Common_FaultPoint();
+    }
+    if( (0 != close(fd)) && !EFI_ERROR(Status) )
+        Status = EFI_DEVICE_ERROR;
+    Common_FaultPoint();
+    if(EFI_ERROR(Status))
+        goto exit1;
+    /* Replace the file */
+    if(0 != rename(tmppath8, filepath8)){
+        Status = EFI_DEVICE_ERROR;
+        goto exit1;
     }
+    Common_FaultPoint();
+    if(dosync)
+        Status = Common_SyncDir(filepath8);
+    goto exit0;
+exit1:
+    unlink(tmppath8);
+exit0:
+    free(tmppath8);
+    free(filepath8);
     return Status;
 }
 
@@ -267,3 +381,123 @@ EFI_STATUS EFIAPI Common_OpenReadCloseDirFile(  IN CHAR8    *dirpath,
     return Status;
 }
 
+/*  Unlike a whole file, a write in place is not atomic: the caller has to
+    detect a torn write (e.g. with a checksum). A file created here is made
+    durable by also syncing the directory. */
+EFI_STATUS EFIAPI Common_WriteDirFileAt(IN  CHAR8   *dirpath,
+                                        IN  CHAR8   *filename,
+                                        IN  UINT64  position,
+                                        IN  VOID*   buffer,
+                                        IN  UINTN   buffersize)
+{
+    EFI_STATUS Status;
+    char filepath8[PATHLEN_MAX + 1];
+    bool dosync, created = false;
+    ssize_t written;
+    int fd;
+    if( (size_t)snprintf(filepath8, sizeof(filepath8), "%s/%s",
+                            dirpath, filename) >= sizeof(filepath8) )
+        return EFI_UNSUPPORTED;
+    dosync = (NULL == getenv(NO_FSYNC_ENV));
+    Common_FaultPoint();
+    fd = open(filepath8, O_WRONLY | O_CLOEXEC);
+    if( (fd < 0) && (ENOENT == errno) ){
+        fd = open(filepath8, O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+        created = true;
+    }
+    Common_FaultPoint();
+    if(fd < 0)
+        return EFI_DEVICE_ERROR;
+    written = pwrite(fd, buffer, buffersize, (off_t)position);
+    Common_FaultPoint();
+    Status = ((ssize_t)buffersize == written)? EFI_SUCCESS : EFI_DEVICE_ERROR;
+    if( !EFI_ERROR(Status) && dosync ){
+        if(0 != fsync(fd))
+            Status = EFI_DEVICE_ERROR;
+        Common_FaultPoint();
+    }
+    if( (0 != close(fd)) && !EFI_ERROR(Status) )
+        Status = EFI_DEVICE_ERROR;
+    Common_FaultPoint();
+    if( !EFI_ERROR(Status) && dosync && created )
+        Status = Common_SyncDir(filepath8);
+    return Status;
+}
+
+/*  One open, read and close, with the path on the stack: no stdio, no file
+    size lookup, and no allocation */
+EFI_STATUS EFIAPI Common_ReadDirFileInto(   IN  CHAR8   *dirpath,
+                                            IN  CHAR8   *filename,
+                                            OUT VOID*   buffer,
+                                            IN  UINTN   buffersize,
+                                            OUT UINTN   *readsize_p)
+{
+    EFI_STATUS Status = EFI_SUCCESS;
+    char filepath8[PATHLEN_MAX + 1];
+    ssize_t readsize;
+    UINTN done = 0;
+    int fd;
+    if( (size_t)snprintf(filepath8, sizeof(filepath8), "%s/%s",
+                            dirpath, filename) >= sizeof(filepath8) )
+        return EFI_UNSUPPORTED;
+    fd = open(filepath8, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return EFI_NOT_FOUND;
+    while(done < buffersize){
+        readsize = read(fd, (char*)buffer + done, buffersize - done);
+        if(readsize < 0){
+            Status = EFI_DEVICE_ERROR;
+            break;
+        }
+        if(0 == readsize)
+            break;
+        done += (UINTN)readsize;
+    }
+    close(fd);
+    *readsize_p = done;
+    return Status;
+}
+
+EFI_STATUS EFIAPI Common_CopyReadBuffer(IN  CONST VOID  *source,
+                                        IN  UINTN       size,
+                                        OUT VOID*       *buffer_p)
+{
+    VOID *buffer = malloc(size);
+    if(NULL == buffer)
+        return EFI_OUT_OF_RESOURCES;
+    memcpy(buffer, source, size);
+    *buffer_p = buffer;
+    return EFI_SUCCESS;
+}
+
+#if defined(__x86_64__)
+/*  CRC32C with the SSE4.2 crc32 instruction, eight bytes at a time */
+__attribute__((target("sse4.2")))
+static UINT32 Common_Crc32cSse42(   IN  CONST VOID  *Buffer,
+                                    IN  UINTN       Length)
+{
+    CONST UINT8 *bytes = (CONST UINT8*)Buffer;
+    UINT64 crc = 0xFFFFFFFF, word;
+    for(; Length >= sizeof(word); Length -= sizeof(word)){
+        memcpy(&word, bytes, sizeof(word));
+        crc = _mm_crc32_u64(crc, word);
+        bytes += sizeof(word);
+    }
+    while(Length--)
+        crc = _mm_crc32_u8((UINT32)crc, *bytes++);
+    return ~(UINT32)crc;
+}
+#endif
+
+UINT32 EFIAPI Common_Crc32c(IN  CONST VOID  *Buffer,
+                            IN  UINTN       Length)
+{
+#if defined(__x86_64__)
+    static int hasSse42 = -1;
+    if(hasSse42 < 0)
+        hasSse42 = __builtin_cpu_supports("sse4.2");
+    if(hasSse42)
+        return Common_Crc32cSse42(Buffer, Length);
+#endif
+    return Crc32c_update(0, Buffer, Length);
+}
@@ -43,4 +43,28 @@ EFI_STATUS EFIAPI Common_OpenReadCloseDirFile(  IN CHAR8    *dirpath,
                                                 OUT VOID*   *buffer_p,
                                                 OUT UINTN   *buffersize_p);
 
+/*  Writes buffersize bytes at position of a file, creating it if needed, and
+    syncs it. The rest of the file is left as it is. */
+EFI_STATUS EFIAPI Common_WriteDirFileAt(IN  CHAR8   *dirpath,
+                                        IN  CHAR8   *filename,
+                                        IN  UINT64  position,
+                                        IN  VOID*   buffer,
+                                        IN  UINTN   buffersize);
+
+/*  Reads at most buffersize bytes of a file into the caller's buffer;
+    *readsize_p is set to the number of bytes read */
+EFI_STATUS EFIAPI Common_ReadDirFileInto(   IN  CHAR8   *dirpath,
+                                            IN  CHAR8   *filename,
+                                            OUT VOID*   buffer,
+                                            IN  UINTN   buffersize,
+                                            OUT UINTN   *readsize_p);
+
+/*  Copies a buffer into a new buffer freed with Common_FreeReadBuffer */
+EFI_STATUS EFIAPI Common_CopyReadBuffer(IN  CONST VOID  *source,
+                                        IN  UINTN       size,
+                                        OUT VOID*       *buffer_p);
+
+UINT32 EFIAPI Common_Crc32c(IN  CONST VOID  *Buffer,
+                            IN  UINTN       Length);
+
 #endif
@@ -0,0 +1,154 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <uchar.h>
+#include "EFIGlue.h"
+#include "LibCommon.h"
+#include "BootStatFile.h"
+
+static const char *usage = "<boot-status directory> [--export=<directory>]";
+
+#define EXPORT_OPT      "--export="
+#define EXPORT_NAME_MAX (255)
+
+/*  Prints one entry as "<name>: <value>". Binary values are printed as their
+    size and hex bytes. */
+static void BootStat_PrintEntry(BOOTSTAT_entry_t    *entry,
+                                char                *name,
+                                uint8_t             *value)
+{
+    uint64_t number;
+    uint32_t i;
+    printf("%.*s:", (int)entry->NameLength, name);
+    switch(entry->Type){
+        case BOOTSTAT_TYPE_STRING:
+            printf(" %.*s\n", (int)entry->ValueLength, (char*)value);
+            break;
+        case BOOTSTAT_TYPE_UINT64:
+            if(sizeof(number) == entry->ValueLength){
+                memcpy(&number, value, sizeof(number));
+                printf(" %" PRIu64 "\n", number);
+                break;
+            }
+            /* Fall through: print what is there */
+        default:
+            printf(" %" PRIu32 " byte(s)%s", entry->ValueLength,
+                    (0 == entry->ValueLength)? "" : " ");
+            for(i = 0; i < entry->ValueLength; i++)
+                printf("%02x", value[i]);
+            printf("\n");
+            break;
+    }
+}
+
+/*  Writes the value of an entry to the file the loader used to write it to.
+    Names that are not plain file names are refused. */
+static int BootStat_ExportEntry(char                *exportdir,
+                                BOOTSTAT_entry_t    *entry,
+                                char                *name,
+                                uint8_t             *value)
+{
+    char filename[EXPORT_NAME_MAX + 1];
+    EFI_STATUS stat;
+    if( (0 == entry->NameLength) || (EXPORT_NAME_MAX < entry->NameLength) ||
+        (NULL != memchr(name, '/', entry->NameLength)) ||
+        (NULL != memchr(name, '\0', entry->NameLength)) ||
+        ('.' == name[0]) ){
+        fprintf(stderr, "    entry name \"%.*s\" is not a file name\n",
+                (int)entry->NameLength, name);
+        return -1;
+    }
+    memcpy(filename, name, entry->NameLength);
+    filename[entry->NameLength] = '\0';
+    stat = Common_CreateWriteCloseDirFile(  exportdir, filename,
+                                            value, entry->ValueLength);
+    if(EFI_ERROR(stat)){
+        fprintf(stderr, "    Common_CreateWriteCloseDirFile failed for "
+                        "\"%s\"\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+/*  Checks the file and prints (or exports) its entries in file order */
+static int BootStat_Dump(   char    *statdir,
+                            char    *exportdir)
+{
+    int ret;
+    EFI_STATUS stat;
+    uint8_t *buffer;
+    UINTN buffersize;
+    BOOTSTAT_header_t *header;
+    BOOTSTAT_entry_t *entry;
+    uint32_t checksum, offset, i;
+
+    stat = Common_OpenReadCloseDirFile( statdir, BOOTSTAT_FILENAME,
+                                        (VOID**)&buffer, &buffersize);
+    if(EFI_ERROR(stat)){
+        fprintf(stderr, "    Common_OpenReadCloseDirFile failed\n");
+        ret = -1;
+        goto exit0;
+    }
+    header = (BOOTSTAT_header_t*)buffer;
+    if(!BootStatFile_headerIsValid(header, buffersize)){
+        fprintf(stderr, "    invalid boot-status header\n");
+        ret = -1;
+        goto exit1;
+    }
+    checksum = header->Checksum;
+    header->Checksum = 0;
+    if(checksum != Common_Crc32c(buffer, buffersize)){
+        fprintf(stderr, "    boot-status checksum mismatch\n");
+        ret = -1;
+        goto exit1;
+    }
+    ret = 0;
+    offset = header->HeaderSize;
+    for(i = 0; i < header->EntryCount; i++){
+        entry = (BOOTSTAT_entry_t*)(buffer + offset);
+        if( (buffersize - offset < sizeof(*entry)) ||
+            (entry->ValueLength > buffersize) ||
+            (buffersize - offset < BootStatFile_entrySize(entry->NameLength,
+                                                    entry->ValueLength)) ){
+            fprintf(stderr, "    boot-status entry %" PRIu32 " is truncated\n",
+                    i);
+            ret = -1;
+            goto exit1;
+        }
+        if(NULL == exportdir)
+            BootStat_PrintEntry(entry, (char*)(entry + 1),
+                                (uint8_t*)(entry + 1) + entry->NameLength);
+        else if(0 != BootStat_ExportEntry(exportdir, entry, (char*)(entry + 1),
+                                (uint8_t*)(entry + 1) + entry->NameLength))
+            ret = -1;
+        offset += BootStatFile_entrySize(entry->NameLength, entry->ValueLength);
+    }
+exit1:
+    Common_FreeReadBuffer(buffer, buffersize);
+exit0:
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int ret;
+    char *exportdir = NULL;
+    if( (argc == 3) &&
+        (0 == strncmp(argv[2], EXPORT_OPT, strlen(EXPORT_OPT))) &&
+        ('\0' != argv[2][strlen(EXPORT_OPT)]) ){
+        exportdir = &(argv[2][strlen(EXPORT_OPT)]);
+        argc--;
+    }
+    if(argc != 2){
+        fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
+        ret = -1;
+    }else{
+        ret = BootStat_Dump(argv[1], exportdir);
+        if(0 != ret)
+            fprintf(stderr, "    BootStat_Dump failed\n");
+    }
+    return ret;
+}
@@ -0,0 +1,265 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <uchar.h>
+#include "EFIGlue.h"
+#include "LibCommon.h"
+#include "BootTimeline.h"
+
+static const char *usage = "<boot-status directory>";
+
+static const char *phase_names[BOOTTIME_PHASE_COUNT] = {
+    "init", "state-get", "state-put", "load-keys", "load-image",
+    "boot-status", "start-image", "bootstat-put"
+};
+
+static const char *stage_names[BOOTTIME_STAGE_COUNT] = {
+    "root", "config", "unknown"
+};
+
+/* Number of log2 buckets in the histogram and width of its longest bar */
+#define HIST_BUCKETS    (64)
+#define HIST_WIDTH      (50)
+
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+} phase_stats_t;
+
+static void Stats_Add(phase_stats_t *stats, uint64_t ticks)
+{
+    if( (0 == stats->count) || (ticks < stats->min) )
+        stats->min = ticks;
+    if(ticks > stats->max)
+        stats->max = ticks;
+    stats->sum += ticks;
+    stats->count++;
+}
+
+/*  Converts TSC ticks to the unit of the report: microseconds if the boot
+    measured its TSC frequency, ticks otherwise. */
+static uint64_t BootTime_Convert(BOOTTIME_boot_t *boot, uint64_t ticks)
+{
+    return (0 != boot->TicksPerUs)? (ticks / boot->TicksPerUs) : ticks;
+}
+
+static unsigned Log2(uint64_t value)
+{
+    unsigned bits = 0;
+    while(value >>= 1)
+        bits++;
+    return bits;
+}
+
+/*  Prints the phases of one boot. A phase lasts from its BEGIN mark to the
+    next END mark of the same phase and stage. Durations are added to stats
+    only if the boot's unit is the unit of the summary. Returns the time from
+    the first mark to the last start-image mark through total_p, or false if
+    the boot never reached a start-image mark. */
+static bool BootTime_PrintBoot( BOOTTIME_boot_t *boot,
+                                bool summaryInUs,
+                                phase_stats_t stats[BOOTTIME_STAGE_COUNT]
+                                                   [BOOTTIME_PHASE_COUNT],
+                                uint64_t *total_p)
+{
+    uint32_t i, j;
+    BOOTTIME_mark_t *mark, *end;
+    bool started = false, summarize;
+    uint64_t startTSC = 0, duration;
+
+    summarize = (summaryInUs == (0 != boot->TicksPerUs));
+    printf("boot %" PRIu64 "  %04u-%02u-%02u %02u:%02u:%02u  ",
+            boot->Sequence,
+            (unsigned)boot->Year, (unsigned)boot->Month,
+            (unsigned)boot->Day, (unsigned)boot->Hour,
+            (unsigned)boot->Minute, (unsigned)boot->Second);
+    if(0 != boot->TicksPerUs)
+        printf("(us, %" PRIu32 " ticks/us)\n", boot->TicksPerUs);
+    else
+        printf("(TSC ticks, not calibrated)\n");
+    for(i = 0; i < boot->MarkCount; i++){
+        mark = &(boot->Marks[i]);
+        if( (mark->Phase >= BOOTTIME_PHASE_COUNT) ||
+            (mark->Stage >= BOOTTIME_STAGE_COUNT) )
+            continue;
+        if(BOOTTIME_MARK_POINT == mark->Kind){
+            if(BOOTTIME_PHASE_STARTIMAGE == mark->Phase){
+                printf("    %-8s%-14s@ %" PRIu64 "\n",
+                        stage_names[mark->Stage], phase_names[mark->Phase],
+                        BootTime_Convert(boot,
+                                         mark->TSC - boot->Marks[0].TSC));
+                startTSC = mark->TSC;
+                started = true;
+            }
+            continue;
+        }
+        if(BOOTTIME_MARK_BEGIN != mark->Kind)
+            continue;
+        for(j = i + 1; j < boot->MarkCount; j++){
+            end = &(boot->Marks[j]);
+            if( (BOOTTIME_MARK_END == end->Kind) &&
+                (end->Phase == mark->Phase) && (end->Stage == mark->Stage) )
+                break;
+        }
+        if(j == boot->MarkCount){
+            printf("    %-8s%-14s(no end)\n",
+                    stage_names[mark->Stage], phase_names[mark->Phase]);
+            continue;
+        }
+        duration = BootTime_Convert(boot, end->TSC - mark->TSC);
+        printf("    %-8s%-14s%" PRIu64 "\n",
+                stage_names[mark->Stage], phase_names[mark->Phase],
+                duration);
+        if(summarize)
+            Stats_Add(&(stats[mark->Stage][mark->Phase]), duration);
+    }
+    if(started){
+        *total_p = BootTime_Convert(boot, startTSC - boot->Marks[0].TSC);
+        printf("    total                 %" PRIu64 "\n", *total_p);
+    }
+    return started && summarize;
+}
+
+static void BootTime_PrintSummary(  bool summaryInUs,
+                                    phase_stats_t stats[BOOTTIME_STAGE_COUNT]
+                                                       [BOOTTIME_PHASE_COUNT])
+{
+    unsigned stage, phase;
+    phase_stats_t *s;
+    printf("%s:\n", summaryInUs? "microseconds, calibrated boots only" :
+                                 "TSC ticks");
+    printf("%-8s%-14s%8s %20s %20s %20s\n",
+            "stage", "phase", "count", "min", "mean", "max");
+    for(stage = 0; stage < BOOTTIME_STAGE_COUNT; stage++){
+        for(phase = 0; phase < BOOTTIME_PHASE_COUNT; phase++){
+            s = &(stats[stage][phase]);
+            if(0 == s->count)
+                continue;
+            printf("%-8s%-14s%8" PRIu64 " %20" PRIu64 " %20" PRIu64
+                    " %20" PRIu64 "\n",
+                    stage_names[stage], phase_names[phase], s->count,
+                    s->min, s->sum / s->count, s->max);
+        }
+    }
+}
+
+/*  Prints a histogram of the totals with one row per power of two */
+static void BootTime_PrintHistogram(   bool summaryInUs,
+                                        uint64_t *totals, uint64_t count)
+{
+    uint64_t buckets[HIST_BUCKETS] = {0};
+    uint64_t i, maxcount = 0;
+    unsigned b, lo = HIST_BUCKETS, hi = 0, width;
+    for(i = 0; i < count; i++){
+        b = Log2(totals[i]);
+        buckets[b]++;
+        if(b < lo)
+            lo = b;
+        if(b > hi)
+            hi = b;
+        if(buckets[b] > maxcount)
+            maxcount = buckets[b];
+    }
+    printf("%s to payload start:\n", summaryInUs? "microseconds" : "ticks");
+    for(b = lo; (0 != count) && (b <= hi); b++){
+        width = (unsigned)((buckets[b] * HIST_WIDTH + maxcount - 1) /
+                            maxcount);
+        printf("    >= 2^%-3u %6" PRIu64 " %.*s\n", b, buckets[b], width,
+                "##################################################");
+    }
+}
+
+/*  Returns boot Sequence from the history, or NULL if its slot was not
+    completely written (the header is updated after the slot). */
+static BOOTTIME_boot_t *BootTime_GetBoot(   uint8_t             *buffer,
+                                            UINTN               buffersize,
+                                            BOOTTIME_header_t   *header,
+                                            uint64_t            seq)
+{
+    BOOTTIME_boot_t *boot;
+    if(BootTime_bootOffset(header, seq) + sizeof(BOOTTIME_boot_t) > buffersize)
+        return NULL;
+    boot = (BOOTTIME_boot_t*)(buffer + BootTime_bootOffset(header, seq));
+    if( (boot->Sequence != seq) || (0 == boot->MarkCount) ||
+        (boot->MarkCount > BOOTTIME_MARKS_MAX) )
+        return NULL;
+    return boot;
+}
+
+/*  Reports every complete boot in the history, oldest first */
+static int BootTime_Report(char *statdir)
+{
+    int ret;
+    EFI_STATUS stat;
+    uint8_t *buffer;
+    UINTN buffersize;
+    BOOTTIME_header_t *header;
+    BOOTTIME_boot_t *boot;
+    uint64_t seq, first, skipped = 0, nTotals = 0;
+    bool summaryInUs = false;
+    uint64_t totals[BOOTTIME_HISTORY_COUNT];
+    phase_stats_t stats[BOOTTIME_STAGE_COUNT][BOOTTIME_PHASE_COUNT] = {{{0}}};
+
+    stat = Common_OpenReadCloseDirFile( statdir, BOOTTIME_FILENAME,
+                                        (VOID**)&buffer, &buffersize);
+    if(EFI_ERROR(stat)){
+        fprintf(stderr, "    Common_OpenReadCloseDirFile failed\n");
+        ret = -1;
+        goto exit0;
+    }
+    header = (BOOTTIME_header_t*)buffer;
+    if( (buffersize < sizeof(BOOTTIME_header_t)) ||
+        !BootTime_headerIsValid(header) ){
+        fprintf(stderr, "    invalid boot-time header\n");
+        ret = -1;
+        goto exit1;
+    }
+    first = (header->Next > header->BootCount)?
+                (header->Next - header->BootCount) : 0;
+    /*  Summarize in microseconds if any boot measured its TSC frequency.
+        Older boots without a measurement are then left out of the summary. */
+    for(seq = first; seq < header->Next; seq++){
+        boot = BootTime_GetBoot(buffer, buffersize, header, seq);
+        if( (NULL != boot) && (0 != boot->TicksPerUs) )
+            summaryInUs = true;
+    }
+    for(seq = first; seq < header->Next; seq++){
+        boot = BootTime_GetBoot(buffer, buffersize, header, seq);
+        if(NULL == boot){
+            skipped++;
+            continue;
+        }
+        if(BootTime_PrintBoot(boot, summaryInUs, stats, &(totals[nTotals])))
+            nTotals++;
+    }
+    if(0 != skipped)
+        fprintf(stderr, "    skipped %" PRIu64 " incomplete boot(s)\n",
+                skipped);
+    printf("\n");
+    BootTime_PrintSummary(summaryInUs, stats);
+    printf("\n");
+    BootTime_PrintHistogram(summaryInUs, totals, nTotals);
+    ret = 0;
+exit1:
+    Common_FreeReadBuffer(buffer, buffersize);
+exit0:
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int ret;
+    if(argc != 2){
+        fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
+        ret = -1;
+    }else{
+        ret = BootTime_Report(argv[1]);
+        if(0 != ret)
+            fprintf(stderr, "    BootTime_Report failed\n");
+    }
+    return ret;
+}
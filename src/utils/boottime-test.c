@@ -11,31 +11,31 @@
 static int bootTimeTest(char *statedir_name)
 {
     int ret;
-    BUM_state_t       *BUM_state_p;
+    BUM_state_handle_t BUM_state;
     EFI_STATUS stat;
     /*  Assume success */
     ret = 0;
     /*  Acquire the BUM state */
-    stat = BUMState_Get(statedir_name, &BUM_state_p);
+    stat = BUMState_Open(statedir_name, &BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Get failed\n");
+        fprintf(stderr, "    BUMState_Open failed\n");
         ret = -1;
         goto exit0;
     }
     /*  Perform the boot-time logic. */
-    BUMStateNext_BootTime(BUM_state_p);
+    BUMStateNext_BootTime(BUM_state.State);
     /*  Save the BUM state */
-    stat = BUMState_Put(statedir_name, BUM_state_p);
+    stat = BUMState_Commit(&BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Put failed\n");
+        fprintf(stderr, "    BUMState_Commit failed\n");
         ret = -1;
         /*goto exit1;*/
     }
 /*exit1:*/
-    /*  Free the state variable */
-    stat = BUMState_Free(BUM_state_p);
+    /*  Close the state */
+    stat = BUMState_Close(&BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Free failed\n");
+        fprintf(stderr, "    BUMState_Close failed\n");
         ret = -1;
         /*goto exit0;*/
     }
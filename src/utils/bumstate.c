@@ -0,0 +1,648 @@
+/* bumstate.c - Multi-call BUM-state tool.
+ *
+ *      bumstate <operation> <BUM state directory> [<argument> ...] [--format=<f>]
+ *      bumstate batch <BUM state directory> [--format=<f>] [<operation list>]
+ *      bumstate watch <BUM state directory> [--format=text|json] [--count=<n>]
+ *
+ *  Runs the same operations as the single-purpose bumstate-* utilities. When
+ *  invoked through a link named bumstate-<operation>, the operation is taken
+ *  from the program name.
+ *
+ *  Batch mode applies a list of operations separated by ';' or newlines (from
+ *  the arguments, or from stdin if there are none) to one in-memory copy of
+ *  the state: the state files are read once and written at most once, after
+ *  every operation has succeeded. If any operation fails, nothing is written.
+ *
+ *  Watch mode waits on inotify for A.state, B.state or the journal J.state to
+ *  be renamed into place or closed after a write, and prints one line per
+ *  committed transition, e.g. "UPDATE_STAGED sda3 attempts=3", until the
+ *  directory goes away or <n> transitions have been printed. It uses no CPU
+ *  while the state is idle.
+ *
+ *  --format=json|kv|binary makes print, currconfig-get, noncurrconfig-get and
+ *  runtime-init print the whole state (see BUMStateOps.h) instead of text;
+ *  watch takes --format=json.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <uchar.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "EFIGlue.h"
+#include "BUMState.h"
+#include "libbumstate.h"
+#include "BUMStateOps.h"
+
+static const char *usage =
+    "<operation> <BUM state directory> [<argument> ...] "
+        BUMSTATE_FORMAT_USAGE "\n"
+    "       %s batch <BUM state directory> " BUMSTATE_FORMAT_USAGE "\n"
+    "                [<operation> [; <operation>] ...]\n"
+    "       %s watch <BUM state directory> [--format=text|json] [--count=<n>]\n"
+    "Operations:\n"
+    "    init <starting config name>\n"
+    "    print\n"
+    "    currconfig-get\n"
+    "    noncurrconfig-get\n"
+    "    runtime-init\n"
+    "    update-start\n"
+    "    update-complete <default attempt count> <new configuration>\n"
+    "    boottime-test\n";
+
+#define PROGRAM_NAME    "bumstate"
+#define BATCH_ARGS_MAX  (8)
+
+/******************************************************************************/
+/*  Operations on an open state                                               */
+/******************************************************************************/
+
+typedef struct {
+    BUM_state_handle_t  handle;
+    char                *statedir;
+    bumstate_format_t   format;
+} bumstate_ctx_t;
+
+/*  Prints the working copy of the state in a format other than text */
+static int Op_Report(bumstate_ctx_t *ctx)
+{
+    bumstate_report_t report;
+    BUMStateOps_GetReport(  ctx->handle.State,
+                            (BUMSTATE_SLOT_A == ctx->handle.Next)?
+                                BUMSTATE_SLOT_B : BUMSTATE_SLOT_A,
+                            ctx->handle.NextValid,
+                            &report);
+    return BUMStateOps_PrintReport(&report, ctx->format);
+}
+
+static int Op_Print(bumstate_ctx_t *ctx, char **argv)
+{
+    if(BUMSTATE_FORMAT_TEXT != ctx->format)
+        return Op_Report(ctx);
+    BUMStateOps_Print(ctx->handle.State, ctx->statedir);
+    return 0;
+}
+
+static int Op_CurrConfigGet(bumstate_ctx_t *ctx, char **argv)
+{
+    char Config[BUMSTATE_CONFIG_MAXLEN];
+    if(BUMSTATE_FORMAT_TEXT != ctx->format)
+        return Op_Report(ctx);
+    if(EFI_ERROR(BUMState_getCurrConfig(ctx->handle.State, Config))){
+        fprintf(stderr, "    BUMState_getCurrConfig failed\n");
+        return -1;
+    }
+    printf("%s", Config);
+    return 0;
+}
+
+static int Op_NonCurrConfigGet(bumstate_ctx_t *ctx, char **argv)
+{
+    char Config[BUMSTATE_CONFIG_MAXLEN];
+    if(BUMSTATE_FORMAT_TEXT != ctx->format)
+        return Op_Report(ctx);
+    if(EFI_ERROR(BUMState_getNonCurrConfig(ctx->handle.State, Config))){
+        fprintf(stderr, "    BUMState_getNonCurrConfig failed\n");
+        return -1;
+    }
+    printf("%s", Config);
+    return 0;
+}
+
+/*  The status, and the state reported in other formats, are those found */
+static int Op_RunTimeInit(bumstate_ctx_t *ctx, char **argv)
+{
+    if(BUMSTATE_FORMAT_TEXT == ctx->format)
+        printf("%s", BUMStateOps_BootStatusString(ctx->handle.State));
+    else if(0 != Op_Report(ctx))
+        return -1;
+    BUMStateNext_RunTimeInit(ctx->handle.State);
+    return 0;
+}
+
+static int Op_UpdateStart(bumstate_ctx_t *ctx, char **argv)
+{
+    BUMStateNext_StartUpdate(ctx->handle.State);
+    return 0;
+}
+
+static int Op_UpdateComplete(bumstate_ctx_t *ctx, char **argv)
+{
+    uint64_t attemptcount;
+    if(0 != BUMStateOps_ValidateUpdateArgs(argv[0], argv[1], &attemptcount)){
+        fprintf(stderr, "    validateargs failed\n");
+        return -1;
+    }
+    if(EFI_ERROR(BUMStateNext_CompleteUpdate(   ctx->handle.State,
+                                                attemptcount,
+                                                argv[1]))){
+        fprintf(stderr, "    BUMStateNext_CompleteUpdate failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int Op_BootTimeTest(bumstate_ctx_t *ctx, char **argv)
+{
+    BUMStateNext_BootTime(ctx->handle.State);
+    return 0;
+}
+
+typedef struct {
+    const char  *name;
+    int         argc;   /* arguments after the state directory */
+    int         (*run)(bumstate_ctx_t *ctx, char **argv);
+} bumstate_op_t;
+
+/*  init is handled separately: it creates the state rather than opening it.
+    So is watch, which only reads it. */
+#define OP_INIT     "init"
+#define OP_WATCH    "watch"
+
+static const bumstate_op_t ops[] = {
+    { "print",              0,  Op_Print            },
+    { "currconfig-get",     0,  Op_CurrConfigGet    },
+    { "noncurrconfig-get",  0,  Op_NonCurrConfigGet },
+    { "runtime-init",       0,  Op_RunTimeInit      },
+    { "update-start",       0,  Op_UpdateStart      },
+    { "update-complete",    2,  Op_UpdateComplete   },
+    { "boottime-test",      0,  Op_BootTimeTest     },
+};
+
+static const bumstate_op_t *Op_Find(const char *name)
+{
+    size_t i;
+    for(i = 0; i < sizeof(ops)/sizeof(ops[0]); i++)
+        if(0 == strcmp(ops[i].name, name))
+            return &ops[i];
+    return NULL;
+}
+
+/******************************************************************************/
+/*  Watching                                                                  */
+/******************************************************************************/
+
+/*  A transition, inferred from the state before and after a commit. Batch
+    mode commits several operations at once, so a transition is named after
+    the state it leaves behind: "update-start; update-complete 3 sda3" is one
+    UPDATE_STAGED. Likewise, commits made faster than the watcher reads them
+    are reported as one transition to the latest state. */
+typedef struct {
+    const char  *event;
+    const char  *argname;   /* of arg, or NULL */
+    const char  *arg;
+    const char  *valname;   /* of val, or NULL */
+    uint64_t    val;
+} watch_event_t;
+
+#define WATCH_COUNT_OPT     "--count="
+
+static bool Watch_SameConfigs(  const BUM_state_t   *prev,
+                                const BUM_state_t   *next)
+{
+    return  (0 == strncmp(prev->DfltConfig, next->DfltConfig,
+                            BUMSTATE_CONFIG_MAXLEN)) &&
+            (0 == strncmp(prev->AltrConfig, next->AltrConfig,
+                            BUMSTATE_CONFIG_MAXLEN));
+}
+
+/*  Everything but the attempts remaining and the current configuration, which
+    a boot changes */
+static bool Watch_SameUpdate(   const BUM_state_t   *prev,
+                                const BUM_state_t   *next)
+{
+    return  Watch_SameConfigs(prev, next) &&
+            (prev->Flags.UpdateAttempt == next->Flags.UpdateAttempt) &&
+            (prev->DfltAttemptCount == next->DfltAttemptCount);
+}
+
+/*  Returns false if next is not a new commit. prev is NULL if there was no
+    valid state before. */
+static bool Watch_Classify( BUM_state_t     *prev,
+                            BUM_state_t     *next,
+                            watch_event_t   *ev)
+{
+    memset(ev, 0, sizeof(*ev));
+    if( (NULL != prev) &&
+        (0 == memcmp(prev, next, sizeof(BUM_state_t))) )
+        return false;
+    if( (NULL == prev) || (1 == next->StateUpdateCounter) ){
+        /*  BUMState_Init starts over from counter 1 */
+        ev->event = "INIT";
+        ev->argname = "config";
+        ev->arg = (BUMSTATE_CONFIG_DFLT == next->Flags.CurrConfig)?
+                    next->DfltConfig : next->AltrConfig;
+    }else if(next->StateUpdateCounter < prev->StateUpdateCounter){
+        /*  An older slot, current while init empties the newer one */
+        return false;
+    }else if(   Watch_SameUpdate(prev, next) &&
+                (prev->Flags.CurrConfig == next->Flags.CurrConfig) &&
+                (prev->DfltAttemptsRemaining == next->DfltAttemptsRemaining)){
+        /*  Only the counter changed: the commits of the tools skip such a
+            write, BUMState_Put does not */
+        ev->event = "STATE_WRITTEN";
+    }else if(   (1 == next->Flags.UpdateAttempt) &&
+                (BUMSTATE_CONFIG_ALTR == next->Flags.CurrConfig) &&
+                (next->DfltAttemptsRemaining == next->DfltAttemptCount)){
+        ev->event = "UPDATE_STAGED";
+        ev->argname = "config";
+        ev->arg = next->DfltConfig;
+        ev->valname = "attempts";
+        ev->val = next->DfltAttemptCount;
+    }else if(   Watch_SameUpdate(prev, next) &&
+                (BUMSTATE_CONFIG_DFLT == next->Flags.CurrConfig) &&
+                (next->DfltAttemptsRemaining + 1 ==
+                    prev->DfltAttemptsRemaining)){
+        ev->event = "BOOT";
+        ev->argname = "config";
+        ev->arg = next->DfltConfig;
+        ev->valname = "remaining";
+        ev->val = next->DfltAttemptsRemaining;
+    }else if(   Watch_SameUpdate(prev, next) &&
+                (BUMSTATE_CONFIG_DFLT == prev->Flags.CurrConfig) &&
+                (BUMSTATE_CONFIG_ALTR == next->Flags.CurrConfig) &&
+                (0 == next->DfltAttemptsRemaining)){
+        /*  Either the attempts ran out, or the root BUM gave up on the
+            default in the boot that could not load it */
+        ev->event = "BOOT_FALLBACK";
+        ev->argname = "config";
+        ev->arg = next->AltrConfig;
+    }else if(   ( (1 == prev->Flags.UpdateAttempt) &&
+                  (0 == next->Flags.UpdateAttempt) ) ||
+                ( Watch_SameUpdate(prev, next) &&
+                  (BUMSTATE_CONFIG_DFLT == next->Flags.CurrConfig) &&
+                  (next->DfltAttemptsRemaining ==
+                    next->DfltAttemptCount) )){
+        /*  The status runtime-init reports is that of the state it found */
+        ev->event = "RUNTIME_INIT";
+        ev->argname = "status";
+        ev->arg = BUMStateOps_BootStatusString(prev);
+    }else if(   (BUMSTATE_CONFIG_ALTR == next->Flags.CurrConfig) &&
+                (0 == next->DfltAttemptsRemaining)){
+        ev->event = "UPDATE_STARTED";
+    }else
+        ev->event = "STATE_CHANGED";
+    return true;
+}
+
+static void Watch_Print(const watch_event_t *ev,
+                        uint64_t            counter,
+                        bumstate_format_t   format)
+{
+    if(BUMSTATE_FORMAT_JSON == format){
+        printf("{\"event\":\"%s\",\"counter\":%" PRIu64, ev->event, counter);
+        if(NULL != ev->argname){
+            printf(",\"%s\":", ev->argname);
+            BUMStateOps_PrintJsonString(ev->arg);
+        }
+        if(NULL != ev->valname)
+            printf(",\"%s\":%" PRIu64, ev->valname, ev->val);
+        printf("}\n");
+    }else{
+        printf("%s", ev->event);
+        if(NULL != ev->argname)
+            printf(" %s", ev->arg);
+        if(NULL != ev->valname)
+            printf(" %s=%" PRIu64, ev->valname, ev->val);
+        printf("\n");
+    }
+    /*  Each line goes out as it happens, also down a pipe */
+    fflush(stdout);
+}
+
+/*  Returns true if the event is a write of one of the state files: the
+    utilities rename a new state file over the old one, and append journal
+    records in place */
+static bool Watch_IsStateWrite(const struct inotify_event *event)
+{
+    return  (0 != event->len) &&
+            ( (0 == strcmp(event->name, ASTATE_FILENAME)) ||
+              (0 == strcmp(event->name, BSTATE_FILENAME)) ||
+              (0 == strcmp(event->name, JSTATE_FILENAME)) );
+}
+
+static int Run_Watch(int argc, char **argv)
+{
+    char buffer[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event;
+    BUM_state_t state[2], *prev = NULL, *next = &state[0];
+    watch_event_t ev;
+    char *statedir, *target, *endptr;
+    bumstate_format_t format = BUMSTATE_FORMAT_TEXT;
+    bool changed;
+    unsigned long long count = 0, printed = 0;
+    ssize_t len;
+    int fd, i, found, ret = -1;
+    if(argc < 1){
+        fprintf(stderr, "    watch: expected a BUM state directory\n");
+        return -1;
+    }
+    statedir = argv[0];
+    for(i = 1; i < argc; i++){
+        found = BUMStateOps_ParseFormat(argv[i], &format);
+        if(found < 0)
+            return -1;
+        else if(found > 0){
+            if( (BUMSTATE_FORMAT_TEXT != format) &&
+                (BUMSTATE_FORMAT_JSON != format) ){
+                fprintf(stderr, "    watch: only text and json output\n");
+                return -1;
+            }
+        }else if(0 == strncmp(   argv[i], WATCH_COUNT_OPT,
+                                sizeof(WATCH_COUNT_OPT) - 1)){
+            errno = 0;
+            count = strtoull(argv[i] + sizeof(WATCH_COUNT_OPT) - 1,
+                                &endptr, 10);
+            if( (0 != errno) || ('\0' != *endptr) || (0 == count) ){
+                fprintf(stderr, "    watch: invalid count \"%s\"\n", argv[i]);
+                return -1;
+            }
+        }else{
+            fprintf(stderr, "    watch: unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+    /*  Variables and blocks have no change notification */
+    BUMState_GetBackend(statedir, &target);
+    if(target != statedir){
+        fprintf(stderr, "    watch: %s is not a state directory\n", statedir);
+        return -1;
+    }
+    fd = inotify_init1(IN_CLOEXEC);
+    if(fd < 0){
+        perror("    inotify_init1");
+        return -1;
+    }
+    if(inotify_add_watch(   fd, statedir,
+                            IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR |
+                            IN_DELETE_SELF | IN_MOVE_SELF) < 0){
+        perror("    inotify_add_watch");
+        goto exit0;
+    }
+    /*  The state found at the start is only the baseline */
+    if(!EFI_ERROR(BUMState_GetCopy(statedir, next))){
+        prev = next;
+        next = &state[1];
+    }
+    for(;;){
+        len = read(fd, buffer, sizeof(buffer));
+        if(len < 0){
+            if(EINTR == errno)
+                continue;
+            perror("    read");
+            goto exit0;
+        }
+        changed = false;
+        for(i = 0; i < len; i += sizeof(*event) + event->len){
+            event = (const struct inotify_event*)&buffer[i];
+            if(0 != (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF |
+                                    IN_IGNORED))){
+                /*  The directory is gone: nothing more will change */
+                ret = 0;
+                goto exit0;
+            }
+            changed = changed || Watch_IsStateWrite(event);
+        }
+        /*  One read for all the events queued: a commit that has both been
+            written and closed is seen once */
+        if( !changed || EFI_ERROR(BUMState_GetCopy(statedir, next)) )
+            continue;
+        if(Watch_Classify(prev, next, &ev)){
+            Watch_Print(&ev, next->StateUpdateCounter, format);
+            printed++;
+        }
+        prev = next;
+        next = (next == &state[0])? &state[1] : &state[0];
+        if( (0 != count) && (printed == count) ){
+            ret = 0;
+            goto exit0;
+        }
+    }
+exit0:
+    close(fd);
+    return ret;
+}
+
+/******************************************************************************/
+/*  Transactions                                                              */
+/******************************************************************************/
+
+static int State_Begin(bumstate_ctx_t *ctx, char *statedir)
+{
+    ctx->statedir = statedir;
+    if(EFI_ERROR(BUMState_Open(statedir, &(ctx->handle)))){
+        fprintf(stderr, "    BUMState_Open failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*  Commits the state if ret is zero, then closes it */
+static int State_End(bumstate_ctx_t *ctx, int ret)
+{
+    if( (0 == ret) && EFI_ERROR(BUMState_Commit(&(ctx->handle))) ){
+        fprintf(stderr, "    BUMState_Commit failed\n");
+        ret = -1;
+    }
+    if(EFI_ERROR(BUMState_Close(&(ctx->handle)))){
+        fprintf(stderr, "    BUMState_Close failed\n");
+        ret = -1;
+    }
+    return ret;
+}
+
+/*  Takes the --format option out of the arguments */
+static int Args_TakeFormat( int                 *argc_p,
+                            char                **argv,
+                            bumstate_format_t   *format_p)
+{
+    int i, j, found;
+    *format_p = BUMSTATE_FORMAT_TEXT;
+    for(i = j = 0; i < *argc_p; i++){
+        found = BUMStateOps_ParseFormat(argv[i], format_p);
+        if(found < 0)
+            return -1;
+        if(0 == found)
+            argv[j++] = argv[i];
+    }
+    *argc_p = j;
+    return 0;
+}
+
+/*  Runs one operation from the command line */
+static int Run_Single(  const char  *name,
+                        int         argc,
+                        char        **argv)
+{
+    const bumstate_op_t *op;
+    bumstate_ctx_t ctx;
+    int ret;
+    if(0 == strcmp(name, OP_INIT)){
+        if(2 != argc){
+            fprintf(stderr, "    %s: expected 2 argument(s)\n", name);
+            return -1;
+        }
+        if(EFI_ERROR(BUMState_Init(argv[0], argv[1]))){
+            fprintf(stderr, "   BUMState_Init failed\n");
+            return -1;
+        }
+        return 0;
+    }
+    if(0 == strcmp(name, OP_WATCH))
+        return Run_Watch(argc, argv);
+    if(0 != Args_TakeFormat(&argc, argv, &(ctx.format)))
+        return -1;
+    op = Op_Find(name);
+    if(NULL == op){
+        fprintf(stderr, "    unknown operation \"%s\"\n", name);
+        return -1;
+    }
+    if(1 + op->argc != argc){
+        fprintf(stderr, "    %s: expected %d argument(s)\n",
+                name, 1 + op->argc);
+        return -1;
+    }
+    if(0 != State_Begin(&ctx, argv[0]))
+        return -1;
+    ret = op->run(&ctx, &argv[1]);
+    return State_End(&ctx, ret);
+}
+
+/*  Reads all of stdin into a string */
+static char *Batch_ReadStdin(void)
+{
+    size_t size = 0, capacity = 4096, n;
+    char *buffer = malloc(capacity), *grown;
+    while(NULL != buffer){
+        n = fread(buffer + size, 1, capacity - size - 1, stdin);
+        size += n;
+        if(size < capacity - 1)
+            break;
+        capacity *= 2;
+        grown = realloc(buffer, capacity);
+        if(NULL == grown)
+            free(buffer);
+        buffer = grown;
+    }
+    if(NULL != buffer)
+        buffer[size] = '\0';
+    return buffer;
+}
+
+/*  Joins the operation arguments into one string */
+static char *Batch_JoinArgs(int argc, char **argv)
+{
+    size_t len = 1;
+    int i;
+    char *buffer;
+    for(i = 0; i < argc; i++)
+        len += strlen(argv[i]) + 1;
+    buffer = malloc(len);
+    if(NULL == buffer)
+        return NULL;
+    buffer[0] = '\0';
+    for(i = 0; i < argc; i++){
+        strcat(buffer, argv[i]);
+        strcat(buffer, " ");
+    }
+    return buffer;
+}
+
+/*  Checks every operation before any is applied, then applies them all to
+    one copy of the state and commits it once. */
+static int Batch_Run(bumstate_ctx_t *ctx, char *list, bool apply)
+{
+    char *opsave, *argsave, *optext, *opargv[BATCH_ARGS_MAX];
+    const bumstate_op_t *op;
+    int opargc, count = 0, ret;
+    for(optext = strtok_r(list, ";\n", &opsave); NULL != optext;
+        optext = strtok_r(NULL, ";\n", &opsave)){
+        opargc = 0;
+        for(opargv[0] = strtok_r(optext, " \t\r", &argsave);
+            (NULL != opargv[opargc]) && (opargc < BATCH_ARGS_MAX - 1);
+            opargv[++opargc] = strtok_r(NULL, " \t\r", &argsave));
+        if(0 == opargc)
+            continue;
+        count++;
+        op = Op_Find(opargv[0]);
+        if(NULL == op){
+            fprintf(stderr, "    batch operation %d: unknown operation "
+                            "\"%s\"\n", count, opargv[0]);
+            return -1;
+        }
+        if(op->argc != opargc - 1){
+            fprintf(stderr, "    batch operation %d: %s expects %d "
+                            "argument(s)\n", count, op->name, op->argc);
+            return -1;
+        }
+        if(apply){
+            ret = op->run(ctx, &opargv[1]);
+            if(0 != ret){
+                fprintf(stderr, "    batch operation %d (%s) failed\n",
+                        count, op->name);
+                return ret;
+            }
+        }
+    }
+    return 0;
+}
+
+static int Run_Batch(int argc, char **argv)
+{
+    bumstate_ctx_t ctx;
+    char *list, *copy;
+    int ret;
+    if(argc < 1){
+        fprintf(stderr, "    batch: expected a BUM state directory\n");
+        return -1;
+    }
+    if(0 != Args_TakeFormat(&argc, argv, &(ctx.format)))
+        return -1;
+    list = (argc > 1)? Batch_JoinArgs(argc - 1, &argv[1]) : Batch_ReadStdin();
+    copy = (NULL != list)? strdup(list) : NULL;
+    if(NULL == copy){
+        fprintf(stderr, "    batch: out of memory\n");
+        free(list);
+        return -1;
+    }
+    /*  Validate the whole list before touching the state */
+    ret = Batch_Run(NULL, copy, false);
+    if(0 == ret){
+        ret = State_Begin(&ctx, argv[0]);
+        if(0 == ret){
+            ret = Batch_Run(&ctx, list, true);
+            ret = State_End(&ctx, ret);
+        }
+    }
+    free(copy);
+    free(list);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int ret;
+    const char *name;
+    /*  Called as bumstate-<operation>? */
+    name = strrchr(argv[0], '/');
+    name = (NULL == name)? argv[0] : name + 1;
+    if(0 == strncmp(name, PROGRAM_NAME "-", sizeof(PROGRAM_NAME)))
+        ret = Run_Single(name + sizeof(PROGRAM_NAME), argc - 1, &argv[1]);
+    else if(argc < 2){
+        fprintf(stderr, "Usage: %s ", argv[0]);
+        fprintf(stderr, usage, argv[0], argv[0]);
+        ret = -1;
+    }else if(0 == strcmp(argv[1], "batch"))
+        ret = Run_Batch(argc - 2, &argv[2]);
+    else
+        ret = Run_Single(argv[1], argc - 2, &argv[2]);
+    if(0 != ret)
+        fprintf(stderr, "    %s failed\n", PROGRAM_NAME);
+    return ret;
+}
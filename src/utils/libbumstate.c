@@ -0,0 +1,190 @@
+/* libbumstate.c - In-process queries of the BUM state (see libbumstate.h).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <uchar.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "EFIGlue.h"
+#include "BUMState.h"
+#include "libbumstate.h"
+#include "BUMStateOps.h"
+
+/*  The files the state is read from: the two slots and the journal */
+#define STATE_FILES (3)
+
+/*  What a state file looked like when the cached state was read */
+typedef struct {
+    bool            exists;
+    dev_t           dev;
+    ino_t           ino;
+    off_t           size;
+    struct timespec mtime;
+} bumstate_filestat_t;
+
+struct bumstate {
+    char                *statedir;
+    char                *filepath[STATE_FILES];
+    bool                cached;
+    bool                valid;
+    bumstate_filestat_t filestat[STATE_FILES];
+    BUM_state_t         state;
+    UINT8               currslot;
+    BOOLEAN             othervalid;
+};
+
+static const char *state_filenames[STATE_FILES] =
+    { ASTATE_FILENAME, BSTATE_FILENAME, JSTATE_FILENAME };
+
+static void FileStat_Get(   const char          *filepath,
+                            bumstate_filestat_t *filestat_p)
+{
+    struct stat st;
+    memset(filestat_p, 0, sizeof(*filestat_p));
+    if(0 == stat(filepath, &st)){
+        filestat_p->exists  = true;
+        filestat_p->dev     = st.st_dev;
+        filestat_p->ino     = st.st_ino;
+        filestat_p->size    = st.st_size;
+        filestat_p->mtime   = st.st_mtim;
+    }
+}
+
+static bool FileStat_Equal( bumstate_filestat_t *a,
+                            bumstate_filestat_t *b)
+{
+    return  (a->exists == b->exists) &&
+            (a->dev == b->dev) && (a->ino == b->ino) &&
+            (a->size == b->size) &&
+            (a->mtime.tv_sec == b->mtime.tv_sec) &&
+            (a->mtime.tv_nsec == b->mtime.tv_nsec);
+}
+
+bumstate_t *bumstate_open(const char *statedir)
+{
+    bumstate_t *ctx;
+    CHAR8 *target;
+    size_t len;
+    int i;
+    ctx = calloc(1, sizeof(*ctx));
+    if(NULL == ctx)
+        goto exit0;
+    ctx->statedir = strdup(statedir);
+    if(NULL == ctx->statedir)
+        goto exit1;
+    /*  Only a state directory can be checked for changes with stat; the
+        variable and block backends are read on every query. */
+    BUMState_GetBackend(ctx->statedir, &target);
+    ctx->cached = (target == ctx->statedir);
+    for(i = 0; i < STATE_FILES; i++){
+        len = strlen(statedir) + 1 + strlen(state_filenames[i]) + 1;
+        ctx->filepath[i] = malloc(len);
+        if(NULL == ctx->filepath[i])
+            goto exit2;
+        snprintf(ctx->filepath[i], len, "%s/%s", statedir, state_filenames[i]);
+    }
+    return ctx;
+exit2:
+    for(i = 0; i < STATE_FILES; i++)
+        free(ctx->filepath[i]);
+    free(ctx->statedir);
+exit1:
+    free(ctx);
+exit0:
+    return NULL;
+}
+
+void bumstate_close(bumstate_t *ctx)
+{
+    int i;
+    if(NULL == ctx)
+        return;
+    for(i = 0; i < STATE_FILES; i++)
+        free(ctx->filepath[i]);
+    free(ctx->statedir);
+    free(ctx);
+}
+
+int bumstate_refresh(bumstate_t *ctx)
+{
+    bumstate_filestat_t filestat[STATE_FILES];
+    int i;
+    /*  Stat before reading, so the cached state is never older than the
+        recorded file attributes: a write between the two is caught by the
+        next refresh. */
+    for(i = 0; i < STATE_FILES; i++)
+        FileStat_Get(ctx->filepath[i], &filestat[i]);
+    for(i = 0; i < STATE_FILES; i++){
+        if(!FileStat_Equal(&filestat[i], &(ctx->filestat[i])))
+            break;
+    }
+    if( ctx->cached && ctx->valid && (STATE_FILES == i) )
+        return 0;
+    ctx->valid = false;
+    if(EFI_ERROR(BUMState_GetInfo(  ctx->statedir,
+                                    &(ctx->state),
+                                    &(ctx->currslot),
+                                    &(ctx->othervalid))))
+        return -1;
+    memcpy(ctx->filestat, filestat, sizeof(ctx->filestat));
+    ctx->valid = true;
+    return 0;
+}
+
+static int bumstate_copyconfig( char        *dst,
+                                size_t      size,
+                                CHAR8       config[BUMSTATE_CONFIG_MAXLEN])
+{
+    size_t len = AsciiStrnLenS(config, BUMSTATE_CONFIG_MAXLEN);
+    if(len >= size)
+        return -1;
+    memcpy(dst, config, len + 1);
+    return 0;
+}
+
+int bumstate_currconfig(bumstate_t  *ctx,
+                        char        *config,
+                        size_t      size)
+{
+    CHAR8 Config[BUMSTATE_CONFIG_MAXLEN];
+    if(0 != bumstate_refresh(ctx))
+        return -1;
+    if(EFI_ERROR(BUMState_getCurrConfig(&(ctx->state), Config)))
+        return -1;
+    return bumstate_copyconfig(config, size, Config);
+}
+
+int bumstate_noncurrconfig( bumstate_t  *ctx,
+                            char        *config,
+                            size_t      size)
+{
+    CHAR8 Config[BUMSTATE_CONFIG_MAXLEN];
+    if(0 != bumstate_refresh(ctx))
+        return -1;
+    if(EFI_ERROR(BUMState_getNonCurrConfig(&(ctx->state), Config)))
+        return -1;
+    return bumstate_copyconfig(config, size, Config);
+}
+
+const char *bumstate_bootstatus(bumstate_t *ctx)
+{
+    if(0 != bumstate_refresh(ctx))
+        return NULL;
+    return BUMStateOps_BootStatusString(&(ctx->state));
+}
+
+int bumstate_report(bumstate_t          *ctx,
+                    bumstate_report_t   *report)
+{
+    if(0 != bumstate_refresh(ctx))
+        return -1;
+    BUMStateOps_GetReport(  &(ctx->state),
+                            ctx->currslot,
+                            ctx->othervalid,
+                            report);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/* libbumstate.h - Public interface of libbumstate, for processes that query
+ *                 the BUM state in-process instead of running the bumstate
+ *                 utilities.
+ *
+ *  A bumstate_t caches the parsed state. Every query first compares the inode,
+ *  size and modification time of A.state, B.state and the journal J.state
+ *  with the cached ones (three stat calls) and only re-reads and re-checks
+ *  the files if they changed. A journal record written in place with pwrite
+ *  keeps the inode and size of J.state, so such a change is only seen through
+ *  its st_mtim: a file system with coarse timestamps can hide a record
+ *  written within the same tick as the cached one.
+ *
+ *  Functions returning int return 0 on success and -1 on failure. Link with
+ *  -lbumstate (libbumstate.so or libbumstate.a).
+ */
+
+#ifndef __LIB_BUM_STATE__
+#define __LIB_BUM_STATE__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*  Major version of the interface, also the major version of the soname */
+#define LIBBUMSTATE_VERSION_MAJOR   (1)
+
+/*  Size of a buffer that holds any configuration name with its terminator */
+#define LIBBUMSTATE_CONFIG_MAXLEN   (128)
+
+#if defined(__GNUC__)
+    #define LIBBUMSTATE_API __attribute__((visibility("default")))
+#else
+    #define LIBBUMSTATE_API
+#endif
+
+typedef struct bumstate bumstate_t;
+
+/*  Every field of the current state, with the slot it came from. This is also
+    the record written by the utilities with --format=binary, in host byte
+    order, so it can be read straight into this structure. */
+#define LIBBUMSTATE_REPORT_MAGIC    (0x524D5542)    /* "BUMR" */
+
+typedef enum {
+    LIBBUMSTATE_BOOTSUCCESS     = 0,
+    LIBBUMSTATE_UPDATESUCCESS   = 1,
+    LIBBUMSTATE_BOOTFAILURE     = 2,
+    LIBBUMSTATE_UPDATEFAILURE   = 3,
+} bumstate_bootstatus_t;
+
+typedef struct {
+    uint32_t    magic;                  /* LIBBUMSTATE_REPORT_MAGIC */
+    uint32_t    size;                   /* sizeof(bumstate_report_t) */
+    uint64_t    state_update_counter;
+    uint64_t    state_size;
+    uint64_t    version;
+    uint64_t    flags;                  /* the raw flags word */
+    uint64_t    dflt_attempt_count;
+    uint64_t    dflt_attempts_remaining;
+    uint64_t    checksum;
+    uint8_t     curr_config;            /* 0: default, 1: alternate */
+    uint8_t     update_attempt;
+    uint8_t     curr_slot;              /* 0: A, 1: B */
+    uint8_t     other_slot_valid;
+    uint32_t    boot_status;            /* bumstate_bootstatus_t */
+    char        dflt_config[LIBBUMSTATE_CONFIG_MAXLEN];
+    char        altr_config[LIBBUMSTATE_CONFIG_MAXLEN];
+} bumstate_report_t;
+
+/*  Returns a context for the state in statedir, or NULL if it can not be
+    allocated. The state files are not read until the first query, so the
+    context can be opened before the state exists. Like the utilities,
+    statedir may instead be a "var:" or "blk:" state location; such a state
+    is not cached and is read on every query. */
+LIBBUMSTATE_API bumstate_t *bumstate_open(const char *statedir);
+
+LIBBUMSTATE_API void bumstate_close(bumstate_t *ctx);
+
+/*  Brings the cached state up to date with the state files. Called by every
+    query; fails if neither state file holds a valid state. */
+LIBBUMSTATE_API int bumstate_refresh(bumstate_t *ctx);
+
+/*  Copies the name of the configuration used for the current boot into
+    config, which has room for size bytes. */
+LIBBUMSTATE_API int bumstate_currconfig(bumstate_t  *ctx,
+                                        char        *config,
+                                        size_t      size);
+
+/*  Copies the name of the configuration other than the current one */
+LIBBUMSTATE_API int bumstate_noncurrconfig( bumstate_t  *ctx,
+                                            char        *config,
+                                            size_t      size);
+
+/*  Returns the boot status reported by bumstate-runtime-init (BOOTSUCCESS,
+    UPDATESUCCESS, BOOTFAILURE or UPDATEFAILURE) for the cached state, or NULL
+    on failure. The string is static. */
+LIBBUMSTATE_API const char *bumstate_bootstatus(bumstate_t *ctx);
+
+/*  Fills *report from the cached state */
+LIBBUMSTATE_API int bumstate_report(bumstate_t          *ctx,
+                                    bumstate_report_t   *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <uchar.h>
+#include "EFIGlue.h"
+#include "LibCommon.h"
+#include "BootLog.h"
+
+static const char *usage = "<boot-log directory>";
+
+/*  Prints one record in the same format as the text log files */
+static void BootLog_PrintRecord(BOOTLOG_record_t *record)
+{
+    printf("%04u-%02u-%02u %02u:%02u:%02u %016" PRIX64 " %.*s) %.*s%s\n",
+            (unsigned)record->Year, (unsigned)record->Month,
+            (unsigned)record->Day, (unsigned)record->Hour,
+            (unsigned)record->Minute, (unsigned)record->Second,
+            record->TSC,
+            (int)AsciiStrnLenS(record->Context, BOOTLOG_CONTEXT_SIZE),
+            record->Context,
+            (int)record->Length, record->Message,
+            (record->Flags & BOOTLOG_RECORD_TRUNCATED)? " ..." : "");
+}
+
+/*  Streams the valid records from oldest to newest */
+static int BootLog_Dump(char    *logdir)
+{
+    int ret;
+    EFI_STATUS stat;
+    uint8_t *buffer;
+    UINTN buffersize;
+    BOOTLOG_header_t *header;
+    BOOTLOG_record_t *record;
+    uint64_t seq, skipped = 0;
+
+    stat = Common_OpenReadCloseDirFile( logdir, BOOTLOG_FILENAME,
+                                        (VOID**)&buffer, &buffersize);
+    if(EFI_ERROR(stat)){
+        fprintf(stderr, "    Common_OpenReadCloseDirFile failed\n");
+        ret = -1;
+        goto exit0;
+    }
+    header = (BOOTLOG_header_t*)buffer;
+    if( (buffersize < BOOTLOG_FILE_SIZE) || !BootLog_headerIsValid(header) ){
+        fprintf(stderr, "    invalid boot-log header\n");
+        ret = -1;
+        goto exit1;
+    }
+    for(seq = header->Head; seq < header->Tail; seq++){
+        record = (BOOTLOG_record_t*)
+                    (buffer + BootLog_recordOffset(header, seq));
+        /*  A record whose sequence does not match was not completely
+            written (the header is updated after the record). */
+        if( (record->Sequence != seq) ||
+            (record->Length > BOOTLOG_MESSAGE_SIZE) ){
+            skipped++;
+            continue;
+        }
+        BootLog_PrintRecord(record);
+    }
+    if(0 != skipped)
+        fprintf(stderr, "    skipped %" PRIu64 " incomplete record(s)\n",
+                skipped);
+    ret = 0;
+exit1:
+    Common_FreeReadBuffer(buffer, buffersize);
+exit0:
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int ret;
+    if(argc != 2){
+        fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
+        ret = -1;
+    }else{
+        ret = BootLog_Dump(argv[1]);
+        if(0 != ret)
+            fprintf(stderr, "    BootLog_Dump failed\n");
+    }
+    return ret;
+}
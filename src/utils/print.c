@@ -7,54 +7,37 @@
 #include "EFIGlue.h"
 #include "EFIGlue.h"
 #include "BUMState.h"
+#include "libbumstate.h"
+#include "BUMStateOps.h"
 
-static const char *usage = "<BUM state directory>";
-
-void BUMState_Print(BUM_state_t *BUM_state_p,
-                    char        *statedir)
-{
-    printf("    BUM State: \n");
-    printf("        State directory:        %s\n", statedir);
-    printf("        Current Configuration:  ");
-    if(BUM_state_p->Flags.CurrConfig == BUMSTATE_CONFIG_DFLT)
-        printf("Default\n");
-    else
-        printf("Alternate\n");
-    printf("        Update Attempt:         ");
-    if(BUM_state_p->Flags.UpdateAttempt == 1)
-        printf("Yes\n");
-    else
-        printf("No\n");
-    printf("        Default Attempt Count:  %" PRIu64 "\n",
-            BUM_state_p->DfltAttemptCount);
-    printf("        Default Attempts Rem.:  %" PRIu64 "\n",
-            BUM_state_p->DfltAttemptsRemaining);
-    printf("        Default Configurtaion:      \"%s\"\n",
-            BUM_state_p->DfltConfig);
-    printf("        Alternate Configurtaion:    \"%s\"\n",
-            BUM_state_p->AltrConfig);
-}
+static const char *usage = "<BUM state directory> " BUMSTATE_FORMAT_USAGE;
 
 int main(int argc, char** argv)
 {
     int ret;
-    BUM_state_t *BUM_state_p;
+    BUM_state_t BUM_state;
+    UINT8 CurrSlot;
+    BOOLEAN OtherValid;
+    bumstate_format_t format = BUMSTATE_FORMAT_TEXT;
+    bumstate_report_t report;
     EFI_STATUS stat;
 
-    if(argc != 2){
+    if( (argc < 2) || (argc > 3) ||
+        ( (3 == argc) && (1 != BUMStateOps_ParseFormat(argv[2], &format)) ) ){
         fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
         ret = -1;
     }else{
-        stat = BUMState_Get(argv[1], &BUM_state_p);
+        stat = BUMState_GetInfo(argv[1], &BUM_state, &CurrSlot, &OtherValid);
         if(EFI_ERROR(stat)){
             fprintf(stderr, "   BUMState_Get failed\n");
             ret = -1;
-        }else{
-            BUMState_Print(BUM_state_p, argv[1]);
-            BUMState_Free(BUM_state_p);
+        }else if(BUMSTATE_FORMAT_TEXT == format){
+            BUMStateOps_Print(&BUM_state, argv[1]);
             ret = 0;
+        }else{
+            BUMStateOps_GetReport(&BUM_state, CurrSlot, OtherValid, &report);
+            ret = BUMStateOps_PrintReport(&report, format);
         }
     }
     return ret;
 }
-
@@ -7,69 +7,50 @@
 #include "EFIGlue.h"
 #include "EFIGlue.h"
 #include "BUMState.h"
+#include "libbumstate.h"
+#include "BUMStateOps.h"
 
-/*  seems redundant, but defining as macros to ensure
-    error-reporting consistency */
-#define BOOTSUCCESS "BOOTSUCCESS"
-#define UPDTSUCCESS "UPDATESUCCESS"
-#define BOOTFAILURE "BOOTFAILURE"
-#define UPDTFAILURE "UPDATEFAILURE"
-#define FATALERROR  "FATALERROR"
-
-static char* getBootStatusString(BUM_state_t *BUM_state_p)
-{
-    char *StatusString;
-    /*  Check for failure: booting alternate */
-    if(BUMSTATE_CONFIG_ALTR == BUM_state_p->Flags.CurrConfig){
-        /*  Check if this was a failed update */
-        if(1 == BUM_state_p->Flags.UpdateAttempt)
-            StatusString = UPDTFAILURE;
-        else
-            StatusString = BOOTFAILURE;
-    }else{ /*Success: booted default */
-        /*  Check if this was a successful update */
-        if(1 == BUM_state_p->Flags.UpdateAttempt)
-            StatusString = UPDTSUCCESS;
-        else
-            StatusString = BOOTSUCCESS;
-    }
-    return StatusString;
-}
-
-static int runTimeInit( char *statedir_name,
-                        char **StatusString_p)
+/*  Also fills *report from the state found, which the status describes */
+static int runTimeInit( char                *statedir_name,
+                        char                **StatusString_p,
+                        bumstate_report_t   *report)
 {
     int ret;
-    BUM_state_t       *BUM_state_p;
+    BUM_state_handle_t BUM_state;
     char *StatusString;
     EFI_STATUS stat;
     /*  Assume success */
     ret = 0;
     /*  Acquire the BUM state */
-    stat = BUMState_Get(statedir_name, &BUM_state_p);
+    stat = BUMState_Open(statedir_name, &BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Get failed\n");
+        fprintf(stderr, "    BUMState_Open failed\n");
         StatusString = FATALERROR;
         ret = -1;
         goto exit0;
     }
     /*  Get boot status */
-    StatusString = getBootStatusString(BUM_state_p);
+    StatusString = BUMStateOps_BootStatusString(BUM_state.State);
+    BUMStateOps_GetReport(  BUM_state.State,
+                            (BUMSTATE_SLOT_A == BUM_state.Next)?
+                                BUMSTATE_SLOT_B : BUMSTATE_SLOT_A,
+                            BUM_state.NextValid,
+                            report);
     /*  Perform the run-time logic. */
-    BUMStateNext_RunTimeInit(BUM_state_p);
+    BUMStateNext_RunTimeInit(BUM_state.State);
     /*  Save the BUM state */
-    stat = BUMState_Put(statedir_name, BUM_state_p);
+    stat = BUMState_Commit(&BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Put failed\n");
+        fprintf(stderr, "    BUMState_Commit failed\n");
         StatusString = FATALERROR;
         ret = -1;
         /*goto exit1;*/
     }
 /*exit1:*/
-    /*  Free the state variable */
-    stat = BUMState_Free(BUM_state_p);
+    /*  Close the state */
+    stat = BUMState_Close(&BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Free failed\n");
+        fprintf(stderr, "    BUMState_Close failed\n");
         StatusString = FATALERROR;
         ret = -1;
         /*goto exit0;*/
@@ -79,20 +60,25 @@ exit0:
     return ret;
 }
 
-static const char *usage = "<BUM state directory>";
+static const char *usage = "<BUM state directory> " BUMSTATE_FORMAT_USAGE;
 
 int main(int argc, char** argv)
 {
     int ret;
     char *StatusString;
-    if(argc != 2){
+    bumstate_format_t format = BUMSTATE_FORMAT_TEXT;
+    bumstate_report_t report;
+    if( (argc < 2) || (argc > 3) ||
+        ( (3 == argc) && (1 != BUMStateOps_ParseFormat(argv[2], &format)) ) ){
         fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
         StatusString = FATALERROR;
         ret = -1;
     }else{
-        ret = runTimeInit(argv[1], &StatusString);
+        ret = runTimeInit(argv[1], &StatusString, &report);
     }
-    printf("%s", StatusString);
+    if(BUMSTATE_FORMAT_TEXT == format)
+        printf("%s", StatusString);
+    else if(0 == ret)
+        ret = BUMStateOps_PrintReport(&report, format);
     return ret;
 }
-
@@ -0,0 +1,485 @@
+/* sim.c - Boot-loop simulator for the A/B state machine.
+ *
+ *      bumstate-sim <BUM state location> <boots> [<seed>]
+ *
+ *  Initializes the state at the location (a directory, or a "var:" or "blk:"
+ *  location, see BUMState.h), replacing any existing state, and runs a
+ *  randomized sequence of boots against it with the real state code: each
+ *  boot is the root BUM's boot-time step, followed, if the booted payload
+ *  comes up, by runtime-init and sometimes by an update (update-start,
+ *  writing the update, update-complete). Any state write may be cut by a
+ *  power loss, which is simulated by writing a torn copy of the new state in
+ *  place of the slot the write would have replaced, or a torn journal record
+ *  where the record would have gone. Some updates are bad and never come
+ *  up, and the configuration BUM of some of those does not even load: the
+ *  root BUM then falls back to the alternate in the same boot.
+ *
+ *  A model of what the disk holds is checked against the state machine:
+ *      - the state read back is always the last state written in full (a cut
+ *        write changes nothing, and the update counter never goes back),
+ *      - a boot always picks a valid configuration that is completely
+ *        written, and ends up in one whose configuration BUM loads,
+ *      - an update is booted at most <attempt count> times before it is
+ *        confirmed by runtime-init, and never again once the boot fell back.
+ *
+ *  Reports the rate of state transitions (open, apply, commit), the state
+ *  bytes written per boot, and the invariant violations. Run it on a tmpfs to
+ *  measure the state code rather than the disk, or on each kind of location
+ *  to compare the storage backends.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <uchar.h>
+#include "EFIGlue.h"
+#include "BUMState.h"
+#include "LibCommon.h"
+
+static const char *usage = "<BUM state location> <boots> [<seed>]";
+
+/*  Percent chances of the random events */
+#define SIM_CUT_PERCENT         (2)     /* a state write is cut */
+#define SIM_TRANSIENT_PERCENT   (5)     /* a good payload still fails */
+#define SIM_UPDATE_PERCENT      (10)    /* runtime-init is followed by an update */
+#define SIM_UPDATECUT_PERCENT   (5)     /* power is lost writing the update */
+#define SIM_BADUPDATE_PERCENT   (30)    /* an update never comes up */
+#define SIM_BADLOAD_PERCENT     (50)    /* a bad update does not even load */
+
+#define SIM_ATTEMPTS_MAX        (5)
+#define SIM_CONFIGS_MAX         (8)
+#define SIM_VIOLATIONS_SHOWN    (10)
+#define SIM_DEFAULT_SEED        (1)
+
+typedef enum {
+    SIM_OP_BOOTTIME,
+    SIM_OP_BOOTFAILURE,
+    SIM_OP_RUNTIMEINIT,
+    SIM_OP_UPDATESTART,
+    SIM_OP_UPDATECOMPLETE,
+} sim_op_t;
+
+/*  A configuration directory on the boot partition */
+typedef struct {
+    char    name[BUMSTATE_CONFIG_MAXLEN];
+    bool    complete;       /* completely written */
+    bool    loads;          /* its configuration BUM loads */
+    bool    good;           /* its payload comes up */
+} sim_config_t;
+
+typedef struct {
+    char            *statedir;
+    CONST BUM_state_backend_t *backend;     /* for the torn writes */
+    CHAR8           *target;
+    uint64_t        rng;
+    /*  The model */
+    BUM_state_t     ondisk;         /* the last state written in full */
+    sim_config_t    configs[SIM_CONFIGS_MAX];
+    unsigned        nconfigs;
+    unsigned        nextname;
+    sim_config_t    *unconfirmed;   /* the update not yet confirmed */
+    uint64_t        budget;         /* boots left to the unconfirmed update */
+    bool            fellback;       /* the boot fell back from it */
+    /*  Statistics */
+    uint64_t        boot;
+    uint64_t        transitions;
+    uint64_t        writes;
+    uint64_t        bytes;
+    uint64_t        cuts;
+    uint64_t        updates;
+    uint64_t        fallbacks;
+    uint64_t        violations;
+} sim_t;
+
+/******************************************************************************/
+/*  Helpers                                                                   */
+/******************************************************************************/
+
+/*  xorshift64*: the sequence only depends on the seed */
+static uint64_t Sim_random(sim_t *sim)
+{
+    sim->rng ^= sim->rng >> 12;
+    sim->rng ^= sim->rng << 25;
+    sim->rng ^= sim->rng >> 27;
+    return sim->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static bool Sim_chance(sim_t *sim, unsigned percent)
+{
+    return (Sim_random(sim) % 100) < percent;
+}
+
+static void Sim_violation(sim_t *sim, const char *what)
+{
+    sim->violations++;
+    if(sim->violations <= SIM_VIOLATIONS_SHOWN)
+        fprintf(stderr, "    boot %" PRIu64 ": %s\n", sim->boot, what);
+    else if(sim->violations == SIM_VIOLATIONS_SHOWN + 1)
+        fprintf(stderr, "    ...\n");
+}
+
+static sim_config_t *Sim_findConfig(sim_t *sim, const char *name)
+{
+    unsigned i;
+    for(i = 0; i < sim->nconfigs; i++){
+        if(0 == strcmp(sim->configs[i].name, name))
+            return &(sim->configs[i]);
+    }
+    return NULL;
+}
+
+/*  Returns the configuration named name, or a new one if name is NULL or not
+    a valid name */
+static sim_config_t *Sim_getConfig(sim_t *sim, const char *name)
+{
+    sim_config_t *config = NULL;
+    unsigned i;
+    if( (NULL != name) && BUMState_configIsValid((CHAR8*)name) )
+        config = Sim_findConfig(sim, name);
+    if(NULL != config)
+        return config;
+    /*  Reuse the entry of a configuration the state no longer names */
+    if(sim->nconfigs < SIM_CONFIGS_MAX)
+        config = &(sim->configs[sim->nconfigs++]);
+    else{
+        for(i = 0; i < SIM_CONFIGS_MAX; i++){
+            config = &(sim->configs[i]);
+            if( (0 != strcmp(config->name, sim->ondisk.DfltConfig)) &&
+                (0 != strcmp(config->name, sim->ondisk.AltrConfig)) )
+                break;
+        }
+    }
+    if( (NULL != name) && BUMState_configIsValid((CHAR8*)name) )
+        snprintf(config->name, sizeof(config->name), "%s", name);
+    else
+        snprintf(config->name, sizeof(config->name), "cfg%u", sim->nextname++);
+    config->complete = false;
+    config->loads = false;
+    config->good = false;
+    return config;
+}
+
+/*  Writes what a cut write of the handle's state would leave behind: the
+    first bytes of the new state over the old contents of the slot the write
+    would have replaced. Returns true if the bytes written happen to complete
+    the new state (e.g. only zero bytes were left out). */
+static bool Sim_tornWrite(sim_t *sim, BUM_state_handle_t *handle_p)
+{
+    BUM_state_t image;
+    UINT8 buffer[sizeof(BUM_state_t)];
+    VOID *old;
+    UINTN oldsize;
+    size_t torn, size;
+    memcpy(&image, handle_p->State, sizeof(image));
+    image.StateUpdateCounter = handle_p->Committed.StateUpdateCounter + 1;
+    image.Version = BUMSTATE_VERSION;
+    image.Checksum = 0;
+    image.Checksum = Common_Crc32c(&image, image.StateSize);
+    if(EFI_ERROR(sim->backend->Read(sim->target, handle_p->Next,
+                                    &old, &oldsize)))
+        oldsize = 0;
+    else{
+        if(oldsize > sizeof(buffer))
+            oldsize = sizeof(buffer);
+        memcpy(buffer, old, oldsize);
+        Common_FreeReadBuffer(old, oldsize);
+    }
+    torn = (size_t)(Sim_random(sim) % sizeof(image));
+    memcpy(buffer, &image, torn);
+    size = (torn > oldsize)? torn : oldsize;
+    sim->backend->Write(sim->target, handle_p->Next, buffer, size);
+    sim->cuts++;
+    sim->bytes += torn;
+    if( (size != sizeof(image)) || (0 != memcmp(buffer, &image, size)) )
+        return false;
+    memcpy(&(sim->ondisk), &image, sizeof(image));
+    return true;
+}
+
+/*  Like Sim_tornWrite, for a commit that would append a journal record: the
+    first bytes of the record are written where it would have gone */
+static bool Sim_tornRecord(sim_t *sim, BUM_state_handle_t *handle_p)
+{
+    BUM_state_record_t record, journal[BUMSTATE_JOURNAL_RECORDS];
+    UINTN offset, readsize;
+    size_t torn;
+    record.StateUpdateCounter = handle_p->Committed.StateUpdateCounter + 1;
+    record.Flags = handle_p->State->Flags.raw;
+    record.DfltAttemptsRemaining = handle_p->State->DfltAttemptsRemaining;
+    record.Base = handle_p->JournalBase;
+    record.Checksum = 0;
+    record.Checksum = Common_Crc32c(&record, sizeof(record));
+    offset = handle_p->JournalNext * sizeof(record);
+    torn = (size_t)(Sim_random(sim) % sizeof(record));
+    if(0 != torn)
+        sim->backend->JournalWrite(sim->target, offset, &record, torn);
+    sim->cuts++;
+    sim->bytes += torn;
+    /*  What an earlier cut left past the torn bytes may complete it */
+    if( EFI_ERROR(sim->backend->JournalRead(sim->target, journal,
+                                            sizeof(journal), &readsize)) ||
+        (readsize < offset + sizeof(record)) ||
+        (0 != memcmp(&(journal[handle_p->JournalNext]), &record,
+                        sizeof(record))) )
+        return false;
+    memcpy(&(sim->ondisk), handle_p->State, sizeof(sim->ondisk));
+    sim->ondisk.StateUpdateCounter = record.StateUpdateCounter;
+    sim->ondisk.Version = BUMSTATE_VERSION;
+    sim->ondisk.Checksum = 0;
+    sim->ondisk.Checksum = Common_Crc32c(&(sim->ondisk),
+                                            sim->ondisk.StateSize);
+    return true;
+}
+
+/*  Applies an operation to the state, as the corresponding utility or the
+    root BUM would. Returns 0 if the new state was written, 1 if the write was
+    cut, and -1 if the operation failed. The new state is returned in
+    after_p. */
+static int Sim_transition(  sim_t       *sim,
+                            sim_op_t    op,
+                            uint64_t    attempts,
+                            char        *config,
+                            BUM_state_t *after_p)
+{
+    BUM_state_handle_t handle;
+    uint64_t counter;
+    int ret = 0;
+    sim->transitions++;
+    if(EFI_ERROR(BUMState_Open(sim->statedir, &handle))){
+        Sim_violation(sim, "the state can not be read");
+        return -1;
+    }
+    /*  The state read must be the last one written in full */
+    counter = handle.Committed.StateUpdateCounter;
+    if(counter < sim->ondisk.StateUpdateCounter)
+        Sim_violation(sim, "the update counter went back");
+    else if(0 != memcmp(&(handle.Committed), &(sim->ondisk),
+                        sizeof(BUM_state_t)))
+        Sim_violation(sim, "the state read is not the state written");
+    /*  Carry on from what was read */
+    memcpy(&(sim->ondisk), &(handle.Committed), sizeof(BUM_state_t));
+    switch(op){
+        case SIM_OP_BOOTTIME:
+            BUMStateNext_BootTime(handle.State);
+            break;
+        case SIM_OP_BOOTFAILURE:
+            if(EFI_ERROR(BUMStateNext_BootFailure(handle.State))){
+                Sim_violation(sim, "fell back from the alternate");
+                ret = -1;
+                goto exit0;
+            }
+            break;
+        case SIM_OP_RUNTIMEINIT:
+            BUMStateNext_RunTimeInit(handle.State);
+            break;
+        case SIM_OP_UPDATESTART:
+            BUMStateNext_StartUpdate(handle.State);
+            break;
+        case SIM_OP_UPDATECOMPLETE:
+            if(EFI_ERROR(BUMStateNext_CompleteUpdate(   handle.State,
+                                                        attempts, config))){
+                Sim_violation(sim, "update-complete failed");
+                ret = -1;
+                goto exit0;
+            }
+            break;
+    }
+    memcpy(after_p, handle.State, sizeof(*after_p));
+    /*  Only a write that would happen can be cut */
+    handle.State->StateUpdateCounter = counter;
+    handle.State->Checksum = handle.Committed.Checksum;
+    if( (0 != memcmp(handle.State, &(handle.Committed), sizeof(BUM_state_t))) &&
+        Sim_chance(sim, SIM_CUT_PERCENT) ){
+        if(BUMState_CommitAppends(&handle))
+            ret = Sim_tornRecord(sim, &handle)? 0 : 1;
+        else
+            ret = Sim_tornWrite(sim, &handle)? 0 : 1;
+        goto exit0;
+    }
+    if(EFI_ERROR(BUMState_Commit(&handle))){
+        Sim_violation(sim, "the state can not be written");
+        ret = -1;
+        goto exit0;
+    }
+    if(handle.Committed.StateUpdateCounter != counter){
+        sim->writes++;
+        /*  A commit that appended a record leaves records after the slot */
+        sim->bytes +=   (0 != handle.JournalNext)?
+                        sizeof(BUM_state_record_t) : handle.Committed.StateSize;
+    }
+    memcpy(&(sim->ondisk), &(handle.Committed), sizeof(BUM_state_t));
+exit0:
+    BUMState_Close(&handle);
+    return ret;
+}
+
+/******************************************************************************/
+/*  The boot loop                                                             */
+/******************************************************************************/
+
+/*  Runs after runtime-init: the update overwrites the configuration that is
+    not running. */
+static void Sim_update(sim_t *sim)
+{
+    BUM_state_t after;
+    char name[BUMSTATE_CONFIG_MAXLEN];
+    sim_config_t *config;
+    uint64_t attempts;
+    if(0 != Sim_transition(sim, SIM_OP_UPDATESTART, 0, NULL, &after))
+        return;
+    if(EFI_ERROR(BUMState_getNonCurrConfig(&after, name)))
+        config = Sim_getConfig(sim, NULL);
+    else
+        config = Sim_getConfig(sim, name);
+    config->complete = false;
+    if(config == sim->unconfirmed)
+        sim->unconfirmed = NULL;
+    if(Sim_chance(sim, SIM_UPDATECUT_PERCENT))
+        return;
+    config->complete = true;
+    config->good = !Sim_chance(sim, SIM_BADUPDATE_PERCENT);
+    config->loads = config->good || !Sim_chance(sim, SIM_BADLOAD_PERCENT);
+    attempts = 1 + Sim_random(sim) % SIM_ATTEMPTS_MAX;
+    if(0 != Sim_transition( sim, SIM_OP_UPDATECOMPLETE, attempts,
+                            config->name, &after))
+        return;
+    sim->updates++;
+    sim->unconfirmed = config;
+    sim->budget = attempts;
+    sim->fellback = false;
+}
+
+/*  Checks the configuration the root BUM picked and counts it against the
+    update. Returns NULL if there is no such configuration to boot. */
+static sim_config_t *Sim_picked(sim_t *sim, BUM_state_t *after_p)
+{
+    char name[BUMSTATE_CONFIG_MAXLEN];
+    sim_config_t *config;
+    if(EFI_ERROR(BUMState_getCurrConfig(after_p, name))){
+        Sim_violation(sim, "booted an invalid configuration");
+        return NULL;
+    }
+    config = Sim_findConfig(sim, name);
+    if( (NULL == config) || !config->complete ){
+        Sim_violation(sim, "booted a configuration that is not written");
+        return NULL;
+    }
+    if(NULL != sim->unconfirmed){
+        if(config == sim->unconfirmed){
+            if(0 == sim->budget)
+                Sim_violation(sim, "booted an update past its attempt count");
+            else
+                sim->budget--;
+        }else if(0 != sim->budget)
+            Sim_violation(sim, "fell back before the update was tried");
+        else if(!sim->fellback){
+            /*  The update must not be tried again */
+            sim->fellback = true;
+            sim->fallbacks++;
+        }
+    }
+    return config;
+}
+
+static void Sim_boot(sim_t *sim)
+{
+    BUM_state_t after;
+    sim_config_t *config;
+    /*  The root BUM */
+    if(0 != Sim_transition(sim, SIM_OP_BOOTTIME, 0, NULL, &after))
+        return;
+    config = Sim_picked(sim, &after);
+    if(NULL == config)
+        return;
+    /*  A configuration BUM that does not load is given up on in place: its
+        remaining attempts are spent */
+    if(!config->loads){
+        if(0 != Sim_transition(sim, SIM_OP_BOOTFAILURE, 0, NULL, &after))
+            return;
+        if(config == sim->unconfirmed)
+            sim->budget = 0;
+        config = Sim_picked(sim, &after);
+        if(NULL == config)
+            return;
+        if(!config->loads){
+            Sim_violation(sim, "fell back to a configuration that does not load");
+            return;
+        }
+    }
+    /*  The payload */
+    if( !config->good || Sim_chance(sim, SIM_TRANSIENT_PERCENT) )
+        return;
+    if(0 != Sim_transition(sim, SIM_OP_RUNTIMEINIT, 0, NULL, &after))
+        return;
+    if(config == sim->unconfirmed)
+        sim->unconfirmed = NULL;
+    if(Sim_chance(sim, SIM_UPDATE_PERCENT))
+        Sim_update(sim);
+}
+
+static int Sim_run( char        *statedir,
+                    uint64_t    boots,
+                    uint64_t    seed)
+{
+    static sim_t sim;
+    BUM_state_t *state_p;
+    sim_config_t *config;
+    struct timespec start, stop;
+    double seconds;
+    memset(&sim, 0, sizeof(sim));
+    sim.statedir = statedir;
+    sim.backend = BUMState_GetBackend(statedir, &(sim.target));
+    sim.rng = (0 == seed)? SIM_DEFAULT_SEED : seed;
+    /*  Start from one good configuration */
+    config = Sim_getConfig(&sim, NULL);
+    config->complete = true;
+    config->loads = true;
+    config->good = true;
+    if( EFI_ERROR(BUMState_Init(statedir, config->name)) ||
+        EFI_ERROR(BUMState_Get(statedir, &state_p)) ){
+        fprintf(stderr, "    BUMState_Init failed\n");
+        return -1;
+    }
+    memcpy(&(sim.ondisk), state_p, sizeof(sim.ondisk));
+    BUMState_Free(state_p);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(sim.boot = 0; sim.boot < boots; sim.boot++)
+        Sim_boot(&sim);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    seconds = (stop.tv_sec - start.tv_sec) +
+                (stop.tv_nsec - start.tv_nsec) / 1e9;
+    if(0 == boots)
+        boots = 1;
+    printf("backend:              %s\n", sim.backend->Name);
+    printf("boots:                %" PRIu64 "\n", sim.boot);
+    printf("transitions:          %" PRIu64 " (%.0f/sec)\n", sim.transitions,
+            (seconds > 0)? sim.transitions / seconds : 0);
+    printf("state writes:         %.3f per boot, %.1f bytes per boot\n",
+            (double)sim.writes / boots, (double)sim.bytes / boots);
+    printf("power cuts:           %" PRIu64 "\n", sim.cuts);
+    printf("updates:              %" PRIu64 " (%" PRIu64 " fell back)\n",
+            sim.updates, sim.fallbacks);
+    printf("invariant violations: %" PRIu64 "\n", sim.violations);
+    return (0 == sim.violations)? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+    int ret;
+    uint64_t seed = SIM_DEFAULT_SEED;
+    if( (argc != 3) && (argc != 4) ){
+        fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
+        ret = -1;
+    }else{
+        if(argc == 4)
+            seed = strtoull(argv[3], NULL, 0);
+        ret = Sim_run(argv[1], strtoull(argv[2], NULL, 0), seed);
+        if(0 != ret)
+            fprintf(stderr, "    Sim_run failed\n");
+    }
+    return ret;
+}
@@ -0,0 +1,342 @@
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <uchar.h>
+#include "EFIGlue.h"
+#include "LibCommon.h"
+#include "BootTrace.h"
+#include "EFIPrint.h"
+
+static const char *usage =  "<boot-log directory> <BUM image (.efi)> "\
+                            "[<BUM image (.efi)> ...]";
+
+#define MESSAGE_MAXLEN  (4096)
+
+/******************************************************************************/
+/*  PE/COFF images holding the format strings                                 */
+/******************************************************************************/
+
+typedef struct {
+    const char  *path;
+    uint8_t     *data;
+    size_t      size;
+    const char  *BuildId;   /* Id of the build-ID record, or NULL */
+    uint8_t     *sections;
+    uint16_t    NumberOfSections;
+} image_t;
+
+static uint16_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t rd32(const uint8_t *p) { return rd16(p) | ((uint32_t)rd16(p + 2) << 16); }
+
+/*  Returns the Id of the image's build-ID record (see BUMBuildId.h): the
+    first BUMBUILDID_MAGIC followed by a terminated Id. */
+static const char *Image_BuildId(image_t *image)
+{
+    uint64_t magic = BUMBUILDID_MAGIC;
+    size_t offset;
+    const uint8_t *id;
+    for(offset = 0; offset + sizeof(BUM_buildId_t) <= image->size; offset++){
+        if(0 != memcmp(image->data + offset, &magic, sizeof(magic)))
+            continue;
+        id = image->data + offset + sizeof(magic);
+        if( (0 != id[0]) && (NULL != memchr(id, 0, BUMBUILDID_IDLEN)) )
+            return (const char*)id;
+    }
+    return NULL;
+}
+
+static int Image_Load(image_t *image, const char *path)
+{
+    FILE *f;
+    long size;
+    uint32_t pe, opt;
+    image->path = path;
+    image->data = NULL;
+    f = fopen(path, "r");
+    if(NULL == f){
+        perror("    fopen failed");
+        return -1;
+    }
+    if( (0 != fseek(f, 0, SEEK_END)) || ((size = ftell(f)) < 0x40) ||
+        (0 != fseek(f, 0, SEEK_SET)) ){
+        fclose(f);
+        fprintf(stderr, "    %s: not a PE/COFF image\n", path);
+        return -1;
+    }
+    image->size = (size_t)size;
+    image->data = malloc(image->size);
+    if( (NULL == image->data) ||
+        (1 != fread(image->data, image->size, 1, f)) ){
+        fclose(f);
+        fprintf(stderr, "    %s: read failed\n", path);
+        return -1;
+    }
+    fclose(f);
+    /*  DOS header -> PE signature -> COFF header -> optional header */
+    pe = rd32(image->data + 0x3C);
+    if( (pe + 24 > image->size) ||
+        (0 != memcmp(image->data + pe, "PE\0\0", 4)) ){
+        fprintf(stderr, "    %s: not a PE/COFF image\n", path);
+        return -1;
+    }
+    image->NumberOfSections = rd16(image->data + pe + 4 + 2);
+    opt = pe + 4 + 20;
+    if(opt + 60 > image->size){
+        fprintf(stderr, "    %s: truncated PE/COFF image\n", path);
+        return -1;
+    }
+    image->sections = image->data + opt + rd16(image->data + pe + 4 + 16);
+    if( (size_t)(image->sections - image->data) +
+            (size_t)image->NumberOfSections * 40 > image->size ){
+        fprintf(stderr, "    %s: truncated section table\n", path);
+        return -1;
+    }
+    image->BuildId = Image_BuildId(image);
+    if(NULL == image->BuildId){
+        fprintf(stderr, "    %s: no build ID\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/*  Returns the UCS-2 string at the given RVA, or NULL */
+static const uint16_t *Image_String(image_t *image, uint32_t rva)
+{
+    uint16_t i;
+    size_t offset, end;
+    for(i = 0; i < image->NumberOfSections; i++){
+        const uint8_t *section = image->sections + (size_t)i * 40;
+        uint32_t VirtualAddress = rd32(section + 12);
+        uint32_t SizeOfRawData = rd32(section + 16);
+        uint32_t PointerToRawData = rd32(section + 20);
+        if( (rva < VirtualAddress) || (rva >= VirtualAddress + SizeOfRawData) )
+            continue;
+        offset = PointerToRawData + (rva - VirtualAddress);
+        end = PointerToRawData + SizeOfRawData;
+        if(end > image->size)
+            end = image->size;
+        /*  The string must be terminated inside the section */
+        for(; offset + 1 < end; offset += 2)
+            if(0 == rd16(image->data + offset))
+                return (const uint16_t*)(image->data + PointerToRawData +
+                                            (rva - VirtualAddress));
+        return NULL;
+    }
+    return NULL;
+}
+
+/******************************************************************************/
+/*  Rendering                                                                 */
+/******************************************************************************/
+
+typedef struct {
+    const BOOTTRACE_record_t    *record;
+    const uint64_t              *args;
+    unsigned                    next;
+} recordargs_t;
+
+static uint64_t Trace_NextArg(void *ctx, EFIPrint_argclass_t argclass)
+{
+    recordargs_t *ra = (recordargs_t*)ctx;
+    uint64_t word;
+    if(ra->next >= ra->record->ArgCount)
+        return 0;
+    word = ra->args[ra->next++];
+    switch(argclass){
+        case EFIPRINT_ARG_STRING16:
+        case EFIPRINT_ARG_STRING8:
+        case EFIPRINT_ARG_GUID:
+        case EFIPRINT_ARG_TIME:
+            /*  Copied data: the word is an offset into the record */
+            if( (0 == word) || (word >= ra->record->Size) )
+                return 0;
+            return (uint64_t)(uintptr_t)((const uint8_t*)ra->record + word);
+        default:
+            return word;
+    }
+}
+
+static time_t Trace_Seconds(const BOOTTRACE_time_t *t)
+{
+    struct tm tm = {0};
+    tm.tm_year = (int)t->Year - 1900;
+    tm.tm_mon = (int)t->Month - 1;
+    tm.tm_mday = t->Day;
+    tm.tm_hour = t->Hour;
+    tm.tm_min = t->Minute;
+    tm.tm_sec = t->Second;
+    return timegm(&tm);
+}
+
+/*  Only the segment's start and end are time stamped; record times are
+    interpolated from the TSC. */
+static void Trace_RecordTime(   const BOOTTRACE_segment_t   *segment,
+                                uint64_t                    TSC,
+                                struct tm                   *tm)
+{
+    time_t start = Trace_Seconds(&segment->StartTime);
+    time_t end = Trace_Seconds(&segment->EndTime);
+    time_t t = start;
+    if( (end > start) && (segment->EndTSC > segment->StartTSC) &&
+        (TSC > segment->StartTSC) )
+        t += (time_t)( (double)(TSC - segment->StartTSC) * (double)(end - start)
+                        / (double)(segment->EndTSC - segment->StartTSC) );
+    gmtime_r(&t, tm);
+}
+
+static void Trace_PrintRecord(  const BOOTTRACE_segment_t   *segment,
+                                const BOOTTRACE_record_t    *record,
+                                image_t                     *image)
+{
+    static char message[MESSAGE_MAXLEN];
+    const uint16_t *format = NULL;
+    recordargs_t ra = { record, (const uint64_t*)(record + 1), 0 };
+    EFIPrint_args_t args = { Trace_NextArg, &ra };
+    struct tm tm;
+
+    if(record->Flags & BOOTTRACE_RECORD_INLINE_FORMAT){
+        if( (0 != record->Format) && (record->Format < record->Size) )
+            format = (const uint16_t*)((const uint8_t*)record + record->Format);
+    }else if(NULL != image)
+        format = Image_String(image, record->Format);
+
+    if(NULL != format)
+        EFIPrint_format(message, sizeof(message), format, NULL, &args);
+    else
+        snprintf(message, sizeof(message),
+                    "<format at RVA 0x%08" PRIX32 " not found>",
+                    record->Format);
+
+    Trace_RecordTime(segment, record->TSC, &tm);
+    printf("%04d-%02d-%02d %02d:%02d:%02d %016" PRIX64 " %.*s) %s%s\n",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+            tm.tm_hour, tm.tm_min, tm.tm_sec,
+            record->TSC,
+            (int)AsciiStrnLenS(segment->Context, BOOTTRACE_CONTEXT_SIZE),
+            segment->Context,
+            message,
+            (record->Flags & BOOTTRACE_RECORD_TRUNCATED)? " ..." : "");
+}
+
+static int Trace_Dump(  char        *logdir,
+                        image_t     *images,
+                        int         imagecount)
+{
+    int ret, i, matches;
+    EFI_STATUS stat;
+    uint8_t *buffer;
+    UINTN buffersize, offset, end;
+    uint32_t n;
+    const BOOTTRACE_segment_t *segment;
+    const BOOTTRACE_record_t *record;
+    image_t *image;
+
+    stat = Common_OpenReadCloseDirFile( logdir, BOOTTRACE_FILENAME,
+                                        (VOID**)&buffer, &buffersize);
+    if(EFI_ERROR(stat)){
+        fprintf(stderr, "    Common_OpenReadCloseDirFile failed\n");
+        ret = -1;
+        goto exit0;
+    }
+    ret = 0;
+    for(offset = 0; offset + sizeof(*segment) <= buffersize; offset = end){
+        segment = (const BOOTTRACE_segment_t*)(buffer + offset);
+        if( (BOOTTRACE_MAGIC != segment->Magic) ||
+            (BOOTTRACE_VERSION != segment->Version) ||
+            (sizeof(*segment) != segment->HeaderSize) ){
+            fprintf(stderr, "    invalid trace segment at offset %lu\n",
+                    (unsigned long)offset);
+            ret = -1;
+            break;
+        }
+        end = offset + sizeof(*segment) + segment->RecordsSize;
+        if(end > buffersize){
+            /*  The last segment was not completely written */
+            fprintf(stderr, "    truncated trace segment at offset %lu\n",
+                    (unsigned long)offset);
+            break;
+        }
+        /*  Images are told apart by their build ID */
+        image = NULL;
+        for(i = 0, matches = 0; i < imagecount; i++){
+            if(0 == strncmp(images[i].BuildId, segment->ImageId,
+                            BUMBUILDID_IDLEN)){
+                image = &images[i];
+                matches++;
+            }
+        }
+        if(1 < matches){
+            fprintf(stderr, "    %d images with build ID \"%.*s\" for context "
+                            "\"%.*s\"\n", matches,
+                            (int)AsciiStrnLenS( segment->ImageId,
+                                                BUMBUILDID_IDLEN),
+                            segment->ImageId,
+                            (int)AsciiStrnLenS( segment->Context,
+                                                BOOTTRACE_CONTEXT_SIZE),
+                            segment->Context);
+            ret = -1;
+            break;
+        }
+        if(NULL == image)
+            fprintf(stderr, "    no image with build ID \"%.*s\" for context "
+                            "\"%.*s\"\n",
+                            (int)AsciiStrnLenS( segment->ImageId,
+                                                BUMBUILDID_IDLEN),
+                            segment->ImageId,
+                            (int)AsciiStrnLenS( segment->Context,
+                                                BOOTTRACE_CONTEXT_SIZE),
+                            segment->Context);
+        record = (const BOOTTRACE_record_t*)(segment + 1);
+        for(n = 0; n < segment->RecordCount; n++){
+            if( ((const uint8_t*)record + sizeof(*record) >
+                    buffer + end) ||
+                (record->Size < sizeof(*record) +
+                                record->ArgCount * sizeof(uint64_t)) ||
+                ((const uint8_t*)record + record->Size > buffer + end) ){
+                fprintf(stderr, "    invalid trace record\n");
+                ret = -1;
+                break;
+            }
+            Trace_PrintRecord(segment, record, image);
+            record = (const BOOTTRACE_record_t*)
+                        ((const uint8_t*)record + record->Size);
+        }
+    }
+    Common_FreeReadBuffer(buffer, buffersize);
+exit0:
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int ret, i;
+    image_t *images;
+    if(argc < 3){
+        fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
+        return -1;
+    }
+    images = calloc(argc - 2, sizeof(image_t));
+    if(NULL == images){
+        fprintf(stderr, "    calloc failed\n");
+        return -1;
+    }
+    ret = 0;
+    for(i = 0; (0 == ret) && (i < argc - 2); i++)
+        ret = Image_Load(&images[i], argv[i + 2]);
+    if(0 != ret)
+        fprintf(stderr, "    Image_Load failed\n");
+    else{
+        ret = Trace_Dump(argv[1], images, argc - 2);
+        if(0 != ret)
+            fprintf(stderr, "    Trace_Dump failed\n");
+    }
+    for(i = 0; i < argc - 2; i++)
+        free(images[i].data);
+    free(images);
+    return ret;
+}
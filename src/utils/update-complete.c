@@ -9,25 +9,27 @@
 
 #include "EFIGlue.h"
 #include "BUMState.h"
+#include "libbumstate.h"
+#include "BUMStateOps.h"
 
 static int updateComplete(  char        *statedir_name,
                             uint64_t    attemptcount,
                             char        *updateconfig)
 {
     int ret;
-    BUM_state_t       *BUM_state_p;
+    BUM_state_handle_t BUM_state;
     EFI_STATUS stat;
     /*  Assume success */
     ret = 0;
     /*  Acquire the BUM state */
-    stat = BUMState_Get(statedir_name, &BUM_state_p);
+    stat = BUMState_Open(statedir_name, &BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Get failed\n");
+        fprintf(stderr, "    BUMState_Open failed\n");
         ret = -1;
         goto exit0;
     }
     /*  Perform the complete-update logic. */
-    stat = BUMStateNext_CompleteUpdate( BUM_state_p,
+    stat = BUMStateNext_CompleteUpdate( BUM_state.State,
                                         attemptcount,
                                         updateconfig);
     if(EFI_ERROR(stat)){
@@ -36,17 +38,17 @@ static int updateComplete(  char        *statedir_name,
         goto exit1;
     }
     /*  Save the BUM state */
-    stat = BUMState_Put(statedir_name, BUM_state_p);
+    stat = BUMState_Commit(&BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Put failed\n");
+        fprintf(stderr, "    BUMState_Commit failed\n");
         ret = -1;
         /*goto exit1;*/
     }
-    /*  Free the state variable */
+    /*  Close the state */
 exit1:
-    stat = BUMState_Free(BUM_state_p);
+    stat = BUMState_Close(&BUM_state);
     if(EFI_ERROR(stat)){
-        fprintf(stderr, "    BUMState_Free failed\n");
+        fprintf(stderr, "    BUMState_Close failed\n");
         ret = -1;
         /*goto exit0;*/
     }
@@ -54,56 +56,6 @@ exit0:
     return ret;
 }
 
-static int validateargs(char        *attemptcount_str,
-                        char        *updateconfig,
-                        uint64_t    *attemptcount_p)
-{
-    size_t len;
-    int ret;
-    char *endptr;
-    unsigned long long attemptcount;
-    /*  Check the attempt count*/
-    len = strlen(attemptcount_str);
-    if(0 == len){
-        fprintf(stderr, "    validateargs: "\
-                        "attempt count can not be an empty string\n");
-        ret = -1;
-    }else{
-        errno = 0;
-        attemptcount = strtoull(attemptcount_str, &endptr, 0);
-        if(0 != errno){
-            perror( "    validateargs: "\
-                    "strtoull failed for attempt count");
-            ret = -1;
-        }else{
-            if('\0' != *endptr){
-                fprintf(stderr, "    validateargs: "\
-                                "attempt count contains non-digit characters\n");
-                ret = -1;
-            }else{
-                if(0 == attemptcount){
-                    fprintf(stderr, "    validateargs: "\
-                                    "attempt count must be greater than zero\n");
-                    ret = -1;
-                }else{
-                    /*  Check the new-configuration name */
-                    len = strlen(updateconfig);
-                    if(0 == len){
-                        fprintf(stderr, "    validateargs: "\
-                                        "new configuration name must be"\
-                                        "a non-empty string.\n");
-                        ret = -1;
-                    }else{
-                        *attemptcount_p = (uint64_t)attemptcount;
-                        ret = 0;
-                    }
-                }
-            }
-        }
-    }
-    return ret;
-}
-
 static const char *usage =  "<BUM state directory> <default attempt count> "\
                             "<new configuration>";
 
@@ -121,7 +73,7 @@ int main(int argc, char** argv)
         statedir_str = argv[1];
         attemptcount_str = argv[2];
         updateconfig = argv[3];
-        ret = validateargs( attemptcount_str,
+        ret = BUMStateOps_ValidateUpdateArgs( attemptcount_str,
                             updateconfig,
                             &attemptcount);
         if(0 != ret)
@@ -16,6 +16,9 @@ else
     outputfile=$2
 fi
 
+# Decoder for the binary boot log (log.bin)
+LOGDUMP=${LOGDUMP:-bin/amd64/bumstate-log-dump}
+
 # Check that $2 is writable
 rm -rf $outputfile
 
@@ -38,7 +41,22 @@ rm -f "test/.tmplog/backup/logline.txt"
 rm -f "test/.tmplog/root/LOGLINE.TXT"
 rm -f "test/.tmplog/primary/LOGLINE.TXT"
 rm -f "test/.tmplog/backup/LOGLINE.TXT"
-cat "test/.tmplog/"*"/"* | sort > $outputfile
+# Binary logs are decoded in order; merging them needs no full sort
+for logdir in root primary backup; do
+    if [ -f "test/.tmplog/${logdir}/LOG.BIN" ]; then
+        mv "test/.tmplog/${logdir}/LOG.BIN" "test/.tmplog/${logdir}/log.bin"
+    fi
+    if [ -f "test/.tmplog/${logdir}/log.bin" ]; then
+        "${LOGDUMP}" "test/.tmplog/${logdir}" > "test/.tmplog/${logdir}.log"
+        rm -f "test/.tmplog/${logdir}/log.bin"
+    fi
+done
+# Text log files (one per segment, 000.txt to 511.txt) still need sorting;
+# other files, such as the binary trace.bin, are left out
+shopt -s nullglob
+cat /dev/null "test/.tmplog/"*"/"[0-9][0-9][0-9].{txt,TXT} | \
+    sort > "test/.tmplog/text.log"
+sort -m "test/.tmplog/"*".log" > $outputfile
 
 rm -rf "test/.tmplog"
 
@@ -0,0 +1,75 @@
+#!/bin/bash
+#
+# Crash-consistency test for the BUM-state write path of the user-space
+# utilities.
+#
+# Builds the utilities with BUMSTATE_FAULT_INJECTION, which makes them exit at
+# the Nth syscall boundary of a state write (BUMSTATE_FAULT_AT=N). Each
+# state-changing utility is then run once for every boundary, starting from
+# the same state each time. After every interrupted run the state must still
+# be readable and must be either the state before or the state after the
+# complete run.
+#
+# Run from the top of the repository.
+
+set -o errexit
+set -o nounset
+set -o pipefail
+
+FAULTOUT=test/faultbin
+FAULTBIN=${FAULTOUT}/amd64
+STATEDIR=test/faultstatedir
+FAULT_EXIT_STATUS=99
+
+cc_flags='-Wall -DBUMSTATE_FAULT_INJECTION' \
+    make -s -f build/Makefile.gcc output_directory=${FAULTOUT} ARCH=amd64
+
+rm -rf ${STATEDIR} ${STATEDIR}.before ${STATEDIR}.after
+mkdir ${STATEDIR}
+${FAULTBIN}/bumstate-init ${STATEDIR} sda2
+
+failures=0
+points=0
+
+# check_op <utility> [<argument> ...]
+check_op () {
+    local before after got status n
+    before=$(${FAULTBIN}/bumstate-print ${STATEDIR})
+    cp -a ${STATEDIR} ${STATEDIR}.before
+    "${FAULTBIN}/bumstate-$1" ${STATEDIR} "${@:2}" > /dev/null
+    after=$(${FAULTBIN}/bumstate-print ${STATEDIR})
+    mv ${STATEDIR} ${STATEDIR}.after
+    for (( n = 1; ; n++ )); do
+        rm -rf ${STATEDIR}
+        cp -a ${STATEDIR}.before ${STATEDIR}
+        status=0
+        BUMSTATE_FAULT_AT=$n "${FAULTBIN}/bumstate-$1" ${STATEDIR} "${@:2}" \
+            > /dev/null || status=$?
+        if ! got=$(${FAULTBIN}/bumstate-print ${STATEDIR}); then
+            echo "FAIL: $1: no valid state after fault $n"
+            failures=$((failures + 1))
+        elif [ "${got}" != "${before}" ] && [ "${got}" != "${after}" ]; then
+            echo "FAIL: $1: unexpected state after fault $n"
+            failures=$((failures + 1))
+        fi
+        if [ ${status} -ne ${FAULT_EXIT_STATUS} ]; then
+            break
+        fi
+        points=$((points + 1))
+    done
+    echo "$1: checked $((n - 1)) fault point(s)"
+    rm -rf ${STATEDIR} ${STATEDIR}.before
+    mv ${STATEDIR}.after ${STATEDIR}
+}
+
+check_op update-complete 3 sda3
+check_op boottime-test
+check_op boottime-test
+check_op runtime-init
+check_op update-start
+check_op update-complete 2 sda4
+
+rm -rf ${STATEDIR} ${FAULTOUT}
+
+echo "${points} fault point(s), ${failures} failure(s)"
+[ ${failures} -eq 0 ]
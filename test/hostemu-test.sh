@@ -0,0 +1,150 @@
+#!/bin/bash
+#
+# Builds the loader against the host UEFI emulation (test/hostemu) and boots
+# it on an EFI system partition held in a directory: root BUM, configuration
+# BUM, and payload, with the state changed between runs by the bumstate tool.
+# Checks that an update whose payload keeps failing falls back to the previous
+# configuration, that one whose configuration BUM cannot be loaded falls back
+# within the same boot, that a configuration BUM identical to the root BUM is
+# run in place, that the payload is handed its configuration and boot attempt
+# in the BUM context, that BUMs older than the context can be mixed in, and
+# that the boot status is recorded, and reports the boot rate.
+#
+# Run from the top of the repository.
+
+set -o errexit
+set -o nounset
+set -o pipefail
+
+HOSTOUT=test/hostbin
+HOSTBIN=${HOSTOUT}/amd64
+# The boot rate is that of the file system: use a tmpfs when there is one
+ESP=$(mktemp -d /dev/shm/bum-hostesp.XXXXXX 2> /dev/null || \
+        mktemp -d -p test bum-hostesp.XXXXXX)
+BIN=test/bum-hostboot
+BENCH_BOOTS=2000
+
+make -s -f build/Makefile.gcc output_directory=${HOSTOUT} ARCH=amd64 \
+    ${HOSTBIN}/bumstate ${HOSTBIN}/bumstate-bootstat-dump \
+    ${HOSTBIN}/bumstate-log-dump
+
+gcc -Wall -O2 -fshort-wchar -DBUM_BUILD_ID=$(./build/build-id.sh) \
+    -I test/hostemu/include -iquote test/hostemu \
+    -iquote src/loader -iquote src/common -iquote src/utils -o ${BIN} \
+    test/hostemu/*.c src/loader/*.c src/common/BUMState.c src/utils/EFIPrint.c
+
+# Expects the boot log to report $1 configuration BUM(s) run in place
+InPlace() {
+    local count
+    count=$(${HOSTBIN}/bumstate-log-dump ${ESP}/bootlog | \
+            grep -c "is this image: running it in place" || true)
+    if [ "${count}" != "$1" ]; then
+        echo "FAIL: expected $1 configuration BUM(s) run in place, got ${count}"
+        exit 1
+    fi
+}
+
+# Expects the boot lines of "${BIN} ${ESP} <boots>" to be exactly $2: the
+# result, the configuration and the boot attempt of each boot
+Boots() {
+    local output
+    output=$(${BIN} ${ESP} $1 2> /dev/null | cut -d ' ' -f 3- | tr '\n' ',')
+    if [ "${output}" != "$2" ]; then
+        echo "FAIL: ${1} boot(s): expected \"$2\", got \"${output}\""
+        exit 1
+    fi
+}
+
+mkdir -p ${ESP}/EFI/BOOT ${ESP}/sda2 ${ESP}/sda3 ${ESP}/bumstate ${ESP}/bootlog
+for image in EFI/BOOT/bootx64.efi sda2/bootx64.efi sda3/bootx64.efi; do
+    ${BIN} -w ${ESP}/${image}
+done
+echo "payload" > ${ESP}/sda2/payload.efi
+echo "fail" > ${ESP}/sda3/payload.efi
+export BUMSTATE_NO_FSYNC=1
+${HOSTBIN}/bumstate init ${ESP}/bumstate sda2 > /dev/null
+
+# A stable configuration boots every time. Its configuration BUM carries the
+# build ID of the root BUM, so the root BUM runs it in place; one of another
+# build is loaded and started.
+Boots 3 "success sda2 0,success sda2 0,success sda2 0,"
+InPlace 3
+${BIN} -w ${ESP}/sda2/bootx64.efi "another build"
+Boots 1 "success sda2 0,"
+InPlace 3
+${BIN} -w ${ESP}/sda2/bootx64.efi
+
+# An update whose payload never comes up is tried, then abandoned. The payload
+# is told which attempt of the update it is.
+${HOSTBIN}/bumstate batch ${ESP}/bumstate \
+    "update-start; update-complete 3 sda3" > /dev/null
+Boots 5 "payload-failure sda3 1,payload-failure sda3 2,payload-failure sda3 3,\
+success sda2 0,success sda2 0,"
+if [ "$(${HOSTBIN}/bumstate currconfig-get ${ESP}/bumstate)" != "sda2" ]; then
+    echo "FAIL: sda2 is not the current configuration"
+    exit 1
+fi
+
+# An update whose configuration BUM cannot be loaded is abandoned in the first
+# boot, which goes on to the previous configuration without a reset
+rm ${ESP}/sda3/bootx64.efi
+${HOSTBIN}/bumstate batch ${ESP}/bumstate \
+    "update-start; update-complete 3 sda3" > /dev/null
+Boots 2 "success sda2 0,success sda2 0,"
+if [ "$(${HOSTBIN}/bumstate currconfig-get ${ESP}/bumstate)" != "sda2" ]; then
+    echo "FAIL: sda2 is not the current configuration"
+    exit 1
+fi
+${BIN} -w ${ESP}/sda3/bootx64.efi
+
+# An update that comes up is kept
+echo "payload" > ${ESP}/sda3/payload.efi
+${HOSTBIN}/bumstate batch ${ESP}/bumstate \
+    "update-start; update-complete 3 sda3" > /dev/null
+Boots 2 "success sda3 1,success sda3 1,"
+
+# BUMs older than the BUM context go by the BUM_CURCONFIG variable alone. A
+# root BUM falls back to such a configuration BUM, and such a root BUM starts
+# a newer configuration BUM, which counts the attempts of an update once.
+${BIN} -l ${ESP}/sda3/bootx64.efi
+echo "fail" > ${ESP}/sda2/payload.efi
+${HOSTBIN}/bumstate batch ${ESP}/bumstate \
+    "update-start; update-complete 3 sda2" > /dev/null
+Boots 4 "payload-failure sda2 1,payload-failure sda2 2,payload-failure sda2 3,\
+success sda3 -,"
+${BIN} -l ${ESP}/EFI/BOOT/bootx64.efi
+for image in sda2/bootx64.efi sda3/bootx64.efi; do
+    ${BIN} -w ${ESP}/${image} "another build"
+done
+${HOSTBIN}/bumstate batch ${ESP}/bumstate \
+    "update-start; update-complete 3 sda2" > /dev/null
+Boots 4 "payload-failure sda2 0,payload-failure sda2 0,payload-failure sda2 0,\
+success sda3 0,"
+for image in EFI/BOOT/bootx64.efi sda2/bootx64.efi sda3/bootx64.efi; do
+    ${BIN} -w ${ESP}/${image}
+done
+echo "payload" > ${ESP}/sda2/payload.efi
+
+echo "boot sequences checked"
+
+# The configuration BUM records the boot status in one file, which exports to
+# the files it used to write one by one
+mkdir ${ESP}/export
+${HOSTBIN}/bumstate-bootstat-dump ${ESP}/bootstatus \
+    --export=${ESP}/export > /dev/null
+exported=$(LC_ALL=C ls ${ESP}/export | tr '\n' ' ')
+if [ "${exported}" != "bum_timestamp bum_tsc_ticks_per_us nvinfo_MaxVarSize \
+nvinfo_NVRemaining nvinfo_NVSize uefivars_KEK uefivars_PK uefivars_SecureBoot \
+uefivars_SetupMode uefivars_db uefivars_dbx " ]; then
+    echo "FAIL: unexpected boot-status files \"${exported}\""
+    exit 1
+fi
+if [ "$(${HOSTBIN}/bumstate-bootstat-dump ${ESP}/bootstatus | \
+        grep -c '^nvinfo_NVSize: [0-9]*$')" != "1" ]; then
+    echo "FAIL: nvinfo_NVSize is not decoded"
+    exit 1
+fi
+echo "boot status checked"
+${BIN} ${ESP} ${BENCH_BOOTS} > /dev/null
+
+rm -rf ${ESP} ${HOSTOUT} ${BIN}
@@ -0,0 +1,584 @@
+/* HostEmu.c - Boot services, runtime services, and system table of the
+ *             emulated platform (see HostEmuBoot.h).
+ *
+ *             NOTE:   StartImage and ResetSystem end the process of the
+ *                     running image; the driver learns the outcome from the
+ *                     exit status and the shared memory. A BUM context
+ *                     installed on the started image is carried to the
+ *                     next image run through the shared memory too.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "HostEmu.h"
+#include "HostEmuFile.h"
+#include "HostEmuBoot.h"
+#include "BUMState.h"
+#include "BootTimeline.h"
+#include "BUMContext.h"
+
+#define HOSTEMU_VAR_COUNT       (32)
+#define HOSTEMU_VAR_NAMELEN     (64)
+#define HOSTEMU_VAR_DATASIZE    (16*1024)
+#define HOSTEMU_PATHLEN         (256)
+
+typedef struct {
+    BOOLEAN     InUse;
+    CHAR16      Name[HOSTEMU_VAR_NAMELEN];
+    EFI_GUID    Guid;
+    UINT32      Attributes;
+    UINTN       DataSize;
+    UINT8       Data[HOSTEMU_VAR_DATASIZE];
+} HostEmuVar_t;
+
+/*  State shared between the driver and the image processes */
+typedef struct {
+    HostEmuVar_t    Vars[HOSTEMU_VAR_COUNT];
+    CHAR16          Started[HOSTEMU_PATHLEN];
+    UINT64          PoolAllocations;
+    UINT64          VariableCalls;
+    HostEmuFileStats_t FileStats;
+    BOOLEAN         HasContext;     /* Context was installed on Started */
+    BUM_context_t   Context;
+} HostEmuShared_t;
+
+/*  An image handle points to one of these. One protocol can be installed on
+    it besides the loaded-image protocol. */
+typedef struct {
+    EFI_LOADED_IMAGE_PROTOCOL   LoadedImage;
+    CHAR16                      Path[HOSTEMU_PATHLEN];
+    EFI_GUID                    ProtocolGuid;
+    VOID                        *Protocol;
+} HostEmuImage_t;
+
+static EFI_GUID sgBUMContextProtocolGuid = BUMCONTEXT_PROTOCOL_GUID;
+
+static HostEmuShared_t                  *sgShared = NULL;
+static EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *sgVolume = NULL;
+static UINT8                            sgDevice;   /* only the address is used */
+static EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  sgConOut;
+
+/*  The mapping of this program, from the linker: every image run is this
+    program, so it is the image of each */
+extern UINT8 __executable_start[], _end[];
+
+/*  Exit statuses of the image processes */
+#define HOSTEMU_STATUS_STARTIMAGE   (100)
+#define HOSTEMU_STATUS_RESET        (101)
+#define HOSTEMU_STATUS_RETURNED     (102)
+
+/******************************************************************************/
+/*  Boot services                                                             */
+/******************************************************************************/
+
+static EFI_STATUS EFIAPI HostEmu_allocatePool(  IN  EFI_MEMORY_TYPE PoolType,
+                                                IN  UINTN           Size,
+                                                OUT VOID            **Buffer)
+{
+    sgShared->PoolAllocations++;
+    *Buffer = malloc((0 == Size)? 1 : Size);
+    return (NULL == *Buffer)? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmu_freePool(IN VOID *Buffer)
+{
+    free(Buffer);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmu_handleProtocol(IN  EFI_HANDLE  Handle,
+                                                IN  EFI_GUID    *Protocol,
+                                                OUT VOID        **Interface)
+{
+    HostEmuImage_t *Image;
+    if(NULL == Handle)
+        return EFI_INVALID_PARAMETER;
+    if(&sgDevice == Handle){
+        if(!CompareGuid(Protocol, &gEfiSimpleFileSystemProtocolGuid))
+            return EFI_UNSUPPORTED;
+        *Interface = sgVolume;
+        return EFI_SUCCESS;
+    }
+    Image = (HostEmuImage_t*)Handle;
+    if( (NULL != Image->Protocol) &&
+        CompareGuid(Protocol, &(Image->ProtocolGuid)) ){
+        *Interface = Image->Protocol;
+        return EFI_SUCCESS;
+    }
+    if(!CompareGuid(Protocol, &gEfiLoadedImageProtocolGuid))
+        return EFI_UNSUPPORTED;
+    *Interface = &(Image->LoadedImage);
+    return EFI_SUCCESS;
+}
+
+/*  Only image handles take protocols, one each */
+static EFI_STATUS EFIAPI HostEmu_installProtocolInterface(
+                                    IN OUT  EFI_HANDLE          *Handle,
+                                    IN      EFI_GUID            *Protocol,
+                                    IN      EFI_INTERFACE_TYPE  InterfaceType,
+                                    IN      VOID                *Interface)
+{
+    HostEmuImage_t *Image;
+    if( (NULL == Handle) || (NULL == *Handle) || (&sgDevice == *Handle) ||
+        (NULL == Protocol) || (EFI_NATIVE_INTERFACE != InterfaceType) )
+        return EFI_INVALID_PARAMETER;
+    Image = (HostEmuImage_t*)*Handle;
+    if(NULL != Image->Protocol)
+        return CompareGuid(Protocol, &(Image->ProtocolGuid))?
+                EFI_INVALID_PARAMETER : EFI_OUT_OF_RESOURCES;
+    Image->ProtocolGuid = *Protocol;
+    Image->Protocol     = Interface;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmu_uninstallProtocolInterface(
+                                    IN  EFI_HANDLE  Handle,
+                                    IN  EFI_GUID    *Protocol,
+                                    IN  VOID        *Interface)
+{
+    HostEmuImage_t *Image = (HostEmuImage_t*)Handle;
+    if( (NULL == Image) || (&sgDevice == Handle) || (NULL == Protocol) )
+        return EFI_INVALID_PARAMETER;
+    if( (NULL == Image->Protocol) || (Interface != Image->Protocol) ||
+        !CompareGuid(Protocol, &(Image->ProtocolGuid)) )
+        return EFI_NOT_FOUND;
+    Image->Protocol = NULL;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmu_openProtocol(  IN  EFI_HANDLE  Handle,
+                                                IN  EFI_GUID    *Protocol,
+                                                OUT VOID        **Interface,
+                                                IN  EFI_HANDLE  AgentHandle,
+                                                IN  EFI_HANDLE  ControllerHandle,
+                                                IN  UINT32      Attributes)
+{
+    return HostEmu_handleProtocol(Handle, Protocol, Interface);
+}
+
+static EFI_STATUS EFIAPI HostEmu_closeProtocol( IN  EFI_HANDLE  Handle,
+                                                IN  EFI_GUID    *Protocol,
+                                                IN  EFI_HANDLE  AgentHandle,
+                                                IN  EFI_HANDLE  ControllerHandle)
+{
+    return EFI_SUCCESS;
+}
+
+/*  There is no SMBIOS table on the emulated platform */
+static EFI_STATUS EFIAPI HostEmu_locateProtocol(IN  EFI_GUID    *Protocol,
+                                                IN  VOID        *Registration,
+                                                OUT VOID        **Interface)
+{
+    return EFI_NOT_FOUND;
+}
+
+/*  The volume is a host directory: there are no block devices */
+static EFI_STATUS EFIAPI HostEmu_locateHandleBuffer(
+                                    IN  EFI_LOCATE_SEARCH_TYPE  SearchType,
+                                    IN  EFI_GUID                *Protocol,
+                                    IN  VOID                    *SearchKey,
+                                    OUT UINTN                   *NoHandles,
+                                    OUT EFI_HANDLE              **Buffer)
+{
+    return EFI_NOT_FOUND;
+}
+
+static HostEmuImage_t *HostEmu_newImage(IN CONST CHAR16 *Path,
+                                        IN EFI_HANDLE   Parent)
+{
+    HostEmuImage_t *Image;
+    if(StrLen(Path) >= HOSTEMU_PATHLEN)
+        return NULL;
+    Image = calloc(1, sizeof(*Image));
+    if(NULL == Image)
+        return NULL;
+    memcpy(Image->Path, Path, (StrLen(Path) + 1) * sizeof(CHAR16));
+    Image->LoadedImage.Revision     = 0x1000;
+    Image->LoadedImage.ParentHandle = Parent;
+    Image->LoadedImage.SystemTable  = gST;
+    Image->LoadedImage.DeviceHandle = &sgDevice;
+    Image->LoadedImage.FilePath     = FileDevicePath(NULL, Path);
+    Image->LoadedImage.ImageCodeType = EfiLoaderCode;
+    Image->LoadedImage.ImageDataType = EfiLoaderData;
+    return Image;
+}
+
+/*  Only file paths on the system partition can be loaded. Nothing is
+    executed: the driver decides what a started image does. */
+static EFI_STATUS EFIAPI HostEmu_loadImage(
+                                    IN  BOOLEAN                     BootPolicy,
+                                    IN  EFI_HANDLE                  Parent,
+                                    IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath,
+                                    IN  VOID                        *SourceBuffer,
+                                    IN  UINTN                       SourceSize,
+                                    OUT EFI_HANDLE                  *ImageHandle)
+{
+    FILEPATH_DEVICE_PATH *FilePath = (FILEPATH_DEVICE_PATH*)DevicePath;
+    HostEmuImage_t *Image;
+    struct stat st;
+    char *HostPath;
+    if( (NULL == DevicePath) || (MEDIA_DEVICE_PATH != DevicePath->Type) ||
+        (MEDIA_FILEPATH_DP != DevicePath->SubType) )
+        return EFI_UNSUPPORTED;
+    HostPath = HostEmuFile_hostPath(sgVolume, FilePath->PathName);
+    if(NULL == HostPath)
+        return EFI_OUT_OF_RESOURCES;
+    if( (0 != stat(HostPath, &st)) || !S_ISREG(st.st_mode) ){
+        free(HostPath);
+        return EFI_NOT_FOUND;
+    }
+    free(HostPath);
+    Image = HostEmu_newImage(FilePath->PathName, Parent);
+    if(NULL == Image)
+        return EFI_OUT_OF_RESOURCES;
+    Image->LoadedImage.ImageSize = (UINT64)st.st_size;
+    *ImageHandle = Image;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmu_startImage(IN  EFI_HANDLE  ImageHandle,
+                                            OUT UINTN       *ExitDataSize,
+                                            OUT CHAR16      **ExitData)
+{
+    HostEmuImage_t *Image = (HostEmuImage_t*)ImageHandle;
+    if(NULL == Image)
+        return EFI_INVALID_PARAMETER;
+    memcpy(sgShared->Started, Image->Path, sizeof(sgShared->Started));
+    if( (NULL != Image->Protocol) &&
+        CompareGuid(&(Image->ProtocolGuid), &sgBUMContextProtocolGuid) ){
+        memcpy(&(sgShared->Context), Image->Protocol, sizeof(BUM_context_t));
+        sgShared->HasContext = TRUE;
+    }
+    fflush(stdout);
+    _exit(HOSTEMU_STATUS_STARTIMAGE);
+}
+
+static EFI_STATUS EFIAPI HostEmu_unloadImage(IN EFI_HANDLE ImageHandle)
+{
+    free(((HostEmuImage_t*)ImageHandle)->LoadedImage.FilePath);
+    free(ImageHandle);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmu_stall(IN UINTN Microseconds)
+{
+    return EFI_SUCCESS;
+}
+
+/*  Services not used by the loader are left NULL */
+static EFI_BOOT_SERVICES sgBootServices = {
+    .AllocatePool   = HostEmu_allocatePool,
+    .FreePool       = HostEmu_freePool,
+    .HandleProtocol = HostEmu_handleProtocol,
+    .InstallProtocolInterface   = HostEmu_installProtocolInterface,
+    .UninstallProtocolInterface = HostEmu_uninstallProtocolInterface,
+    .LoadImage      = HostEmu_loadImage,
+    .StartImage     = HostEmu_startImage,
+    .UnloadImage    = HostEmu_unloadImage,
+    .Stall          = HostEmu_stall,
+    .OpenProtocol   = HostEmu_openProtocol,
+    .CloseProtocol  = HostEmu_closeProtocol,
+    .LocateHandleBuffer = HostEmu_locateHandleBuffer,
+    .LocateProtocol = HostEmu_locateProtocol,
+};
+
+/******************************************************************************/
+/*  Runtime services                                                          */
+/******************************************************************************/
+
+static EFI_STATUS EFIAPI HostEmu_getTime(   OUT EFI_TIME                *Time,
+                                            OUT EFI_TIME_CAPABILITIES   *Caps)
+{
+    struct timespec ts;
+    struct tm tm;
+    if(NULL == Time)
+        return EFI_INVALID_PARAMETER;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    localtime_r(&(ts.tv_sec), &tm);
+    ZeroMem(Time, sizeof(*Time));
+    Time->Year          = (UINT16)(tm.tm_year + 1900);
+    Time->Month         = (UINT8)(tm.tm_mon + 1);
+    Time->Day           = (UINT8)tm.tm_mday;
+    Time->Hour          = (UINT8)tm.tm_hour;
+    Time->Minute        = (UINT8)tm.tm_min;
+    Time->Second        = (UINT8)tm.tm_sec;
+    Time->Nanosecond    = (UINT32)ts.tv_nsec;
+    Time->TimeZone      = 0x07FF;   /* EFI_UNSPECIFIED_TIMEZONE */
+    if(NULL != Caps){
+        Caps->Resolution    = 1;
+        Caps->Accuracy      = 50000000;
+        Caps->SetsToZero    = FALSE;
+    }
+    return EFI_SUCCESS;
+}
+
+static HostEmuVar_t *HostEmu_findVar(   IN CONST CHAR16     *Name,
+                                        IN CONST EFI_GUID   *Guid)
+{
+    UINTN i;
+    for(i = 0; i < HOSTEMU_VAR_COUNT; i++){
+        if( sgShared->Vars[i].InUse &&
+            CompareGuid(&(sgShared->Vars[i].Guid), Guid) &&
+            (0 == StrCmp(sgShared->Vars[i].Name, Name)) )
+            return &(sgShared->Vars[i]);
+    }
+    return NULL;
+}
+
+static EFI_STATUS EFIAPI HostEmu_getVariable(   IN  CHAR16      *VariableName,
+                                                IN  EFI_GUID    *VendorGuid,
+                                                OUT UINT32      *Attributes,
+                                                IN OUT UINTN    *DataSize,
+                                                OUT VOID        *Data)
+{
+    HostEmuVar_t *Var;
+    sgShared->VariableCalls++;
+    if( (NULL == VariableName) || (NULL == VendorGuid) || (NULL == DataSize) )
+        return EFI_INVALID_PARAMETER;
+    Var = HostEmu_findVar(VariableName, VendorGuid);
+    if(NULL == Var)
+        return EFI_NOT_FOUND;
+    if(*DataSize < Var->DataSize){
+        *DataSize = Var->DataSize;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    if(NULL == Data)
+        return EFI_INVALID_PARAMETER;
+    memcpy(Data, Var->Data, Var->DataSize);
+    *DataSize = Var->DataSize;
+    if(NULL != Attributes)
+        *Attributes = Var->Attributes;
+    return EFI_SUCCESS;
+}
+
+/*  Authenticated writes are not emulated: they are stored as is. */
+static EFI_STATUS EFIAPI HostEmu_setVariable(   IN  CHAR16      *VariableName,
+                                                IN  EFI_GUID    *VendorGuid,
+                                                IN  UINT32      Attributes,
+                                                IN  UINTN       DataSize,
+                                                IN  VOID        *Data)
+{
+    HostEmuVar_t *Var;
+    UINTN i;
+    sgShared->VariableCalls++;
+    if( (NULL == VariableName) || (NULL == VendorGuid) )
+        return EFI_INVALID_PARAMETER;
+    if(StrLen(VariableName) >= HOSTEMU_VAR_NAMELEN)
+        return EFI_INVALID_PARAMETER;
+    Var = HostEmu_findVar(VariableName, VendorGuid);
+    /*  Delete */
+    if( (0 == DataSize) || (0 == Attributes) ){
+        if(NULL == Var)
+            return EFI_NOT_FOUND;
+        Var->InUse = FALSE;
+        return EFI_SUCCESS;
+    }
+    if(DataSize > HOSTEMU_VAR_DATASIZE)
+        return EFI_OUT_OF_RESOURCES;
+    if(NULL == Var){
+        for(i = 0; (i < HOSTEMU_VAR_COUNT) && sgShared->Vars[i].InUse; i++);
+        if(HOSTEMU_VAR_COUNT == i)
+            return EFI_OUT_OF_RESOURCES;
+        Var = &(sgShared->Vars[i]);
+        ZeroMem(Var->Name, sizeof(Var->Name));
+        memcpy(Var->Name, VariableName, StrLen(VariableName) * sizeof(CHAR16));
+        Var->Guid = *VendorGuid;
+    }else if((Var->Attributes ^ Attributes) & EFI_VARIABLE_NON_VOLATILE)
+        return EFI_INVALID_PARAMETER;
+    Var->Attributes = Attributes;
+    Var->DataSize   = DataSize;
+    memcpy(Var->Data, Data, DataSize);
+    Var->InUse      = TRUE;
+    return EFI_SUCCESS;
+}
+
+static VOID EFIAPI HostEmu_resetSystem( IN  EFI_RESET_TYPE  ResetType,
+                                        IN  EFI_STATUS      ResetStatus,
+                                        IN  UINTN           DataSize,
+                                        IN  VOID            *ResetData)
+{
+    fflush(stdout);
+    _exit(HOSTEMU_STATUS_RESET);
+}
+
+static EFI_STATUS EFIAPI HostEmu_queryVariableInfo(
+                                    IN  UINT32  Attributes,
+                                    OUT UINT64  *MaximumVariableStorageSize,
+                                    OUT UINT64  *RemainingVariableStorageSize,
+                                    OUT UINT64  *MaximumVariableSize)
+{
+    UINTN i, Free = 0;
+    for(i = 0; i < HOSTEMU_VAR_COUNT; i++){
+        if(!sgShared->Vars[i].InUse)
+            Free++;
+    }
+    *MaximumVariableStorageSize     = HOSTEMU_VAR_COUNT * HOSTEMU_VAR_DATASIZE;
+    *RemainingVariableStorageSize   = Free * HOSTEMU_VAR_DATASIZE;
+    *MaximumVariableSize            = HOSTEMU_VAR_DATASIZE;
+    return EFI_SUCCESS;
+}
+
+static EFI_RUNTIME_SERVICES sgRuntimeServices = {
+    .GetTime            = HostEmu_getTime,
+    .GetVariable        = HostEmu_getVariable,
+    .SetVariable        = HostEmu_setVariable,
+    .ResetSystem        = HostEmu_resetSystem,
+    .QueryVariableInfo  = HostEmu_queryVariableInfo,
+};
+
+/******************************************************************************/
+/*  System table and platform control                                         */
+/******************************************************************************/
+
+static EFI_SYSTEM_TABLE sgSystemTable = {
+    .ConOut             = NULL,
+    .RuntimeServices    = &sgRuntimeServices,
+    .BootServices       = &sgBootServices,
+};
+
+EFI_SYSTEM_TABLE        *gST = &sgSystemTable;
+EFI_BOOT_SERVICES       *gBS = &sgBootServices;
+EFI_RUNTIME_SERVICES    *gRT = &sgRuntimeServices;
+EFI_HANDLE              gImageHandle = NULL;
+
+EFI_STATUS EFIAPI HostEmu_init(IN CONST char *EspDir, IN BOOLEAN Verbose)
+{
+    sgShared = mmap(NULL, sizeof(*sgShared), PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(MAP_FAILED == sgShared){
+        sgShared = NULL;
+        return EFI_OUT_OF_RESOURCES;
+    }
+    sgVolume = HostEmuFile_volume(EspDir, &(sgShared->FileStats));
+    if(NULL == sgVolume){
+        munmap(sgShared, sizeof(*sgShared));
+        sgShared = NULL;
+        return EFI_OUT_OF_RESOURCES;
+    }
+    sgSystemTable.ConOut = Verbose? &sgConOut : NULL;
+    return EFI_SUCCESS;
+}
+
+VOID EFIAPI HostEmu_powerCycle(VOID)
+{
+    UINTN i;
+    for(i = 0; i < HOSTEMU_VAR_COUNT; i++){
+        if(!(sgShared->Vars[i].Attributes & EFI_VARIABLE_NON_VOLATILE))
+            sgShared->Vars[i].InUse = FALSE;
+    }
+    sgShared->HasContext = FALSE;
+}
+
+HOSTEMU_EXIT_TYPE EFIAPI HostEmu_runImage(  IN  CONST CHAR16        *ImagePath,
+                                            IN  HOSTEMU_IMAGE_ENTRY Entry,
+                                            OUT CHAR16              *Started,
+                                            IN  UINTN               StartedSize)
+{
+    HostEmuImage_t *Image;
+    pid_t pid;
+    int wstatus;
+    BOOLEAN HasContext = sgShared->HasContext;
+    BUM_context_t Context = sgShared->Context;
+    /*  The context of the last started image goes to this one */
+    sgShared->HasContext = FALSE;
+    ZeroMem(sgShared->Started, sizeof(sgShared->Started));
+    fflush(stdout);
+    pid = fork();
+    if(0 > pid)
+        return HOSTEMU_EXIT_CRASHED;
+    if(0 == pid){
+        Image = HostEmu_newImage(ImagePath, NULL);
+        if(NULL == Image)
+            _exit(1);
+        Image->LoadedImage.ImageBase = __executable_start;
+        Image->LoadedImage.ImageSize = (UINT64)(_end - __executable_start);
+        if(HasContext){
+            Image->ProtocolGuid = sgBUMContextProtocolGuid;
+            Image->Protocol     = &Context;
+        }
+        gImageHandle = Image;
+        Entry(Image, gST);
+        fflush(stdout);
+        _exit(HOSTEMU_STATUS_RETURNED);
+    }
+    if( (pid != waitpid(pid, &wstatus, 0)) || !WIFEXITED(wstatus) )
+        return HOSTEMU_EXIT_CRASHED;
+    switch(WEXITSTATUS(wstatus)){
+        case HOSTEMU_STATUS_STARTIMAGE:
+            if(NULL != Started){
+                ZeroMem(Started, StartedSize * sizeof(CHAR16));
+                memcpy( Started, sgShared->Started,
+                        MIN(StartedSize - 1, StrLen(sgShared->Started)) *
+                            sizeof(CHAR16));
+            }
+            return HOSTEMU_EXIT_STARTIMAGE;
+        case HOSTEMU_STATUS_RESET:
+            return HOSTEMU_EXIT_RESET;
+        case HOSTEMU_STATUS_RETURNED:
+            return HOSTEMU_EXIT_RETURNED;
+        default:
+            return HOSTEMU_EXIT_CRASHED;
+    }
+}
+
+EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* EFIAPI HostEmu_volume(VOID)
+{
+    return sgVolume;
+}
+
+EFI_HANDLE EFIAPI HostEmu_deviceHandle(VOID)
+{
+    return &sgDevice;
+}
+
+VOID* EFIAPI HostEmu_imageBase(VOID)
+{
+    return __executable_start;
+}
+
+UINT64 EFIAPI HostEmu_poolAllocations(VOID)
+{
+    return sgShared->PoolAllocations;
+}
+
+UINT64 EFIAPI HostEmu_variableCalls(VOID)
+{
+    return sgShared->VariableCalls;
+}
+
+EFI_STATUS EFIAPI HostEmu_startedProtocol(  IN  EFI_GUID    *Protocol,
+                                            OUT VOID        **Interface)
+{
+    if( !sgShared->HasContext ||
+        !CompareGuid(Protocol, &sgBUMContextProtocolGuid) )
+        return EFI_NOT_FOUND;
+    *Interface = &(sgShared->Context);
+    return EFI_SUCCESS;
+}
+
+VOID EFIAPI HostEmu_dropStartedProtocol(VOID)
+{
+    sgShared->HasContext = FALSE;
+}
+
+UINT64 EFIAPI HostEmu_fileOpens(VOID)
+{
+    return sgShared->FileStats.Opens;
+}
+
+UINT64 EFIAPI HostEmu_fileLookups(VOID)
+{
+    return sgShared->FileStats.Lookups;
+}
+
+UINT64 EFIAPI HostEmu_sectorWrites(VOID)
+{
+    return sgShared->FileStats.SectorWrites;
+}
@@ -0,0 +1,76 @@
+/* HostEmuBoot.h - Control of the emulated platform: power cycles and the
+ *                 running of images (see HostEmu.c).
+ *
+ *                 Every image runs in a child process forked from the driver,
+ *                 so each image starts with fresh static data as it would on
+ *                 the firmware. The variable store is shared with the
+ *                 children, and the file system is a host directory. The
+ *                 BUM context installed on a started image is handed to the
+ *                 image run next, unless the platform is power-cycled.
+ */
+
+#ifndef __HOST_EMU_BOOT__
+#define __HOST_EMU_BOOT__
+
+/*  How a run of an image ended */
+typedef enum {
+    HOSTEMU_EXIT_STARTIMAGE = 1,    /* the image started another image */
+    HOSTEMU_EXIT_RESET,             /* the image reset the system */
+    HOSTEMU_EXIT_RETURNED,          /* the entry point returned */
+    HOSTEMU_EXIT_CRASHED,           /* the image process died */
+} HOSTEMU_EXIT_TYPE;
+
+typedef EFI_STATUS (EFIAPI *HOSTEMU_IMAGE_ENTRY)(   IN EFI_HANDLE       Image,
+                                                    IN EFI_SYSTEM_TABLE *ST);
+
+/*  Sets up the emulated platform with the EFI system partition at EspDir.
+    Output of the images goes to the console if Verbose is set. */
+EFI_STATUS EFIAPI HostEmu_init(IN CONST char *EspDir, IN BOOLEAN Verbose);
+
+/*  Clears the volatile variables, as a power cycle would */
+VOID EFIAPI HostEmu_powerCycle(VOID);
+
+/*  Runs Entry as the image at the UEFI path ImagePath of the system
+    partition. If the image starts another image, the UEFI path of the
+    started image is returned in Started (of StartedSize characters). */
+HOSTEMU_EXIT_TYPE EFIAPI HostEmu_runImage(  IN  CONST CHAR16        *ImagePath,
+                                            IN  HOSTEMU_IMAGE_ENTRY Entry,
+                                            OUT CHAR16              *Started,
+                                            IN  UINTN               StartedSize);
+
+/*  Returns the file-system protocol of the system partition */
+EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* EFIAPI HostEmu_volume(VOID);
+
+/*  Returns the handle of the device holding the system partition */
+EFI_HANDLE EFIAPI HostEmu_deviceHandle(VOID);
+
+/*  Returns the image base of every image run: they are all this program */
+VOID* EFIAPI HostEmu_imageBase(VOID);
+
+/*  Returns the number of AllocatePool calls made by all images so far */
+UINT64 EFIAPI HostEmu_poolAllocations(VOID);
+
+/*  Returns the number of GetVariable and SetVariable calls made by all
+    images so far */
+UINT64 EFIAPI HostEmu_variableCalls(VOID);
+
+/*  Returns the interface of Protocol installed on the image started by the
+    last image run, if it is carried to the next image (only the BUM context
+    is) */
+EFI_STATUS EFIAPI HostEmu_startedProtocol(  IN  EFI_GUID    *Protocol,
+                                            OUT VOID        **Interface);
+
+/*  Drops the BUM context to be handed to the image run next, as an image
+    older than the context would neither have read nor installed it */
+VOID EFIAPI HostEmu_dropStartedProtocol(VOID);
+
+/*  Returns the number of file Open calls made by all images so far, and the
+    number of directory entries they looked up */
+UINT64 EFIAPI HostEmu_fileOpens(VOID);
+UINT64 EFIAPI HostEmu_fileLookups(VOID);
+
+/*  Returns the number of sectors a FAT driver would have written for the
+    file operations of all images so far */
+UINT64 EFIAPI HostEmu_sectorWrites(VOID);
+
+#endif
@@ -0,0 +1,539 @@
+/* HostEmuFile.c - EFI_FILE_PROTOCOL backed by a host directory tree. UEFI
+ *                 paths ('\' separated, absolute or relative to the opening
+ *                 directory) are mapped below the root directory of the
+ *                 volume. Flush does not sync: the emulation is for
+ *                 exercising the loader logic, not for durability.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "HostEmu.h"
+#include "HostEmuFile.h"
+
+typedef struct {
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL Protocol;   /* must be first */
+    char                            *RootDir;
+    HostEmuFileStats_t              *Stats;
+} HostEmuVolume_t;
+
+typedef struct {
+    EFI_FILE_PROTOCOL   Protocol;   /* must be first */
+    HostEmuVolume_t     *Volume;
+    char                *Path;      /* relative to the root, "" for the root */
+    int                 Fd;         /* -1 for directories */
+    DIR                 *Dir;
+    UINT64              Position;
+    UINT64              OpenMode;
+    BOOLEAN             Dirty;      /* directory entry to be written */
+} HostEmuFile_t;
+
+static EFI_FILE_PROTOCOL sgFileProtocol;
+
+/******************************************************************************/
+/*  Sector writes                                                             */
+/******************************************************************************/
+
+/*  Sector writes are counted as a FAT driver would issue them: the data
+    sectors a write covers, both FAT copies whenever a file gains or loses a
+    cluster, and the directory entry of a created, written or resized file
+    when it is flushed or closed. */
+#define HOSTEMU_SECTOR_SIZE     (512)
+#define HOSTEMU_CLUSTER_SIZE    (4096)
+#define HOSTEMU_FAT_COPIES      (2)
+
+static VOID HostEmuFile_countResize(IN  HostEmuFile_t   *File,
+                                    IN  UINT64          OldSize,
+                                    IN  UINT64          NewSize)
+{
+    if( (OldSize + HOSTEMU_CLUSTER_SIZE - 1) / HOSTEMU_CLUSTER_SIZE !=
+        (NewSize + HOSTEMU_CLUSTER_SIZE - 1) / HOSTEMU_CLUSTER_SIZE )
+        File->Volume->Stats->SectorWrites += HOSTEMU_FAT_COPIES;
+    if(OldSize != NewSize)
+        File->Dirty = TRUE;
+}
+
+static VOID HostEmuFile_countFlush(IN  HostEmuFile_t   *File)
+{
+    if(File->Dirty)
+        File->Volume->Stats->SectorWrites++;
+    File->Dirty = FALSE;
+}
+
+/******************************************************************************/
+/*  Paths                                                                     */
+/******************************************************************************/
+
+/*  Resolves Name against the directory Base (relative to the root) into a
+    normalized relative path: no empty, "." or ".." components. */
+static char *HostEmuFile_resolve(   IN CONST char   *Base,
+                                    IN CONST CHAR16 *Name)
+{
+    UINTN NameLen = StrLen(Name), BaseLen = strlen(Base), i, j;
+    char *Path, *Component, *Save, *Out;
+    Path = malloc(BaseLen + 1 + NameLen + 1);
+    Out = malloc(BaseLen + 1 + NameLen + 1);
+    if((NULL == Path) || (NULL == Out)){
+        free(Path);
+        free(Out);
+        return NULL;
+    }
+    /*  Absolute names start at the root */
+    if(L'\\' == Name[0])
+        j = 0;
+    else{
+        memcpy(Path, Base, BaseLen);
+        j = BaseLen;
+    }
+    Path[j++] = '/';
+    for(i = 0; i < NameLen; i++)
+        Path[j++] = (L'\\' == Name[i])? '/' : (char)Name[i];
+    Path[j] = '\0';
+    /*  Normalize */
+    Out[0] = '\0';
+    j = 0;
+    for(Component = strtok_r(Path, "/", &Save); NULL != Component;
+        Component = strtok_r(NULL, "/", &Save)){
+        if(0 == strcmp(Component, "."))
+            continue;
+        if(0 == strcmp(Component, "..")){
+            while((j > 0) && ('/' != Out[j - 1]))
+                j--;
+            if(j > 0)
+                j--;
+            Out[j] = '\0';
+            continue;
+        }
+        if(j > 0)
+            Out[j++] = '/';
+        strcpy(&(Out[j]), Component);
+        j += strlen(Component);
+    }
+    free(Path);
+    return Out;
+}
+
+static char *HostEmuFile_joinRoot(  IN HostEmuVolume_t  *Volume,
+                                    IN CONST char       *Path)
+{
+    char *HostPath;
+    if(0 > asprintf(&HostPath, "%s/%s", Volume->RootDir, Path))
+        return NULL;
+    return HostPath;
+}
+
+char* EFIAPI HostEmuFile_hostPath(  IN EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *Volume,
+                                    IN CONST CHAR16 *Path)
+{
+    char *Relative, *HostPath;
+    Relative = HostEmuFile_resolve("", Path);
+    if(NULL == Relative)
+        return NULL;
+    HostPath = HostEmuFile_joinRoot((HostEmuVolume_t*)Volume, Relative);
+    free(Relative);
+    return HostPath;
+}
+
+static EFI_STATUS HostEmuFile_errnoStatus(int err)
+{
+    switch(err){
+        case ENOENT:
+        case ENOTDIR:
+            return EFI_NOT_FOUND;
+        case EACCES:
+        case EPERM:
+            return EFI_ACCESS_DENIED;
+        case EROFS:
+            return EFI_WRITE_PROTECTED;
+        case ENOSPC:
+            return EFI_VOLUME_FULL;
+        case ENOMEM:
+            return EFI_OUT_OF_RESOURCES;
+        default:
+            return EFI_DEVICE_ERROR;
+    }
+}
+
+/******************************************************************************/
+/*  EFI_FILE_PROTOCOL                                                         */
+/******************************************************************************/
+
+static EFI_STATUS EFIAPI HostEmuFile_new(   IN  HostEmuVolume_t     *Volume,
+                                            IN  char                *Path,
+                                            IN  UINT64              OpenMode,
+                                            IN  UINT64              Attributes,
+                                            OUT EFI_FILE_PROTOCOL   **NewHandle)
+{
+    EFI_STATUS Status;
+    HostEmuFile_t *File;
+    char *HostPath;
+    struct stat st;
+    int flags;
+    File = calloc(1, sizeof(*File));
+    HostPath = HostEmuFile_joinRoot(Volume, Path);
+    if((NULL == File) || (NULL == HostPath)){
+        Status = EFI_OUT_OF_RESOURCES;
+        goto exit0;
+    }
+    File->Protocol  = sgFileProtocol;
+    File->Volume    = Volume;
+    File->Path      = Path;
+    File->Fd        = -1;
+    File->OpenMode  = OpenMode;
+    if(0 != stat(HostPath, &st)){
+        if( (ENOENT != errno) || (0 == (OpenMode & EFI_FILE_MODE_CREATE)) ){
+            Status = HostEmuFile_errnoStatus(errno);
+            goto exit0;
+        }
+        if(Attributes & EFI_FILE_DIRECTORY){
+            if(0 != mkdir(HostPath, 0755)){
+                Status = HostEmuFile_errnoStatus(errno);
+                goto exit0;
+            }
+        }else{
+            File->Fd = open(HostPath, O_RDWR | O_CREAT | O_EXCL, 0644);
+            if(0 > File->Fd){
+                Status = HostEmuFile_errnoStatus(errno);
+                goto exit0;
+            }
+        }
+        File->Dirty = TRUE;
+        if(0 != stat(HostPath, &st)){
+            Status = HostEmuFile_errnoStatus(errno);
+            goto exit0;
+        }
+    }
+    if(S_ISDIR(st.st_mode)){
+        File->Dir = opendir(HostPath);
+        if(NULL == File->Dir){
+            Status = HostEmuFile_errnoStatus(errno);
+            goto exit0;
+        }
+    }else if(0 > File->Fd){
+        flags = (OpenMode & EFI_FILE_MODE_WRITE)? O_RDWR : O_RDONLY;
+        File->Fd = open(HostPath, flags);
+        if(0 > File->Fd){
+            Status = HostEmuFile_errnoStatus(errno);
+            goto exit0;
+        }
+    }
+    free(HostPath);
+    *NewHandle = &(File->Protocol);
+    return EFI_SUCCESS;
+exit0:
+    free(HostPath);
+    free(File);
+    free(Path);
+    return Status;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_open(  IN  EFI_FILE_PROTOCOL   *This,
+                                            OUT EFI_FILE_PROTOCOL   **NewHandle,
+                                            IN  CHAR16              *FileName,
+                                            IN  UINT64              OpenMode,
+                                            IN  UINT64              Attributes)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    char *Path;
+    UINTN i;
+    if((NULL == NewHandle) || (NULL == FileName))
+        return EFI_INVALID_PARAMETER;
+    File->Volume->Stats->Opens++;
+    for(i = 0; L'\0' != FileName[i]; i++)
+        if( (L'\\' != FileName[i]) &&
+            ((0 == i) || (L'\\' == FileName[i - 1])) )
+            File->Volume->Stats->Lookups++;
+    if( (OpenMode & EFI_FILE_MODE_CREATE) &&
+        !(OpenMode & EFI_FILE_MODE_WRITE) )
+        return EFI_INVALID_PARAMETER;
+    Path = HostEmuFile_resolve(File->Path, FileName);
+    if(NULL == Path)
+        return EFI_OUT_OF_RESOURCES;
+    return HostEmuFile_new(File->Volume, Path, OpenMode, Attributes, NewHandle);
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_close(IN EFI_FILE_PROTOCOL *This)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    HostEmuFile_countFlush(File);
+    if(0 <= File->Fd)
+        close(File->Fd);
+    if(NULL != File->Dir)
+        closedir(File->Dir);
+    free(File->Path);
+    free(File);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_delete(IN EFI_FILE_PROTOCOL *This)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    char *HostPath;
+    int ret = -1;
+    HostPath = HostEmuFile_joinRoot(File->Volume, File->Path);
+    if(NULL != HostPath){
+        ret = (NULL != File->Dir)? rmdir(HostPath) : unlink(HostPath);
+        free(HostPath);
+    }
+    HostEmuFile_close(This);
+    return (0 == ret)? EFI_SUCCESS : EFI_WARN_DELETE_FAILURE;
+}
+
+/*  Fills Info for the file at HostPath named Name. Returns the size needed. */
+static UINTN HostEmuFile_fillInfo(  IN  CONST char      *HostPath,
+                                    IN  CONST char      *Name,
+                                    OUT EFI_FILE_INFO   *Info,
+                                    IN  UINTN           InfoSize)
+{
+    struct stat st;
+    struct tm tm;
+    UINTN NameLen = strlen(Name), Size, i;
+    Size = SIZE_OF_EFI_FILE_INFO + (NameLen + 1) * sizeof(CHAR16);
+    if((NULL == Info) || (InfoSize < Size))
+        return Size;
+    ZeroMem(Info, Size);
+    Info->Size = Size;
+    if(0 == stat(HostPath, &st)){
+        Info->FileSize      = S_ISDIR(st.st_mode)? 0 : (UINT64)st.st_size;
+        Info->PhysicalSize  = (UINT64)st.st_blocks * 512;
+        Info->Attribute     = S_ISDIR(st.st_mode)? EFI_FILE_DIRECTORY :
+                                                   EFI_FILE_ARCHIVE;
+        gmtime_r(&st.st_mtime, &tm);
+        Info->ModificationTime.Year     = (UINT16)(tm.tm_year + 1900);
+        Info->ModificationTime.Month    = (UINT8)(tm.tm_mon + 1);
+        Info->ModificationTime.Day      = (UINT8)tm.tm_mday;
+        Info->ModificationTime.Hour     = (UINT8)tm.tm_hour;
+        Info->ModificationTime.Minute   = (UINT8)tm.tm_min;
+        Info->ModificationTime.Second   = (UINT8)tm.tm_sec;
+        Info->CreateTime = Info->LastAccessTime = Info->ModificationTime;
+    }
+    for(i = 0; i <= NameLen; i++)
+        Info->FileName[i] = (CHAR16)(UINT8)Name[i];
+    return Size;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_readDir(   IN  HostEmuFile_t   *File,
+                                                IN OUT UINTN        *BufferSize,
+                                                OUT VOID            *Buffer)
+{
+    struct dirent *Entry;
+    long Location;
+    char *HostPath;
+    UINTN Needed;
+    do{
+        Location = telldir(File->Dir);
+        Entry = readdir(File->Dir);
+    }while( (NULL != Entry) && ( (0 == strcmp(Entry->d_name, ".")) ||
+                                 (0 == strcmp(Entry->d_name, "..")) ) );
+    if(NULL == Entry){
+        *BufferSize = 0;
+        return EFI_SUCCESS;
+    }
+    if(0 > asprintf(&HostPath, "%s/%s/%s", File->Volume->RootDir,
+                                            File->Path, Entry->d_name))
+        return EFI_OUT_OF_RESOURCES;
+    Needed = HostEmuFile_fillInfo(  HostPath, Entry->d_name,
+                                    (EFI_FILE_INFO*)Buffer, *BufferSize);
+    free(HostPath);
+    if(Needed > *BufferSize){
+        /*  The entry is returned again by the next read */
+        seekdir(File->Dir, Location);
+        *BufferSize = Needed;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    *BufferSize = Needed;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_read(  IN  EFI_FILE_PROTOCOL   *This,
+                                            IN OUT UINTN            *BufferSize,
+                                            OUT VOID                *Buffer)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    ssize_t ret;
+    if(NULL != File->Dir)
+        return HostEmuFile_readDir(File, BufferSize, Buffer);
+    ret = pread(File->Fd, Buffer, *BufferSize, (off_t)File->Position);
+    if(0 > ret)
+        return EFI_DEVICE_ERROR;
+    File->Position += (UINT64)ret;
+    *BufferSize = (UINTN)ret;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_write( IN  EFI_FILE_PROTOCOL   *This,
+                                            IN OUT UINTN            *BufferSize,
+                                            IN  VOID                *Buffer)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    ssize_t ret;
+    struct stat st;
+    if(NULL != File->Dir)
+        return EFI_UNSUPPORTED;
+    if(!(File->OpenMode & EFI_FILE_MODE_WRITE))
+        return EFI_ACCESS_DENIED;
+    if(0 != fstat(File->Fd, &st))
+        return EFI_DEVICE_ERROR;
+    ret = pwrite(File->Fd, Buffer, *BufferSize, (off_t)File->Position);
+    if(0 > ret){
+        *BufferSize = 0;
+        return HostEmuFile_errnoStatus(errno);
+    }
+    if(0 < ret){
+        File->Volume->Stats->SectorWrites +=
+            (File->Position + (UINT64)ret - 1) / HOSTEMU_SECTOR_SIZE -
+            File->Position / HOSTEMU_SECTOR_SIZE + 1;
+        HostEmuFile_countResize(File, (UINT64)st.st_size,
+                                MAX((UINT64)st.st_size,
+                                    File->Position + (UINT64)ret));
+        File->Dirty = TRUE;
+    }
+    File->Position += (UINT64)ret;
+    *BufferSize = (UINTN)ret;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_getPosition(   IN  EFI_FILE_PROTOCOL *This,
+                                                    OUT UINT64  *Position)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    if(NULL != File->Dir)
+        return EFI_UNSUPPORTED;
+    *Position = File->Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_setPosition(   IN  EFI_FILE_PROTOCOL *This,
+                                                    IN  UINT64  Position)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    struct stat st;
+    if(NULL != File->Dir){
+        /*  Directories can only be rewound */
+        if(0 != Position)
+            return EFI_UNSUPPORTED;
+        rewinddir(File->Dir);
+        return EFI_SUCCESS;
+    }
+    if(MAX_UINT64 == Position){
+        if(0 != fstat(File->Fd, &st))
+            return EFI_DEVICE_ERROR;
+        Position = (UINT64)st.st_size;
+    }
+    File->Position = Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_getInfo(   IN  EFI_FILE_PROTOCOL   *This,
+                                                IN  EFI_GUID    *InformationType,
+                                                IN OUT UINTN    *BufferSize,
+                                                OUT VOID        *Buffer)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    CONST char *Name;
+    char *HostPath;
+    UINTN Needed;
+    if(!CompareGuid(InformationType, &gEfiFileInfoGuid))
+        return EFI_UNSUPPORTED;
+    HostPath = HostEmuFile_joinRoot(File->Volume, File->Path);
+    if(NULL == HostPath)
+        return EFI_OUT_OF_RESOURCES;
+    Name = strrchr(File->Path, '/');
+    Name = (NULL == Name)? File->Path : Name + 1;
+    Needed = HostEmuFile_fillInfo(  HostPath, Name, (EFI_FILE_INFO*)Buffer,
+                                    *BufferSize);
+    free(HostPath);
+    if(Needed > *BufferSize){
+        *BufferSize = Needed;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    *BufferSize = Needed;
+    return EFI_SUCCESS;
+}
+
+/*  Only the file size can be changed */
+static EFI_STATUS EFIAPI HostEmuFile_setInfo(   IN  EFI_FILE_PROTOCOL   *This,
+                                                IN  EFI_GUID    *InformationType,
+                                                IN  UINTN       BufferSize,
+                                                IN  VOID        *Buffer)
+{
+    HostEmuFile_t *File = (HostEmuFile_t*)This;
+    EFI_FILE_INFO *Info = (EFI_FILE_INFO*)Buffer;
+    struct stat st;
+    if(!CompareGuid(InformationType, &gEfiFileInfoGuid))
+        return EFI_UNSUPPORTED;
+    if(BufferSize < SIZE_OF_EFI_FILE_INFO)
+        return EFI_BAD_BUFFER_SIZE;
+    if(NULL != File->Dir)
+        return EFI_SUCCESS;
+    if(!(File->OpenMode & EFI_FILE_MODE_WRITE))
+        return EFI_ACCESS_DENIED;
+    if(0 != fstat(File->Fd, &st))
+        return EFI_DEVICE_ERROR;
+    if(0 != ftruncate(File->Fd, (off_t)Info->FileSize))
+        return HostEmuFile_errnoStatus(errno);
+    HostEmuFile_countResize(File, (UINT64)st.st_size, Info->FileSize);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI HostEmuFile_flush(IN EFI_FILE_PROTOCOL *This)
+{
+    HostEmuFile_countFlush((HostEmuFile_t*)This);
+    return EFI_SUCCESS;
+}
+
+static EFI_FILE_PROTOCOL sgFileProtocol = {
+    0x00010000,
+    HostEmuFile_open,
+    HostEmuFile_close,
+    HostEmuFile_delete,
+    HostEmuFile_read,
+    HostEmuFile_write,
+    HostEmuFile_getPosition,
+    HostEmuFile_setPosition,
+    HostEmuFile_getInfo,
+    HostEmuFile_setInfo,
+    HostEmuFile_flush
+};
+
+/******************************************************************************/
+/*  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL                                           */
+/******************************************************************************/
+
+static EFI_STATUS EFIAPI HostEmuFile_openVolume(
+                                    IN  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *This,
+                                    OUT EFI_FILE_PROTOCOL               **Root)
+{
+    char *Path = strdup("");
+    if(NULL == Path)
+        return EFI_OUT_OF_RESOURCES;
+    return HostEmuFile_new( (HostEmuVolume_t*)This, Path,
+                            EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0, Root);
+}
+
+EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* EFIAPI HostEmuFile_volume(
+                                            IN CONST char           *RootDir,
+                                            IN HostEmuFileStats_t   *Stats)
+{
+    HostEmuVolume_t *Volume;
+    Volume = calloc(1, sizeof(*Volume));
+    if(NULL == Volume)
+        return NULL;
+    Volume->Protocol.Revision   = 0x00010000;
+    Volume->Protocol.OpenVolume = HostEmuFile_openVolume;
+    Volume->Stats = Stats;
+    Volume->RootDir = strdup(RootDir);
+    if(NULL == Volume->RootDir){
+        free(Volume);
+        return NULL;
+    }
+    return &(Volume->Protocol);
+}
@@ -0,0 +1,29 @@
+/* HostEmuFile.h - EFI_SIMPLE_FILE_SYSTEM_PROTOCOL and EFI_FILE_PROTOCOL
+ *                 backed by a host directory tree (see HostEmuFile.c).
+ */
+
+#ifndef __HOST_EMU_FILE__
+#define __HOST_EMU_FILE__
+
+/*  The Open calls made on a volume, the directory entries they looked up
+    (one per component of the opened name, as a FAT driver walks it) and the
+    sectors a FAT driver would write (see HostEmuFile.c). */
+typedef struct {
+    UINT64  Opens;
+    UINT64  Lookups;
+    UINT64  SectorWrites;
+} HostEmuFileStats_t;
+
+/*  Returns the file-system protocol of a volume whose root is RootDir. Its
+    Open calls are counted in Stats. */
+EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* EFIAPI HostEmuFile_volume(
+                                            IN CONST char           *RootDir,
+                                            IN HostEmuFileStats_t   *Stats);
+
+/*  Returns the host path (to be freed with free) of the UEFI path Path,
+    taken relative to the root of the volume, or NULL if it can not be
+    formed. */
+char* EFIAPI HostEmuFile_hostPath(  IN EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *Volume,
+                                    IN CONST CHAR16 *Path);
+
+#endif
@@ -0,0 +1,470 @@
+/* HostEmuLib.c - Host implementation of the EDK2 BaseLib, BaseMemoryLib,
+ *                PrintLib and DevicePathLib functions used by the loader.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#include "HostEmu.h"
+#include "EFIPrint.h"
+
+/******************************************************************************/
+/*  GUIDs                                                                     */
+/******************************************************************************/
+
+EFI_GUID gEfiLoadedImageProtocolGuid =
+    { 0x5B1B31A1, 0x9562, 0x11D2, { 0x8E, 0x3F, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+EFI_GUID gEfiDevicePathProtocolGuid =
+    { 0x09576E91, 0x6D3F, 0x11D2, { 0x8E, 0x39, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+EFI_GUID gEfiSimpleFileSystemProtocolGuid =
+    { 0x964E5B22, 0x6459, 0x11D2, { 0x8E, 0x39, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+EFI_GUID gEfiBlockIoProtocolGuid =
+    { 0x964E5B21, 0x6459, 0x11D2, { 0x8E, 0x39, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+EFI_GUID gEfiUnicodeCollationProtocolGuid =
+    { 0x1D85CD7F, 0xF43D, 0x11D2, { 0x9A, 0x0C, 0x00, 0x90, 0x27, 0x3F, 0xC1, 0x4D } };
+EFI_GUID gEfiUnicodeCollation2ProtocolGuid =
+    { 0xA4C751FC, 0x23AE, 0x4C3E, { 0x92, 0xE9, 0x49, 0x64, 0xCF, 0x63, 0xF3, 0x49 } };
+EFI_GUID gEfiSmbiosProtocolGuid =
+    { 0x03583FF6, 0xCB36, 0x4940, { 0x94, 0x7E, 0xB9, 0xB3, 0x9F, 0x4A, 0xFA, 0xF7 } };
+EFI_GUID gEfiFileInfoGuid =
+    { 0x09576E92, 0x6D3F, 0x11D2, { 0x8E, 0x39, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+EFI_GUID gEfiGlobalVariableGuid =
+    { 0x8BE4DF61, 0x93CA, 0x11D2, { 0xAA, 0x0D, 0x00, 0xE0, 0x98, 0x03, 0x2B, 0x8C } };
+EFI_GUID gEfiImageSecurityDatabaseGuid =
+    { 0xD719B2CB, 0x3D3A, 0x4596, { 0xA3, 0xBC, 0xDA, 0xD0, 0x0E, 0x67, 0x65, 0x6F } };
+
+BOOLEAN EFIAPI CompareGuid(IN CONST EFI_GUID *Guid1, IN CONST EFI_GUID *Guid2)
+{
+    return (0 == memcmp(Guid1, Guid2, sizeof(EFI_GUID)))? TRUE : FALSE;
+}
+
+/******************************************************************************/
+/*  BaseMemoryLib                                                             */
+/******************************************************************************/
+
+VOID* EFIAPI CopyMem(OUT VOID *Dst, IN CONST VOID *Src, IN UINTN Length)
+{
+    return memmove(Dst, Src, Length);
+}
+
+VOID* EFIAPI SetMem(OUT VOID *Buffer, IN UINTN Length, IN UINT8 Value)
+{
+    return memset(Buffer, Value, Length);
+}
+
+VOID* EFIAPI ZeroMem(OUT VOID *Buffer, IN UINTN Length)
+{
+    return memset(Buffer, 0, Length);
+}
+
+INTN EFIAPI CompareMem( IN CONST VOID *Dst, IN CONST VOID *Src,
+                        IN UINTN Length)
+{
+    CONST UINT8 *a = Dst, *b = Src;
+    UINTN i;
+    for(i = 0; i < Length; i++)
+        if(a[i] != b[i])
+            return (INTN)a[i] - (INTN)b[i];
+    return 0;
+}
+
+/******************************************************************************/
+/*  BaseLib                                                                   */
+/******************************************************************************/
+
+UINTN EFIAPI StrLen(IN CONST CHAR16 *String)
+{
+    UINTN len;
+    for(len = 0; L'\0' != String[len]; len++);
+    return len;
+}
+
+UINTN EFIAPI StrnLenS(IN CONST CHAR16 *String, IN UINTN MaxSize)
+{
+    UINTN len;
+    if(NULL == String)
+        return 0;
+    for(len = 0; (len < MaxSize) && (L'\0' != String[len]); len++);
+    return len;
+}
+
+INTN EFIAPI StrCmp(IN CONST CHAR16 *First, IN CONST CHAR16 *Second)
+{
+    while((L'\0' != *First) && (*First == *Second)){
+        First++;
+        Second++;
+    }
+    return (INTN)*First - (INTN)*Second;
+}
+
+INTN EFIAPI StrnCmp(IN CONST CHAR16 *First, IN CONST CHAR16 *Second,
+                    IN UINTN Length)
+{
+    if(0 == Length)
+        return 0;
+    while((L'\0' != *First) && (*First == *Second) && (Length > 1)){
+        First++;
+        Second++;
+        Length--;
+    }
+    return (INTN)*First - (INTN)*Second;
+}
+
+UINTN EFIAPI AsciiStrLen(IN CONST CHAR8 *String)
+{
+    return strlen(String);
+}
+
+UINTN EFIAPI AsciiStrnLenS(IN CONST CHAR8 *String, IN UINTN MaxSize)
+{
+    return (NULL == String)? 0 : strnlen(String, MaxSize);
+}
+
+UINTN EFIAPI AsciiStrSize(IN CONST CHAR8 *String)
+{
+    return strlen(String) + 1;
+}
+
+CHAR8* EFIAPI AsciiStrCpy(OUT CHAR8 *Destination, IN CONST CHAR8 *Source)
+{
+    return strcpy(Destination, Source);
+}
+
+INTN EFIAPI AsciiStrCmp(IN CONST CHAR8 *First, IN CONST CHAR8 *Second)
+{
+    return strcmp(First, Second);
+}
+
+INTN EFIAPI AsciiStrnCmp(IN CONST CHAR8 *First, IN CONST CHAR8 *Second,
+                        IN UINTN Length)
+{
+    return strncmp(First, Second, Length);
+}
+
+UINTN EFIAPI AsciiStrDecimalToUintn(IN CONST CHAR8 *String)
+{
+    return (UINTN)strtoul(String, NULL, 10);
+}
+
+/*  As in EDK2: copies at most Length characters and always terminates */
+RETURN_STATUS EFIAPI AsciiStrnCpyS( OUT CHAR8 *Destination, IN UINTN DestMax,
+                                    IN CONST CHAR8 *Source, IN UINTN Length)
+{
+    UINTN SourceLen;
+    if((NULL == Destination) || (NULL == Source) || (0 == DestMax))
+        return EFI_INVALID_PARAMETER;
+    SourceLen = strnlen(Source, Length);
+    if(DestMax <= SourceLen)
+        return EFI_BUFFER_TOO_SMALL;
+    memmove(Destination, Source, SourceLen);
+    Destination[SourceLen] = '\0';
+    return EFI_SUCCESS;
+}
+
+RETURN_STATUS EFIAPI AsciiStrToUnicodeStrS( IN  CONST CHAR8 *Source,
+                                            OUT CHAR16      *Destination,
+                                            IN  UINTN       DestMax)
+{
+    UINTN i, len;
+    if((NULL == Source) || (NULL == Destination) || (0 == DestMax))
+        return EFI_INVALID_PARAMETER;
+    len = strnlen(Source, DestMax);
+    if(len >= DestMax)
+        return EFI_BUFFER_TOO_SMALL;
+    for(i = 0; i <= len; i++)
+        Destination[i] = (CHAR16)(UINT8)Source[i];
+    return EFI_SUCCESS;
+}
+
+RETURN_STATUS EFIAPI UnicodeStrToAsciiStrS(IN  CONST CHAR16 *Source,
+                                            OUT CHAR8        *Destination,
+                                            IN  UINTN        DestMax)
+{
+    UINTN i, len;
+    if((NULL == Source) || (NULL == Destination) || (0 == DestMax))
+        return EFI_INVALID_PARAMETER;
+    len = StrnLenS(Source, DestMax);
+    if(len >= DestMax)
+        return EFI_BUFFER_TOO_SMALL;
+    for(i = 0; i <= len; i++)
+        Destination[i] = (CHAR8)Source[i];
+    return EFI_SUCCESS;
+}
+
+UINT64 EFIAPI AsmReadTsc(VOID)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UINT64)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+/*  The host's CPUID, which goes with its TSC. Elsewhere every leaf reads as
+    zero. */
+UINT32 EFIAPI AsmCpuid(IN UINT32 Index, OUT UINT32 *Eax, OUT UINT32 *Ebx,
+                        OUT UINT32 *Ecx, OUT UINT32 *Edx)
+{
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __cpuid_count(Index, 0, a, b, c, d);
+#endif
+    if(NULL != Eax)
+        *Eax = a;
+    if(NULL != Ebx)
+        *Ebx = b;
+    if(NULL != Ecx)
+        *Ecx = c;
+    if(NULL != Edx)
+        *Edx = d;
+    return Index;
+}
+
+UINT64 EFIAPI DivU64x32(UINT64 Dividend, UINT32 Divisor)
+{
+    return Dividend / Divisor;
+}
+
+VOID EFIAPI CpuPause(VOID)
+{
+}
+
+/******************************************************************************/
+/*  PrintLib and UefiLib printing                                             */
+/******************************************************************************/
+
+/*  Argument source reading a VA_LIST, with the promotions of the EDK2 calling
+    convention: 32-bit arguments for int-sized conversions, 64-bit otherwise */
+typedef struct {
+    va_list Marker;
+} valist_args_t;
+
+static uint64_t valist_next(void *ctx, EFIPrint_argclass_t argclass)
+{
+    valist_args_t *va = (valist_args_t*)ctx;
+    switch(argclass){
+        case EFIPRINT_ARG_INT:
+            return (uint64_t)(uint32_t)va_arg(va->Marker, int);
+        case EFIPRINT_ARG_INT64:
+            return va_arg(va->Marker, uint64_t);
+        default:
+            return (uint64_t)(uintptr_t)va_arg(va->Marker, void*);
+    }
+}
+
+static UINTN HostEmu_vformat(   OUT CHAR8           *Buffer,
+                                IN  UINTN           BufferSize,
+                                IN  CONST CHAR16    *Format16,
+                                IN  CONST CHAR8     *Format8,
+                                IN  VA_LIST         Marker)
+{
+    valist_args_t va;
+    EFIPrint_args_t args = { valist_next, &va };
+    UINTN Printed;
+    va_copy(va.Marker, Marker);
+    Printed = EFIPrint_format(  Buffer, BufferSize,
+                                (const uint16_t*)Format16, Format8, &args);
+    va_end(va.Marker);
+    return Printed;
+}
+
+UINTN EFIAPI AsciiVSPrintUnicodeFormat( OUT CHAR8 *StartOfBuffer,
+                                        IN UINTN BufferSize,
+                                        IN CONST CHAR16 *FormatString,
+                                        IN VA_LIST Marker)
+{
+    return HostEmu_vformat(StartOfBuffer, BufferSize, FormatString, NULL,
+                            Marker);
+}
+
+UINTN EFIAPI AsciiSPrintUnicodeFormat(  OUT CHAR8 *StartOfBuffer,
+                                        IN UINTN BufferSize,
+                                        IN CONST CHAR16 *FormatString, ...)
+{
+    VA_LIST Marker;
+    UINTN Printed;
+    VA_START(Marker, FormatString);
+    Printed = AsciiVSPrintUnicodeFormat(StartOfBuffer, BufferSize,
+                                        FormatString, Marker);
+    VA_END(Marker);
+    return Printed;
+}
+
+UINTN EFIAPI AsciiVSPrint(  OUT CHAR8 *StartOfBuffer, IN UINTN BufferSize,
+                            IN CONST CHAR8 *FormatString, IN VA_LIST Marker)
+{
+    return HostEmu_vformat(StartOfBuffer, BufferSize, NULL, FormatString,
+                            Marker);
+}
+
+UINTN EFIAPI AsciiSPrint(   OUT CHAR8 *StartOfBuffer, IN UINTN BufferSize,
+                            IN CONST CHAR8 *FormatString, ...)
+{
+    VA_LIST Marker;
+    UINTN Printed;
+    VA_START(Marker, FormatString);
+    Printed = AsciiVSPrint(StartOfBuffer, BufferSize, FormatString, Marker);
+    VA_END(Marker);
+    return Printed;
+}
+
+/*  UCS-2 output: formatted as ASCII, then widened. BufferSize is in bytes. */
+UINTN EFIAPI UnicodeVSPrint(OUT CHAR16 *StartOfBuffer, IN UINTN BufferSize,
+                            IN CONST CHAR16 *FormatString, IN VA_LIST Marker)
+{
+    UINTN Printed, i, MaxChars = BufferSize / sizeof(CHAR16);
+    CHAR8 *Ascii;
+    if(0 == MaxChars)
+        return 0;
+    Ascii = malloc(MaxChars);
+    if(NULL == Ascii)
+        return 0;
+    Printed = HostEmu_vformat(Ascii, MaxChars, FormatString, NULL, Marker);
+    for(i = 0; i <= Printed; i++)
+        StartOfBuffer[i] = (CHAR16)(UINT8)Ascii[i];
+    free(Ascii);
+    return Printed;
+}
+
+UINTN EFIAPI UnicodeSPrint( OUT CHAR16 *StartOfBuffer, IN UINTN BufferSize,
+                            IN CONST CHAR16 *FormatString, ...)
+{
+    VA_LIST Marker;
+    UINTN Printed;
+    VA_START(Marker, FormatString);
+    Printed = UnicodeVSPrint(StartOfBuffer, BufferSize, FormatString, Marker);
+    VA_END(Marker);
+    return Printed;
+}
+
+UINTN EFIAPI SPrintLength(IN CONST CHAR16 *FormatString, IN VA_LIST Marker)
+{
+    return HostEmu_vformat(NULL, 0, FormatString, NULL, Marker);
+}
+
+UINTN EFIAPI SPrintLengthAsciiFormat(   IN CONST CHAR8 *FormatString,
+                                        IN VA_LIST Marker)
+{
+    return HostEmu_vformat(NULL, 0, NULL, FormatString, Marker);
+}
+
+UINTN EFIAPI AsciiPrint(IN CONST CHAR8 *Format, ...)
+{
+    VA_LIST Marker;
+    UINTN Printed, Length;
+    CHAR8 *Buffer;
+    VA_START(Marker, Format);
+    Length = SPrintLengthAsciiFormat(Format, Marker);
+    VA_END(Marker);
+    Buffer = malloc(Length + 1);
+    if(NULL == Buffer)
+        return 0;
+    VA_START(Marker, Format);
+    Printed = AsciiVSPrint(Buffer, Length + 1, Format, Marker);
+    VA_END(Marker);
+    fputs(Buffer, stdout);
+    free(Buffer);
+    return Printed;
+}
+
+UINTN EFIAPI Print(IN CONST CHAR16 *Format, ...)
+{
+    VA_LIST Marker;
+    UINTN Printed, Length;
+    CHAR8 *Buffer;
+    VA_START(Marker, Format);
+    Length = SPrintLength(Format, Marker);
+    VA_END(Marker);
+    Buffer = malloc(Length + 1);
+    if(NULL == Buffer)
+        return 0;
+    VA_START(Marker, Format);
+    Printed = AsciiVSPrintUnicodeFormat(Buffer, Length + 1, Format, Marker);
+    VA_END(Marker);
+    fputs(Buffer, stdout);
+    free(Buffer);
+    return Printed;
+}
+
+/******************************************************************************/
+/*  DevicePathLib                                                             */
+/******************************************************************************/
+
+UINT8 EFIAPI DevicePathType(IN CONST VOID *Node)
+{
+    return ((CONST EFI_DEVICE_PATH_PROTOCOL*)Node)->Type;
+}
+
+UINT8 EFIAPI DevicePathSubType(IN CONST VOID *Node)
+{
+    return ((CONST EFI_DEVICE_PATH_PROTOCOL*)Node)->SubType;
+}
+
+UINTN EFIAPI DevicePathNodeLength(IN CONST VOID *Node)
+{
+    CONST EFI_DEVICE_PATH_PROTOCOL *Header = Node;
+    return (UINTN)Header->Length[0] | ((UINTN)Header->Length[1] << 8);
+}
+
+EFI_DEVICE_PATH_PROTOCOL* EFIAPI NextDevicePathNode(IN CONST VOID *Node)
+{
+    return (EFI_DEVICE_PATH_PROTOCOL*)((UINT8*)Node +
+                                        DevicePathNodeLength(Node));
+}
+
+BOOLEAN EFIAPI IsDevicePathEnd(IN CONST VOID *Node)
+{
+    return  (END_DEVICE_PATH_TYPE == DevicePathType(Node)) &&
+            (END_ENTIRE_DEVICE_PATH_SUBTYPE == DevicePathSubType(Node));
+}
+
+/*  A single file-path node followed by the end node. The device handle is not
+    recorded: the emulation has one volume. */
+EFI_DEVICE_PATH_PROTOCOL* EFIAPI FileDevicePath(IN EFI_HANDLE Device OPTIONAL,
+                                                IN CONST CHAR16 *FileName)
+{
+    UINTN NameSize, NodeSize;
+    FILEPATH_DEVICE_PATH *Node;
+    EFI_DEVICE_PATH_PROTOCOL *End;
+    NameSize = (StrLen(FileName) + 1) * sizeof(CHAR16);
+    NodeSize = OFFSET_OF(FILEPATH_DEVICE_PATH, PathName) + NameSize;
+    Node = malloc(NodeSize + sizeof(EFI_DEVICE_PATH_PROTOCOL));
+    if(NULL == Node)
+        return NULL;
+    Node->Header.Type       = MEDIA_DEVICE_PATH;
+    Node->Header.SubType    = MEDIA_FILEPATH_DP;
+    Node->Header.Length[0]  = (UINT8)NodeSize;
+    Node->Header.Length[1]  = (UINT8)(NodeSize >> 8);
+    memcpy(Node->PathName, FileName, NameSize);
+    End = (EFI_DEVICE_PATH_PROTOCOL*)((UINT8*)Node + NodeSize);
+    End->Type       = END_DEVICE_PATH_TYPE;
+    End->SubType    = END_ENTIRE_DEVICE_PATH_SUBTYPE;
+    End->Length[0]  = sizeof(EFI_DEVICE_PATH_PROTOCOL);
+    End->Length[1]  = 0;
+    return &(Node->Header);
+}
+
+CHAR16* EFIAPI ConvertDevicePathToText( IN CONST EFI_DEVICE_PATH_PROTOCOL *DP,
+                                        IN BOOLEAN DisplayOnly,
+                                        IN BOOLEAN AllowShortcuts)
+{
+    CONST FILEPATH_DEVICE_PATH *Node = (CONST FILEPATH_DEVICE_PATH*)DP;
+    UINTN Size;
+    CHAR16 *Text;
+    if( (NULL == DP) || (MEDIA_DEVICE_PATH != DP->Type) ||
+        (MEDIA_FILEPATH_DP != DP->SubType) )
+        return NULL;
+    Size = (StrLen(Node->PathName) + 1) * sizeof(CHAR16);
+    Text = malloc(Size);
+    if(NULL != Text)
+        memcpy(Text, Node->PathName, Size);
+    return Text;
+}
@@ -0,0 +1,335 @@
+/* hostboot.c - Boots the loader on the emulated platform.
+ *
+ *      bum-hostboot [-v] <EFI system partition directory> <boots>
+ *      bum-hostboot -w <image file> [<build ID>]
+ *      bum-hostboot -l <image file>
+ *
+ *      Each boot power-cycles the platform and runs the root BUM at
+ *      \EFI\BOOT\bootx64.efi. A started bootx64.efi is run as a configuration
+ *      BUM. A started payload.efi is not run: if its content begins with
+ *      "fail" the boot fails (the system resets without runtime-init), and
+ *      otherwise the boot succeeds and the runtime-init operation is applied
+ *      to the state, as the booted OS would.
+ *
+ *      One line is printed per boot with the configuration of the payload
+ *      and the boot attempt handed to it in the BUM context, followed by a
+ *      summary on stderr. A payload started without a context naming its
+ *      configuration fails the loader, unless a BUM older than the context
+ *      started it; its boot attempt is then printed as "-".
+ *
+ *      With -w, an image file for a BUM is written instead: a PE file whose
+ *      only section holds the build-ID record (see BUMBuildId.h) where the
+ *      loader has its own, with the loader's build ID or the one given. The
+ *      root BUM runs a configuration BUM written with the loader's build ID
+ *      in place.
+ *
+ *      With -l, the image file written is that of a BUM older than the BUM
+ *      context: the loader is run for it, but the context is dropped both
+ *      when it starts and when it starts another image, so that it only has
+ *      the BUM_CURCONFIG variable to go by. The root BUM loads it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include <Uefi.h>
+#include "HostEmuFile.h"
+#include "HostEmuBoot.h"
+#include "LibCommon.h"
+#include "BUMState.h"
+#include "BootTimeline.h"
+#include "BUMContext.h"
+#include "BUMBuildId.h"
+
+#define ROOT_IMAGE_PATH     L"\\EFI\\BOOT\\bootx64.efi"
+#define BUM_IMAGENAME       L"bootx64.efi"
+#define PAYLOAD_IMAGENAME   L"payload.efi"
+#define BUM_STATEDIR        "\\bumstate"
+#define MAX_IMAGE_CHAIN     (4)
+#define PATH_MAXLEN         (256)
+#define LEGACY_IMAGE        "legacy"
+
+static const char *usage = "[-v] <EFI system partition directory> <boots>\n"
+                            "       -w <image file> [<build ID>]\n"
+                            "       -l <image file>";
+
+static EFI_GUID sgBUMContextProtocolGuid = BUMCONTEXT_PROTOCOL_GUID;
+
+EFI_STATUS EFIAPI BUM_main( IN EFI_HANDLE       LoadedImageHandle,
+                            IN EFI_SYSTEM_TABLE *SystemTable);
+
+typedef enum {
+    BOOT_SUCCESS,           /* the payload booted */
+    BOOT_PAYLOADFAILURE,    /* the payload was started but failed */
+    BOOT_LOADERFAILURE,     /* no payload was started */
+} boot_result_t;
+
+static const char *boot_result_names[] = {
+    "success",
+    "payload-failure",
+    "loader-failure",
+};
+
+/*  Splits the UEFI path Path into its directory (as ASCII) and file name */
+static const CHAR16 *SplitPath( IN  CONST CHAR16    *Path,
+                                OUT char            *Dir,
+                                IN  size_t          DirSize)
+{
+    const CHAR16 *Name = Path, *p;
+    size_t i;
+    for(p = Path; L'\0' != *p; p++){
+        if(L'\\' == *p)
+            Name = p + 1;
+    }
+    for(i = 0; (&(Path[i]) + 1 < Name) && (i + 1 < DirSize); i++)
+        Dir[i] = (char)Path[i];
+    Dir[i] = '\0';
+    return Name;
+}
+
+/*  Returns TRUE if the content of the file at Path begins with Prefix, and
+    IfMissing if the file cannot be read */
+static BOOLEAN FileBeginsWith(  IN CONST CHAR16 *Path,
+                                IN CONST char   *Prefix,
+                                IN BOOLEAN      IfMissing)
+{
+    char *HostPath, Buffer[16];
+    size_t PrefixLen = strlen(Prefix);
+    FILE *fp;
+    BOOLEAN Begins = IfMissing;
+    HostPath = HostEmuFile_hostPath(HostEmu_volume(), Path);
+    if(NULL == HostPath)
+        return IfMissing;
+    fp = fopen(HostPath, "r");
+    if(NULL != fp){
+        Begins =    (PrefixLen <= sizeof(Buffer)) &&
+                    (PrefixLen == fread(Buffer, 1, PrefixLen, fp)) &&
+                    (0 == memcmp(Buffer, Prefix, PrefixLen));
+        fclose(fp);
+    }
+    free(HostPath);
+    return Begins;
+}
+
+static BOOLEAN PayloadFails(IN CONST CHAR16 *Path)
+{
+    return FileBeginsWith(Path, "fail", TRUE);
+}
+
+/*  Returns TRUE if the image at Path is a BUM older than the BUM context */
+static BOOLEAN ImageIsLegacy(IN CONST CHAR16 *Path)
+{
+    return FileBeginsWith(Path, LEGACY_IMAGE, FALSE);
+}
+
+/*  Writes the image file of a BUM older than the BUM context */
+static int WriteLegacyImage(IN CONST char *Path)
+{
+    FILE *fp;
+    int ret = -1;
+    fp = fopen(Path, "w");
+    if(NULL == fp)
+        goto exit0;
+    if(1 == fwrite(LEGACY_IMAGE, sizeof(LEGACY_IMAGE) - 1, 1, fp))
+        ret = 0;
+    if(0 != fclose(fp))
+        ret = -1;
+exit0:
+    if(0 != ret)
+        fprintf(stderr, "    WriteLegacyImage failed for \"%s\"\n", Path);
+    return ret;
+}
+
+/*  Writes a BUM image file holding the build ID Id, or the loader's own if
+    Id is NULL. The record's raw data is at IMAGE_RAWDATA_OFFSET. */
+#define IMAGE_RAWDATA_OFFSET    (0x200)
+
+typedef struct {
+    EFI_IMAGE_DOS_HEADER        Dos;
+    UINT32                      Signature;
+    EFI_IMAGE_FILE_HEADER       File;
+    EFI_IMAGE_SECTION_HEADER    Section;
+} image_headers_t;
+
+static int WriteImage(IN CONST char *Path, IN CONST char *Id)
+{
+    image_headers_t Headers;
+    BUM_buildId_t BuildId = gBUMBuildId;
+    FILE *fp;
+    int ret = -1;
+    if(NULL != Id){
+        ZeroMem(BuildId.Id, sizeof(BuildId.Id));
+        strncpy(BuildId.Id, Id, sizeof(BuildId.Id) - 1);
+    }
+    ZeroMem(&Headers, sizeof(Headers));
+    Headers.Dos.e_magic                 = EFI_IMAGE_DOS_SIGNATURE;
+    Headers.Dos.e_lfanew                = OFFSET_OF(image_headers_t, Signature);
+    Headers.Signature                   = EFI_IMAGE_NT_SIGNATURE;
+    Headers.File.Machine                = 0x8664;   /* x64 */
+    Headers.File.NumberOfSections       = 1;
+    memcpy(Headers.Section.Name, ".data", sizeof(".data"));
+    Headers.Section.Misc.VirtualSize    = sizeof(BuildId);
+    Headers.Section.VirtualAddress      = (UINT32)((CONST UINT8*)&gBUMBuildId -
+                                            (UINT8*)HostEmu_imageBase());
+    Headers.Section.SizeOfRawData       = sizeof(BuildId);
+    Headers.Section.PointerToRawData    = IMAGE_RAWDATA_OFFSET;
+    fp = fopen(Path, "w");
+    if(NULL == fp)
+        goto exit0;
+    if( (1 == fwrite(&Headers, sizeof(Headers), 1, fp)) &&
+        (0 == fseek(fp, IMAGE_RAWDATA_OFFSET, SEEK_SET)) &&
+        (1 == fwrite(&BuildId, sizeof(BuildId), 1, fp)) )
+        ret = 0;
+    if(0 != fclose(fp))
+        ret = -1;
+exit0:
+    if(0 != ret)
+        fprintf(stderr, "    WriteImage failed for \"%s\"\n", Path);
+    return ret;
+}
+
+/*  What the booted OS does with bumstate-runtime-init */
+static EFI_STATUS RunTimeInit(VOID)
+{
+    EFI_STATUS Status, CloseStatus;
+    BUM_state_handle_t BUM_state;
+    Status = Common_FileOpsInit(HostEmu_deviceHandle());
+    if(EFI_ERROR(Status))
+        goto exit0;
+    Status = BUMState_Open(BUM_STATEDIR, &BUM_state);
+    if(EFI_ERROR(Status))
+        goto exit1;
+    BUMStateNext_RunTimeInit(BUM_state.State);
+    Status = BUMState_Commit(&BUM_state);
+    CloseStatus = BUMState_Close(&BUM_state);
+    if(!EFI_ERROR(Status))
+        Status = CloseStatus;
+exit1:
+    CloseStatus = Common_FileOpsClose();
+    if(!EFI_ERROR(Status))
+        Status = CloseStatus;
+exit0:
+    return Status;
+}
+
+/*  Checks the BUM context handed to the payload of Config and returns its
+    boot attempt */
+static EFI_STATUS PayloadContext(   IN  CONST char  *Config,
+                                    OUT UINT64      *BootAttempt)
+{
+    BUM_context_t *Context;
+    if( EFI_ERROR(HostEmu_startedProtocol(  &sgBUMContextProtocolGuid,
+                                            (VOID**)&Context)) ||
+        !BUMContext_isValid(Context) ||
+        (BUMCONTEXT_IMAGE_CFGPLD != Context->ImageType) ||
+        (0 != AsciiStrnCmp(Context->Config, Config, BUMSTATE_CONFIG_MAXLEN)) ||
+        (0 == Context->Timeline.MarkCount) ||
+        (BOOTTIME_STAGE_ROOT != Context->Timeline.Marks[0].Stage) )
+        return EFI_COMPROMISED_DATA;
+    *BootAttempt = Context->BootAttempt;
+    return EFI_SUCCESS;
+}
+
+/*  Boots once. HasContext is cleared if the payload was started by a BUM
+    older than the BUM context, which hands over no boot attempt. */
+static boot_result_t Boot( OUT char *Config, IN size_t ConfigSize,
+                            OUT UINT64 *BootAttempt, OUT BOOLEAN *HasContext)
+{
+    CHAR16 Path[PATH_MAXLEN], Started[PATH_MAXLEN];
+    const CHAR16 *Name;
+    BOOLEAN Legacy;
+    HOSTEMU_EXIT_TYPE Exit;
+    int i;
+    HostEmu_powerCycle();
+    Config[0] = '\0';
+    memcpy(Path, ROOT_IMAGE_PATH, sizeof(ROOT_IMAGE_PATH));
+    for(i = 0; i < MAX_IMAGE_CHAIN; i++){
+        Legacy = ImageIsLegacy(Path);
+        if(Legacy)
+            HostEmu_dropStartedProtocol();
+        Exit = HostEmu_runImage(Path, BUM_main, Started, PATH_MAXLEN);
+        if(Legacy)
+            HostEmu_dropStartedProtocol();
+        if(HOSTEMU_EXIT_STARTIMAGE != Exit)
+            return BOOT_LOADERFAILURE;
+        Name = SplitPath(Started, Config, ConfigSize);
+        if(0 == StrCmp(Name, PAYLOAD_IMAGENAME)){
+            *HasContext = !Legacy;
+            if( !Legacy && EFI_ERROR(PayloadContext(Config, BootAttempt)) ){
+                fprintf(stderr, "    no valid BUM context for the payload\n");
+                return BOOT_LOADERFAILURE;
+            }
+            if(PayloadFails(Started))
+                return BOOT_PAYLOADFAILURE;
+            if(EFI_ERROR(RunTimeInit())){
+                fprintf(stderr, "    RunTimeInit failed\n");
+                return BOOT_PAYLOADFAILURE;
+            }
+            return BOOT_SUCCESS;
+        }
+        if(0 != StrCmp(Name, BUM_IMAGENAME))
+            return BOOT_LOADERFAILURE;
+        memcpy(Path, Started, sizeof(Path));
+    }
+    return BOOT_LOADERFAILURE;
+}
+
+int main(int argc, char** argv)
+{
+    char Config[PATH_MAXLEN];
+    struct timespec start, stop;
+    unsigned long boots, i, counts[3] = {0, 0, 0};
+    UINT64 BootAttempt = 0;
+    boot_result_t result;
+    BOOLEAN Verbose = FALSE, HasContext;
+    double seconds;
+    if( ((argc == 3) || (argc == 4)) && (0 == strcmp(argv[1], "-w")) )
+        return WriteImage(argv[2], (argc == 4)? argv[3] : NULL);
+    if( (argc == 3) && (0 == strcmp(argv[1], "-l")) )
+        return WriteLegacyImage(argv[2]);
+    if( (argc == 4) && (0 == strcmp(argv[1], "-v")) ){
+        Verbose = TRUE;
+        argc--;
+        argv++;
+    }
+    if(argc != 3){
+        fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
+        return -1;
+    }
+    boots = strtoul(argv[2], NULL, 0);
+    if(EFI_ERROR(HostEmu_init(argv[1], Verbose))){
+        fprintf(stderr, "    HostEmu_init failed\n");
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < boots; i++){
+        result = Boot(Config, sizeof(Config), &BootAttempt, &HasContext);
+        counts[result]++;
+        if( (BOOT_LOADERFAILURE == result) || !HasContext )
+            printf("boot %lu: %s %s -\n", i, boot_result_names[result],
+                    ('\0' == Config[0])? "-" : Config);
+        else
+            printf("boot %lu: %s %s %" PRIu64 "\n", i,
+                    boot_result_names[result], Config, BootAttempt);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    seconds = (stop.tv_sec - start.tv_sec) +
+                (stop.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%lu boot(s): %lu success, %lu payload failure, "
+                    "%lu loader failure, %.0f boots/sec, "
+                    "%.1f pool allocations/boot, %.1f file opens/boot, "
+                    "%.1f directory lookups/boot, "
+                    "%.1f sector writes/boot, "
+                    "%.1f variable calls/boot\n",
+            boots, counts[BOOT_SUCCESS], counts[BOOT_PAYLOADFAILURE],
+            counts[BOOT_LOADERFAILURE], (seconds > 0)? boots / seconds : 0,
+            (boots > 0)? (double)HostEmu_poolAllocations() / boots : 0,
+            (boots > 0)? (double)HostEmu_fileOpens() / boots : 0,
+            (boots > 0)? (double)HostEmu_fileLookups() / boots : 0,
+            (boots > 0)? (double)HostEmu_sectorWrites() / boots : 0,
+            (boots > 0)? (double)HostEmu_variableCalls() / boots : 0);
+    return (0 == counts[BOOT_LOADERFAILURE])? 0 : -1;
+}
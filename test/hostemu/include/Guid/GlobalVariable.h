@@ -0,0 +1,2 @@
+/* Guid/GlobalVariable.h - Forwarding header for the host UEFI emulation. See HostEmu.h */
+#include "HostEmu.h"
@@ -0,0 +1,671 @@
+/* HostEmu.h -  Types, macros, and service tables emulating the subset of the
+ *              EDK2/UEFI environment used by the loader so that the loader
+ *              sources can be compiled and run as a Linux process.
+ *
+ *              NOTE:   This header replaces the EDK2 headers included by the
+ *                      loader (Uefi.h, Library/BaseLib.h, ...). Every header
+ *                      under include/ simply includes this file. The
+ *                      functions and service tables are implemented in
+ *                      HostEmuLib.c, HostEmuFile.c and HostEmu.c.
+ */
+
+#ifndef __HOST_EMU__
+#define __HOST_EMU__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+/******************************************************************************/
+/*  Base types                                                                */
+/******************************************************************************/
+
+typedef uint64_t            UINT64;
+typedef int64_t             INT64;
+typedef uint32_t            UINT32;
+typedef int32_t             INT32;
+typedef uint16_t            UINT16;
+typedef int16_t             INT16;
+typedef uint8_t             UINT8;
+typedef int8_t              INT8;
+typedef uint64_t            UINTN;
+typedef int64_t             INTN;
+typedef unsigned char       BOOLEAN;
+typedef char                CHAR8;
+typedef wchar_t             CHAR16;     /* requires -fshort-wchar */
+typedef void                VOID;
+
+typedef UINTN               RETURN_STATUS;
+typedef RETURN_STATUS       EFI_STATUS;
+typedef VOID                *EFI_HANDLE;
+typedef VOID                *EFI_EVENT;
+typedef UINTN               EFI_TPL;
+typedef UINT64              EFI_PHYSICAL_ADDRESS;
+typedef UINT64              EFI_LBA;
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST               const
+#define STATIC              static
+#define EFIAPI
+
+#define TRUE                ((BOOLEAN)(1==1))
+#define FALSE               ((BOOLEAN)(0==1))
+#ifndef NULL
+#define NULL                ((VOID *) 0)
+#endif
+
+#define MAX_UINT8           ((UINT8)0xFF)
+#define MAX_UINT16          ((UINT16)0xFFFF)
+#define MAX_UINT32          ((UINT32)0xFFFFFFFF)
+#define MAX_UINT64          ((UINT64)0xFFFFFFFFFFFFFFFFULL)
+#define MAX_UINTN           MAX_UINT64
+
+#define VA_LIST             va_list
+#define VA_START(m, p)      va_start(m, p)
+#define VA_END(m)           va_end(m)
+#define VA_ARG(m, t)        va_arg(m, t)
+#define VA_COPY(d, s)       va_copy(d, s)
+
+#define OFFSET_OF(t, f)     offsetof(t, f)
+#define ARRAY_SIZE(a)       (sizeof(a) / sizeof((a)[0]))
+#define ALIGN_VALUE(v, a)   ((v) + (((a) - (v)) & ((a) - 1)))
+#define MIN(a, b)           (((a) < (b))? (a) : (b))
+#define MAX(a, b)           (((a) > (b))? (a) : (b))
+#define BIT8                (0x00000100)
+
+typedef struct {
+    UINT32  Data1;
+    UINT16  Data2;
+    UINT16  Data3;
+    UINT8   Data4[8];
+} EFI_GUID;
+
+typedef struct {
+    UINT16  Year;
+    UINT8   Month;
+    UINT8   Day;
+    UINT8   Hour;
+    UINT8   Minute;
+    UINT8   Second;
+    UINT8   Pad1;
+    UINT32  Nanosecond;
+    INT16   TimeZone;
+    UINT8   Daylight;
+    UINT8   Pad2;
+} EFI_TIME;
+
+typedef struct {
+    UINT32  Resolution;
+    UINT32  Accuracy;
+    BOOLEAN SetsToZero;
+} EFI_TIME_CAPABILITIES;
+
+/******************************************************************************/
+/*  Status codes                                                              */
+/******************************************************************************/
+
+#define MAX_BIT                     (0x8000000000000000ULL)
+#define ENCODE_ERROR(c)             ((RETURN_STATUS)(MAX_BIT | (c)))
+#define ENCODE_WARNING(c)           ((RETURN_STATUS)(c))
+#define RETURN_ERROR(s)             (((INTN)(RETURN_STATUS)(s)) < 0)
+#define EFI_ERROR(s)                RETURN_ERROR(s)
+
+#define RETURN_SUCCESS              0
+#define EFI_SUCCESS                 RETURN_SUCCESS
+#define EFI_LOAD_ERROR              ENCODE_ERROR(1)
+#define EFI_INVALID_PARAMETER       ENCODE_ERROR(2)
+#define EFI_UNSUPPORTED             ENCODE_ERROR(3)
+#define EFI_BAD_BUFFER_SIZE         ENCODE_ERROR(4)
+#define EFI_BUFFER_TOO_SMALL        ENCODE_ERROR(5)
+#define EFI_NOT_READY               ENCODE_ERROR(6)
+#define EFI_DEVICE_ERROR            ENCODE_ERROR(7)
+#define EFI_WRITE_PROTECTED         ENCODE_ERROR(8)
+#define EFI_OUT_OF_RESOURCES        ENCODE_ERROR(9)
+#define EFI_VOLUME_CORRUPTED        ENCODE_ERROR(10)
+#define EFI_VOLUME_FULL             ENCODE_ERROR(11)
+#define EFI_NO_MEDIA                ENCODE_ERROR(12)
+#define EFI_MEDIA_CHANGED           ENCODE_ERROR(13)
+#define EFI_NOT_FOUND               ENCODE_ERROR(14)
+#define EFI_ACCESS_DENIED           ENCODE_ERROR(15)
+#define EFI_NO_RESPONSE             ENCODE_ERROR(16)
+#define EFI_NO_MAPPING              ENCODE_ERROR(17)
+#define EFI_TIMEOUT                 ENCODE_ERROR(18)
+#define EFI_NOT_STARTED             ENCODE_ERROR(19)
+#define EFI_ALREADY_STARTED         ENCODE_ERROR(20)
+#define EFI_ABORTED                 ENCODE_ERROR(21)
+#define EFI_END_OF_FILE             ENCODE_ERROR(31)
+#define EFI_SECURITY_VIOLATION      ENCODE_ERROR(26)
+#define EFI_CRC_ERROR               ENCODE_ERROR(27)
+#define EFI_COMPROMISED_DATA        ENCODE_ERROR(33)
+#define EFI_WARN_DELETE_FAILURE     ENCODE_WARNING(2)
+
+/******************************************************************************/
+/*  BaseLib, BaseMemoryLib, PrintLib, UefiLib, DevicePathLib subsets          */
+/******************************************************************************/
+
+VOID*   EFIAPI CopyMem(OUT VOID *Dst, IN CONST VOID *Src, IN UINTN Length);
+VOID*   EFIAPI SetMem(OUT VOID *Buffer, IN UINTN Length, IN UINT8 Value);
+VOID*   EFIAPI ZeroMem(OUT VOID *Buffer, IN UINTN Length);
+INTN    EFIAPI CompareMem(  IN CONST VOID *Dst, IN CONST VOID *Src,
+                            IN UINTN Length);
+
+UINTN   EFIAPI StrLen(IN CONST CHAR16 *String);
+UINTN   EFIAPI StrnLenS(IN CONST CHAR16 *String, IN UINTN MaxSize);
+INTN    EFIAPI StrCmp(IN CONST CHAR16 *First, IN CONST CHAR16 *Second);
+INTN    EFIAPI StrnCmp( IN CONST CHAR16 *First, IN CONST CHAR16 *Second,
+                        IN UINTN Length);
+UINTN   EFIAPI AsciiStrLen(IN CONST CHAR8 *String);
+UINTN   EFIAPI AsciiStrnLenS(IN CONST CHAR8 *String, IN UINTN MaxSize);
+UINTN   EFIAPI AsciiStrSize(IN CONST CHAR8 *String);
+CHAR8*  EFIAPI AsciiStrCpy(OUT CHAR8 *Destination, IN CONST CHAR8 *Source);
+INTN    EFIAPI AsciiStrCmp(IN CONST CHAR8 *First, IN CONST CHAR8 *Second);
+INTN    EFIAPI AsciiStrnCmp(IN CONST CHAR8 *First, IN CONST CHAR8 *Second,
+                            IN UINTN Length);
+UINTN   EFIAPI AsciiStrDecimalToUintn(IN CONST CHAR8 *String);
+RETURN_STATUS EFIAPI AsciiStrnCpyS( OUT CHAR8 *Destination, IN UINTN DestMax,
+                                    IN CONST CHAR8 *Source, IN UINTN Length);
+RETURN_STATUS EFIAPI AsciiStrToUnicodeStrS( IN  CONST CHAR8 *Source,
+                                            OUT CHAR16      *Destination,
+                                            IN  UINTN       DestMax);
+RETURN_STATUS EFIAPI UnicodeStrToAsciiStrS( IN  CONST CHAR16 *Source,
+                                            OUT CHAR8        *Destination,
+                                            IN  UINTN        DestMax);
+UINT64  EFIAPI AsmReadTsc(VOID);
+UINT32  EFIAPI AsmCpuid(IN UINT32 Index, OUT UINT32 *Eax, OUT UINT32 *Ebx,
+                        OUT UINT32 *Ecx, OUT UINT32 *Edx);
+UINT64  EFIAPI DivU64x32(UINT64 Dividend, UINT32 Divisor);
+VOID    EFIAPI CpuPause(VOID);
+
+UINTN EFIAPI UnicodeSPrint( OUT CHAR16 *StartOfBuffer, IN UINTN BufferSize,
+                            IN CONST CHAR16 *FormatString, ...);
+UINTN EFIAPI UnicodeVSPrint(OUT CHAR16 *StartOfBuffer, IN UINTN BufferSize,
+                            IN CONST CHAR16 *FormatString, IN VA_LIST Marker);
+UINTN EFIAPI AsciiSPrint(   OUT CHAR8 *StartOfBuffer, IN UINTN BufferSize,
+                            IN CONST CHAR8 *FormatString, ...);
+UINTN EFIAPI AsciiVSPrint(  OUT CHAR8 *StartOfBuffer, IN UINTN BufferSize,
+                            IN CONST CHAR8 *FormatString, IN VA_LIST Marker);
+UINTN EFIAPI AsciiSPrintUnicodeFormat(  OUT CHAR8 *StartOfBuffer,
+                                        IN UINTN BufferSize,
+                                        IN CONST CHAR16 *FormatString, ...);
+UINTN EFIAPI AsciiVSPrintUnicodeFormat( OUT CHAR8 *StartOfBuffer,
+                                        IN UINTN BufferSize,
+                                        IN CONST CHAR16 *FormatString,
+                                        IN VA_LIST Marker);
+UINTN EFIAPI SPrintLength(  IN CONST CHAR16 *FormatString, IN VA_LIST Marker);
+UINTN EFIAPI SPrintLengthAsciiFormat(   IN CONST CHAR8 *FormatString,
+                                        IN VA_LIST Marker);
+UINTN EFIAPI Print(IN CONST CHAR16 *Format, ...);
+UINTN EFIAPI AsciiPrint(IN CONST CHAR8 *Format, ...);
+
+/*  PcdLib: only the PCDs referenced by the loader */
+#define PcdGet32(TokenName)     _PCD_GET_MODE_32_##TokenName
+#define _PCD_GET_MODE_32_PcdMaximumUnicodeStringLength  ((UINT32)1000000)
+
+/******************************************************************************/
+/*  Device paths                                                              */
+/******************************************************************************/
+
+typedef struct {
+    UINT8   Type;
+    UINT8   SubType;
+    UINT8   Length[2];
+} EFI_DEVICE_PATH_PROTOCOL;
+
+#define MEDIA_DEVICE_PATH           0x04
+#define MEDIA_HARDDRIVE_DP          0x01
+#define MEDIA_FILEPATH_DP           0x04
+#define END_DEVICE_PATH_TYPE        0x7f
+#define END_ENTIRE_DEVICE_PATH_SUBTYPE  0xFF
+
+typedef struct {
+    EFI_DEVICE_PATH_PROTOCOL    Header;
+    CHAR16                      PathName[1];
+} FILEPATH_DEVICE_PATH;
+
+#pragma pack(1)
+typedef struct {
+    EFI_DEVICE_PATH_PROTOCOL    Header;
+    UINT32                      PartitionNumber;
+    UINT64                      PartitionStart;
+    UINT64                      PartitionSize;
+    UINT8                       Signature[16];
+    UINT8                       MBRType;
+    UINT8                       SignatureType;
+} HARDDRIVE_DEVICE_PATH;
+#pragma pack()
+
+UINT8   EFIAPI DevicePathType(IN CONST VOID *Node);
+UINT8   EFIAPI DevicePathSubType(IN CONST VOID *Node);
+UINTN   EFIAPI DevicePathNodeLength(IN CONST VOID *Node);
+EFI_DEVICE_PATH_PROTOCOL* EFIAPI NextDevicePathNode(IN CONST VOID *Node);
+BOOLEAN EFIAPI IsDevicePathEnd(IN CONST VOID *Node);
+
+EFI_DEVICE_PATH_PROTOCOL* EFIAPI FileDevicePath(IN EFI_HANDLE Device OPTIONAL,
+                                                IN CONST CHAR16 *FileName);
+CHAR16* EFIAPI ConvertDevicePathToText( IN CONST EFI_DEVICE_PATH_PROTOCOL *DP,
+                                        IN BOOLEAN DisplayOnly,
+                                        IN BOOLEAN AllowShortcuts);
+
+/******************************************************************************/
+/*  File protocol                                                             */
+/******************************************************************************/
+
+#define EFI_FILE_MODE_READ      0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE     0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE    0x8000000000000000ULL
+
+#define EFI_FILE_READ_ONLY      0x0000000000000001ULL
+#define EFI_FILE_HIDDEN         0x0000000000000002ULL
+#define EFI_FILE_SYSTEM         0x0000000000000004ULL
+#define EFI_FILE_RESERVED       0x0000000000000008ULL
+#define EFI_FILE_DIRECTORY      0x0000000000000010ULL
+#define EFI_FILE_ARCHIVE        0x0000000000000020ULL
+#define EFI_FILE_VALID_ATTR     0x0000000000000037ULL
+
+typedef struct {
+    UINT64      Size;
+    UINT64      FileSize;
+    UINT64      PhysicalSize;
+    EFI_TIME    CreateTime;
+    EFI_TIME    LastAccessTime;
+    EFI_TIME    ModificationTime;
+    UINT64      Attribute;
+    CHAR16      FileName[1];
+} EFI_FILE_INFO;
+
+#define SIZE_OF_EFI_FILE_INFO   OFFSET_OF(EFI_FILE_INFO, FileName)
+
+typedef struct _EFI_FILE_PROTOCOL EFI_FILE_PROTOCOL;
+typedef EFI_FILE_PROTOCOL *EFI_FILE_HANDLE;
+
+struct _EFI_FILE_PROTOCOL {
+    UINT64  Revision;
+    EFI_STATUS (EFIAPI *Open)(  IN  EFI_FILE_PROTOCOL   *This,
+                                OUT EFI_FILE_PROTOCOL   **NewHandle,
+                                IN  CHAR16              *FileName,
+                                IN  UINT64              OpenMode,
+                                IN  UINT64              Attributes);
+    EFI_STATUS (EFIAPI *Close)( IN  EFI_FILE_PROTOCOL   *This);
+    EFI_STATUS (EFIAPI *Delete)(IN  EFI_FILE_PROTOCOL   *This);
+    EFI_STATUS (EFIAPI *Read)(  IN  EFI_FILE_PROTOCOL   *This,
+                                IN OUT UINTN            *BufferSize,
+                                OUT VOID                *Buffer);
+    EFI_STATUS (EFIAPI *Write)( IN  EFI_FILE_PROTOCOL   *This,
+                                IN OUT UINTN            *BufferSize,
+                                IN  VOID                *Buffer);
+    EFI_STATUS (EFIAPI *GetPosition)(   IN  EFI_FILE_PROTOCOL   *This,
+                                        OUT UINT64              *Position);
+    EFI_STATUS (EFIAPI *SetPosition)(   IN  EFI_FILE_PROTOCOL   *This,
+                                        IN  UINT64              Position);
+    EFI_STATUS (EFIAPI *GetInfo)(   IN  EFI_FILE_PROTOCOL   *This,
+                                    IN  EFI_GUID            *InformationType,
+                                    IN OUT UINTN            *BufferSize,
+                                    OUT VOID                *Buffer);
+    EFI_STATUS (EFIAPI *SetInfo)(   IN  EFI_FILE_PROTOCOL   *This,
+                                    IN  EFI_GUID            *InformationType,
+                                    IN  UINTN               BufferSize,
+                                    IN  VOID                *Buffer);
+    EFI_STATUS (EFIAPI *Flush)( IN  EFI_FILE_PROTOCOL   *This);
+};
+
+typedef struct _EFI_SIMPLE_FILE_SYSTEM_PROTOCOL EFI_SIMPLE_FILE_SYSTEM_PROTOCOL;
+struct _EFI_SIMPLE_FILE_SYSTEM_PROTOCOL {
+    UINT64  Revision;
+    EFI_STATUS (EFIAPI *OpenVolume)(IN  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *This,
+                                    OUT EFI_FILE_PROTOCOL               **Root);
+};
+
+/******************************************************************************/
+/*  Block I/O protocol                                                        */
+/******************************************************************************/
+
+typedef struct {
+    UINT32  MediaId;
+    BOOLEAN RemovableMedia;
+    BOOLEAN MediaPresent;
+    BOOLEAN LogicalPartition;
+    BOOLEAN ReadOnly;
+    BOOLEAN WriteCaching;
+    UINT32  BlockSize;
+    UINT32  IoAlign;
+    EFI_LBA LastBlock;
+} EFI_BLOCK_IO_MEDIA;
+
+typedef struct _EFI_BLOCK_IO_PROTOCOL EFI_BLOCK_IO_PROTOCOL;
+struct _EFI_BLOCK_IO_PROTOCOL {
+    UINT64              Revision;
+    EFI_BLOCK_IO_MEDIA  *Media;
+    EFI_STATUS (EFIAPI *Reset)( IN  EFI_BLOCK_IO_PROTOCOL   *This,
+                                IN  BOOLEAN                 Extended);
+    EFI_STATUS (EFIAPI *ReadBlocks)(IN  EFI_BLOCK_IO_PROTOCOL   *This,
+                                    IN  UINT32                  MediaId,
+                                    IN  EFI_LBA                 Lba,
+                                    IN  UINTN                   BufferSize,
+                                    OUT VOID                    *Buffer);
+    EFI_STATUS (EFIAPI *WriteBlocks)(   IN  EFI_BLOCK_IO_PROTOCOL   *This,
+                                        IN  UINT32                  MediaId,
+                                        IN  EFI_LBA                 Lba,
+                                        IN  UINTN                   BufferSize,
+                                        IN  VOID                    *Buffer);
+    EFI_STATUS (EFIAPI *FlushBlocks)(IN EFI_BLOCK_IO_PROTOCOL *This);
+};
+
+/******************************************************************************/
+/*  Loaded-image protocol                                                     */
+/******************************************************************************/
+
+typedef struct _EFI_SYSTEM_TABLE EFI_SYSTEM_TABLE;
+
+typedef enum {
+    EfiReservedMemoryType,
+    EfiLoaderCode,
+    EfiLoaderData,
+    EfiBootServicesCode,
+    EfiBootServicesData,
+    EfiRuntimeServicesCode,
+    EfiRuntimeServicesData,
+    EfiMaxMemoryType
+} EFI_MEMORY_TYPE;
+
+typedef struct {
+    UINT32                      Revision;
+    EFI_HANDLE                  ParentHandle;
+    EFI_SYSTEM_TABLE            *SystemTable;
+    EFI_HANDLE                  DeviceHandle;
+    EFI_DEVICE_PATH_PROTOCOL    *FilePath;
+    VOID                        *Reserved;
+    UINT32                      LoadOptionsSize;
+    VOID                        *LoadOptions;
+    VOID                        *ImageBase;
+    UINT64                      ImageSize;
+    EFI_MEMORY_TYPE             ImageCodeType;
+    EFI_MEMORY_TYPE             ImageDataType;
+    EFI_STATUS (EFIAPI *Unload)(IN EFI_HANDLE ImageHandle);
+} EFI_LOADED_IMAGE_PROTOCOL;
+
+/******************************************************************************/
+/*  PE/COFF image headers                                                     */
+/******************************************************************************/
+
+#define EFI_IMAGE_DOS_SIGNATURE     0x5A4D      /* "MZ" */
+#define EFI_IMAGE_NT_SIGNATURE      0x00004550  /* "PE\0\0" */
+#define EFI_IMAGE_SIZEOF_SHORT_NAME 8
+
+typedef struct {
+    UINT16  e_magic;
+    UINT16  e_cblp;
+    UINT16  e_cp;
+    UINT16  e_crlc;
+    UINT16  e_cparhdr;
+    UINT16  e_minalloc;
+    UINT16  e_maxalloc;
+    UINT16  e_ss;
+    UINT16  e_sp;
+    UINT16  e_csum;
+    UINT16  e_ip;
+    UINT16  e_cs;
+    UINT16  e_lfarlc;
+    UINT16  e_ovno;
+    UINT16  e_res[4];
+    UINT16  e_oemid;
+    UINT16  e_oeminfo;
+    UINT16  e_res2[10];
+    UINT32  e_lfanew;
+} EFI_IMAGE_DOS_HEADER;
+
+typedef struct {
+    UINT16  Machine;
+    UINT16  NumberOfSections;
+    UINT32  TimeDateStamp;
+    UINT32  PointerToSymbolTable;
+    UINT32  NumberOfSymbols;
+    UINT16  SizeOfOptionalHeader;
+    UINT16  Characteristics;
+} EFI_IMAGE_FILE_HEADER;
+
+typedef struct {
+    UINT8   Name[EFI_IMAGE_SIZEOF_SHORT_NAME];
+    union {
+        UINT32  PhysicalAddress;
+        UINT32  VirtualSize;
+    } Misc;
+    UINT32  VirtualAddress;
+    UINT32  SizeOfRawData;
+    UINT32  PointerToRawData;
+    UINT32  PointerToRelocations;
+    UINT32  PointerToLinenumbers;
+    UINT16  NumberOfRelocations;
+    UINT16  NumberOfLinenumbers;
+    UINT32  Characteristics;
+} EFI_IMAGE_SECTION_HEADER;
+
+/******************************************************************************/
+/*  SMBIOS                                                                    */
+/******************************************************************************/
+
+typedef UINT8   SMBIOS_TABLE_STRING;
+typedef UINT8   SMBIOS_TYPE;
+typedef UINT16  SMBIOS_HANDLE;
+typedef SMBIOS_TYPE     EFI_SMBIOS_TYPE;
+typedef SMBIOS_HANDLE   EFI_SMBIOS_HANDLE;
+
+#define SMBIOS_HANDLE_PI_RESERVED       0xFFFE
+#define SMBIOS_TYPE_BIOS_INFORMATION    0
+#define SMBIOS_TABLE_MAX_LENGTH         0xFFFF
+#define SMBIOS_3_0_TABLE_MAX_LENGTH     0xFFFFFFFF
+
+#pragma pack(1)
+typedef struct {
+    SMBIOS_TYPE     Type;
+    UINT8           Length;
+    SMBIOS_HANDLE   Handle;
+} SMBIOS_STRUCTURE;
+
+typedef struct {
+    SMBIOS_STRUCTURE    Hdr;
+    SMBIOS_TABLE_STRING Vendor;
+    SMBIOS_TABLE_STRING BiosVersion;
+    UINT16              BiosSegment;
+    SMBIOS_TABLE_STRING BiosReleaseDate;
+    UINT8               BiosSize;
+} SMBIOS_TABLE_TYPE0;
+#pragma pack()
+
+typedef union {
+    SMBIOS_STRUCTURE    *Hdr;
+    SMBIOS_TABLE_TYPE0  *Type0;
+    UINT8               *Raw;
+} SMBIOS_STRUCTURE_POINTER;
+
+typedef SMBIOS_STRUCTURE EFI_SMBIOS_TABLE_HEADER;
+
+typedef struct _EFI_SMBIOS_PROTOCOL EFI_SMBIOS_PROTOCOL;
+struct _EFI_SMBIOS_PROTOCOL {
+    EFI_STATUS (EFIAPI *GetNext)(   IN  CONST EFI_SMBIOS_PROTOCOL   *This,
+                                    IN OUT EFI_SMBIOS_HANDLE        *Handle,
+                                    IN  EFI_SMBIOS_TYPE             *Type,
+                                    OUT EFI_SMBIOS_TABLE_HEADER     **Record,
+                                    OUT EFI_HANDLE                  *Producer);
+    UINT8   MajorVersion;
+    UINT8   MinorVersion;
+};
+
+/******************************************************************************/
+/*  Boot, runtime, and system tables                                          */
+/******************************************************************************/
+
+#define TPL_APPLICATION     4
+#define TPL_CALLBACK        8
+#define TPL_NOTIFY          16
+#define TPL_HIGH_LEVEL      31
+
+#define EVT_TIMER           0x80000000
+#define EVT_NOTIFY_SIGNAL   0x00000200
+
+typedef enum {
+    TimerCancel,
+    TimerPeriodic,
+    TimerRelative
+} EFI_TIMER_DELAY;
+
+typedef VOID (EFIAPI *EFI_EVENT_NOTIFY)(IN EFI_EVENT Event, IN VOID *Context);
+
+typedef enum {
+    EFI_NATIVE_INTERFACE
+} EFI_INTERFACE_TYPE;
+
+typedef enum {
+    AllHandles,
+    ByRegisterNotify,
+    ByProtocol
+} EFI_LOCATE_SEARCH_TYPE;
+
+typedef enum {
+    EfiResetCold,
+    EfiResetWarm,
+    EfiResetShutdown,
+    EfiResetPlatformSpecific
+} EFI_RESET_TYPE;
+
+#define EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL    0x00000001
+#define EFI_OPEN_PROTOCOL_GET_PROTOCOL          0x00000002
+
+typedef struct {
+    EFI_TPL (EFIAPI *RaiseTPL)(IN EFI_TPL NewTpl);
+    VOID (EFIAPI *RestoreTPL)(IN EFI_TPL OldTpl);
+    EFI_STATUS (EFIAPI *AllocatePool)(  IN  EFI_MEMORY_TYPE PoolType,
+                                        IN  UINTN           Size,
+                                        OUT VOID            **Buffer);
+    EFI_STATUS (EFIAPI *FreePool)(IN VOID *Buffer);
+    EFI_STATUS (EFIAPI *CreateEvent)(   IN  UINT32              Type,
+                                        IN  EFI_TPL             NotifyTpl,
+                                        IN  EFI_EVENT_NOTIFY    NotifyFunction,
+                                        IN  VOID                *NotifyContext,
+                                        OUT EFI_EVENT           *Event);
+    EFI_STATUS (EFIAPI *SetTimer)(  IN  EFI_EVENT       Event,
+                                    IN  EFI_TIMER_DELAY Type,
+                                    IN  UINT64          TriggerTime);
+    EFI_STATUS (EFIAPI *WaitForEvent)(  IN  UINTN       NumberOfEvents,
+                                        IN  EFI_EVENT   *Event,
+                                        OUT UINTN       *Index);
+    EFI_STATUS (EFIAPI *SignalEvent)(IN EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CloseEvent)(IN EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CheckEvent)(IN EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *InstallProtocolInterface)(
+                                    IN OUT EFI_HANDLE       *Handle,
+                                    IN  EFI_GUID            *Protocol,
+                                    IN  EFI_INTERFACE_TYPE  InterfaceType,
+                                    IN  VOID                *Interface);
+    EFI_STATUS (EFIAPI *UninstallProtocolInterface)(
+                                    IN  EFI_HANDLE          Handle,
+                                    IN  EFI_GUID            *Protocol,
+                                    IN  VOID                *Interface);
+    EFI_STATUS (EFIAPI *HandleProtocol)(IN  EFI_HANDLE  Handle,
+                                        IN  EFI_GUID    *Protocol,
+                                        OUT VOID        **Interface);
+    EFI_STATUS (EFIAPI *LoadImage)( IN  BOOLEAN                     BootPolicy,
+                                    IN  EFI_HANDLE                  ParentImageHandle,
+                                    IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath,
+                                    IN  VOID                        *SourceBuffer,
+                                    IN  UINTN                       SourceSize,
+                                    OUT EFI_HANDLE                  *ImageHandle);
+    EFI_STATUS (EFIAPI *StartImage)(IN  EFI_HANDLE  ImageHandle,
+                                    OUT UINTN       *ExitDataSize,
+                                    OUT CHAR16      **ExitData);
+    EFI_STATUS (EFIAPI *UnloadImage)(IN EFI_HANDLE ImageHandle);
+    EFI_STATUS (EFIAPI *Stall)(IN UINTN Microseconds);
+    EFI_STATUS (EFIAPI *OpenProtocol)(  IN  EFI_HANDLE  Handle,
+                                        IN  EFI_GUID    *Protocol,
+                                        OUT VOID        **Interface,
+                                        IN  EFI_HANDLE  AgentHandle,
+                                        IN  EFI_HANDLE  ControllerHandle,
+                                        IN  UINT32      Attributes);
+    EFI_STATUS (EFIAPI *CloseProtocol)( IN  EFI_HANDLE  Handle,
+                                        IN  EFI_GUID    *Protocol,
+                                        IN  EFI_HANDLE  AgentHandle,
+                                        IN  EFI_HANDLE  ControllerHandle);
+    EFI_STATUS (EFIAPI *LocateHandleBuffer)(
+                                    IN  EFI_LOCATE_SEARCH_TYPE  SearchType,
+                                    IN  EFI_GUID                *Protocol,
+                                    IN  VOID                    *SearchKey,
+                                    OUT UINTN                   *NoHandles,
+                                    OUT EFI_HANDLE              **Buffer);
+    EFI_STATUS (EFIAPI *LocateProtocol)(IN  EFI_GUID    *Protocol,
+                                        IN  VOID        *Registration,
+                                        OUT VOID        **Interface);
+} EFI_BOOT_SERVICES;
+
+typedef struct {
+    EFI_STATUS (EFIAPI *GetTime)(   OUT EFI_TIME                *Time,
+                                    OUT EFI_TIME_CAPABILITIES   *Capabilities);
+    EFI_STATUS (EFIAPI *GetVariable)(   IN  CHAR16      *VariableName,
+                                        IN  EFI_GUID    *VendorGuid,
+                                        OUT UINT32      *Attributes,
+                                        IN OUT UINTN    *DataSize,
+                                        OUT VOID        *Data);
+    EFI_STATUS (EFIAPI *SetVariable)(   IN  CHAR16      *VariableName,
+                                        IN  EFI_GUID    *VendorGuid,
+                                        IN  UINT32      Attributes,
+                                        IN  UINTN       DataSize,
+                                        IN  VOID        *Data);
+    VOID (EFIAPI *ResetSystem)( IN  EFI_RESET_TYPE  ResetType,
+                                IN  EFI_STATUS      ResetStatus,
+                                IN  UINTN           DataSize,
+                                IN  VOID            *ResetData);
+    EFI_STATUS (EFIAPI *QueryVariableInfo)(
+                                    IN  UINT32  Attributes,
+                                    OUT UINT64  *MaximumVariableStorageSize,
+                                    OUT UINT64  *RemainingVariableStorageSize,
+                                    OUT UINT64  *MaximumVariableSize);
+} EFI_RUNTIME_SERVICES;
+
+typedef struct {
+    VOID    *Reserved;
+} EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL;
+
+struct _EFI_SYSTEM_TABLE {
+    EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *ConOut;
+    EFI_RUNTIME_SERVICES            *RuntimeServices;
+    EFI_BOOT_SERVICES               *BootServices;
+};
+
+extern EFI_SYSTEM_TABLE     *gST;
+extern EFI_BOOT_SERVICES    *gBS;
+extern EFI_RUNTIME_SERVICES *gRT;
+extern EFI_HANDLE           gImageHandle;
+
+/******************************************************************************/
+/*  Variables and GUIDs                                                       */
+/******************************************************************************/
+
+#define EFI_VARIABLE_NON_VOLATILE                           0x00000001
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS                     0x00000002
+#define EFI_VARIABLE_RUNTIME_ACCESS                         0x00000004
+#define EFI_VARIABLE_HARDWARE_ERROR_RECORD                  0x00000008
+#define EFI_VARIABLE_AUTHENTICATED_WRITE_ACCESS             0x00000010
+#define EFI_VARIABLE_TIME_BASED_AUTHENTICATED_WRITE_ACCESS  0x00000020
+#define EFI_VARIABLE_APPEND_WRITE                           0x00000040
+
+#define EFI_PLATFORM_KEY_NAME           L"PK"
+#define EFI_KEY_EXCHANGE_KEY_NAME       L"KEK"
+#define EFI_IMAGE_SECURITY_DATABASE     L"db"
+#define EFI_IMAGE_SECURITY_DATABASE1    L"dbx"
+#define EFI_SETUP_MODE_NAME             L"SetupMode"
+#define EFI_SECURE_BOOT_MODE_NAME       L"SecureBoot"
+
+extern EFI_GUID gEfiLoadedImageProtocolGuid;
+extern EFI_GUID gEfiDevicePathProtocolGuid;
+extern EFI_GUID gEfiSimpleFileSystemProtocolGuid;
+extern EFI_GUID gEfiBlockIoProtocolGuid;
+extern EFI_GUID gEfiUnicodeCollationProtocolGuid;
+extern EFI_GUID gEfiUnicodeCollation2ProtocolGuid;
+extern EFI_GUID gEfiSmbiosProtocolGuid;
+extern EFI_GUID gEfiFileInfoGuid;
+extern EFI_GUID gEfiGlobalVariableGuid;
+extern EFI_GUID gEfiImageSecurityDatabaseGuid;
+
+BOOLEAN EFIAPI CompareGuid(IN CONST EFI_GUID *Guid1, IN CONST EFI_GUID *Guid2);
+
+#endif
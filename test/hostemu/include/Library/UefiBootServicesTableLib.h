@@ -0,0 +1,2 @@
+/* Library/UefiBootServicesTableLib.h - Forwarding header for the host UEFI emulation. See HostEmu.h */
+#include "HostEmu.h"
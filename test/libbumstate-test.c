@@ -0,0 +1,174 @@
+/* libbumstate-test.c - Tests for libbumstate.
+ *
+ *      libbumstate-test <initialized state directory> <bumstate binary>
+ *          Changes the state with the bumstate tool and checks that one open
+ *          context reports each change, and that its report is the record
+ *          printed by "bumstate print --format=binary".
+ *
+ *      libbumstate-test bench <state directory>
+ *          Reports the time of a cached query.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "libbumstate.h"
+
+#define BENCH_ITERATIONS    (1000000)
+
+static const char *usage = "<state directory> <bumstate binary> | "\
+                            "bench <state directory>";
+
+/*  Each step changes the state with the bumstate tool and then checks what
+    one long-lived context reports, so the cache must notice every change.
+    A NULL non-current config means the query must fail. */
+static const struct {
+    const char *operation;
+    const char *currconfig;
+    const char *noncurrconfig;
+    const char *bootstatus;
+} steps[] = {
+    { "print",                  "sda2", NULL,   "BOOTFAILURE"   },
+    { "update-start",           "sda2", NULL,   "BOOTFAILURE"   },
+    { "update-complete 3 sda3", "sda2", "sda3", "UPDATEFAILURE" },
+    { "boottime-test",          "sda3", "sda2", "UPDATESUCCESS" },
+    { "runtime-init",           "sda3", "sda2", "BOOTSUCCESS"   },
+    { "boottime-test",          "sda3", "sda2", "BOOTSUCCESS"   },
+    { "boottime-test",          "sda3", "sda2", "BOOTSUCCESS"   },
+    { "boottime-test",          "sda3", "sda2", "BOOTSUCCESS"   },
+    { "boottime-test",          "sda2", "sda3", "BOOTFAILURE"   },
+    { "update-complete 2 sda4", "sda2", "sda4", "UPDATEFAILURE" },
+};
+
+static int Check(   bumstate_t  *ctx,
+                    const char  *currconfig,
+                    const char  *noncurrconfig,
+                    const char  *bootstatus)
+{
+    char config[LIBBUMSTATE_CONFIG_MAXLEN];
+    const char *status;
+    int ret = 0;
+    if( (0 != bumstate_currconfig(ctx, config, sizeof(config))) ||
+        (0 != strcmp(config, currconfig)) ){
+        fprintf(stderr, "    current config mismatch\n");
+        ret = -1;
+    }
+    if(NULL == noncurrconfig){
+        if(0 == bumstate_noncurrconfig(ctx, config, sizeof(config))){
+            fprintf(stderr, "    invalid non-current config returned\n");
+            ret = -1;
+        }
+    }else if(   (0 != bumstate_noncurrconfig(ctx, config, sizeof(config))) ||
+                (0 != strcmp(config, noncurrconfig)) ){
+        fprintf(stderr, "    non-current config mismatch\n");
+        ret = -1;
+    }
+    status = bumstate_bootstatus(ctx);
+    if( (NULL == status) || (0 != strcmp(status, bootstatus)) ){
+        fprintf(stderr, "    boot status mismatch\n");
+        ret = -1;
+    }
+    return ret;
+}
+
+static int CheckReport( bumstate_t  *ctx,
+                        char        *statedir,
+                        char        *bumstate)
+{
+    bumstate_report_t report, printed;
+    char command[1024];
+    FILE *tool;
+    size_t n;
+    snprintf(command, sizeof(command), "%s print %s --format=binary",
+                bumstate, statedir);
+    tool = popen(command, "r");
+    if(NULL == tool)
+        return -1;
+    n = fread(&printed, sizeof(printed), 1, tool);
+    if( (0 != pclose(tool)) || (1 != n) ||
+        (0 != bumstate_report(ctx, &report)) ||
+        (LIBBUMSTATE_REPORT_MAGIC != report.magic) ||
+        (0 != memcmp(&report, &printed, sizeof(report))) ){
+        fprintf(stderr, "    report mismatch\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int Sequence(char *statedir, char *bumstate)
+{
+    bumstate_t *ctx;
+    char command[1024], small[2];
+    size_t i;
+    int ret = 0;
+    ctx = bumstate_open(statedir);
+    if(NULL == ctx){
+        fprintf(stderr, "    bumstate_open failed\n");
+        return -1;
+    }
+    for(i = 0; i < sizeof(steps)/sizeof(steps[0]); i++){
+        snprintf(command, sizeof(command), "%s batch %s \"%s\" > /dev/null",
+                    bumstate, statedir, steps[i].operation);
+        if(0 != system(command)){
+            fprintf(stderr, "    step %zu: \"%s\" failed\n",
+                    i, steps[i].operation);
+            ret = -1;
+            break;
+        }
+        /*  Twice: the second answer comes from the cache */
+        if( (0 != Check(ctx, steps[i].currconfig, steps[i].noncurrconfig,
+                        steps[i].bootstatus)) ||
+            (0 != Check(ctx, steps[i].currconfig, steps[i].noncurrconfig,
+                        steps[i].bootstatus)) ||
+            (0 != CheckReport(ctx, statedir, bumstate)) ){
+            fprintf(stderr, "    step %zu: \"%s\" mismatch\n",
+                    i, steps[i].operation);
+            ret = -1;
+        }
+    }
+    /*  Buffers that are too small are refused */
+    if(0 == bumstate_currconfig(ctx, small, sizeof(small))){
+        fprintf(stderr, "    short buffer accepted\n");
+        ret = -1;
+    }
+    if(0 == ret)
+        printf("%zu step(s) checked\n", i);
+    bumstate_close(ctx);
+    return ret;
+}
+
+static int Bench(char *statedir)
+{
+    bumstate_t *ctx;
+    char config[LIBBUMSTATE_CONFIG_MAXLEN];
+    struct timespec start, stop;
+    int i, ret = 0;
+    ctx = bumstate_open(statedir);
+    if(NULL == ctx)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; (i < BENCH_ITERATIONS) && (0 == ret); i++)
+        ret = bumstate_currconfig(ctx, config, sizeof(config));
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    if(0 == ret)
+        printf("cached bumstate_currconfig: %.1f ns\n",
+                ((stop.tv_sec - start.tv_sec) * 1e9 +
+                    (stop.tv_nsec - start.tv_nsec)) / BENCH_ITERATIONS);
+    bumstate_close(ctx);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int ret;
+    if( (argc == 3) && (0 == strcmp(argv[1], "bench")) )
+        ret = Bench(argv[2]);
+    else if(argc == 3)
+        ret = Sequence(argv[1], argv[2]);
+    else{
+        fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
+        ret = -1;
+    }
+    return ret;
+}
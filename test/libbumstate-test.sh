@@ -0,0 +1,41 @@
+#!/bin/bash
+#
+# Builds libbumstate and the bumstate tool, links test/libbumstate-test.c
+# against the shared library, checks that a long-lived context follows every
+# state change made by the tool, and reports the cost of a cached query.
+#
+# Run from the top of the repository.
+
+set -o errexit
+set -o nounset
+set -o pipefail
+
+LIBOUT=test/libbin
+LIBDIR=${LIBOUT}/amd64
+STATEDIR=test/libstatedir
+BIN=test/libbumstate-test
+
+make -s -f build/Makefile.gcc output_directory=${LIBOUT} ARCH=amd64 \
+    ${LIBDIR}/bumstate lib
+
+# Only the functions of libbumstate.h are exported
+exported=$(nm -D --defined-only ${LIBDIR}/libbumstate.so | \
+            awk '$2 == "T" { print $3 }' | sort | tr '\n' ' ')
+expected="bumstate_bootstatus bumstate_close bumstate_currconfig \
+bumstate_noncurrconfig bumstate_open bumstate_refresh bumstate_report "
+if [ "${exported}" != "${expected}" ]; then
+    echo "FAIL: exported symbols: ${exported}"
+    exit 1
+fi
+
+gcc -Wall -O2 -I ${LIBDIR} -o ${BIN} test/libbumstate-test.c \
+    -L ${LIBDIR} -lbumstate -Wl,-rpath,${PWD}/${LIBDIR}
+
+rm -rf ${STATEDIR}
+mkdir ${STATEDIR}
+export BUMSTATE_NO_FSYNC=1
+${LIBDIR}/bumstate init ${STATEDIR} sda2
+${BIN} ${STATEDIR} ${LIBDIR}/bumstate
+${BIN} bench ${STATEDIR}
+
+rm -rf ${STATEDIR} ${LIBOUT} ${BIN}
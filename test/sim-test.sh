@@ -0,0 +1,32 @@
+#!/bin/bash
+#
+# Runs the bumstate-sim boot loop with a few seeds and fails on any invariant
+# violation of the A/B state machine. The first seed is also run on the UEFI
+# variable and block backends, to compare them with the state directory.
+#
+# Run from the top of the repository.
+
+set -o errexit
+set -o nounset
+set -o pipefail
+
+SIMOUT=test/simbin
+SIMBIN=${SIMOUT}/amd64
+BOOTS=100000
+
+make -s -f build/Makefile.gcc output_directory=${SIMOUT} ARCH=amd64 \
+    ${SIMBIN}/bumstate-sim
+
+# The rate is that of the file system: use a tmpfs when there is one
+STATEDIR=$(mktemp -d /dev/shm/bum-simstate.XXXXXX 2> /dev/null || \
+            mktemp -d -p test bum-simstate.XXXXXX)
+export BUMSTATE_NO_FSYNC=1
+for seed in 1 2 3; do
+    ${SIMBIN}/bumstate-sim ${STATEDIR} ${BOOTS} ${seed}
+done
+mkdir ${STATEDIR}/efivars
+${SIMBIN}/bumstate-sim var:${STATEDIR}/efivars ${BOOTS} 1
+touch ${STATEDIR}/state.img
+${SIMBIN}/bumstate-sim blk:${STATEDIR}/state.img ${BOOTS} 1
+
+rm -rf ${STATEDIR} ${SIMOUT}
@@ -0,0 +1,347 @@
+/* state-check.c - Integrity-check tests for the BUM state files.
+ *
+ *      state-check fuzz <corpus directory>
+ *          Writes a corpus of corrupted version 1 state files (every single
+ *          bit flip, swapped words, truncations, and torn writes mixing an old
+ *          and a new state) and checks that BUMState_Check rejects every one.
+ *          Also checks that valid version 0 and version 1 files are accepted,
+ *          that a version 0 state is written back as version 0, that the
+ *          CRC32C implementations agree, and that a corrupted or torn journal
+ *          record is never applied.
+ *
+ *      state-check bench <scratch directory>
+ *          Reports the time BUMState_Check takes on a BUM_state_t.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <uchar.h>
+#include "EFIGlue.h"
+#include "LibCommon.h"
+#include "BUMState.h"
+#include "Crc32c.h"
+
+#define BENCH_ITERATIONS    (1000000)
+
+static const char *usage = "fuzz <corpus directory> | "\
+                            "bench <scratch directory>";
+
+/*  Builds a valid state by writing it with BUMState_Init in a scratch
+    directory and reading it back, so the test does not depend on the
+    layout of the checksum. */
+static int State_Make(  char        *dir,
+                        char        *config,
+                        BUM_state_t *state_p)
+{
+    BUM_state_t *read_p;
+    if(EFI_ERROR(BUMState_Init(dir, config)))
+        return -1;
+    if(EFI_ERROR(BUMState_Get(dir, &read_p)))
+        return -1;
+    memcpy(state_p, read_p, sizeof(*state_p));
+    BUMState_Free(read_p);
+    return 0;
+}
+
+/*  Commits an update to the state in dir and returns the new state */
+static int State_Update(char        *dir,
+                        BUM_state_t *state_p)
+{
+    BUM_state_handle_t handle;
+    if(EFI_ERROR(BUMState_Open(dir, &handle)))
+        return -1;
+    BUMStateNext_CompleteUpdate(handle.State, 3, "sda3");
+    if(EFI_ERROR(BUMState_Commit(&handle))){
+        BUMState_Close(&handle);
+        return -1;
+    }
+    memcpy(state_p, handle.State, sizeof(*state_p));
+    BUMState_Close(&handle);
+    return 0;
+}
+
+/*  Version 0 state: the UINT64 words add up to zero */
+static void State_MakeV0(BUM_state_t *state_p)
+{
+    uint64_t *words = (uint64_t*)state_p, sum = 0;
+    size_t i;
+    state_p->Version = 0;
+    state_p->Checksum = 0;
+    for(i = 0; i < sizeof(*state_p) / sizeof(uint64_t); i++)
+        sum += words[i];
+    state_p->Checksum = -sum;
+}
+
+static int corpus_count = 0;
+static int corpus_failures = 0;
+
+/*  Writes one corpus file and checks that it is rejected */
+static void Corpus_Add( char        *dir,
+                        const char  *kind,
+                        void        *buffer,
+                        size_t      size)
+{
+    char name[64];
+    void *copy;
+    UINTN copysize;
+    snprintf(name, sizeof(name), "%05d-%s.state", corpus_count++, kind);
+    if(EFI_ERROR(Common_CreateWriteCloseDirFile(dir, name, buffer, size))){
+        fprintf(stderr, "    %s: write failed\n", name);
+        corpus_failures++;
+        return;
+    }
+    /*  Check the file as read back, like BUMState_Get does */
+    if(EFI_ERROR(Common_OpenReadCloseDirFile(dir, name, &copy, &copysize))){
+        /*  An empty file can not be read, which is a rejection too */
+        return;
+    }
+    if(!EFI_ERROR(BUMState_Check((BUM_state_t*)copy, copysize))){
+        fprintf(stderr, "    %s: accepted\n", name);
+        corpus_failures++;
+    }
+    Common_FreeReadBuffer(copy, copysize);
+}
+
+/*  Commits a boot attempt to the state in dir, which appends a journal
+    record, and returns the state read back */
+static int State_Boot(  char        *dir,
+                        BUM_state_t *state_p)
+{
+    BUM_state_handle_t handle;
+    if(EFI_ERROR(BUMState_Open(dir, &handle)))
+        return -1;
+    BUMStateNext_BootTime(handle.State);
+    if( !BUMState_CommitAppends(&handle) ||
+        EFI_ERROR(BUMState_Commit(&handle)) ){
+        BUMState_Close(&handle);
+        return -1;
+    }
+    BUMState_Close(&handle);
+    return EFI_ERROR(BUMState_GetCopy(dir, state_p))? -1 : 0;
+}
+
+/*  Writes a journal and checks that the state read back is expected_p */
+static int Journal_Try( char        *dir,
+                        void        *journal,
+                        size_t      size,
+                        BUM_state_t *expected_p)
+{
+    BUM_state_t state;
+    if( EFI_ERROR(Common_CreateWriteCloseDirFile(   dir, JSTATE_FILENAME,
+                                                    journal, size)) ||
+        EFI_ERROR(BUMState_GetCopy(dir, &state)) )
+        return -1;
+    return (0 == memcmp(&state, expected_p, sizeof(state)))? 0 : -1;
+}
+
+/*  Every single-bit flip and truncation of the last of two journal records
+    must leave the state the first one made */
+static int Journal_Fuzz(char *dir)
+{
+    BUM_state_t state, before, after;
+    uint8_t journal[2 * sizeof(BUM_state_record_t)], work[sizeof(journal)];
+    void *buffer;
+    UINTN size;
+    size_t i;
+    int count = 0, failures = 0;
+    if( (0 != State_Make(dir, "sda2", &state)) ||
+        (0 != State_Update(dir, &state)) ||
+        (0 != State_Boot(dir, &before)) ||
+        (0 != State_Boot(dir, &after)) ){
+        fprintf(stderr, "    journal setup failed\n");
+        return -1;
+    }
+    if( EFI_ERROR(Common_OpenReadCloseDirFile(  dir, JSTATE_FILENAME,
+                                                &buffer, &size)) ){
+        fprintf(stderr, "    journal not written\n");
+        return -1;
+    }
+    if(sizeof(journal) != size){
+        fprintf(stderr, "    journal of %zu byte(s)\n", (size_t)size);
+        Common_FreeReadBuffer(buffer, size);
+        return -1;
+    }
+    memcpy(journal, buffer, sizeof(journal));
+    Common_FreeReadBuffer(buffer, size);
+    for(i = sizeof(BUM_state_record_t) * 8; i < sizeof(journal) * 8; i++){
+        memcpy(work, journal, sizeof(work));
+        work[i / 8] ^= (uint8_t)(1 << (i % 8));
+        count++;
+        if(0 != Journal_Try(dir, work, sizeof(work), &before)){
+            fprintf(stderr, "    journal bit %zu: applied\n", i);
+            failures++;
+        }
+    }
+    for(i = sizeof(BUM_state_record_t); i < sizeof(journal); i++){
+        count++;
+        if(0 != Journal_Try(dir, journal, i, &before)){
+            fprintf(stderr, "    journal of %zu byte(s): applied\n", i);
+            failures++;
+        }
+    }
+    if(0 != Journal_Try(dir, journal, sizeof(journal), &after)){
+        fprintf(stderr, "    valid journal not applied\n");
+        failures++;
+    }
+    printf("%d corrupted journal record(s), %d applied\n", count, failures);
+    return (0 == failures)? 0 : -1;
+}
+
+static int Fuzz(char *dir)
+{
+    BUM_state_t oldstate, newstate, v0state, work;
+    uint8_t *bytes = (uint8_t*)&work, buffer[2 * sizeof(work)];
+    uint64_t *words = (uint64_t*)&work, tmp;
+    size_t i, j, nwords = sizeof(work) / sizeof(uint64_t);
+    uint8_t random[4096];
+    int ret = 0;
+
+    /*  The SSE4.2 and table-driven CRC32C must agree with each other and
+        with the standard check value */
+    if(0xE3069283 != Common_Crc32c("123456789", 9)){
+        fprintf(stderr, "    CRC32C check value mismatch\n");
+        ret = -1;
+    }
+    srand(1);
+    for(i = 0; i < sizeof(random); i++)
+        random[i] = (uint8_t)rand();
+    for(i = 0; i < sizeof(random); i += 61){
+        if(Common_Crc32c(random, i) != Crc32c_update(0, random, i)){
+            fprintf(stderr, "    CRC32C mismatch for length %zu\n", i);
+            ret = -1;
+        }
+    }
+    /*  An old and a new state as written around an update */
+    if(0 != State_Make(dir, "sda2", &oldstate)){
+        fprintf(stderr, "    State_Make failed\n");
+        return -1;
+    }
+    if(0 != State_Update(dir, &newstate)){
+        fprintf(stderr, "    State_Update failed\n");
+        return -1;
+    }
+    if( (1 != oldstate.Version) || (1 != newstate.Version) ||
+        EFI_ERROR(BUMState_Check(&oldstate, sizeof(oldstate))) ||
+        EFI_ERROR(BUMState_Check(&newstate, sizeof(newstate))) ){
+        fprintf(stderr, "    valid version 1 state rejected\n");
+        ret = -1;
+    }
+    /*  Version 0 files are still accepted */
+    v0state = oldstate;
+    State_MakeV0(&v0state);
+    if(EFI_ERROR(BUMState_Check(&v0state, sizeof(v0state)))){
+        fprintf(stderr, "    valid version 0 state rejected\n");
+        ret = -1;
+    }
+    /*  A version 0 state is written back as version 0, which a root BUM
+        older than version 1 still reads */
+    work = oldstate;
+    State_MakeV0(&work);
+    if( (0 != State_Make(dir, "sda2", &oldstate)) ||
+        EFI_ERROR(Common_CreateWriteCloseDirFile(dir, ASTATE_FILENAME,
+                                                &work, sizeof(work))) ||
+        (0 != State_Update(dir, &work)) ||
+        (0 != work.Version) ||
+        EFI_ERROR(BUMState_Check(&work, sizeof(work))) ){
+        fprintf(stderr, "    version 0 state not written as version 0\n");
+        ret = -1;
+    }
+    /*  Every single-bit flip */
+    for(i = 0; i < sizeof(work) * 8; i++){
+        work = oldstate;
+        bytes[i / 8] ^= (uint8_t)(1 << (i % 8));
+        Corpus_Add(dir, "bitflip", &work, sizeof(work));
+    }
+    /*  Swapped words, which the additive sum of version 0 can not detect */
+    for(i = 0; i < nwords; i++){
+        for(j = i + 1; j < nwords; j++){
+            work = newstate;
+            if(words[i] == words[j])
+                continue;
+            tmp = words[i];
+            words[i] = words[j];
+            words[j] = tmp;
+            Corpus_Add(dir, "swap", &work, sizeof(work));
+        }
+    }
+    /*  Truncated and extended files */
+    for(i = 0; i < sizeof(work); i += 8)
+        Corpus_Add(dir, "truncated", &oldstate, i);
+    memcpy(buffer, &oldstate, sizeof(oldstate));
+    memset(buffer + sizeof(oldstate), 0, sizeof(oldstate));
+    Corpus_Add(dir, "extended", buffer, sizeof(oldstate) + 8);
+    /*  Torn writes: the start of the new state over the old one, at every
+        word boundary */
+    for(i = 8; i < sizeof(work); i += 8){
+        work = oldstate;
+        memcpy(&work, &newstate, i);
+        if(0 == memcmp(&work, &oldstate, sizeof(work)))
+            continue;
+        Corpus_Add(dir, "torn", &work, sizeof(work));
+    }
+    printf("%d corrupted state file(s), %d accepted\n",
+            corpus_count, corpus_failures);
+    if(0 != corpus_failures)
+        ret = -1;
+    if(0 != Journal_Fuzz(dir))
+        ret = -1;
+    return ret;
+}
+
+static double Bench_Run(BUM_state_t *state_p)
+{
+    struct timespec start, stop;
+    volatile EFI_STATUS result = EFI_SUCCESS;
+    int i;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < BENCH_ITERATIONS; i++)
+        result |= BUMState_Check(state_p, sizeof(*state_p));
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    if(EFI_ERROR(result))
+        return -1.0;
+    return ((stop.tv_sec - start.tv_sec) * 1e9 +
+            (stop.tv_nsec - start.tv_nsec)) / BENCH_ITERATIONS;
+}
+
+static int Bench(char *dir)
+{
+    BUM_state_t state, v0state;
+    uint8_t *bytes = (uint8_t*)&state;
+    struct timespec start, stop;
+    volatile UINT32 crc = 0;
+    int i;
+    if(0 != State_Make(dir, "sda2", &state))
+        return -1;
+    v0state = state;
+    State_MakeV0(&v0state);
+    printf("BUM_state_t:                %zu bytes\n", sizeof(state));
+    printf("version 1 (CRC32C) check:   %.1f ns\n", Bench_Run(&state));
+    printf("version 0 (sum) check:      %.1f ns\n", Bench_Run(&v0state));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < BENCH_ITERATIONS; i++)
+        crc ^= Crc32c_update(0, bytes, sizeof(state));
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("table-driven CRC32C:        %.1f ns\n",
+            ((stop.tv_sec - start.tv_sec) * 1e9 +
+                (stop.tv_nsec - start.tv_nsec)) / BENCH_ITERATIONS);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int ret;
+    if( (argc == 3) && (0 == strcmp(argv[1], "fuzz")) )
+        ret = Fuzz(argv[2]);
+    else if( (argc == 3) && (0 == strcmp(argv[1], "bench")) )
+        ret = Bench(argv[2]);
+    else{
+        fprintf(stderr, "Usage: %s %s\n", argv[0], usage);
+        ret = -1;
+    }
+    return ret;
+}
@@ -0,0 +1,26 @@
+#!/bin/bash
+#
+# Builds test/state-check.c against the user-space BUM-state code, runs the
+# corrupted-state corpus and the corrupted journal records through the
+# integrity check, and reports the cost of the check.
+#
+# Run from the top of the repository.
+
+set -o errexit
+set -o nounset
+set -o pipefail
+
+CORPUS=test/statecorpus
+BIN=test/state-check
+
+gcc -Wall -O2 -fshort-wchar -iquote src/utils -iquote src/common -o ${BIN} \
+    test/state-check.c src/common/BUMState.c src/utils/BUMStateBackend.c \
+    src/utils/LibCommon.c src/utils/EFIGlue.c
+
+rm -rf ${CORPUS}
+mkdir ${CORPUS}
+export BUMSTATE_NO_FSYNC=1
+${BIN} fuzz ${CORPUS}
+${BIN} bench ${CORPUS}
+
+rm -rf ${CORPUS} ${BIN}
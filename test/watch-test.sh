@@ -0,0 +1,79 @@
+#!/bin/bash
+#
+# Builds the bumstate tool, runs "bumstate watch" on a state directory while
+# the tool changes the state, and checks the transitions it reports in both
+# output formats.
+#
+# Run from the top of the repository.
+
+set -o errexit
+set -o nounset
+set -o pipefail
+
+WATCHOUT=test/watchbin
+WATCHBIN=${WATCHOUT}/amd64
+STATEDIR=$(mktemp -d /dev/shm/bum-watch.XXXXXX 2> /dev/null || \
+            mktemp -d -p test bum-watch.XXXXXX)
+OUT=${STATEDIR}.out
+
+make -s -f build/Makefile.gcc output_directory=${WATCHOUT} ARCH=amd64 \
+    ${WATCHBIN}/bumstate
+
+export BUMSTATE_NO_FSYNC=1
+
+# Starts the watcher in the background and waits for its inotify watch
+WatchStart() {
+    ${WATCHBIN}/bumstate watch ${STATEDIR} "$@" > ${OUT} &
+    WATCHPID=$!
+    until grep -qs "^inotify wd" /proc/${WATCHPID}/fdinfo/*; do
+        sleep 0.01
+    done
+}
+
+# Waits for the watcher to exit and expects its output to be exactly $1
+WatchCheck() {
+    local output
+    wait ${WATCHPID}
+    output=$(tr '\n' ',' < ${OUT})
+    if [ "${output}" != "$1" ]; then
+        echo "FAIL: expected \"$1\", got \"${output}\""
+        exit 1
+    fi
+}
+
+# A state created while watching, then an update that is tried and kept.
+# Operations that change nothing are not committed and not reported.
+WatchStart --count=7
+${WATCHBIN}/bumstate init ${STATEDIR} sda2 > /dev/null
+${WATCHBIN}/bumstate update-start ${STATEDIR} > /dev/null
+${WATCHBIN}/bumstate update-complete ${STATEDIR} 3 sda3 > /dev/null
+${WATCHBIN}/bumstate boottime-test ${STATEDIR} > /dev/null
+${WATCHBIN}/bumstate runtime-init ${STATEDIR} > /dev/null
+${WATCHBIN}/bumstate boottime-test ${STATEDIR} > /dev/null
+${WATCHBIN}/bumstate runtime-init ${STATEDIR} > /dev/null
+${WATCHBIN}/bumstate update-start ${STATEDIR} > /dev/null
+WatchCheck "INIT sda2,UPDATE_STAGED sda3 attempts=3,BOOT sda3 remaining=2,\
+RUNTIME_INIT UPDATESUCCESS,BOOT sda3 remaining=2,RUNTIME_INIT BOOTSUCCESS,\
+UPDATE_STARTED,"
+
+# An update that fails every attempt, then a new state, reported as JSON
+WatchStart --format=json --count=5
+${WATCHBIN}/bumstate update-complete ${STATEDIR} 1 sda4 > /dev/null
+${WATCHBIN}/bumstate boottime-test ${STATEDIR} > /dev/null
+${WATCHBIN}/bumstate boottime-test ${STATEDIR} > /dev/null
+${WATCHBIN}/bumstate runtime-init ${STATEDIR} > /dev/null
+${WATCHBIN}/bumstate init ${STATEDIR} sda2 > /dev/null
+WatchCheck "\
+{\"event\":\"UPDATE_STAGED\",\"counter\":8,\"config\":\"sda4\",\"attempts\":1},\
+{\"event\":\"BOOT\",\"counter\":9,\"config\":\"sda4\",\"remaining\":0},\
+{\"event\":\"BOOT_FALLBACK\",\"counter\":10,\"config\":\"sda3\"},\
+{\"event\":\"RUNTIME_INIT\",\"counter\":11,\"status\":\"UPDATEFAILURE\"},\
+{\"event\":\"INIT\",\"counter\":1,\"config\":\"sda2\"},"
+
+# The watcher stops when the directory goes away
+WatchStart
+rm -rf ${STATEDIR}
+WatchCheck ""
+
+echo "watched transitions checked"
+rm -rf ${OUT} ${WATCHOUT}